@@ -26,6 +26,10 @@ if(ENABLE_LIBJUSTIFY)
     include(CMake/thirdparty/SetupLibjustify.cmake)
 endif()
 
+if(ENABLE_ZSTD)
+    include(CMake/thirdparty/SetupZstd.cmake)
+endif()
+
 if(BUILD_DOCS)
     find_package(Doxygen)
     include(CMake/thirdparty/FindSphinx.cmake)
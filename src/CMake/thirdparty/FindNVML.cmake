@@ -3,8 +3,17 @@
 #
 # SPDX-License-Identifier: MIT
 
-# First check for user-specified NVML_DIR
-if(NVML_DIR)
+# Build against the stub library in tests/stubs, see ENABLE_GPU_STUBS
+if(ENABLE_GPU_STUBS)
+    set(NVML_FOUND TRUE CACHE INTERNAL "")
+    set(NVML_INCLUDE_DIRS ${PROJECT_SOURCE_DIR}/tests/stubs/include CACHE PATH "" FORCE)
+    set(NVML_LIBRARY nvidia-ml CACHE STRING "" FORCE)
+    include_directories(${NVML_INCLUDE_DIRS})
+
+    message(STATUS "Using NVML stub library")
+    message(STATUS " [*] NVML_INCLUDE_DIRS = ${NVML_INCLUDE_DIRS}")
+# Next check for user-specified NVML_DIR
+elseif(NVML_DIR)
     message(STATUS "Looking for NVML using NVML_DIR = ${NVML_DIR}")
 
     set(NVML_FOUND TRUE CACHE INTERNAL "")
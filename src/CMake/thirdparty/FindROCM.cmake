@@ -3,8 +3,17 @@
 #
 # SPDX-License-Identifier: MIT
 
-# First check for user-specified ROCM_DIR
-if(ROCM_DIR)
+# Build against the stub library in tests/stubs, see ENABLE_GPU_STUBS
+if(ENABLE_GPU_STUBS)
+    set(ROCM_FOUND TRUE CACHE INTERNAL "")
+    set(ROCM_INCLUDE_DIRS ${PROJECT_SOURCE_DIR}/tests/stubs/include CACHE PATH "" FORCE)
+    set(ROCM_LIBRARY rocm_smi64 CACHE STRING "" FORCE)
+    include_directories(${ROCM_INCLUDE_DIRS})
+
+    message(STATUS "Using ROCM SMI stub library")
+    message(STATUS " [*] ROCM_INCLUDE_DIRS = ${ROCM_INCLUDE_DIRS}")
+# Next check for user-specified ROCM_DIR
+elseif(ROCM_DIR)
     message(STATUS "Looking for ROCM using ROCM_DIR = ${ROCM_DIR}")
 
     set(ROCM_FOUND TRUE CACHE INTERNAL "")
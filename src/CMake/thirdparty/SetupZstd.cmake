@@ -0,0 +1,66 @@
+# Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+# Variorum Project Developers. See the top-level LICENSE file for details.
+#
+# SPDX-License-Identifier: MIT
+
+# First check for user-specified ZSTD_DIR
+if(ZSTD_DIR)
+    message(STATUS "Looking for zstd using ZSTD_DIR = ${ZSTD_DIR}")
+
+    find_path(ZSTD_INCLUDE_DIRS
+        NAMES zstd.h
+        HINTS ${ZSTD_DIR}/include/
+    )
+    if(NOT ZSTD_INCLUDE_DIRS)
+        MESSAGE(WARNING "Could not find zstd.h in ${ZSTD_DIR}/include")
+    endif()
+
+    find_library(ZSTD_LIBRARY
+        NAMES zstd
+        HINTS ${ZSTD_DIR}/lib/ ${ZSTD_DIR}/lib64/
+    )
+    if(NOT ZSTD_LIBRARY)
+        MESSAGE(WARNING "Could not find libzstd in ${ZSTD_DIR}/lib/")
+    endif()
+
+    set(ZSTD_FOUND TRUE CACHE INTERNAL "")
+    add_definitions(-DZSTD_FOUND)
+    set(ZSTD_DIR ${ZSTD_DIR} CACHE PATH "" FORCE)
+    include_directories(${ZSTD_INCLUDE_DIRS})
+
+    message(STATUS "FOUND zstd")
+    message(STATUS " [*] ZSTD_DIR = ${ZSTD_DIR}")
+    message(STATUS " [*] ZSTD_INCLUDE_DIRS = ${ZSTD_INCLUDE_DIRS}")
+    message(STATUS " [*] ZSTD_LIBRARY = ${ZSTD_LIBRARY}")
+
+# If ZSTD_DIR not specified, then try to automatically find the zstd header
+# and library
+elseif(NOT ZSTD_FOUND)
+    message(STATUS "Looking for zstd install on system")
+    find_path(ZSTD_INCLUDE_DIRS
+        NAMES zstd.h
+    )
+
+    find_library(ZSTD_LIBRARY
+        NAMES zstd
+    )
+
+    if(ZSTD_INCLUDE_DIRS AND ZSTD_LIBRARY)
+        set(ZSTD_FOUND TRUE CACHE INTERNAL "")
+        add_definitions(-DZSTD_FOUND)
+        set(ZSTD_DIR ${ZSTD_DIR} CACHE PATH "" FORCE)
+        set(ZSTD_INCLUDE_DIRS ${ZSTD_INCLUDE_DIRS} CACHE PATH "" FORCE)
+        set(ZSTD_LIBRARY ${ZSTD_LIBRARY} CACHE PATH "" FORCE)
+        include_directories(${ZSTD_INCLUDE_DIRS})
+
+        message(STATUS "FOUND zstd using find_library()")
+        message(STATUS " [*] ZSTD_FOUND = TRUE")
+        message(STATUS " [*] ZSTD_INCLUDE_DIRS = ${ZSTD_INCLUDE_DIRS}")
+        message(STATUS " [*] ZSTD_LIBRARY = ${ZSTD_LIBRARY}")
+    endif()
+endif()
+
+# Abort if all methods fail
+if(NOT ZSTD_FOUND)
+    message(FATAL_ERROR "zstd support needs explict ZSTD_DIR")
+endif()
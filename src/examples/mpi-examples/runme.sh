@@ -8,4 +8,13 @@ srun -N 2 -n 8 ./variorum-print-power-mpi-example
 # node will set a cap of 100W.
 srun -N 2 -n 8 ./variorum-cap-socket-power-limit-mpi-example -l 100
 
+# Launch 8 tasks, 4 tasks per node using Slurm. One rank per node samples node
+# power, and rank 0 prints the job's total power every second for 10 seconds.
+srun -N 2 -n 8 ./variorum-print-job-power-mpi-example -t 10
+
+# Launch 8 tasks, 4 tasks per node using Slurm, with the PMPI energy profiler
+# preloaded. Each rank writes the node energy spent in its MPI calls to
+# variorum-pmpi.<rank>.dat at MPI_Finalize.
+LD_PRELOAD=../../pmpi/libvariorum_pmpi.so srun -N 2 -n 8 ./variorum-print-power-mpi-example
+
 #
@@ -0,0 +1,84 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <getopt.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <variorum.h>
+#include <variorum_mpi.h>
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    int rank = 0;
+    int seconds = 5;
+    long interval_ms = 100;
+    int i;
+
+    const char *usage = "Usage: %s [-h] [-v] [-i interval_ms] [-t seconds]\n";
+    int opt;
+    while ((opt = getopt(argc, argv, "hvi:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                printf(usage, argv[0]);
+                return 0;
+            case 'v':
+                printf("%s\n", variorum_get_current_version());
+                return 0;
+            case 'i':
+                interval_ms = atol(optarg);
+                break;
+            case 't':
+                seconds = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, usage, argv[0]);
+                return -1;
+        }
+    }
+
+    MPI_Init(NULL, NULL);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Only one rank per node reads the energy counters; job totals are
+    // reduced among those ranks and visible to every rank.
+    ret = variorum_mpi_init(MPI_COMM_WORLD, interval_ms);
+    if (ret != 0)
+    {
+        printf("MPI power aggregation failed!\n");
+        MPI_Abort(MPI_COMM_WORLD, ret);
+    }
+
+    for (i = 0; i < seconds; i++)
+    {
+        struct variorum_mpi_job_power job;
+        int t;
+
+        // Application work would go here; the node leaders progress
+        // reductions whenever they call into variorum_mpi.
+        for (t = 0; t < 100; t++)
+        {
+            usleep(10000);
+            variorum_mpi_progress();
+        }
+        variorum_mpi_get_job_power(&job);
+        if (rank == 0)
+        {
+            printf("_JOB_POWER Round Nodes Total_W CPU_W Mem_W GPU_W Max_Node_W Max_Node\n");
+            printf("_JOB_POWER %lu %d %lf %lf %lf %lf %lf %d\n", job.round,
+                   job.num_nodes, job.total_watts, job.cpu_watts, job.mem_watts,
+                   job.gpu_watts, job.max_node_watts, job.max_node);
+        }
+    }
+
+    variorum_mpi_finalize();
+    MPI_Finalize();
+    return ret;
+}
@@ -5,3 +5,8 @@
 OMP_NUM_THREADS=4 srun -N 1 ./variorum-print-power-openmp-example
 
 #
+
+# Launch 4 threads on a single node using Slurm. Each thread opens a region
+# around its share of the loop, and the per-region energy summary is printed
+# at the end.
+OMP_NUM_THREADS=4 srun -N 1 ./variorum-region-energy-openmp-example
@@ -0,0 +1,77 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <getopt.h>
+#include <omp.h>
+#include <stdio.h>
+
+#include <variorum.h>
+
+#define N 10000000
+
+static double a[N];
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    int i, iter;
+    double sum = 0.0;
+
+    const char *usage = "Usage: %s [-h] [-v]\n";
+    int opt;
+    while ((opt = getopt(argc, argv, "hv")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                printf(usage, argv[0]);
+                return 0;
+            case 'v':
+                printf("%s\n", variorum_get_current_version());
+                return 0;
+            default:
+                fprintf(stderr, usage, argv[0]);
+                return -1;
+        }
+    }
+
+    for (iter = 0; iter < 10; iter++)
+    {
+        ret |= variorum_region_begin("iteration");
+
+        ret |= variorum_region_begin("init");
+        #pragma omp parallel for
+        for (i = 0; i < N; i++)
+        {
+            a[i] = i * 0.5;
+        }
+        ret |= variorum_region_end("init");
+
+        // Each thread measures its share of the reduction; the energy of
+        // every thread's region is the node's energy during that time.
+        #pragma omp parallel reduction(+:sum)
+        {
+            variorum_region_begin("reduce");
+            #pragma omp for
+            for (i = 0; i < N; i++)
+            {
+                sum += a[i] * a[i];
+            }
+            variorum_region_end("reduce");
+        }
+
+        ret |= variorum_region_end("iteration");
+    }
+
+    printf("Sum: %e\n", sum);
+    if (ret != 0)
+    {
+        printf("Region profiling failed!\n");
+    }
+
+    // Also written automatically when the process exits.
+    variorum_print_region_summary();
+    return ret;
+}
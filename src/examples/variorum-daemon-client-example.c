@@ -0,0 +1,74 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <variorum.h>
+#include <variorum_daemon.h>
+
+int main(int argc, char **argv)
+{
+    struct variorum_daemon_response r;
+    const char *path = NULL;
+    int cap = 0;
+    int fd, ret;
+
+    const char *usage = "Usage: %s [-h] [-v] [-s socket] [-c node_watts]\n";
+    int opt;
+    while ((opt = getopt(argc, argv, "hvs:c:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                printf(usage, argv[0]);
+                return 0;
+            case 'v':
+                printf("%s\n", variorum_get_current_version());
+                return 0;
+            case 's':
+                path = optarg;
+                break;
+            case 'c':
+                cap = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, usage, argv[0]);
+                return -1;
+        }
+    }
+
+    fd = variorum_daemon_connect(path);
+    if (fd < 0)
+    {
+        printf("Could not connect to variorumd!\n");
+        return -1;
+    }
+    if (cap > 0)
+    {
+        ret = variorum_daemon_call(fd, VARIORUM_DAEMON_OP_CAP_NODE_POWER, cap, &r);
+    }
+    else
+    {
+        ret = variorum_daemon_call(fd, VARIORUM_DAEMON_OP_GET_POWER, 0, &r);
+    }
+    if (ret != 0 || r.status != VARIORUM_DAEMON_OK)
+    {
+        printf("Request failed with status %d!\n", ret != 0 ? -1 : r.status);
+        variorum_daemon_disconnect(fd);
+        return -1;
+    }
+    if (cap == 0)
+    {
+        printf("_VARIORUMD Time_s Pkg_J DRAM_J GPU_J Pkg_W DRAM_W GPU_W Requests Reads\n");
+        printf("_VARIORUMD %lf %lf %lf %lf %lf %lf %lf %lu %lu\n", r.time,
+               r.energy.pkg_joules, r.energy.dram_joules, r.energy.gpu_joules,
+               r.pkg_watts, r.dram_watts, r.gpu_watts, (unsigned long)r.requests,
+               (unsigned long)r.hardware_reads);
+    }
+    variorum_daemon_disconnect(fd);
+    return 0;
+}
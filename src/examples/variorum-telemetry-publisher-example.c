@@ -0,0 +1,62 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <variorum.h>
+
+int main(int argc, char **argv)
+{
+    int ret;
+    int seconds = 10;
+    int interval_ms = 100;
+    const char *name = NULL;
+
+    const char *usage =
+        "Usage: %s [-h] [-v] [-n name] [-i interval_ms] [-t seconds]\n";
+    int opt;
+    while ((opt = getopt(argc, argv, "hvn:i:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                printf(usage, argv[0]);
+                return 0;
+            case 'v':
+                printf("%s\n", variorum_get_current_version());
+                return 0;
+            case 'n':
+                name = optarg;
+                break;
+            case 'i':
+                interval_ms = atoi(optarg);
+                break;
+            case 't':
+                seconds = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, usage, argv[0]);
+                return -1;
+        }
+    }
+
+    ret = variorum_start_telemetry_publisher(name, interval_ms, 64);
+    if (ret != 0)
+    {
+        printf("Start telemetry publisher failed!\n");
+        return ret;
+    }
+    printf("Publishing node telemetry for %d s\n", seconds);
+    sleep(seconds);
+    ret = variorum_stop_telemetry_publisher();
+    if (ret != 0)
+    {
+        printf("Stop telemetry publisher failed!\n");
+    }
+    return ret;
+}
@@ -0,0 +1,59 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <getopt.h>
+#include <stdio.h>
+
+#include <variorum.h>
+#include <variorum_telemetry.h>
+
+int main(int argc, char **argv)
+{
+    struct variorum_telemetry_segment *segment;
+    struct variorum_telemetry_sample history[64];
+    const char *name = VARIORUM_TELEMETRY_DEFAULT_NAME;
+    int i, n;
+
+    const char *usage = "Usage: %s [-h] [-v] [-n name]\n";
+    int opt;
+    while ((opt = getopt(argc, argv, "hvn:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                printf(usage, argv[0]);
+                return 0;
+            case 'v':
+                printf("%s\n", variorum_get_current_version());
+                return 0;
+            case 'n':
+                name = optarg;
+                break;
+            default:
+                fprintf(stderr, usage, argv[0]);
+                return -1;
+        }
+    }
+
+    // No privileges needed, only a running publisher.
+    segment = variorum_telemetry_attach(name);
+    if (segment == NULL)
+    {
+        printf("No telemetry published under %s!\n", name);
+        return -1;
+    }
+    n = variorum_telemetry_read_history(segment, history, 64);
+    printf("_TELEMETRY Index Time_s Pkg_J DRAM_J GPU_J Pkg_W DRAM_W GPU_W\n");
+    for (i = 0; i < n; i++)
+    {
+        printf("_TELEMETRY %lu %lf %lf %lf %lf %lf %lf %lf\n",
+               (unsigned long)history[i].index, history[i].time,
+               history[i].pkg_joules, history[i].dram_joules,
+               history[i].gpu_joules, history[i].pkg_watts,
+               history[i].dram_watts, history[i].gpu_watts);
+    }
+    variorum_telemetry_detach(segment);
+    return 0;
+}
@@ -0,0 +1,611 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <float.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <variorum.h>
+#include <variorum_error.h>
+#include <variorum_mpi.h>
+#include <variorum_power_balancer.h>
+#include <variorum_region.h>
+#include <variorum_timers.h>
+
+/* Number of per-domain power values summed across nodes. */
+#define NUM_DOMAINS 4
+
+/* State shared by the ranks of a node, written by the leader only. Each half
+ * is guarded by its own sequence lock. */
+struct shared_state
+{
+    unsigned node_seq;
+    struct variorum_mpi_node_power node;
+    unsigned job_seq;
+    struct variorum_mpi_job_power job;
+    double node_watts[];
+};
+
+static struct
+{
+    int initialized;
+    int leader;
+    int node_index;
+    int num_nodes;
+    int thread_multiple;
+    long interval_ms;
+    MPI_Comm node_comm;
+    MPI_Comm leader_comm;
+    MPI_Comm sync_comm;
+    MPI_Win win;
+    struct shared_state *shared;
+} agg;
+
+/* Reduction state on the node leader. */
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_t thread;
+    int running;
+    int stop;
+    double mock_watts;
+    double mock_joules;
+    double mock_time;
+    long mock_cap_mw;
+    double origin;
+    struct variorum_energy_counters last;
+    double last_time;
+    int in_flight;
+    unsigned long posted;
+    double next_round;
+    MPI_Request req[3];
+    double sum_send[NUM_DOMAINS];
+    double sum_recv[NUM_DOMAINS];
+    struct
+    {
+        double watts;
+        int node;
+    } max_send, max_recv;
+    double gather_send;
+    double *gather_recv;
+} leader = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/* Job power budget shared among the nodes. */
+static struct
+{
+    int enabled;
+    struct variorum_power_balancer_config config;
+    double progress;
+    double cap_watts;
+    double last_joules;
+    double last_time;
+    struct variorum_power_balancer_node *nodes;
+    double *caps;
+} balancer;
+
+static double now_seconds(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* The mock node draws its demand, or its cap if that is lower. */
+static int read_counters(struct variorum_energy_counters *counters)
+{
+    double now, watts;
+    long cap_mw;
+
+    if (leader.mock_watts > 0.0)
+    {
+        now = now_seconds();
+        cap_mw = __atomic_load_n(&leader.mock_cap_mw, __ATOMIC_ACQUIRE);
+        watts = leader.mock_watts;
+        if (cap_mw > 0 && cap_mw / 1e3 < watts)
+        {
+            watts = cap_mw / 1e3;
+        }
+        if (leader.mock_time > 0.0)
+        {
+            leader.mock_joules += watts * (now - leader.mock_time);
+        }
+        leader.mock_time = now;
+        memset(counters, 0, sizeof(*counters));
+        counters->pkg_joules = leader.mock_joules;
+        return 0;
+    }
+    return variorum_region_read_counters(counters);
+}
+
+/* Demand of this node from a comma-separated list indexed by node. */
+static double mock_demand(const char *list, int node)
+{
+    const char *p = list;
+    int count = 1, i;
+
+    for (i = 0; list[i] != '\0'; i++)
+    {
+        count += list[i] == ',';
+    }
+    for (i = node % count; i > 0; i--)
+    {
+        p = strchr(p, ',') + 1;
+    }
+    return atof(p);
+}
+
+static void publish_node(const struct variorum_mpi_node_power *power)
+{
+    struct shared_state *s = agg.shared;
+
+    __atomic_store_n(&s->node_seq, s->node_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->node = *power;
+    __atomic_store_n(&s->node_seq, s->node_seq + 1, __ATOMIC_RELEASE);
+}
+
+static void read_node(struct variorum_mpi_node_power *power)
+{
+    struct shared_state *s = agg.shared;
+    unsigned seq;
+
+    do
+    {
+        seq = __atomic_load_n(&s->node_seq, __ATOMIC_ACQUIRE);
+        *power = s->node;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while ((seq & 1) || seq != __atomic_load_n(&s->node_seq, __ATOMIC_RELAXED));
+}
+
+/* Read the counters and publish the node's power since the previous read.
+ * Called with leader.lock held. */
+static void sample_node(void)
+{
+    struct variorum_energy_counters counters;
+    struct variorum_mpi_node_power power;
+    double time, dt;
+
+    if (read_counters(&counters))
+    {
+        return;
+    }
+    time = now_seconds();
+    dt = time - leader.last_time;
+    if (dt <= 0.0)
+    {
+        return;
+    }
+    power.time = time;
+    power.cpu_watts = (counters.pkg_joules - leader.last.pkg_joules) / dt;
+    power.mem_watts = (counters.dram_joules - leader.last.dram_joules) / dt;
+    power.gpu_watts = (counters.gpu_joules - leader.last.gpu_joules) / dt;
+    power.node_watts = power.cpu_watts + power.mem_watts + power.gpu_watts;
+    power.joules = counters.pkg_joules + counters.dram_joules +
+                   counters.gpu_joules - leader.origin;
+    leader.last = counters;
+    leader.last_time = time;
+    publish_node(&power);
+}
+
+static void post_round(void)
+{
+    struct variorum_mpi_node_power power;
+
+    read_node(&power);
+    leader.sum_send[0] = power.node_watts;
+    leader.sum_send[1] = power.cpu_watts;
+    leader.sum_send[2] = power.mem_watts;
+    leader.sum_send[3] = power.gpu_watts;
+    leader.max_send.watts = power.node_watts;
+    leader.max_send.node = agg.node_index;
+    leader.gather_send = power.node_watts;
+
+    /* Posted in the same order on every leader. */
+    MPI_Iallreduce(leader.sum_send, leader.sum_recv, NUM_DOMAINS, MPI_DOUBLE,
+                   MPI_SUM, agg.leader_comm, &leader.req[0]);
+    MPI_Iallreduce(&leader.max_send, &leader.max_recv, 1, MPI_DOUBLE_INT,
+                   MPI_MAXLOC, agg.leader_comm, &leader.req[1]);
+    MPI_Iallgather(&leader.gather_send, 1, MPI_DOUBLE, leader.gather_recv, 1,
+                   MPI_DOUBLE, agg.leader_comm, &leader.req[2]);
+    leader.in_flight = 1;
+    leader.posted++;
+}
+
+static void publish_round(void)
+{
+    struct shared_state *s = agg.shared;
+
+    __atomic_store_n(&s->job_seq, s->job_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->job.round = leader.posted;
+    s->job.num_nodes = agg.num_nodes;
+    s->job.total_watts = leader.sum_recv[0];
+    s->job.cpu_watts = leader.sum_recv[1];
+    s->job.mem_watts = leader.sum_recv[2];
+    s->job.gpu_watts = leader.sum_recv[3];
+    s->job.max_node_watts = leader.max_recv.watts;
+    s->job.max_node = leader.max_recv.node;
+    memcpy(s->node_watts, leader.gather_recv, agg.num_nodes * sizeof(double));
+    __atomic_store_n(&s->job_seq, s->job_seq + 1, __ATOMIC_RELEASE);
+    leader.in_flight = 0;
+}
+
+/* Called with leader.lock held. */
+static void progress_locked(void)
+{
+    double now;
+    int done;
+
+    if (leader.in_flight)
+    {
+        MPI_Testall(3, leader.req, &done, MPI_STATUSES_IGNORE);
+        if (!done)
+        {
+            return;
+        }
+        publish_round();
+    }
+    now = now_seconds();
+    if (now >= leader.next_round)
+    {
+        post_round();
+        leader.next_round = now + agg.interval_ms / 1e3;
+    }
+}
+
+static void *leader_sampler(void *arg)
+{
+    (void)arg;
+
+    while (!__atomic_load_n(&leader.stop, __ATOMIC_ACQUIRE))
+    {
+        sleep_ms(agg.interval_ms);
+        pthread_mutex_lock(&leader.lock);
+        sample_node();
+        if (agg.thread_multiple)
+        {
+            progress_locked();
+        }
+        pthread_mutex_unlock(&leader.lock);
+    }
+    return NULL;
+}
+
+static int split_nodes(MPI_Comm comm)
+{
+    char *val = getenv("VARIORUM_MPI_RANKS_PER_NODE");
+    int rank;
+
+    MPI_Comm_rank(comm, &rank);
+    /* Emulate several nodes on one machine for testing; the groups must
+     * still share memory. */
+    if (val != NULL && atoi(val) > 0)
+    {
+        return MPI_Comm_split(comm, rank / atoi(val), rank, &agg.node_comm);
+    }
+    return MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                               &agg.node_comm);
+}
+
+int variorum_mpi_init(MPI_Comm comm, long interval_ms)
+{
+    MPI_Aint size;
+    int local_rank, rank, disp, provided;
+    char *val;
+
+    if (agg.initialized)
+    {
+        return 0;
+    }
+    if (interval_ms <= 0)
+    {
+        val = getenv("VARIORUM_MPI_INTERVAL_MS");
+        interval_ms = val != NULL && atol(val) > 0 ? atol(val) : 100;
+    }
+    agg.interval_ms = interval_ms;
+    MPI_Query_thread(&provided);
+    agg.thread_multiple = provided == MPI_THREAD_MULTIPLE;
+
+    MPI_Comm_rank(comm, &rank);
+    if (split_nodes(comm) != MPI_SUCCESS)
+    {
+        variorum_error_handler("Could not group ranks by node", VARIORUM_ERROR_INVAL,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+    MPI_Comm_rank(agg.node_comm, &local_rank);
+    agg.leader = local_rank == 0;
+    MPI_Comm_split(comm, agg.leader ? 0 : MPI_UNDEFINED, rank, &agg.leader_comm);
+    if (agg.leader)
+    {
+        MPI_Comm_rank(agg.leader_comm, &agg.node_index);
+        MPI_Comm_size(agg.leader_comm, &agg.num_nodes);
+        /* Blocking collectives among leaders, apart from the rounds. */
+        MPI_Comm_dup(agg.leader_comm, &agg.sync_comm);
+    }
+    MPI_Bcast(&agg.node_index, 1, MPI_INT, 0, agg.node_comm);
+    MPI_Bcast(&agg.num_nodes, 1, MPI_INT, 0, agg.node_comm);
+
+    /* The leader owns the state, the other ranks map it. */
+    if (MPI_Win_allocate_shared(agg.leader ? sizeof(struct shared_state) +
+                                agg.num_nodes * sizeof(double) : 0, 1,
+                                MPI_INFO_NULL, agg.node_comm, &agg.shared,
+                                &agg.win) != MPI_SUCCESS)
+    {
+        variorum_error_handler("Could not allocate shared window",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    MPI_Win_shared_query(agg.win, 0, &size, &disp, &agg.shared);
+
+    if (agg.leader)
+    {
+        memset(agg.shared, 0, sizeof(struct shared_state) +
+               agg.num_nodes * sizeof(double));
+        leader.gather_recv = (double *) calloc(agg.num_nodes, sizeof(double));
+        val = getenv("VARIORUM_MPI_MOCK_WATTS");
+        leader.mock_watts = val != NULL ? mock_demand(val, agg.node_index) : 0.0;
+        leader.last_time = now_seconds();
+        leader.next_round = leader.last_time + agg.interval_ms / 1e3;
+        if (read_counters(&leader.last) == 0)
+        {
+            leader.origin = leader.last.pkg_joules + leader.last.dram_joules +
+                            leader.last.gpu_joules;
+            leader.running = pthread_create(&leader.thread, NULL, leader_sampler,
+                                            NULL) == 0;
+        }
+        if (!leader.running)
+        {
+            variorum_error_handler("Could not start node sampler",
+                                   VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                                   __FILE__, __FUNCTION__, __LINE__);
+        }
+    }
+    MPI_Barrier(agg.node_comm);
+    agg.initialized = 1;
+    return 0;
+}
+
+int variorum_mpi_progress(void)
+{
+    if (!agg.initialized)
+    {
+        return -1;
+    }
+    if (agg.leader && !agg.thread_multiple)
+    {
+        pthread_mutex_lock(&leader.lock);
+        progress_locked();
+        pthread_mutex_unlock(&leader.lock);
+    }
+    return 0;
+}
+
+int variorum_mpi_get_node_power(struct variorum_mpi_node_power *power)
+{
+    if (variorum_mpi_progress())
+    {
+        return -1;
+    }
+    read_node(power);
+    return 0;
+}
+
+int variorum_mpi_get_job_power(struct variorum_mpi_job_power *power)
+{
+    struct shared_state *s = agg.shared;
+    unsigned seq;
+
+    if (variorum_mpi_progress())
+    {
+        return -1;
+    }
+    do
+    {
+        seq = __atomic_load_n(&s->job_seq, __ATOMIC_ACQUIRE);
+        *power = s->job;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while ((seq & 1) || seq != __atomic_load_n(&s->job_seq, __ATOMIC_RELAXED));
+    return 0;
+}
+
+int variorum_mpi_get_node_powers(double *watts, int num_nodes)
+{
+    struct shared_state *s = agg.shared;
+    unsigned seq;
+
+    if (variorum_mpi_progress())
+    {
+        return -1;
+    }
+    if (num_nodes > agg.num_nodes)
+    {
+        num_nodes = agg.num_nodes;
+    }
+    do
+    {
+        seq = __atomic_load_n(&s->job_seq, __ATOMIC_ACQUIRE);
+        memcpy(watts, s->node_watts, num_nodes * sizeof(double));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while ((seq & 1) || seq != __atomic_load_n(&s->job_seq, __ATOMIC_RELAXED));
+    return num_nodes;
+}
+
+int variorum_mpi_node_index(void)
+{
+    return agg.initialized ? agg.node_index : -1;
+}
+
+/* Apply a node cap on the leader. The mock node only records it. Holds
+ * leader.lock so the cap never overlaps a sample of the node sampler. */
+static int apply_node_cap(double watts)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&leader.lock);
+    if (leader.mock_watts > 0.0)
+    {
+        __atomic_store_n(&leader.mock_cap_mw, (long)(watts * 1e3), __ATOMIC_RELEASE);
+    }
+    else
+    {
+        ret = variorum_cap_best_effort_node_power_limit((int) watts);
+    }
+    pthread_mutex_unlock(&leader.lock);
+    return ret;
+}
+
+int variorum_mpi_balancer_init(double budget_watts, double min_node_watts,
+                               double max_node_watts)
+{
+    struct variorum_mpi_node_power power;
+    double share;
+    int ret = 0;
+
+    if (!agg.initialized)
+    {
+        return -1;
+    }
+    share = budget_watts / agg.num_nodes;
+    if (share < min_node_watts || min_node_watts > max_node_watts)
+    {
+        variorum_error_handler("Budget is below the minimum node caps",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    balancer.config.budget_watts = budget_watts;
+    balancer.config.min_cap_watts = min_node_watts;
+    balancer.config.max_cap_watts = max_node_watts;
+    balancer.config.margin_watts = 0.02 * share;
+    balancer.config.max_step_watts = 0.1 * share;
+    balancer.config.progress_tolerance = 0.05;
+    balancer.cap_watts = share < max_node_watts ? share : max_node_watts;
+    balancer.progress = 0.0;
+
+    if (agg.leader)
+    {
+        balancer.nodes = (struct variorum_power_balancer_node *)
+                         calloc(agg.num_nodes, sizeof(struct variorum_power_balancer_node));
+        balancer.caps = (double *) calloc(agg.num_nodes, sizeof(double));
+        ret = apply_node_cap(balancer.cap_watts);
+        read_node(&power);
+        balancer.last_joules = power.joules;
+        balancer.last_time = power.time;
+    }
+    MPI_Bcast(&ret, 1, MPI_INT, 0, agg.node_comm);
+    balancer.enabled = ret == 0;
+    return ret == 0 ? 0 : -1;
+}
+
+int variorum_mpi_balancer_set_progress(double progress)
+{
+    if (!balancer.enabled)
+    {
+        return -1;
+    }
+    balancer.progress = progress;
+    return 0;
+}
+
+int variorum_mpi_balance(double *node_cap_watts)
+{
+    struct variorum_mpi_node_power power;
+    struct variorum_power_balancer_node mine;
+    double progress;
+    int ret = 0;
+
+    if (!balancer.enabled)
+    {
+        return -1;
+    }
+    /* The node is as fast as its slowest rank. */
+    progress = balancer.progress > 0.0 ? balancer.progress : DBL_MAX;
+    MPI_Reduce(agg.leader ? MPI_IN_PLACE : &progress, &progress, 1, MPI_DOUBLE,
+               MPI_MIN, 0, agg.node_comm);
+
+    if (agg.leader)
+    {
+        read_node(&power);
+        mine.cap_watts = balancer.cap_watts;
+        mine.power_watts = power.time > balancer.last_time ?
+                           (power.joules - balancer.last_joules) /
+                           (power.time - balancer.last_time) : power.node_watts;
+        mine.progress = progress < DBL_MAX ? progress : 0.0;
+        balancer.last_joules = power.joules;
+        balancer.last_time = power.time;
+
+        /* Every leader computes the same caps from the same data. */
+        MPI_Allgather(&mine, sizeof(mine), MPI_BYTE, balancer.nodes, sizeof(mine),
+                      MPI_BYTE, agg.sync_comm);
+        ret = variorum_power_balance(&balancer.config, balancer.nodes,
+                                     agg.num_nodes, balancer.caps);
+        if (ret == 0)
+        {
+            balancer.cap_watts = balancer.caps[agg.node_index];
+            ret = apply_node_cap(balancer.cap_watts);
+        }
+    }
+    MPI_Bcast(&ret, 1, MPI_INT, 0, agg.node_comm);
+    MPI_Bcast(&balancer.cap_watts, 1, MPI_DOUBLE, 0, agg.node_comm);
+    if (node_cap_watts != NULL)
+    {
+        *node_cap_watts = balancer.cap_watts;
+    }
+    return ret == 0 ? 0 : -1;
+}
+
+int variorum_mpi_finalize(void)
+{
+    unsigned long rounds;
+
+    if (!agg.initialized)
+    {
+        return -1;
+    }
+    if (agg.leader)
+    {
+        if (leader.running)
+        {
+            __atomic_store_n(&leader.stop, 1, __ATOMIC_RELEASE);
+            pthread_join(leader.thread, NULL);
+            leader.running = 0;
+        }
+        /* Leaders that fell behind post the rounds they missed, so every
+         * collective on the leader communicator is matched. Rounds may be
+         * in flight, so agree on the count over a separate communicator. */
+        MPI_Allreduce(&leader.posted, &rounds, 1, MPI_UNSIGNED_LONG, MPI_MAX,
+                      agg.sync_comm);
+        while (leader.in_flight || leader.posted < rounds)
+        {
+            if (!leader.in_flight)
+            {
+                post_round();
+            }
+            MPI_Waitall(3, leader.req, MPI_STATUSES_IGNORE);
+            publish_round();
+        }
+        free(balancer.nodes);
+        free(balancer.caps);
+        MPI_Comm_free(&agg.sync_comm);
+        MPI_Comm_free(&agg.leader_comm);
+        free(leader.gather_recv);
+        leader.gather_recv = NULL;
+    }
+    /* Nobody reads the window past this barrier. */
+    MPI_Barrier(agg.node_comm);
+    MPI_Win_free(&agg.win);
+    MPI_Comm_free(&agg.node_comm);
+    memset(&balancer, 0, sizeof(balancer));
+    agg.initialized = 0;
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_MPI_H_INCLUDE
+#define VARIORUM_MPI_H_INCLUDE
+
+#include <mpi.h>
+
+/// @brief Power of one node, averaged over the latest sampling interval.
+struct variorum_mpi_node_power
+{
+    /// @brief CLOCK_MONOTONIC time of the sample (s).
+    double time;
+    /// @brief Node power, the sum of the domains below (W).
+    double node_watts;
+    /// @brief Package power of all sockets (W).
+    double cpu_watts;
+    /// @brief DRAM power of all sockets (W).
+    double mem_watts;
+    /// @brief Power of all GPUs (W).
+    double gpu_watts;
+    /// @brief Node energy since variorum_mpi_init() (J).
+    double joules;
+};
+
+/// @brief Power of all nodes of the job from the latest completed reduction.
+struct variorum_mpi_job_power
+{
+    /// @brief Number of completed reductions, 0 until the first completes.
+    unsigned long round;
+    /// @brief Number of nodes in the job.
+    int num_nodes;
+    /// @brief Total node power (W).
+    double total_watts;
+    /// @brief Total package power (W).
+    double cpu_watts;
+    /// @brief Total DRAM power (W).
+    double mem_watts;
+    /// @brief Total GPU power (W).
+    double gpu_watts;
+    /// @brief Power of the node drawing the most (W).
+    double max_node_watts;
+    /// @brief Index of the node drawing the most.
+    int max_node;
+};
+
+/// @brief Start node sampling and job-wide power reduction on a
+/// communicator.
+///
+/// @note Collective over comm. The ranks sharing a node elect the lowest
+/// rank as the node's leader, which alone reads the energy counters and
+/// publishes node power in a shared memory window. The leaders reduce job
+/// totals with non-blocking collectives every interval; the other ranks read
+/// the results from the window without communication. If MPI was initialized
+/// with MPI_THREAD_MULTIPLE the leader progresses reductions on its sampling
+/// thread; otherwise on its own calls to variorum_mpi_progress() or the
+/// getters below.
+///
+/// @param [in] comm Communicator spanning the job.
+/// @param [in] interval_ms Sampling and reduction interval (ms), or 0 for
+///             VARIORUM_MPI_INTERVAL_MS or 100.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_mpi_init(
+    MPI_Comm comm,
+    long interval_ms
+);
+
+/// @brief Complete a finished reduction and start the next one if due.
+///
+/// @note Local; a no-op except on node leaders.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_mpi_progress(void);
+
+/// @brief Copy the latest power sample of the calling rank's node.
+///
+/// @param [out] power Node power.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_mpi_get_node_power(
+    struct variorum_mpi_node_power *power
+);
+
+/// @brief Copy the latest job-wide power totals.
+///
+/// @param [out] power Job power.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_mpi_get_job_power(
+    struct variorum_mpi_job_power *power
+);
+
+/// @brief Copy the power of every node from the latest reduction.
+///
+/// @param [out] watts Node power (W), indexed by node.
+/// @param [in] num_nodes Length of watts.
+///
+/// @return Number of nodes copied, otherwise -1.
+int variorum_mpi_get_node_powers(
+    double *watts,
+    int num_nodes
+);
+
+/// @brief Index of the calling rank's node, from 0 to the number of nodes.
+///
+/// @return Node index, otherwise -1.
+int variorum_mpi_node_index(void);
+
+/// @brief Share a job power budget among the nodes.
+///
+/// @note Collective over the communicator given to variorum_mpi_init(), which
+/// must be called first. Every node starts with an equal share of the budget.
+///
+/// @param [in] budget_watts Job power budget (W).
+/// @param [in] min_node_watts Lowest node cap (W).
+/// @param [in] max_node_watts Highest node cap (W).
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_mpi_balancer_init(
+    double budget_watts,
+    double min_node_watts,
+    double max_node_watts
+);
+
+/// @brief Report the calling rank's progress rate since the last
+/// rebalance, for example iterations per second.
+///
+/// @note Local. A node's progress is that of its slowest rank. Ranks that
+/// never report are ignored.
+///
+/// @param [in] progress Progress rate, higher is faster.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_mpi_balancer_set_progress(
+    double progress
+);
+
+/// @brief Reallocate the job power budget among the nodes.
+///
+/// @note Collective over the communicator given to variorum_mpi_init(). Node
+/// leaders gather each node's average power and progress since the previous
+/// call; nodes held at their cap receive the headroom of nodes drawing less
+/// and part of the cap of nodes ahead of the others. Each leader applies its
+/// new cap with variorum_cap_best_effort_node_power_limit().
+///
+/// @param [out] node_cap_watts New cap of the calling rank's node (W), may be
+///              NULL.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_mpi_balance(
+    double *node_cap_watts
+);
+
+/// @brief Finish outstanding reductions and release the shared window.
+///
+/// @note Collective over the communicator given to variorum_mpi_init().
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_mpi_finalize(void);
+
+#endif
@@ -0,0 +1,1047 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#define _GNU_SOURCE
+
+#include <limits.h>
+#include <mpi.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <variorum.h>
+#include <variorum_error.h>
+#include <variorum_region.h>
+#include <variorum_timers.h>
+
+/* Profiling interposer attributing node energy to MPI calls. One rank per
+ * node samples the node's energy counters and publishes them in a shared
+ * memory window; every rank reads the window on entry to and exit from each
+ * wrapped call and charges the difference to the (call, communicator)
+ * pair.
+ *
+ * With VARIORUM_PMPI_SLACK=1, every rank also measures the fraction of each
+ * window it spends inside MPI. Ranks that mostly wait are not on the
+ * critical path and request a lower frequency for their cores; a rank that
+ * stops waiting is restored to the highest frequency. The leader applies the
+ * requests of the node in one batched write per sampling interval, from its
+ * own MPI calls rather than from the sampling thread. */
+
+#define PMPI_MAX_COMMS 32
+#define PMPI_COMM_NAME_LEN MPI_MAX_OBJECT_NAME
+#define PMPI_SLACK_MAX_CPUS 64
+
+enum pmpi_call
+{
+    CALL_SEND,
+    CALL_RECV,
+    CALL_ISEND,
+    CALL_IRECV,
+    CALL_SENDRECV,
+    CALL_PROBE,
+    CALL_WAIT,
+    CALL_WAITALL,
+    CALL_WAITANY,
+    CALL_WAITSOME,
+    CALL_BARRIER,
+    CALL_BCAST,
+    CALL_REDUCE,
+    CALL_ALLREDUCE,
+    CALL_GATHER,
+    CALL_GATHERV,
+    CALL_SCATTER,
+    CALL_SCATTERV,
+    CALL_ALLGATHER,
+    CALL_ALLGATHERV,
+    CALL_ALLTOALL,
+    CALL_ALLTOALLV,
+    CALL_REDUCE_SCATTER,
+    NUM_CALLS
+};
+
+static const char *call_names[NUM_CALLS] =
+{
+    "MPI_Send",
+    "MPI_Recv",
+    "MPI_Isend",
+    "MPI_Irecv",
+    "MPI_Sendrecv",
+    "MPI_Probe",
+    "MPI_Wait",
+    "MPI_Waitall",
+    "MPI_Waitany",
+    "MPI_Waitsome",
+    "MPI_Barrier",
+    "MPI_Bcast",
+    "MPI_Reduce",
+    "MPI_Allreduce",
+    "MPI_Gather",
+    "MPI_Gatherv",
+    "MPI_Scatter",
+    "MPI_Scatterv",
+    "MPI_Allgather",
+    "MPI_Allgatherv",
+    "MPI_Alltoall",
+    "MPI_Alltoallv",
+    "MPI_Reduce_scatter",
+};
+
+/* Node sample in the shared window, written by the leader only. */
+struct node_sample
+{
+    unsigned seq;
+    int valid;
+    /// @brief CLOCK_MONOTONIC time of the sample (s).
+    double time;
+    /// @brief Node energy since the leader started sampling (J).
+    double joules;
+    /// @brief Node power over the last sampling interval (W).
+    double watts;
+};
+
+/* Frequency request of a rank in the shared window. */
+struct rank_slot
+{
+    /// @brief Number of CPUs the rank is bound to, 0 if it does not take
+    /// part.
+    int ncpus;
+    int cpus[PMPI_SLACK_MAX_CPUS];
+    /// @brief Requested frequency (MHz), written by the owning rank.
+    int target_mhz;
+};
+
+struct node_state
+{
+    struct node_sample sample;
+    /// @brief Set if the leader applies the frequency requests.
+    int applying;
+    struct rank_slot ranks[];
+};
+
+struct call_stats
+{
+    unsigned long calls;
+    double seconds;
+    double joules;
+};
+
+static struct
+{
+    int active;
+    int thread_multiple;
+    int rank;
+    int local_rank;
+    int local_size;
+    MPI_Comm node_comm;
+    MPI_Win win;
+    struct node_state *node;
+    struct node_sample *sample;
+    double start_time;
+    double start_joules;
+    /* Slot 0 collects calls without a communicator (completion calls). */
+    int ncomms;
+    MPI_Comm comm[PMPI_MAX_COMMS];
+    char comm_name[PMPI_MAX_COMMS][PMPI_COMM_NAME_LEN];
+    struct call_stats stats[NUM_CALLS][PMPI_MAX_COMMS];
+} prof;
+
+static pthread_mutex_t prof_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Sampling thread on the node leader. */
+static struct
+{
+    pthread_t thread;
+    int running;
+    int stop;
+    long interval_ms;
+    double mock_watts;
+    /* Written by apply_targets(), read by the sampling thread. */
+    double mock_scale;
+    double mock_time;
+    double mock_joules;
+    double origin;
+    /* Time of the next apply_targets() call. */
+    double next_apply;
+    /* Frequencies last applied to each rank slot. */
+    int *applied;
+    int *cpus;
+    int *cpu_mhz;
+} leader;
+
+/* Slack-driven frequency selection of this rank. */
+static struct
+{
+    int enabled;
+    double window_s;
+    int min_mhz;
+    int max_mhz;
+    int step_mhz;
+    double high;
+    double low;
+    /* Current request and the time it was made. */
+    int mhz;
+    double since;
+    double window_start;
+    double window_wait;
+    unsigned long windows;
+    unsigned long changes;
+    double wait_s;
+    double mhz_seconds;
+    double reduced_s;
+    /* Seconds at reduced frequency weighted by the relative reduction. */
+    double saved_s;
+    /* Compute time lost to reduced frequency, if compute bound. */
+    double delay_s;
+} slack;
+
+static double now_seconds(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int read_node_joules(double *joules)
+{
+    struct variorum_energy_counters counters;
+
+    if (leader.mock_watts > 0.0)
+    {
+        /* Mock power follows the mean frequency of the node's ranks. */
+        double now = now_seconds();
+        double scale;
+
+        __atomic_load(&leader.mock_scale, &scale, __ATOMIC_RELAXED);
+        if (leader.mock_time > 0.0)
+        {
+            leader.mock_joules += leader.mock_watts * scale *
+                                  (now - leader.mock_time);
+        }
+        leader.mock_time = now;
+        *joules = leader.mock_joules;
+        return 0;
+    }
+    if (variorum_region_read_counters(&counters))
+    {
+        return -1;
+    }
+    *joules = counters.pkg_joules + counters.dram_joules + counters.gpu_joules;
+    return 0;
+}
+
+static void publish_sample(double time, double joules, double watts)
+{
+    struct node_sample *s = prof.sample;
+
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->time = time;
+    s->joules = joules;
+    s->watts = watts;
+    s->valid = 1;
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Apply the frequency requests that changed since the last call in one
+ * batched write. Runs on the leader's MPI thread, so the API call never
+ * overlaps the application's own Variorum calls on that thread, and the
+ * platform is only exited when a request changed. */
+static void apply_targets(void)
+{
+    double ratio = 0.0;
+    int i, k, n = 0, nslots = 0;
+
+    for (i = 0; i < prof.local_size; i++)
+    {
+        struct rank_slot *slot = &prof.node->ranks[i];
+        int mhz = __atomic_load_n(&slot->target_mhz, __ATOMIC_ACQUIRE);
+
+        if (slot->ncpus == 0 || mhz == 0)
+        {
+            continue;
+        }
+        nslots++;
+        ratio += (double)mhz / slack.max_mhz;
+        if (mhz == leader.applied[i])
+        {
+            continue;
+        }
+        for (k = 0; k < slot->ncpus; k++)
+        {
+            leader.cpus[n] = slot->cpus[k];
+            leader.cpu_mhz[n] = mhz;
+            n++;
+        }
+        leader.applied[i] = mhz;
+    }
+    if (leader.mock_watts > 0.0)
+    {
+        if (nslots > 0)
+        {
+            ratio /= nslots;
+            __atomic_store(&leader.mock_scale, &ratio, __ATOMIC_RELAXED);
+        }
+        return;
+    }
+    if (n > 0 && variorum_cap_cpu_frequency_targets(n, leader.cpus,
+            leader.cpu_mhz))
+    {
+        variorum_error_handler("Could not apply frequency targets",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"), __FILE__,
+                               __FUNCTION__, __LINE__);
+    }
+}
+
+static void *leader_sampler(void *arg)
+{
+    double last_time = prof.sample->time;
+    double last_joules = 0.0;
+    (void)arg;
+
+    while (!__atomic_load_n(&leader.stop, __ATOMIC_ACQUIRE))
+    {
+        double joules, time;
+
+        sleep_ms(leader.interval_ms);
+        if (read_node_joules(&joules))
+        {
+            continue;
+        }
+        time = now_seconds();
+        joules -= leader.origin;
+        publish_sample(time, joules,
+                       time > last_time ? (joules - last_joules) / (time - last_time) : 0.0);
+        last_time = time;
+        last_joules = joules;
+    }
+    return NULL;
+}
+
+/* Take the first sample and start sampling. Without readable counters the
+ * sample stays invalid and every call is charged no energy. */
+static void start_leader(void)
+{
+    char *val;
+
+    val = getenv("VARIORUM_PMPI_INTERVAL_MS");
+    leader.interval_ms = val != NULL && atol(val) > 0 ? atol(val) : 10;
+    val = getenv("VARIORUM_PMPI_MOCK_WATTS");
+    leader.mock_watts = val != NULL ? atof(val) : 0.0;
+    leader.mock_scale = 1.0;
+    if (slack.enabled)
+    {
+        leader.applied = (int *) calloc(prof.local_size, sizeof(int));
+        leader.cpus = (int *) malloc(prof.local_size * PMPI_SLACK_MAX_CPUS *
+                                     sizeof(int));
+        leader.cpu_mhz = (int *) malloc(prof.local_size * PMPI_SLACK_MAX_CPUS *
+                                        sizeof(int));
+        if (leader.applied == NULL || leader.cpus == NULL || leader.cpu_mhz == NULL)
+        {
+            slack.enabled = 0;
+        }
+    }
+
+    if (read_node_joules(&leader.origin))
+    {
+        return;
+    }
+    publish_sample(now_seconds(), 0.0, 0.0);
+    if (pthread_create(&leader.thread, NULL, leader_sampler, NULL) == 0)
+    {
+        leader.running = 1;
+        prof.node->applying = slack.enabled;
+    }
+    else
+    {
+        variorum_error_handler("Could not start node sampler", VARIORUM_ERROR_INVAL,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+    }
+}
+
+/* Node energy now, extrapolated from the latest sample at its power so that
+ * calls shorter than the sampling interval are charged. */
+static double node_joules(double now)
+{
+    struct node_sample *s = prof.sample;
+    struct node_sample copy;
+    unsigned seq;
+
+    do
+    {
+        seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        copy = *s;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while ((seq & 1) || seq != __atomic_load_n(&s->seq, __ATOMIC_RELAXED));
+
+    if (!copy.valid)
+    {
+        return 0.0;
+    }
+    return copy.joules + copy.watts * (now > copy.time ? now - copy.time : 0.0);
+}
+
+static int comm_slot(MPI_Comm comm)
+{
+    int i, len, size;
+    char *name;
+
+    if (comm == MPI_COMM_NULL)
+    {
+        return 0;
+    }
+    for (i = 1; i < prof.ncomms; i++)
+    {
+        if (prof.comm[i] == comm)
+        {
+            return i;
+        }
+    }
+    if (prof.ncomms == PMPI_MAX_COMMS)
+    {
+        /* Out of slots, charge the call to the last one. */
+        return PMPI_MAX_COMMS - 1;
+    }
+    i = prof.ncomms++;
+    prof.comm[i] = comm;
+    if (i == PMPI_MAX_COMMS - 1)
+    {
+        snprintf(prof.comm_name[i], PMPI_COMM_NAME_LEN, "other");
+        return i;
+    }
+    PMPI_Comm_get_name(comm, prof.comm_name[i], &len);
+    if (len == 0)
+    {
+        PMPI_Comm_size(comm, &size);
+        snprintf(prof.comm_name[i], PMPI_COMM_NAME_LEN, "comm%d_size%d", i, size);
+    }
+    /* Keep the profile whitespace separated. */
+    for (name = prof.comm_name[i]; *name; name++)
+    {
+        if (*name == ' ')
+        {
+            *name = '_';
+        }
+    }
+    return i;
+}
+
+static int read_khz(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    long khz = 0;
+
+    if (f == NULL)
+    {
+        return 0;
+    }
+    if (fscanf(f, "%ld", &khz) != 1)
+    {
+        khz = 0;
+    }
+    fclose(f);
+    return (int)(khz / 1000);
+}
+
+static int env_int(const char *name, int fallback)
+{
+    char *val = getenv(name);
+    return val != NULL && atoi(val) > 0 ? atoi(val) : fallback;
+}
+
+/* Read the slack configuration, identical on every rank of the node. */
+static void slack_config(void)
+{
+    char *val = getenv("VARIORUM_PMPI_SLACK");
+
+    if (val == NULL || atoi(val) != 1)
+    {
+        return;
+    }
+    slack.window_s = env_int("VARIORUM_PMPI_SLACK_WINDOW_MS", 100) / 1000.0;
+    slack.min_mhz = env_int("VARIORUM_PMPI_SLACK_MIN_MHZ",
+                            read_khz("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_min_freq"));
+    slack.max_mhz = env_int("VARIORUM_PMPI_SLACK_MAX_MHZ",
+                            read_khz("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq"));
+    slack.step_mhz = env_int("VARIORUM_PMPI_SLACK_STEP_MHZ", 200);
+    val = getenv("VARIORUM_PMPI_SLACK_HIGH");
+    slack.high = val != NULL ? atof(val) : 0.25;
+    val = getenv("VARIORUM_PMPI_SLACK_LOW");
+    slack.low = val != NULL ? atof(val) : 0.10;
+    if (slack.min_mhz <= 0 || slack.max_mhz < slack.min_mhz)
+    {
+        variorum_error_handler("No frequency range, slack mode disabled",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"), __FILE__,
+                               __FUNCTION__, __LINE__);
+        return;
+    }
+    slack.enabled = 1;
+}
+
+/* Publish the CPUs of this rank. Ranks that are not bound to a subset of
+ * the node share their cores with others and are left alone. */
+static void slack_join(double now)
+{
+    struct rank_slot *slot = &prof.node->ranks[prof.local_rank];
+    cpu_set_t set;
+    int cpu, count;
+
+    slot->ncpus = 0;
+    if (!prof.node->applying)
+    {
+        slack.enabled = 0;
+        return;
+    }
+    if (getenv("VARIORUM_PMPI_MOCK_WATTS") != NULL)
+    {
+        slot->ncpus = 1;
+        slot->cpus[0] = prof.local_rank;
+    }
+    else if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        count = CPU_COUNT(&set);
+        if (count <= PMPI_SLACK_MAX_CPUS && count < sysconf(_SC_NPROCESSORS_ONLN))
+        {
+            for (cpu = 0; cpu < CPU_SETSIZE && slot->ncpus < count; cpu++)
+            {
+                if (CPU_ISSET(cpu, &set))
+                {
+                    slot->cpus[slot->ncpus++] = cpu;
+                }
+            }
+        }
+    }
+    slack.mhz = slack.max_mhz;
+    slack.since = now;
+    slack.window_start = now;
+    __atomic_store_n(&slot->target_mhz, slack.mhz, __ATOMIC_RELEASE);
+}
+
+/* Charge the time since the last request to its frequency. */
+static void slack_account(double now)
+{
+    double dt = now - slack.since;
+
+    slack.mhz_seconds += slack.mhz * dt;
+    if (slack.mhz < slack.max_mhz)
+    {
+        slack.reduced_s += dt;
+        slack.saved_s += dt * (1.0 - (double)slack.mhz / slack.max_mhz);
+    }
+    slack.since = now;
+}
+
+static void slack_request(double now, int mhz)
+{
+    if (mhz == slack.mhz)
+    {
+        return;
+    }
+    slack_account(now);
+    slack.mhz = mhz;
+    slack.changes++;
+    __atomic_store_n(&prof.node->ranks[prof.local_rank].target_mhz, mhz,
+                     __ATOMIC_RELEASE);
+}
+
+/* Close the window once it is long enough and pick the next frequency from
+ * its fraction of time spent waiting. */
+static void slack_update(double now, double waited)
+{
+    double elapsed, fraction;
+    int mhz = slack.mhz;
+
+    slack.window_wait += waited;
+    elapsed = now - slack.window_start;
+    if (elapsed < slack.window_s)
+    {
+        return;
+    }
+    fraction = slack.window_wait / elapsed;
+    slack.windows++;
+    slack.wait_s += slack.window_wait;
+    slack.delay_s += (elapsed - slack.window_wait) *
+                     (1.0 - (double)slack.mhz / slack.max_mhz);
+    if (prof.node->ranks[prof.local_rank].ncpus > 0)
+    {
+        if (fraction > slack.high)
+        {
+            mhz = slack.mhz - slack.step_mhz > slack.min_mhz ?
+                  slack.mhz - slack.step_mhz : slack.min_mhz;
+        }
+        else if (fraction < slack.low)
+        {
+            mhz = slack.max_mhz;
+        }
+    }
+    slack_request(now, mhz);
+    slack.window_start = now;
+    slack.window_wait = 0.0;
+}
+
+struct probe
+{
+    double time;
+    double joules;
+};
+
+static inline void probe_begin(struct probe *p)
+{
+    if (prof.active)
+    {
+        p->time = now_seconds();
+        p->joules = node_joules(p->time);
+    }
+}
+
+static inline void probe_end(const struct probe *p, enum pmpi_call call,
+                             MPI_Comm comm)
+{
+    struct call_stats *st;
+    double time, joules;
+
+    if (!prof.active)
+    {
+        return;
+    }
+    time = now_seconds();
+    joules = node_joules(time);
+
+    if (prof.thread_multiple)
+    {
+        pthread_mutex_lock(&prof_lock);
+    }
+    st = &prof.stats[call][comm_slot(comm)];
+    st->calls++;
+    st->seconds += time - p->time;
+    st->joules += joules - p->joules;
+    if (slack.enabled)
+    {
+        slack_update(time, time - p->time);
+        if (prof.local_rank == 0 && time >= leader.next_apply)
+        {
+            apply_targets();
+            leader.next_apply = time + leader.interval_ms / 1e3;
+        }
+    }
+    if (prof.thread_multiple)
+    {
+        pthread_mutex_unlock(&prof_lock);
+    }
+}
+
+#define PROFILE(call, comm, expr) \
+    do \
+    { \
+        struct probe p = {0, 0}; \
+        probe_begin(&p); \
+        ret = expr; \
+        probe_end(&p, call, comm); \
+    } \
+    while (0)
+
+static void pmpi_setup(int provided)
+{
+    MPI_Aint size;
+    int disp;
+    double now;
+
+    PMPI_Comm_rank(MPI_COMM_WORLD, &prof.rank);
+    PMPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, prof.rank,
+                         MPI_INFO_NULL, &prof.node_comm);
+    PMPI_Comm_rank(prof.node_comm, &prof.local_rank);
+    PMPI_Comm_size(prof.node_comm, &prof.local_size);
+
+    /* The leader owns the node state, the other ranks map it. */
+    size = sizeof(struct node_state) + prof.local_size * sizeof(struct rank_slot);
+    PMPI_Win_allocate_shared(prof.local_rank == 0 ? size : 0, 1, MPI_INFO_NULL,
+                             prof.node_comm, &prof.node, &prof.win);
+    PMPI_Win_shared_query(prof.win, 0, &size, &disp, &prof.node);
+    prof.sample = &prof.node->sample;
+    if (prof.local_rank == 0)
+    {
+        memset(prof.node, 0, size);
+    }
+    slack_config();
+    PMPI_Barrier(prof.node_comm);
+
+    prof.thread_multiple = provided == MPI_THREAD_MULTIPLE;
+    prof.ncomms = 1;
+    prof.comm[0] = MPI_COMM_NULL;
+    snprintf(prof.comm_name[0], PMPI_COMM_NAME_LEN, "-");
+
+    if (prof.local_rank == 0)
+    {
+        start_leader();
+    }
+    /* Make the first sample visible before anyone measures. */
+    PMPI_Barrier(prof.node_comm);
+
+    now = now_seconds();
+    if (slack.enabled)
+    {
+        slack_join(now);
+    }
+    prof.start_time = now;
+    prof.start_joules = node_joules(prof.start_time);
+    prof.active = 1;
+}
+
+static void write_profile(double seconds, double joules)
+{
+    char path[PATH_MAX];
+    char hostname[1024];
+    char *dir = getenv("VARIORUM_PMPI_PROFILE_DIR");
+    FILE *output;
+    int call, c;
+
+    gethostname(hostname, 1024);
+    snprintf(path, PATH_MAX, "%s/variorum-pmpi.%d.dat", dir != NULL ? dir : ".",
+             prof.rank);
+    output = fopen(path, "w");
+    if (output == NULL)
+    {
+        variorum_error_handler("Could not open PMPI profile", VARIORUM_ERROR_INVAL,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return;
+    }
+    fprintf(output,
+            "_PMPI_ENERGY Host Rank Local_Rank Call Comm Calls Time_s Node_J Share_J\n");
+    fprintf(output, "_PMPI_ENERGY %s %d %d Total - 1 %lf %lf %lf\n", hostname,
+            prof.rank, prof.local_rank, seconds, joules, joules / prof.local_size);
+    for (call = 0; call < NUM_CALLS; call++)
+    {
+        for (c = 0; c < prof.ncomms; c++)
+        {
+            struct call_stats *st = &prof.stats[call][c];
+
+            if (st->calls == 0)
+            {
+                continue;
+            }
+            fprintf(output, "_PMPI_ENERGY %s %d %d %s %s %lu %lf %lf %lf\n",
+                    hostname, prof.rank, prof.local_rank, call_names[call],
+                    prof.comm_name[c], st->calls, st->seconds, st->joules,
+                    st->joules / prof.local_size);
+        }
+    }
+    if (slack.enabled)
+    {
+        fprintf(output,
+                "_PMPI_SLACK Host Rank Local_Rank Windows Wait_s Slack_Pct Avg_MHz Reduced_s Changes Est_Delay_s Est_Saved_J\n");
+        fprintf(output, "_PMPI_SLACK %s %d %d %lu %lf %lf %lf %lf %lu %lf %lf\n",
+                hostname, prof.rank, prof.local_rank, slack.windows, slack.wait_s,
+                seconds > 0.0 ? 100.0 * slack.wait_s / seconds : 0.0,
+                seconds > 0.0 ? slack.mhz_seconds / seconds : 0.0, slack.reduced_s,
+                slack.changes, slack.delay_s,
+                seconds > 0.0 ? slack.saved_s * joules / seconds / prof.local_size : 0.0);
+    }
+    fclose(output);
+}
+
+int MPI_Init(int *argc, char ***argv)
+{
+    int ret = PMPI_Init(argc, argv);
+
+    if (ret == MPI_SUCCESS)
+    {
+        pmpi_setup(MPI_THREAD_SINGLE);
+    }
+    return ret;
+}
+
+int MPI_Init_thread(int *argc, char ***argv, int required, int *provided)
+{
+    int ret = PMPI_Init_thread(argc, argv, required, provided);
+
+    if (ret == MPI_SUCCESS)
+    {
+        pmpi_setup(*provided);
+    }
+    return ret;
+}
+
+int MPI_Finalize(void)
+{
+    double time;
+
+    if (prof.active)
+    {
+        time = now_seconds();
+        if (slack.enabled)
+        {
+            slack_account(time);
+        }
+        write_profile(time - prof.start_time,
+                      node_joules(time) - prof.start_joules);
+        prof.active = 0;
+        if (slack.enabled)
+        {
+            __atomic_store_n(&prof.node->ranks[prof.local_rank].target_mhz,
+                             slack.max_mhz, __ATOMIC_RELEASE);
+        }
+
+        /* Nobody reads the window past this barrier. */
+        PMPI_Barrier(prof.node_comm);
+        if (leader.running)
+        {
+            __atomic_store_n(&leader.stop, 1, __ATOMIC_RELEASE);
+            pthread_join(leader.thread, NULL);
+            leader.running = 0;
+        }
+        if (prof.local_rank == 0 && prof.node->applying)
+        {
+            /* Restore every core of the node. */
+            apply_targets();
+            free(leader.applied);
+            free(leader.cpus);
+            free(leader.cpu_mhz);
+        }
+        PMPI_Win_free(&prof.win);
+        PMPI_Comm_free(&prof.node_comm);
+    }
+    return PMPI_Finalize();
+}
+
+int MPI_Comm_free(MPI_Comm *comm)
+{
+    int i;
+
+    if (prof.thread_multiple)
+    {
+        pthread_mutex_lock(&prof_lock);
+    }
+    /* The handle may be reused for a new communicator; keep the totals under
+     * the old name but stop matching the handle. */
+    for (i = 1; i < prof.ncomms; i++)
+    {
+        if (prof.comm[i] == *comm)
+        {
+            prof.comm[i] = MPI_COMM_NULL;
+        }
+    }
+    if (prof.thread_multiple)
+    {
+        pthread_mutex_unlock(&prof_lock);
+    }
+    return PMPI_Comm_free(comm);
+}
+
+int MPI_Send(const void *buf, int count, MPI_Datatype datatype, int dest,
+             int tag, MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_SEND, comm, PMPI_Send(buf, count, datatype, dest, tag, comm));
+    return ret;
+}
+
+int MPI_Recv(void *buf, int count, MPI_Datatype datatype, int source, int tag,
+             MPI_Comm comm, MPI_Status *status)
+{
+    int ret;
+    PROFILE(CALL_RECV, comm, PMPI_Recv(buf, count, datatype, source, tag, comm,
+                                       status));
+    return ret;
+}
+
+int MPI_Isend(const void *buf, int count, MPI_Datatype datatype, int dest,
+              int tag, MPI_Comm comm, MPI_Request *request)
+{
+    int ret;
+    PROFILE(CALL_ISEND, comm, PMPI_Isend(buf, count, datatype, dest, tag, comm,
+                                         request));
+    return ret;
+}
+
+int MPI_Irecv(void *buf, int count, MPI_Datatype datatype, int source, int tag,
+              MPI_Comm comm, MPI_Request *request)
+{
+    int ret;
+    PROFILE(CALL_IRECV, comm, PMPI_Irecv(buf, count, datatype, source, tag, comm,
+                                         request));
+    return ret;
+}
+
+int MPI_Sendrecv(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
+                 int dest, int sendtag, void *recvbuf, int recvcount,
+                 MPI_Datatype recvtype, int source, int recvtag, MPI_Comm comm,
+                 MPI_Status *status)
+{
+    int ret;
+    PROFILE(CALL_SENDRECV, comm, PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest,
+            sendtag, recvbuf, recvcount, recvtype, source, recvtag, comm, status));
+    return ret;
+}
+
+int MPI_Probe(int source, int tag, MPI_Comm comm, MPI_Status *status)
+{
+    int ret;
+    PROFILE(CALL_PROBE, comm, PMPI_Probe(source, tag, comm, status));
+    return ret;
+}
+
+int MPI_Wait(MPI_Request *request, MPI_Status *status)
+{
+    int ret;
+    PROFILE(CALL_WAIT, MPI_COMM_NULL, PMPI_Wait(request, status));
+    return ret;
+}
+
+int MPI_Waitall(int count, MPI_Request array_of_requests[],
+                MPI_Status array_of_statuses[])
+{
+    int ret;
+    PROFILE(CALL_WAITALL, MPI_COMM_NULL, PMPI_Waitall(count, array_of_requests,
+            array_of_statuses));
+    return ret;
+}
+
+int MPI_Waitany(int count, MPI_Request array_of_requests[], int *index,
+                MPI_Status *status)
+{
+    int ret;
+    PROFILE(CALL_WAITANY, MPI_COMM_NULL, PMPI_Waitany(count, array_of_requests,
+            index, status));
+    return ret;
+}
+
+int MPI_Waitsome(int incount, MPI_Request array_of_requests[], int *outcount,
+                 int array_of_indices[], MPI_Status array_of_statuses[])
+{
+    int ret;
+    PROFILE(CALL_WAITSOME, MPI_COMM_NULL, PMPI_Waitsome(incount,
+            array_of_requests, outcount, array_of_indices, array_of_statuses));
+    return ret;
+}
+
+int MPI_Barrier(MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_BARRIER, comm, PMPI_Barrier(comm));
+    return ret;
+}
+
+int MPI_Bcast(void *buffer, int count, MPI_Datatype datatype, int root,
+              MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_BCAST, comm, PMPI_Bcast(buffer, count, datatype, root, comm));
+    return ret;
+}
+
+int MPI_Reduce(const void *sendbuf, void *recvbuf, int count,
+               MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_REDUCE, comm, PMPI_Reduce(sendbuf, recvbuf, count, datatype, op,
+                                           root, comm));
+    return ret;
+}
+
+int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count,
+                  MPI_Datatype datatype, MPI_Op op, MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_ALLREDUCE, comm, PMPI_Allreduce(sendbuf, recvbuf, count,
+            datatype, op, comm));
+    return ret;
+}
+
+int MPI_Gather(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
+               void *recvbuf, int recvcount, MPI_Datatype recvtype, int root,
+               MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_GATHER, comm, PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf,
+                                           recvcount, recvtype, root, comm));
+    return ret;
+}
+
+int MPI_Gatherv(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
+                void *recvbuf, const int recvcounts[], const int displs[],
+                MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_GATHERV, comm, PMPI_Gatherv(sendbuf, sendcount, sendtype,
+            recvbuf, recvcounts, displs, recvtype, root, comm));
+    return ret;
+}
+
+int MPI_Scatter(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
+                void *recvbuf, int recvcount, MPI_Datatype recvtype, int root,
+                MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_SCATTER, comm, PMPI_Scatter(sendbuf, sendcount, sendtype,
+            recvbuf, recvcount, recvtype, root, comm));
+    return ret;
+}
+
+int MPI_Scatterv(const void *sendbuf, const int sendcounts[],
+                 const int displs[], MPI_Datatype sendtype, void *recvbuf,
+                 int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_SCATTERV, comm, PMPI_Scatterv(sendbuf, sendcounts, displs,
+            sendtype, recvbuf, recvcount, recvtype, root, comm));
+    return ret;
+}
+
+int MPI_Allgather(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
+                  void *recvbuf, int recvcount, MPI_Datatype recvtype,
+                  MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_ALLGATHER, comm, PMPI_Allgather(sendbuf, sendcount, sendtype,
+            recvbuf, recvcount, recvtype, comm));
+    return ret;
+}
+
+int MPI_Allgatherv(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
+                   void *recvbuf, const int recvcounts[], const int displs[],
+                   MPI_Datatype recvtype, MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_ALLGATHERV, comm, PMPI_Allgatherv(sendbuf, sendcount, sendtype,
+            recvbuf, recvcounts, displs, recvtype, comm));
+    return ret;
+}
+
+int MPI_Alltoall(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
+                 void *recvbuf, int recvcount, MPI_Datatype recvtype,
+                 MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_ALLTOALL, comm, PMPI_Alltoall(sendbuf, sendcount, sendtype,
+            recvbuf, recvcount, recvtype, comm));
+    return ret;
+}
+
+int MPI_Alltoallv(const void *sendbuf, const int sendcounts[],
+                  const int sdispls[], MPI_Datatype sendtype, void *recvbuf,
+                  const int recvcounts[], const int rdispls[],
+                  MPI_Datatype recvtype, MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_ALLTOALLV, comm, PMPI_Alltoallv(sendbuf, sendcounts, sdispls,
+            sendtype, recvbuf, recvcounts, rdispls, recvtype, comm));
+    return ret;
+}
+
+int MPI_Reduce_scatter(const void *sendbuf, void *recvbuf,
+                       const int recvcounts[], MPI_Datatype datatype, MPI_Op op,
+                       MPI_Comm comm)
+{
+    int ret;
+    PROFILE(CALL_REDUCE_SCATTER, comm, PMPI_Reduce_scatter(sendbuf, recvbuf,
+            recvcounts, datatype, op, comm));
+    return ret;
+}
@@ -0,0 +1,101 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <mpi.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_mpi.h>
+}
+
+#define MOCK_WATTS 50.0
+#define RANKS_PER_NODE 2
+#define MIN_ROUNDS 3
+
+static int rank = 0;
+static int nranks = 0;
+static struct variorum_mpi_job_power job;
+
+TEST(variorum_mpi, node_index)
+{
+    EXPECT_EQ(rank / RANKS_PER_NODE, variorum_mpi_node_index());
+}
+
+TEST(variorum_mpi, node_power)
+{
+    struct variorum_mpi_node_power node;
+
+    ASSERT_EQ(0, variorum_mpi_get_node_power(&node));
+    EXPECT_NEAR(MOCK_WATTS, node.node_watts, 0.01 * MOCK_WATTS);
+    EXPECT_NEAR(MOCK_WATTS, node.cpu_watts, 0.01 * MOCK_WATTS);
+    EXPECT_EQ(0.0, node.mem_watts);
+    EXPECT_EQ(0.0, node.gpu_watts);
+}
+
+TEST(variorum_mpi, job_power)
+{
+    int num_nodes = (nranks + RANKS_PER_NODE - 1) / RANKS_PER_NODE;
+
+    ASSERT_GE(job.round, (unsigned long)MIN_ROUNDS);
+    EXPECT_EQ(num_nodes, job.num_nodes);
+    EXPECT_NEAR(num_nodes * MOCK_WATTS, job.total_watts, 0.01 * MOCK_WATTS);
+    EXPECT_NEAR(num_nodes * MOCK_WATTS, job.cpu_watts, 0.01 * MOCK_WATTS);
+    EXPECT_NEAR(MOCK_WATTS, job.max_node_watts, 0.01 * MOCK_WATTS);
+    EXPECT_GE(job.max_node, 0);
+    EXPECT_LT(job.max_node, num_nodes);
+}
+
+TEST(variorum_mpi, node_powers)
+{
+    double watts[64];
+    int i, n;
+
+    n = variorum_mpi_get_node_powers(watts, 64);
+    ASSERT_EQ(job.num_nodes, n);
+    for (i = 0; i < n; i++)
+    {
+        EXPECT_NEAR(MOCK_WATTS, watts[i], 0.01 * MOCK_WATTS);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret, i;
+
+    ::testing::InitGoogleTest(&argc, argv);
+
+    setenv("VARIORUM_MPI_MOCK_WATTS", "50", 1);
+    setenv("VARIORUM_MPI_RANKS_PER_NODE", "2", 1);
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+
+    if (variorum_mpi_init(MPI_COMM_WORLD, 5) != 0)
+    {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    // Leaders progress reductions from their own calls; the first rounds may
+    // precede the first node sample.
+    for (i = 0; i < 5000; i++)
+    {
+        variorum_mpi_get_job_power(&job);
+        if (job.round >= MIN_ROUNDS + 1)
+        {
+            break;
+        }
+        usleep(1000);
+    }
+
+    ret = RUN_ALL_TESTS();
+
+    // Leaders may have posted different numbers of rounds by now.
+    variorum_mpi_finalize();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,116 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <math.h>
+#include <mpi.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_mpi.h>
+}
+
+#define BUDGET_WATTS 300.0
+#define NUM_BALANCES 30
+
+// Two emulated nodes; node 1 needs more power than its even share.
+static const double demand[2] = {100.0, 250.0};
+
+static int node = 0;
+static double first_cap = 0.0;
+static double last_cap = 0.0;
+static double caps[2];
+static double job_watts = 0.0;
+
+static double progress_at(int n, double cap)
+{
+    return (cap < demand[n] ? cap : demand[n]) / demand[n];
+}
+
+TEST(variorum_mpi_balancer, even_start)
+{
+    EXPECT_DOUBLE_EQ(BUDGET_WATTS / 2, first_cap);
+}
+
+TEST(variorum_mpi_balancer, power_moves_to_limited_node)
+{
+    EXPECT_GT(caps[1], caps[0]);
+    EXPECT_GT(caps[1], 180.0);
+    EXPECT_LE(caps[0] + caps[1], BUDGET_WATTS + 1e-6);
+    EXPECT_GE(caps[0], 50.0);
+}
+
+TEST(variorum_mpi_balancer, progress_converges)
+{
+    double start_gap = progress_at(0, BUDGET_WATTS / 2) -
+                       progress_at(1, BUDGET_WATTS / 2);
+    double gap = progress_at(0, caps[0]) - progress_at(1, caps[1]);
+
+    EXPECT_LT(fabs(gap), 0.5 * start_gap);
+}
+
+TEST(variorum_mpi_balancer, job_within_budget)
+{
+    // The mock nodes draw the lower of their demand and their cap.
+    EXPECT_LE(job_watts, BUDGET_WATTS * 1.01);
+    EXPECT_GT(job_watts, 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    struct variorum_mpi_job_power job;
+    double rank_caps[64];
+    unsigned long round;
+    int ret, i;
+
+    ::testing::InitGoogleTest(&argc, argv);
+
+    setenv("VARIORUM_MPI_MOCK_WATTS", "100,250", 1);
+    setenv("VARIORUM_MPI_RANKS_PER_NODE", "2", 1);
+
+    MPI_Init(&argc, &argv);
+
+    if (variorum_mpi_init(MPI_COMM_WORLD, 5) != 0 ||
+            variorum_mpi_balancer_init(BUDGET_WATTS, 50.0, 300.0) != 0)
+    {
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    node = variorum_mpi_node_index();
+    first_cap = BUDGET_WATTS / 2;
+    last_cap = first_cap;
+    for (i = 0; i < NUM_BALANCES; i++)
+    {
+        // A step of work whose speed depends on the node's power.
+        usleep(20000);
+        variorum_mpi_balancer_set_progress(progress_at(node, last_cap));
+        if (variorum_mpi_balance(&last_cap) != 0)
+        {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    // Ranks 0-1 are node 0 and ranks 2-3 node 1.
+    MPI_Allgather(&last_cap, 1, MPI_DOUBLE, rank_caps, 1, MPI_DOUBLE,
+                  MPI_COMM_WORLD);
+    caps[0] = rank_caps[0];
+    caps[1] = rank_caps[2];
+
+    // Wait for reductions of samples taken under the final caps.
+    variorum_mpi_get_job_power(&job);
+    round = job.round;
+    for (i = 0; i < 5000 && job.round < round + 3; i++)
+    {
+        usleep(1000);
+        variorum_mpi_get_job_power(&job);
+    }
+    job_watts = job.total_watts;
+
+    ret = RUN_ALL_TESTS();
+
+    variorum_mpi_finalize();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,150 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#define MOCK_WATTS 100.0
+#define NUM_ALLREDUCE 50
+#define NUM_EXCHANGES 20
+#define BARRIER_DELAY_US 200000
+
+static int rank = 0;
+static int nranks = 0;
+
+struct profile_line
+{
+    int found;
+    unsigned long calls;
+    double seconds;
+    double node_joules;
+    double share_joules;
+};
+
+// Find the line of a call and communicator in this rank's profile.
+static struct profile_line find_line(const char *call, const char *comm)
+{
+    struct profile_line line;
+    char path[64];
+    char buf[512];
+    FILE *profile;
+
+    memset(&line, 0, sizeof(line));
+    snprintf(path, sizeof(path), "variorum-pmpi.%d.dat", rank);
+    profile = fopen(path, "r");
+    if (profile == NULL)
+    {
+        return line;
+    }
+    while (fgets(buf, sizeof(buf), profile) != NULL)
+    {
+        char host[256], c[64], m[256];
+        int r, lr;
+        struct profile_line l;
+
+        if (sscanf(buf, "_PMPI_ENERGY %255s %d %d %63s %255s %lu %lf %lf %lf", host,
+                   &r, &lr, c, m, &l.calls, &l.seconds, &l.node_joules,
+                   &l.share_joules) == 9 && strcmp(c, call) == 0 &&
+                strcmp(m, comm) == 0)
+        {
+            line = l;
+            line.found = 1;
+        }
+    }
+    fclose(profile);
+    return line;
+}
+
+TEST(variorum_pmpi, calls_per_communicator)
+{
+    struct profile_line line = find_line("MPI_Allreduce", "MPI_COMM_WORLD");
+    ASSERT_TRUE(line.found);
+    EXPECT_EQ((unsigned long)NUM_ALLREDUCE, line.calls);
+
+    line = find_line("MPI_Isend", "halo");
+    ASSERT_TRUE(line.found);
+    EXPECT_EQ((unsigned long)NUM_EXCHANGES, line.calls);
+
+    // Completion calls have no communicator.
+    line = find_line("MPI_Waitall", "-");
+    ASSERT_TRUE(line.found);
+    EXPECT_EQ((unsigned long)NUM_EXCHANGES, line.calls);
+}
+
+TEST(variorum_pmpi, barrier_energy)
+{
+    struct profile_line line = find_line("MPI_Barrier", "MPI_COMM_WORLD");
+    ASSERT_TRUE(line.found);
+    EXPECT_EQ(1ul, line.calls);
+    if (rank != 0)
+    {
+        // Waiting for rank 0 to arrive.
+        EXPECT_GT(line.seconds, 0.5 * BARRIER_DELAY_US / 1e6);
+    }
+    EXPECT_NEAR(MOCK_WATTS * line.seconds, line.node_joules,
+                0.01 * MOCK_WATTS * line.seconds + 1e-3);
+    EXPECT_LE(line.share_joules, line.node_joules);
+}
+
+TEST(variorum_pmpi, total)
+{
+    struct profile_line line = find_line("Total", "-");
+    ASSERT_TRUE(line.found);
+    EXPECT_GT(line.seconds, BARRIER_DELAY_US / 1e6);
+    EXPECT_GT(line.node_joules, 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+    MPI_Comm halo;
+    int sendbuf, recvbuf, i;
+    MPI_Request req[2];
+
+    ::testing::InitGoogleTest(&argc, argv);
+
+    setenv("VARIORUM_PMPI_MOCK_WATTS", "100", 1);
+    setenv("VARIORUM_PMPI_INTERVAL_MS", "1", 1);
+    unsetenv("VARIORUM_PMPI_PROFILE_DIR");
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+
+    for (i = 0; i < NUM_ALLREDUCE; i++)
+    {
+        sendbuf = rank;
+        MPI_Allreduce(&sendbuf, &recvbuf, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    }
+
+    MPI_Comm_dup(MPI_COMM_WORLD, &halo);
+    MPI_Comm_set_name(halo, "halo");
+    for (i = 0; i < NUM_EXCHANGES; i++)
+    {
+        sendbuf = rank;
+        MPI_Isend(&sendbuf, 1, MPI_INT, (rank + 1) % nranks, 0, halo, &req[0]);
+        MPI_Irecv(&recvbuf, 1, MPI_INT, (rank + nranks - 1) % nranks, 0, halo,
+                  &req[1]);
+        MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
+    }
+    MPI_Comm_free(&halo);
+
+    if (rank == 0)
+    {
+        usleep(BARRIER_DELAY_US);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // The profile is written here.
+    MPI_Finalize();
+
+    ret = RUN_ALL_TESTS();
+    return ret;
+}
@@ -0,0 +1,183 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#define MOCK_WATTS 100.0
+#define MIN_MHZ 1000
+#define MAX_MHZ 2000
+#define NUM_ITERATIONS 40
+#define COMPUTE_US 20000
+#define PROFILE_DIR "pmpi-slack"
+
+static int rank = 0;
+
+struct slack_line
+{
+    int found;
+    unsigned long windows;
+    double wait_s;
+    double slack_pct;
+    double avg_mhz;
+    double reduced_s;
+    unsigned long changes;
+    double delay_s;
+    double saved_joules;
+};
+
+struct total_line
+{
+    int found;
+    double seconds;
+    double node_joules;
+};
+
+static FILE *open_profile(void)
+{
+    char path[128];
+
+    snprintf(path, sizeof(path), PROFILE_DIR "/variorum-pmpi.%d.dat", rank);
+    return fopen(path, "r");
+}
+
+static struct slack_line find_slack(void)
+{
+    struct slack_line line;
+    char buf[512];
+    FILE *profile = open_profile();
+
+    memset(&line, 0, sizeof(line));
+    if (profile == NULL)
+    {
+        return line;
+    }
+    while (fgets(buf, sizeof(buf), profile) != NULL)
+    {
+        char host[256];
+        int r, lr;
+
+        if (sscanf(buf, "_PMPI_SLACK %255s %d %d %lu %lf %lf %lf %lf %lu %lf %lf",
+                   host, &r, &lr, &line.windows, &line.wait_s, &line.slack_pct,
+                   &line.avg_mhz, &line.reduced_s, &line.changes, &line.delay_s,
+                   &line.saved_joules) == 11)
+        {
+            line.found = 1;
+        }
+    }
+    fclose(profile);
+    return line;
+}
+
+static struct total_line find_total(void)
+{
+    struct total_line line;
+    char buf[512];
+    FILE *profile = open_profile();
+
+    memset(&line, 0, sizeof(line));
+    if (profile == NULL)
+    {
+        return line;
+    }
+    while (fgets(buf, sizeof(buf), profile) != NULL)
+    {
+        char host[256];
+        int r, lr;
+        unsigned long calls;
+        double share;
+
+        if (sscanf(buf, "_PMPI_ENERGY %255s %d %d Total - %lu %lf %lf %lf", host,
+                   &r, &lr, &calls, &line.seconds, &line.node_joules, &share) == 7)
+        {
+            line.found = 1;
+        }
+    }
+    fclose(profile);
+    return line;
+}
+
+TEST(variorum_pmpi_slack, critical_rank_keeps_frequency)
+{
+    struct slack_line line = find_slack();
+
+    if (rank != 0)
+    {
+        GTEST_SKIP();
+    }
+    ASSERT_TRUE(line.found);
+    EXPECT_GT(line.windows, 0ul);
+    EXPECT_LT(line.slack_pct, 10.0);
+    EXPECT_EQ(0ul, line.changes);
+    EXPECT_NEAR(MAX_MHZ, line.avg_mhz, 1.0);
+    EXPECT_EQ(0.0, line.reduced_s);
+}
+
+TEST(variorum_pmpi_slack, waiting_ranks_slow_down)
+{
+    struct slack_line line = find_slack();
+
+    if (rank == 0)
+    {
+        GTEST_SKIP();
+    }
+    ASSERT_TRUE(line.found);
+    EXPECT_GT(line.slack_pct, 50.0);
+    EXPECT_GT(line.changes, 0ul);
+    EXPECT_LT(line.avg_mhz, 0.8 * MAX_MHZ);
+    EXPECT_GE(line.avg_mhz, MIN_MHZ);
+    EXPECT_GT(line.reduced_s, 0.0);
+    EXPECT_GT(line.saved_joules, 0.0);
+}
+
+TEST(variorum_pmpi_slack, node_energy_reduced)
+{
+    struct total_line line = find_total();
+
+    ASSERT_TRUE(line.found);
+    // The mock node power follows the mean frequency of its ranks.
+    EXPECT_LT(line.node_joules, 0.9 * MOCK_WATTS * line.seconds);
+}
+
+int main(int argc, char **argv)
+{
+    int ret, i;
+
+    ::testing::InitGoogleTest(&argc, argv);
+
+    setenv("VARIORUM_PMPI_MOCK_WATTS", "100", 1);
+    setenv("VARIORUM_PMPI_INTERVAL_MS", "1", 1);
+    setenv("VARIORUM_PMPI_SLACK", "1", 1);
+    setenv("VARIORUM_PMPI_SLACK_WINDOW_MS", "50", 1);
+    setenv("VARIORUM_PMPI_SLACK_MIN_MHZ", "1000", 1);
+    setenv("VARIORUM_PMPI_SLACK_MAX_MHZ", "2000", 1);
+    setenv("VARIORUM_PMPI_PROFILE_DIR", PROFILE_DIR, 1);
+    mkdir(PROFILE_DIR, 0755);
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Rank 0 is on the critical path, the others wait for it.
+    for (i = 0; i < NUM_ITERATIONS; i++)
+    {
+        if (rank == 0)
+        {
+            usleep(COMPUTE_US);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    // The profile is written here.
+    MPI_Finalize();
+
+    ret = RUN_ALL_TESTS();
+    return ret;
+}
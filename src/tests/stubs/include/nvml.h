@@ -0,0 +1,162 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef NVML_STUB_H_INCLUDE
+#define NVML_STUB_H_INCLUDE
+
+// The subset of the NVML API used by Variorum, with the same names, values,
+// and signatures, for building and testing without GPUs.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum nvmlReturn_enum
+{
+    NVML_SUCCESS = 0,
+    NVML_ERROR_UNINITIALIZED = 1,
+    NVML_ERROR_INVALID_ARGUMENT = 2,
+    NVML_ERROR_NOT_SUPPORTED = 3,
+    NVML_ERROR_NO_PERMISSION = 4,
+    NVML_ERROR_NOT_FOUND = 6,
+    NVML_ERROR_INSUFFICIENT_SIZE = 7,
+    NVML_ERROR_UNKNOWN = 999
+} nvmlReturn_t;
+
+typedef struct nvmlDevice_st *nvmlDevice_t;
+
+typedef enum nvmlTemperatureSensors_enum
+{
+    NVML_TEMPERATURE_GPU = 0,
+} nvmlTemperatureSensors_t;
+
+typedef enum nvmlClockType_enum
+{
+    NVML_CLOCK_GRAPHICS = 0,
+    NVML_CLOCK_SM = 1,
+    NVML_CLOCK_MEM = 2,
+    NVML_CLOCK_VIDEO = 3,
+} nvmlClockType_t;
+
+typedef enum nvmlClockId_enum
+{
+    NVML_CLOCK_ID_CURRENT = 0,
+} nvmlClockId_t;
+
+typedef struct nvmlUtilization_st
+{
+    unsigned int gpu;
+    unsigned int memory;
+} nvmlUtilization_t;
+
+typedef enum nvmlValueType_enum
+{
+    NVML_VALUE_TYPE_DOUBLE = 0,
+    NVML_VALUE_TYPE_UNSIGNED_INT = 1,
+    NVML_VALUE_TYPE_UNSIGNED_LONG = 2,
+    NVML_VALUE_TYPE_UNSIGNED_LONG_LONG = 3,
+    NVML_VALUE_TYPE_SIGNED_LONG_LONG = 4,
+    NVML_VALUE_TYPE_SIGNED_INT = 5,
+    NVML_VALUE_TYPE_COUNT
+} nvmlValueType_t;
+
+typedef union nvmlValue_st
+{
+    double dVal;
+    int siVal;
+    unsigned int uiVal;
+    unsigned long ulVal;
+    unsigned long long ullVal;
+    signed long long sllVal;
+} nvmlValue_t;
+
+#define NVML_FI_DEV_TOTAL_ENERGY_CONSUMPTION 83
+#define NVML_FI_DEV_POWER_AVERAGE            185
+#define NVML_FI_DEV_POWER_INSTANT            186
+#define NVML_FI_DEV_POWER_CURRENT_LIMIT      190
+
+typedef struct nvmlFieldValue_st
+{
+    unsigned int fieldId;
+    unsigned int scopeId;
+    long long timestamp;
+    long long latencyUsec;
+    nvmlValueType_t valueType;
+    nvmlReturn_t nvmlReturn;
+    nvmlValue_t value;
+} nvmlFieldValue_t;
+
+typedef enum nvmlSamplingType_enum
+{
+    NVML_TOTAL_POWER_SAMPLES = 0,
+    NVML_GPU_UTILIZATION_SAMPLES = 1,
+    NVML_MEMORY_UTILIZATION_SAMPLES = 2,
+} nvmlSamplingType_t;
+
+typedef struct nvmlSample_st
+{
+    unsigned long long timeStamp;
+    nvmlValue_t sampleValue;
+} nvmlSample_t;
+
+nvmlReturn_t nvmlInit(void);
+
+nvmlReturn_t nvmlShutdown(void);
+
+nvmlReturn_t nvmlDeviceGetCount(unsigned int *deviceCount);
+
+nvmlReturn_t nvmlDeviceGetHandleByIndex(unsigned int index,
+                                        nvmlDevice_t *device);
+
+nvmlReturn_t nvmlDeviceGetPowerUsage(nvmlDevice_t device, unsigned int *power);
+
+nvmlReturn_t nvmlDeviceGetTotalEnergyConsumption(nvmlDevice_t device,
+        unsigned long long *energy);
+
+nvmlReturn_t nvmlDeviceGetTemperature(nvmlDevice_t device,
+                                      nvmlTemperatureSensors_t sensorType,
+                                      unsigned int *temp);
+
+nvmlReturn_t nvmlDeviceGetEnforcedPowerLimit(nvmlDevice_t device,
+        unsigned int *limit);
+
+nvmlReturn_t nvmlDeviceGetClock(nvmlDevice_t device, nvmlClockType_t clockType,
+                                nvmlClockId_t clockId, unsigned int *clockMHz);
+
+nvmlReturn_t nvmlDeviceGetUtilizationRates(nvmlDevice_t device,
+        nvmlUtilization_t *utilization);
+
+nvmlReturn_t nvmlDeviceSetPowerManagementLimit(nvmlDevice_t device,
+        unsigned int limit);
+
+nvmlReturn_t nvmlDeviceGetFieldValues(nvmlDevice_t device, int valuesCount,
+                                      nvmlFieldValue_t *values);
+
+nvmlReturn_t nvmlDeviceGetSamples(nvmlDevice_t device, nvmlSamplingType_t type,
+                                  unsigned long long lastSeenTimeStamp,
+                                  nvmlValueType_t *sampleValType,
+                                  unsigned int *sampleCount,
+                                  nvmlSample_t *samples);
+
+// Stub only. The stub reports NVML_STUB_DEVICES devices (default 4); device
+// d draws 100 + 10 * d watts, and the driver keeps a power sample every
+// 20 ms. With NVML_STUB_NO_ENERGY=1 the devices have no energy counter, like
+// GPUs older than Volta, with NVML_STUB_NO_FIELDS=1 the driver does not
+// support field value queries, and with NVML_STUB_NO_POWER=1 power readings
+// fail. NVML_STUB_ENFORCED_MW=<mW> holds the enforced power limit below the
+// power management limit, as another limiter would.
+
+// Number of device queries (nvmlDeviceGet* calls other than handle lookups)
+// made so far.
+unsigned nvml_stub_query_count(void);
+
+// Number of nvmlDeviceGetSamples() calls made so far.
+unsigned nvml_stub_samples_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
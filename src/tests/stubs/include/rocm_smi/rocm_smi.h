@@ -0,0 +1,119 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef ROCM_SMI_STUB_H_INCLUDE
+#define ROCM_SMI_STUB_H_INCLUDE
+
+// The subset of the ROCm SMI API used by Variorum, with the same names,
+// values, and signatures, for building and testing without GPUs.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    RSMI_STATUS_SUCCESS = 0x0,
+    RSMI_STATUS_INVALID_ARGS = 0x1,
+    RSMI_STATUS_NOT_SUPPORTED = 0x2,
+    RSMI_STATUS_FILE_ERROR = 0x3,
+    RSMI_STATUS_PERMISSION = 0x4,
+    RSMI_STATUS_OUT_OF_RESOURCES = 0x5,
+    RSMI_STATUS_INTERNAL_EXCEPTION = 0x6,
+    RSMI_STATUS_INPUT_OUT_OF_BOUNDS = 0x7,
+    RSMI_STATUS_INIT_ERROR = 0x8,
+} rsmi_status_t;
+
+typedef enum
+{
+    RSMI_AVERAGE_POWER = 0,
+    RSMI_CURRENT_POWER,
+    RSMI_INVALID_POWER = 0xFFFFFFFF
+} RSMI_POWER_TYPE;
+
+typedef enum
+{
+    RSMI_TEMP_TYPE_EDGE = 0,
+    RSMI_TEMP_TYPE_JUNCTION,
+    RSMI_TEMP_TYPE_MEMORY,
+} rsmi_temperature_type_t;
+
+typedef enum
+{
+    RSMI_TEMP_CURRENT = 0x0,
+} rsmi_temperature_metric_t;
+
+typedef enum
+{
+    RSMI_CLK_TYPE_SYS = 0x0,
+    RSMI_CLK_TYPE_DF,
+    RSMI_CLK_TYPE_DCEF,
+    RSMI_CLK_TYPE_SOC,
+    RSMI_CLK_TYPE_MEM,
+} rsmi_clk_type_t;
+
+#define RSMI_MAX_NUM_FREQUENCIES 32
+
+typedef struct
+{
+    uint32_t num_supported;
+    uint32_t current;
+    uint64_t frequency[RSMI_MAX_NUM_FREQUENCIES];
+} rsmi_frequencies_t;
+
+rsmi_status_t rsmi_init(uint64_t init_flags);
+
+rsmi_status_t rsmi_shut_down(void);
+
+rsmi_status_t rsmi_num_monitor_devices(uint32_t *num_devices);
+
+rsmi_status_t rsmi_dev_power_get(uint32_t dv_ind, uint64_t *power,
+                                 RSMI_POWER_TYPE *type);
+
+rsmi_status_t rsmi_dev_power_ave_get(uint32_t dv_ind, uint32_t sensor_ind,
+                                     uint64_t *power);
+
+rsmi_status_t rsmi_dev_energy_count_get(uint32_t dv_ind, uint64_t *power,
+                                        float *counter_resolution,
+                                        uint64_t *timestamp);
+
+rsmi_status_t rsmi_dev_power_cap_get(uint32_t dv_ind, uint32_t sensor_ind,
+                                     uint64_t *cap);
+
+rsmi_status_t rsmi_dev_power_cap_range_get(uint32_t dv_ind,
+        uint32_t sensor_ind, uint64_t *max, uint64_t *min);
+
+rsmi_status_t rsmi_dev_power_cap_set(uint32_t dv_ind, uint32_t sensor_ind,
+                                     uint64_t cap);
+
+rsmi_status_t rsmi_dev_temp_metric_get(uint32_t dv_ind, uint32_t sensor_type,
+                                       rsmi_temperature_metric_t metric,
+                                       int64_t *temperature);
+
+rsmi_status_t rsmi_dev_gpu_clk_freq_get(uint32_t dv_ind,
+                                        rsmi_clk_type_t clk_type,
+                                        rsmi_frequencies_t *f);
+
+rsmi_status_t rsmi_dev_busy_percent_get(uint32_t dv_ind,
+                                        uint32_t *busy_percent);
+
+// Stub only. The stub reports RSMI_STUB_DEVICES devices (default 4) and
+// sleeps RSMI_STUB_LATENCY_US microseconds in each device query. Device d
+// draws 100 + 10 * d watts; its energy counter starts at the first
+// rsmi_init().
+
+/// @brief Number of successful rsmi_init() calls.
+unsigned rsmi_stub_init_count(void);
+
+/// @brief Largest number of device queries that were in flight at once.
+unsigned rsmi_stub_max_concurrency(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,362 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <nvml.h>
+
+#define STUB_MAX_DEVICES 64
+/* The driver keeps a power sample every 20 ms, the last 100 of them. */
+#define STUB_SAMPLE_PERIOD_US 20000
+#define STUB_MAX_SAMPLES 100
+
+struct nvmlDevice_st
+{
+    unsigned int index;
+    unsigned int limit_mw;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned refs;
+static struct nvmlDevice_st devices[STUB_MAX_DEVICES];
+/* Time of the first nvmlInit(), when the energy counters start at zero. */
+static uint64_t origin_ns;
+static unsigned queries;
+static unsigned samples_queries;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned int num_devices(void)
+{
+    char *val = getenv("NVML_STUB_DEVICES");
+    int n = val != NULL ? atoi(val) : 4;
+
+    if (n < 0)
+    {
+        return 0;
+    }
+    return n > STUB_MAX_DEVICES ? STUB_MAX_DEVICES : (unsigned int)n;
+}
+
+static nvmlReturn_t check(nvmlDevice_t device)
+{
+    if (refs == 0)
+    {
+        return NVML_ERROR_UNINITIALIZED;
+    }
+    if (device == NULL || device->index >= num_devices())
+    {
+        return NVML_ERROR_INVALID_ARGUMENT;
+    }
+    return NVML_SUCCESS;
+}
+
+/* A device query, counted for nvml_stub_query_count(). */
+static nvmlReturn_t query(nvmlDevice_t device)
+{
+    __atomic_fetch_add(&queries, 1, __ATOMIC_RELAXED);
+    return check(device);
+}
+
+static int env_flag(const char *name)
+{
+    char *val = getenv(name);
+
+    return val != NULL && atoi(val) == 1;
+}
+
+static unsigned int device_watts(nvmlDevice_t device)
+{
+    return 100 + 10 * device->index;
+}
+
+/* Millijoules since the first nvmlInit() at constant power. */
+static unsigned long long device_energy(nvmlDevice_t device)
+{
+    return (now_ns() - origin_ns) / 1000000 * device_watts(device);
+}
+
+nvmlReturn_t nvmlInit(void)
+{
+    pthread_mutex_lock(&lock);
+    if (origin_ns == 0)
+    {
+        unsigned int d;
+        origin_ns = now_ns();
+        for (d = 0; d < STUB_MAX_DEVICES; d++)
+        {
+            devices[d].index = d;
+            devices[d].limit_mw = 250000;
+        }
+    }
+    refs++;
+    pthread_mutex_unlock(&lock);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlShutdown(void)
+{
+    nvmlReturn_t ret = NVML_SUCCESS;
+
+    pthread_mutex_lock(&lock);
+    if (refs == 0)
+    {
+        ret = NVML_ERROR_UNINITIALIZED;
+    }
+    else
+    {
+        refs--;
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+nvmlReturn_t nvmlDeviceGetCount(unsigned int *deviceCount)
+{
+    if (refs == 0)
+    {
+        return NVML_ERROR_UNINITIALIZED;
+    }
+    *deviceCount = num_devices();
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetHandleByIndex(unsigned int index,
+                                        nvmlDevice_t *device)
+{
+    if (refs == 0)
+    {
+        return NVML_ERROR_UNINITIALIZED;
+    }
+    if (index >= num_devices())
+    {
+        return NVML_ERROR_INVALID_ARGUMENT;
+    }
+    *device = &devices[index];
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetPowerUsage(nvmlDevice_t device, unsigned int *power)
+{
+    nvmlReturn_t ret = query(device);
+
+    if (ret == NVML_SUCCESS && env_flag("NVML_STUB_NO_POWER"))
+    {
+        ret = NVML_ERROR_UNKNOWN;
+    }
+    if (ret == NVML_SUCCESS)
+    {
+        *power = device_watts(device) * 1000;
+    }
+    return ret;
+}
+
+nvmlReturn_t nvmlDeviceGetTotalEnergyConsumption(nvmlDevice_t device,
+        unsigned long long *energy)
+{
+    nvmlReturn_t ret = query(device);
+
+    if (ret == NVML_SUCCESS && env_flag("NVML_STUB_NO_ENERGY"))
+    {
+        ret = NVML_ERROR_NOT_SUPPORTED;
+    }
+    if (ret == NVML_SUCCESS)
+    {
+        *energy = device_energy(device);
+    }
+    return ret;
+}
+
+nvmlReturn_t nvmlDeviceGetTemperature(nvmlDevice_t device,
+                                      nvmlTemperatureSensors_t sensorType,
+                                      unsigned int *temp)
+{
+    nvmlReturn_t ret = query(device);
+
+    (void)sensorType;
+    if (ret == NVML_SUCCESS)
+    {
+        *temp = 50 + device->index;
+    }
+    return ret;
+}
+
+nvmlReturn_t nvmlDeviceGetEnforcedPowerLimit(nvmlDevice_t device,
+        unsigned int *limit)
+{
+    nvmlReturn_t ret = query(device);
+    char *val = getenv("NVML_STUB_ENFORCED_MW");
+
+    if (ret == NVML_SUCCESS)
+    {
+        *limit = device->limit_mw;
+        if (val != NULL && (unsigned)atoi(val) < *limit)
+        {
+            *limit = atoi(val);
+        }
+    }
+    return ret;
+}
+
+nvmlReturn_t nvmlDeviceGetClock(nvmlDevice_t device, nvmlClockType_t clockType,
+                                nvmlClockId_t clockId, unsigned int *clockMHz)
+{
+    nvmlReturn_t ret = query(device);
+
+    (void)clockId;
+    if (ret == NVML_SUCCESS)
+    {
+        *clockMHz = clockType == NVML_CLOCK_MEM ? 1215 : 1410;
+    }
+    return ret;
+}
+
+nvmlReturn_t nvmlDeviceGetUtilizationRates(nvmlDevice_t device,
+        nvmlUtilization_t *utilization)
+{
+    nvmlReturn_t ret = query(device);
+
+    if (ret == NVML_SUCCESS)
+    {
+        utilization->gpu = (10 * device->index) % 101;
+        utilization->memory = (5 * device->index) % 101;
+    }
+    return ret;
+}
+
+nvmlReturn_t nvmlDeviceSetPowerManagementLimit(nvmlDevice_t device,
+        unsigned int limit)
+{
+    nvmlReturn_t ret = check(device);
+
+    if (ret == NVML_SUCCESS)
+    {
+        if (limit < 100000 || limit > 400000)
+        {
+            return NVML_ERROR_INVALID_ARGUMENT;
+        }
+        device->limit_mw = limit;
+    }
+    return ret;
+}
+
+nvmlReturn_t nvmlDeviceGetFieldValues(nvmlDevice_t device, int valuesCount,
+                                      nvmlFieldValue_t *values)
+{
+    nvmlReturn_t ret = query(device);
+    long long now_us = now_ns() / 1000;
+    int i;
+
+    if (ret == NVML_SUCCESS && env_flag("NVML_STUB_NO_FIELDS"))
+    {
+        ret = NVML_ERROR_NOT_SUPPORTED;
+    }
+    if (ret != NVML_SUCCESS)
+    {
+        return ret;
+    }
+    for (i = 0; i < valuesCount; i++)
+    {
+        nvmlFieldValue_t *v = &values[i];
+
+        v->timestamp = now_us;
+        v->latencyUsec = 0;
+        v->nvmlReturn = NVML_SUCCESS;
+        switch (v->fieldId)
+        {
+            case NVML_FI_DEV_TOTAL_ENERGY_CONSUMPTION:
+                if (env_flag("NVML_STUB_NO_ENERGY"))
+                {
+                    v->nvmlReturn = NVML_ERROR_NOT_SUPPORTED;
+                    break;
+                }
+                v->valueType = NVML_VALUE_TYPE_UNSIGNED_LONG_LONG;
+                v->value.ullVal = device_energy(device);
+                break;
+            case NVML_FI_DEV_POWER_AVERAGE:
+            case NVML_FI_DEV_POWER_INSTANT:
+                if (env_flag("NVML_STUB_NO_POWER"))
+                {
+                    v->nvmlReturn = NVML_ERROR_UNKNOWN;
+                    break;
+                }
+                v->valueType = NVML_VALUE_TYPE_UNSIGNED_INT;
+                v->value.uiVal = device_watts(device) * 1000;
+                break;
+            case NVML_FI_DEV_POWER_CURRENT_LIMIT:
+                v->valueType = NVML_VALUE_TYPE_UNSIGNED_INT;
+                v->value.uiVal = device->limit_mw;
+                break;
+            default:
+                v->nvmlReturn = NVML_ERROR_NOT_SUPPORTED;
+                break;
+        }
+    }
+    return NVML_SUCCESS;
+}
+
+/* Power samples are taken every STUB_SAMPLE_PERIOD_US since the first
+ * nvmlInit(), and returned oldest first. */
+nvmlReturn_t nvmlDeviceGetSamples(nvmlDevice_t device, nvmlSamplingType_t type,
+                                  unsigned long long lastSeenTimeStamp,
+                                  nvmlValueType_t *sampleValType,
+                                  unsigned int *sampleCount,
+                                  nvmlSample_t *samples)
+{
+    nvmlReturn_t ret = query(device);
+    unsigned long long origin_us = origin_ns / 1000;
+    unsigned long long last, first, k;
+    unsigned int n = 0;
+
+    __atomic_fetch_add(&samples_queries, 1, __ATOMIC_RELAXED);
+    if (ret != NVML_SUCCESS)
+    {
+        return ret;
+    }
+    if (type != NVML_TOTAL_POWER_SAMPLES || sampleCount == NULL)
+    {
+        return NVML_ERROR_NOT_SUPPORTED;
+    }
+    *sampleValType = NVML_VALUE_TYPE_UNSIGNED_INT;
+    if (samples == NULL)
+    {
+        *sampleCount = STUB_MAX_SAMPLES;
+        return NVML_SUCCESS;
+    }
+
+    last = (now_ns() / 1000 - origin_us) / STUB_SAMPLE_PERIOD_US;
+    first = last >= STUB_MAX_SAMPLES ? last - STUB_MAX_SAMPLES + 1 : 1;
+    if (lastSeenTimeStamp >= origin_us)
+    {
+        k = (lastSeenTimeStamp - origin_us) / STUB_SAMPLE_PERIOD_US + 1;
+        first = k > first ? k : first;
+    }
+    for (k = first; k <= last && n < *sampleCount; k++, n++)
+    {
+        samples[n].timeStamp = origin_us + k * STUB_SAMPLE_PERIOD_US;
+        samples[n].sampleValue.uiVal = device_watts(device) * 1000;
+    }
+    *sampleCount = n;
+    return n > 0 ? NVML_SUCCESS : NVML_ERROR_NOT_FOUND;
+}
+
+unsigned nvml_stub_query_count(void)
+{
+    return __atomic_load_n(&queries, __ATOMIC_RELAXED);
+}
+
+unsigned nvml_stub_samples_count(void)
+{
+    return __atomic_load_n(&samples_queries, __ATOMIC_RELAXED);
+}
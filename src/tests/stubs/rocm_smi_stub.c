@@ -0,0 +1,269 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <rocm_smi/rocm_smi.h>
+
+#define STUB_MAX_DEVICES 64
+
+/* Energy counter increment (uJ). */
+#define STUB_ENERGY_RESOLUTION 15.3f
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned init_count;
+static unsigned refs;
+static unsigned in_flight;
+static unsigned max_in_flight;
+static uint64_t cap_uw[STUB_MAX_DEVICES];
+/* Time of the first rsmi_init(), when the energy counters start at zero. */
+static uint64_t origin_ns;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t num_devices(void)
+{
+    char *val = getenv("RSMI_STUB_DEVICES");
+    int n = val != NULL ? atoi(val) : 4;
+
+    if (n < 0)
+    {
+        return 0;
+    }
+    return n > STUB_MAX_DEVICES ? STUB_MAX_DEVICES : (uint32_t)n;
+}
+
+/* Every device query goes through here: check the session and the index,
+ * and account for concurrent callers while sleeping the configured latency. */
+static rsmi_status_t enter(uint32_t dv_ind)
+{
+    char *val = getenv("RSMI_STUB_LATENCY_US");
+
+    pthread_mutex_lock(&lock);
+    if (refs == 0)
+    {
+        pthread_mutex_unlock(&lock);
+        return RSMI_STATUS_INIT_ERROR;
+    }
+    if (dv_ind >= num_devices())
+    {
+        pthread_mutex_unlock(&lock);
+        return RSMI_STATUS_INVALID_ARGS;
+    }
+    if (++in_flight > max_in_flight)
+    {
+        max_in_flight = in_flight;
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (val != NULL)
+    {
+        usleep(atoi(val));
+    }
+
+    pthread_mutex_lock(&lock);
+    in_flight--;
+    pthread_mutex_unlock(&lock);
+    return RSMI_STATUS_SUCCESS;
+}
+
+rsmi_status_t rsmi_init(uint64_t init_flags)
+{
+    (void)init_flags;
+    pthread_mutex_lock(&lock);
+    if (origin_ns == 0)
+    {
+        origin_ns = now_ns();
+    }
+    if (refs++ == 0)
+    {
+        uint32_t d;
+        for (d = 0; d < STUB_MAX_DEVICES; d++)
+        {
+            cap_uw[d] = 300000000;
+        }
+    }
+    init_count++;
+    pthread_mutex_unlock(&lock);
+    return RSMI_STATUS_SUCCESS;
+}
+
+rsmi_status_t rsmi_shut_down(void)
+{
+    rsmi_status_t ret = RSMI_STATUS_SUCCESS;
+
+    pthread_mutex_lock(&lock);
+    if (refs == 0)
+    {
+        ret = RSMI_STATUS_INIT_ERROR;
+    }
+    else
+    {
+        refs--;
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+rsmi_status_t rsmi_num_monitor_devices(uint32_t *num)
+{
+    if (num == NULL)
+    {
+        return RSMI_STATUS_INVALID_ARGS;
+    }
+    *num = num_devices();
+    return RSMI_STATUS_SUCCESS;
+}
+
+/* Device d draws 100 + 10 * d watts. */
+rsmi_status_t rsmi_dev_power_get(uint32_t dv_ind, uint64_t *power,
+                                 RSMI_POWER_TYPE *type)
+{
+    rsmi_status_t ret = enter(dv_ind);
+
+    if (ret == RSMI_STATUS_SUCCESS)
+    {
+        *power = (100 + 10 * (uint64_t)dv_ind) * 1000000;
+        *type = RSMI_AVERAGE_POWER;
+    }
+    return ret;
+}
+
+rsmi_status_t rsmi_dev_energy_count_get(uint32_t dv_ind, uint64_t *power,
+                                        float *counter_resolution,
+                                        uint64_t *timestamp)
+{
+    rsmi_status_t ret = enter(dv_ind);
+
+    if (ret == RSMI_STATUS_SUCCESS)
+    {
+        uint64_t now = now_ns();
+        /* W x us = uJ */
+        double uj = (100 + 10 * (double)dv_ind) * ((now - origin_ns) / 1000);
+
+        *power = (uint64_t)(uj / STUB_ENERGY_RESOLUTION);
+        *counter_resolution = STUB_ENERGY_RESOLUTION;
+        *timestamp = now;
+    }
+    return ret;
+}
+
+rsmi_status_t rsmi_dev_power_ave_get(uint32_t dv_ind, uint32_t sensor_ind,
+                                     uint64_t *power)
+{
+    RSMI_POWER_TYPE type;
+
+    (void)sensor_ind;
+    return rsmi_dev_power_get(dv_ind, power, &type);
+}
+
+rsmi_status_t rsmi_dev_power_cap_get(uint32_t dv_ind, uint32_t sensor_ind,
+                                     uint64_t *cap)
+{
+    rsmi_status_t ret = enter(dv_ind);
+
+    (void)sensor_ind;
+    if (ret == RSMI_STATUS_SUCCESS)
+    {
+        *cap = cap_uw[dv_ind];
+    }
+    return ret;
+}
+
+rsmi_status_t rsmi_dev_power_cap_range_get(uint32_t dv_ind,
+        uint32_t sensor_ind, uint64_t *max, uint64_t *min)
+{
+    rsmi_status_t ret = enter(dv_ind);
+
+    (void)sensor_ind;
+    if (ret == RSMI_STATUS_SUCCESS)
+    {
+        *max = 500000000;
+        *min = 100000000;
+    }
+    return ret;
+}
+
+rsmi_status_t rsmi_dev_power_cap_set(uint32_t dv_ind, uint32_t sensor_ind,
+                                     uint64_t cap)
+{
+    rsmi_status_t ret = enter(dv_ind);
+
+    (void)sensor_ind;
+    if (ret == RSMI_STATUS_SUCCESS)
+    {
+        if (cap < 100000000 || cap > 500000000)
+        {
+            return RSMI_STATUS_INVALID_ARGS;
+        }
+        cap_uw[dv_ind] = cap;
+    }
+    return ret;
+}
+
+/* Device d is at 40 + d degrees C. */
+rsmi_status_t rsmi_dev_temp_metric_get(uint32_t dv_ind, uint32_t sensor_type,
+                                       rsmi_temperature_metric_t metric,
+                                       int64_t *temperature)
+{
+    rsmi_status_t ret = enter(dv_ind);
+
+    (void)sensor_type;
+    (void)metric;
+    if (ret == RSMI_STATUS_SUCCESS)
+    {
+        *temperature = (40 + (int64_t)dv_ind) * 1000;
+    }
+    return ret;
+}
+
+/* The current system clock is 1700 MHz and the memory clock 1600 MHz. */
+rsmi_status_t rsmi_dev_gpu_clk_freq_get(uint32_t dv_ind,
+                                        rsmi_clk_type_t clk_type,
+                                        rsmi_frequencies_t *f)
+{
+    rsmi_status_t ret = enter(dv_ind);
+
+    if (ret == RSMI_STATUS_SUCCESS)
+    {
+        f->num_supported = 2;
+        f->current = 1;
+        f->frequency[0] = 500000000;
+        f->frequency[1] = clk_type == RSMI_CLK_TYPE_MEM ? 1600000000 : 1700000000;
+    }
+    return ret;
+}
+
+/* Device d is busy 10 * d percent of the time. */
+rsmi_status_t rsmi_dev_busy_percent_get(uint32_t dv_ind,
+                                        uint32_t *busy_percent)
+{
+    rsmi_status_t ret = enter(dv_ind);
+
+    if (ret == RSMI_STATUS_SUCCESS)
+    {
+        *busy_percent = (10 * dv_ind) % 101;
+    }
+    return ret;
+}
+
+unsigned rsmi_stub_init_count(void)
+{
+    return init_count;
+}
+
+unsigned rsmi_stub_max_concurrency(void)
+{
+    return max_in_flight;
+}
@@ -0,0 +1,126 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <jansson.h>
+#include <rocm_smi/rocm_smi.h>
+#include <variorum.h>
+#include <variorum_region.h>
+}
+
+// Runs against the stub ROCm SMI library: 4 devices, device d at 100 + 10 * d
+// watts and 40 + d degrees C.
+
+static double elapsed_ms(const struct timespec &t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+}
+
+TEST(variorum_amd_gpu, initializes_once)
+{
+    char *s = NULL;
+
+    EXPECT_EQ(0, variorum_print_power());
+    EXPECT_EQ(0, variorum_print_thermals());
+    EXPECT_EQ(0, variorum_print_power_limit());
+    EXPECT_EQ(0, variorum_get_power_json(&s));
+    free(s);
+    EXPECT_EQ(1u, rsmi_stub_init_count());
+}
+
+TEST(variorum_amd_gpu, power_json)
+{
+    char hostname[1024];
+    char *s = NULL;
+
+    gethostname(hostname, sizeof(hostname));
+    ASSERT_EQ(0, variorum_get_power_json(&s));
+    json_t *root = json_loads(s, 0, NULL);
+    free(s);
+    ASSERT_NE(nullptr, root);
+    json_t *node = json_object_get(root, hostname);
+    json_t *gpus = json_object_get(json_object_get(node, "socket_0"),
+                                   "power_gpu_watts");
+    ASSERT_NE(nullptr, gpus);
+    EXPECT_DOUBLE_EQ(100.0, json_real_value(json_object_get(gpus, "GPU_0")));
+    if (json_integer_value(json_object_get(node, "num_gpus_per_socket")) == 4)
+    {
+        EXPECT_DOUBLE_EQ(130.0, json_real_value(json_object_get(gpus, "GPU_3")));
+    }
+    json_decref(root);
+}
+
+TEST(variorum_amd_gpu, devices_read_in_parallel)
+{
+    // Each query sleeps long enough for the readers to overlap, which the
+    // stub records; serial reads would never have two queries in flight.
+    setenv("RSMI_STUB_LATENCY_US", "50000", 1);
+    EXPECT_EQ(0, variorum_print_power());
+    unsetenv("RSMI_STUB_LATENCY_US");
+
+    EXPECT_GT(rsmi_stub_max_concurrency(), 1u);
+}
+
+TEST(variorum_amd_gpu, energy_counters)
+{
+    struct variorum_energy_counters c0, c1;
+    struct timespec t0;
+    struct timespec pause = {0, 100000000};
+
+    ASSERT_EQ(0, variorum_region_read_counters(&c0));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    nanosleep(&pause, NULL);
+    ASSERT_EQ(0, variorum_region_read_counters(&c1));
+    double seconds = elapsed_ms(t0) / 1e3;
+
+    // The 4 devices draw 460 W; the counters cover the time between the two
+    // reads, which includes the reads themselves.
+    double joules = c1.gpu_joules - c0.gpu_joules;
+    EXPECT_GT(joules, 460.0 * 0.1 * 0.95);
+    EXPECT_LT(joules, 460.0 * seconds * 1.05);
+}
+
+TEST(variorum_amd_gpu, energy_json)
+{
+    char hostname[1024];
+    char *s = NULL;
+
+    gethostname(hostname, sizeof(hostname));
+    ASSERT_EQ(0, variorum_get_energy_json(&s));
+    json_t *root = json_loads(s, 0, NULL);
+    free(s);
+    ASSERT_NE(nullptr, root);
+    json_t *gpus = json_object_get(json_object_get(json_object_get(root,
+                                   hostname), "socket_0"), "energy_gpu_joules");
+    ASSERT_NE(nullptr, gpus);
+    EXPECT_GT(json_real_value(json_object_get(gpus, "GPU_0")), 0.0);
+    json_decref(root);
+}
+
+TEST(variorum_amd_gpu, caps_each_gpu)
+{
+    uint64_t cap = 0;
+
+    EXPECT_EQ(0, variorum_cap_each_gpu_power_limit(250));
+    ASSERT_EQ(RSMI_STATUS_SUCCESS, rsmi_dev_power_cap_get(3, 0, &cap));
+    EXPECT_EQ(250000000u, cap);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
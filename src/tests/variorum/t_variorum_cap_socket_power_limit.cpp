@@ -3,20 +3,73 @@
 //
 // SPDX-License-Identifier: MIT
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "gtest/gtest.h"
 
 extern "C" {
 #include <variorum.h>
 }
 
+// Socket 0's first package power limit from one monitoring sample.
+static int sampled_socket_power_limit(double *watts)
+{
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *f = open_memstream(&buf, &len);
+    int found = 0;
+    char *line, *save = NULL;
+
+    if (f == NULL)
+    {
+        return 0;
+    }
+    variorum_monitoring(f);
+    fclose(f);
+    for (line = strtok_r(buf, "\n", &save); line != NULL;
+            line = strtok_r(NULL, "\n", &save))
+    {
+        long now;
+        double joules;
+
+        if (sscanf(line, "_VAR_MONITOR %ld %lf %lf", &now, &joules, watts) == 3)
+        {
+            found = 1;
+        }
+    }
+    free(buf);
+    return found;
+}
+
 TEST(variorum_power_limit, test_cap_socket_power_limit)
 {
     int socket_power_limit = 100;
     EXPECT_EQ(0, variorum_cap_each_socket_power_limit(socket_power_limit));
 }
 
+TEST(variorum_power_limit, test_cap_visible_to_next_sample)
+{
+    double watts;
+
+    // Cache the current limit, then read the new one back right away.
+    if (!sampled_socket_power_limit(&watts))
+    {
+        GTEST_SKIP() << "No package power limit in the monitoring sample";
+    }
+    ASSERT_EQ(0, variorum_cap_each_socket_power_limit(90));
+    ASSERT_TRUE(sampled_socket_power_limit(&watts));
+    EXPECT_NEAR(90.0, watts, 1.0);
+    ASSERT_EQ(0, variorum_cap_each_socket_power_limit(100));
+    ASSERT_TRUE(sampled_socket_power_limit(&watts));
+    EXPECT_NEAR(100.0, watts, 1.0);
+}
+
 int main(int argc, char **argv)
 {
+    // Never revalidate cached limits, so only the write can refresh them.
+    setenv("VARIORUM_MSR_CACHE_TTL_MS", "0", 1);
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
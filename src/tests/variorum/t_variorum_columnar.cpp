@@ -0,0 +1,125 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "columnar.h"
+}
+
+static std::vector<char> file_contents(FILE *f)
+{
+    std::vector<char> buf;
+    long len;
+
+    fflush(f);
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    rewind(f);
+    buf.resize(len);
+    if (len > 0 && fread(buf.data(), 1, len, f) != (size_t)len)
+    {
+        buf.clear();
+    }
+    return buf;
+}
+
+static uint32_t u32_at(const std::vector<char> &buf, size_t off)
+{
+    uint32_t v;
+    memcpy(&v, buf.data() + off, sizeof(v));
+    return v;
+}
+
+static uint64_t u64_at(const std::vector<char> &buf, size_t off)
+{
+    uint64_t v;
+    memcpy(&v, buf.data() + off, sizeof(v));
+    return v;
+}
+
+TEST(variorum_columnar, open_without_file)
+{
+    struct columnar_sink s;
+
+    EXPECT_EQ(-1, columnar_open(&s, NULL, "node", 4));
+}
+
+TEST(variorum_columnar, writes_header_and_chunks)
+{
+    struct columnar_sink s;
+    FILE *f = tmpfile();
+    int64_t row;
+
+    ASSERT_NE(nullptr, f);
+    ASSERT_EQ(0, columnar_open(&s, f, "node1", 2));
+    for (row = 0; row < 3; row++)
+    {
+        EXPECT_EQ(0, columnar_push_int64(&s, "ts", 100 + row));
+        EXPECT_EQ(0, columnar_push_float64(&s, "watts", 1.5 * row));
+        EXPECT_EQ(0, columnar_end_row(&s));
+    }
+    // A row that does not match the schema is discarded.
+    EXPECT_EQ(-1, columnar_push_float64(&s, "ts", 0.0));
+    EXPECT_EQ(-1, columnar_end_row(&s));
+    // The third row is still buffered and written by close.
+    EXPECT_EQ(0, columnar_close(&s));
+    EXPECT_EQ(nullptr, s.data);
+
+    std::vector<char> buf = file_contents(f);
+    fclose(f);
+    ASSERT_GE(buf.size(), 8u + 16u);
+    EXPECT_EQ(0, memcmp(buf.data(), COLUMNAR_MAGIC, 8));
+    EXPECT_EQ(1u, u32_at(buf, 8));
+    EXPECT_EQ(2u, u32_at(buf, 12));
+    EXPECT_EQ(5u, u32_at(buf, 16));
+    EXPECT_EQ(0x01020304u, u32_at(buf, 20));
+    EXPECT_EQ("node1", std::string(buf.data() + 24, 5));
+
+    // Two columns, each a type, name length and name padded to 8 bytes.
+    size_t off = 32;
+    EXPECT_EQ((uint32_t)COLUMNAR_INT64, u32_at(buf, off));
+    EXPECT_EQ("ts", std::string(buf.data() + off + 8, u32_at(buf, off + 4)));
+    off += 16;
+    EXPECT_EQ((uint32_t)COLUMNAR_FLOAT64, u32_at(buf, off));
+    EXPECT_EQ("watts", std::string(buf.data() + off + 8, u32_at(buf, off + 4)));
+    off += 16;
+
+    // A full chunk of two rows, then a short one.
+    const uint32_t rows[] = {2, 1};
+    int64_t first = 0;
+    for (uint32_t nrows : rows)
+    {
+        ASSERT_LE(off + 8 + 2 * nrows * 8, buf.size());
+        EXPECT_EQ(0, memcmp(buf.data() + off, "CHNK", 4));
+        EXPECT_EQ(nrows, u32_at(buf, off + 4));
+        off += 8;
+        for (uint32_t r = 0; r < nrows; r++)
+        {
+            double watts;
+            uint64_t bits = u64_at(buf, off + (nrows + r) * 8);
+
+            memcpy(&watts, &bits, sizeof(watts));
+            EXPECT_EQ((uint64_t)(100 + first + r), u64_at(buf, off + r * 8));
+            EXPECT_DOUBLE_EQ(1.5 * (first + r), watts);
+        }
+        off += 2 * nrows * 8;
+        first += nrows;
+    }
+    EXPECT_EQ(buf.size(), off);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,230 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_core_power.h>
+}
+
+// Two sockets of two CCDs of two cores each.
+static int init_small(struct variorum_core_power *cp)
+{
+    const unsigned core_ccd[] = {0, 0, 1, 1, 2, 2, 3, 3};
+    const unsigned ccd_socket[] = {0, 0, 1, 1};
+
+    return variorum_core_power_init(cp, 8, core_ccd, 4, ccd_socket, 1e-3);
+}
+
+TEST(variorum_core_power, wraps_and_aggregates)
+{
+    struct variorum_core_power cp;
+    uint32_t raw[8];
+    unsigned i;
+
+    ASSERT_EQ(0, init_small(&cp));
+    EXPECT_EQ(2u, cp.nsockets);
+
+    for (i = 0; i < 8; i++)
+    {
+        raw[i] = 1000 * i;
+    }
+    // Core 7 is about to wrap.
+    raw[7] = 0xFFFFFFF0u;
+    variorum_core_power_update(&cp, raw, 1000000000ULL);
+    EXPECT_DOUBLE_EQ(0.0, cp.core_watts[0]);
+
+    // 10 ms later: core i used (i + 1) * 10 ticks of 1 mJ, i.e., i + 1 W.
+    for (i = 0; i < 8; i++)
+    {
+        raw[i] += (i + 1) * 10;
+    }
+    variorum_core_power_update(&cp, raw, 1010000000ULL);
+    EXPECT_EQ(10000000u, cp.elapsed_ns);
+    EXPECT_LT(raw[7], 0x100u);
+    for (i = 0; i < 8; i++)
+    {
+        EXPECT_NEAR(i + 1.0, cp.core_watts[i], 1e-9);
+        EXPECT_NEAR((i + 1) * 0.01, cp.core_joules[i], 1e-12);
+    }
+    EXPECT_NEAR(3.0, cp.ccd_watts[0], 1e-9);
+    EXPECT_NEAR(15.0, cp.ccd_watts[3], 1e-9);
+    EXPECT_NEAR(10.0, cp.socket_watts[0], 1e-9);
+    EXPECT_NEAR(26.0, cp.socket_watts[1], 1e-9);
+
+    struct variorum_core_power_sample sample;
+    variorum_core_power_get_sample(&cp, &sample);
+    EXPECT_EQ(8u, sample.ncores);
+    EXPECT_EQ(4u, sample.nccds);
+    EXPECT_EQ(cp.core_watts, sample.core_watts);
+
+    variorum_core_power_free(&cp);
+}
+
+TEST(variorum_core_power, wide_counters_over_long_interval)
+{
+    struct variorum_core_power cp;
+    uint64_t raw[8];
+    unsigned i;
+
+    // Microjoule counters, as read through E-SMI.
+    const unsigned core_ccd[] = {0, 0, 1, 1, 2, 2, 3, 3};
+    const unsigned ccd_socket[] = {0, 0, 1, 1};
+    ASSERT_EQ(0, variorum_core_power_init(&cp, 8, core_ccd, 4, ccd_socket, 1e-6));
+
+    for (i = 0; i < 8; i++)
+    {
+        raw[i] = 1000000ULL * i;
+    }
+    variorum_core_power_update64(&cp, raw, 0);
+
+    // 1000 s at 10 W per core: 10^10 uJ, more than 2^32 ticks.
+    for (i = 0; i < 8; i++)
+    {
+        raw[i] += 10000000000ULL;
+    }
+    variorum_core_power_update64(&cp, raw, 1000000000000ULL);
+    for (i = 0; i < 8; i++)
+    {
+        EXPECT_NEAR(10.0, cp.core_watts[i], 1e-9);
+        EXPECT_NEAR(10000.0, cp.core_joules[i], 1e-6);
+    }
+    EXPECT_NEAR(40.0, cp.socket_watts[1], 1e-9);
+
+    variorum_core_power_free(&cp);
+}
+
+TEST(variorum_core_power, json)
+{
+    struct variorum_core_power cp;
+    uint32_t raw[8] = {0};
+
+    ASSERT_EQ(0, init_small(&cp));
+    variorum_core_power_update(&cp, raw, 0);
+    raw[5] = 20;
+    variorum_core_power_update(&cp, raw, 10000000ULL);
+
+    json_t *node = json_object();
+    variorum_core_power_to_json(&cp, node);
+    json_t *socket = json_object_get(node, "socket_1");
+    ASSERT_NE(nullptr, socket);
+    EXPECT_DOUBLE_EQ(2.0, json_real_value(json_object_get(socket,
+                     "power_cores_watts")));
+    EXPECT_DOUBLE_EQ(2.0, json_real_value(json_object_get(
+                         json_object_get(socket, "ccd"), "ccd_2_power_watts")));
+    EXPECT_DOUBLE_EQ(2.0, json_real_value(json_object_get(
+                         json_object_get(socket, "core"), "core_5_power_watts")));
+    // Cores are listed under their own socket only.
+    EXPECT_EQ(nullptr, json_object_get(json_object_get(socket, "core"),
+                                       "core_0_power_watts"));
+    json_decref(node);
+
+    variorum_core_power_free(&cp);
+}
+
+TEST(variorum_core_power, trace)
+{
+    struct variorum_core_power cp;
+    struct variorum_trace t;
+    struct variorum_trace_reader r;
+    uint32_t raw[8] = {0};
+    int64_t ts;
+    int64_t values[8 + 4 + 2];
+    FILE *f = tmpfile();
+
+    ASSERT_NE(nullptr, f);
+    ASSERT_EQ(0, init_small(&cp));
+    ASSERT_EQ(0, variorum_core_power_trace_open(&cp, &t, f));
+    variorum_core_power_update(&cp, raw, 0);
+    raw[0] = 15;
+    variorum_core_power_update(&cp, raw, 10000000ULL);
+    ASSERT_EQ(0, variorum_core_power_trace_append(&cp, &t));
+    ASSERT_EQ(0, variorum_trace_close(&t));
+
+    rewind(f);
+    ASSERT_EQ(0, variorum_trace_reader_open(&r, f));
+    ASSERT_EQ(14u, r.ncols);
+    ASSERT_EQ(1, variorum_trace_read(&r, &ts, values));
+    EXPECT_EQ(10000000, ts);
+    EXPECT_EQ(1500, values[0]);
+    EXPECT_EQ(1500, values[8]);
+    EXPECT_EQ(1500, values[12]);
+    EXPECT_EQ(0, values[13]);
+    variorum_trace_reader_close(&r);
+    fclose(f);
+
+    variorum_core_power_free(&cp);
+}
+
+// A 2x96-core Genoa node sampled every millisecond.
+TEST(variorum_core_power, large_topology)
+{
+    const unsigned ncores = 192;
+    const unsigned nccds = 24;
+    const int iterations = 1000;
+    std::vector<unsigned> core_ccd(ncores), ccd_socket(nccds);
+    std::vector<uint32_t> raw(ncores);
+    struct variorum_core_power cp;
+    unsigned i;
+    int k;
+
+    for (i = 0; i < ncores; i++)
+    {
+        core_ccd[i] = i / 8;
+    }
+    for (i = 0; i < nccds; i++)
+    {
+        ccd_socket[i] = i / 12;
+    }
+    ASSERT_EQ(0, variorum_core_power_init(&cp, ncores, core_ccd.data(), nccds,
+                                          ccd_socket.data(), 1.0 / 65536));
+    variorum_core_power_update(&cp, raw.data(), 0);
+
+    for (k = 1; k <= iterations; k++)
+    {
+        for (i = 0; i < ncores; i++)
+        {
+            raw[i] += 300 + i;
+        }
+        variorum_core_power_update(&cp, raw.data(), k * 1000000ULL);
+    }
+    EXPECT_EQ((uint64_t)iterations + 1, cp.nsamples);
+    EXPECT_EQ(2u, cp.nsockets);
+    EXPECT_NEAR((300 + 191) * 1000.0 / 65536, cp.core_watts[191], 1e-6);
+    EXPECT_NEAR((300 + 191) * iterations / 65536.0, cp.core_joules[191], 1e-6);
+
+    // Every level adds up the one below it.
+    double sockets[2] = {0.0, 0.0};
+    for (i = 0; i < nccds; i++)
+    {
+        double sum = 0.0;
+        unsigned c;
+
+        for (c = 0; c < ncores; c++)
+        {
+            if (core_ccd[c] == i)
+            {
+                sum += cp.core_watts[c];
+            }
+        }
+        EXPECT_NEAR(sum, cp.ccd_watts[i], 1e-6);
+        sockets[ccd_socket[i]] += cp.ccd_watts[i];
+    }
+    EXPECT_NEAR(sockets[0], cp.socket_watts[0], 1e-6);
+    EXPECT_NEAR(sockets[1], cp.socket_watts[1], 1e-6);
+
+    variorum_core_power_free(&cp);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
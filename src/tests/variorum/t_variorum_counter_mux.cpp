@@ -0,0 +1,102 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_counter_mux.h>
+}
+
+static const struct variorum_pmc_event table[] =
+{
+    {"A", 0x01, 0x00, 0x00},
+    {"B", 0x02, 0x00, 0x00},
+    {"C", 0x03, 0x00, 0x00},
+    {"D", 0x04, 0x00, 0x00},
+    {"E", 0x05, 0x00, 0x00},
+};
+
+TEST(variorum_counter_mux, groups)
+{
+    struct variorum_counter_mux mux;
+
+    ASSERT_EQ(0, variorum_counter_mux_init(&mux, table, 5, NULL, 2, 1));
+    EXPECT_EQ(5u, mux.nevents);
+    EXPECT_EQ(3u, mux.ngroups);
+    EXPECT_EQ(2u, variorum_counter_mux_group_size(&mux, 0));
+    EXPECT_EQ(1u, variorum_counter_mux_group_size(&mux, 2));
+    EXPECT_STREQ("C", variorum_counter_mux_event(&mux, 1, 0)->name);
+    EXPECT_STREQ("E", variorum_counter_mux_event(&mux, 2, 0)->name);
+    EXPECT_EQ(NULL, variorum_counter_mux_event(&mux, 2, 1));
+    variorum_counter_mux_free(&mux);
+}
+
+TEST(variorum_counter_mux, select_by_name)
+{
+    struct variorum_counter_mux mux;
+
+    ASSERT_EQ(0, variorum_counter_mux_init(&mux, table, 5, "D,A", 4, 2));
+    EXPECT_EQ(2u, mux.nevents);
+    EXPECT_EQ(1u, mux.ngroups);
+    EXPECT_STREQ("D", variorum_counter_mux_event(&mux, 0, 0)->name);
+    EXPECT_STREQ("A", variorum_counter_mux_event(&mux, 0, 1)->name);
+    variorum_counter_mux_free(&mux);
+
+    EXPECT_EQ(-1, variorum_counter_mux_init(&mux, table, 5, "A,Z", 4, 2));
+    EXPECT_EQ(-1, variorum_counter_mux_init(&mux, table, 5, "", 4, 2));
+}
+
+TEST(variorum_counter_mux, single_group_is_exact)
+{
+    struct variorum_counter_mux mux;
+    // Two threads, two counters: [t0 A, t0 B, t1 A, t1 B]
+    const uint64_t raw[4] = {100, 200, 300, 400};
+
+    ASSERT_EQ(0, variorum_counter_mux_init(&mux, table, 5, "A,B", 2, 2));
+    EXPECT_EQ(0u, variorum_counter_mux_update(&mux, raw, 1000));
+    EXPECT_DOUBLE_EQ(100.0, mux.deltas[0]);
+    EXPECT_DOUBLE_EQ(200.0, mux.deltas[1]);
+    EXPECT_DOUBLE_EQ(300.0, mux.deltas[2]);
+    EXPECT_DOUBLE_EQ(400.0, mux.deltas[3]);
+    EXPECT_EQ(1000u, mux.running_ns[0]);
+    EXPECT_EQ(1000u, mux.enabled_ns);
+    variorum_counter_mux_free(&mux);
+}
+
+TEST(variorum_counter_mux, rotation_scales_inactive_groups)
+{
+    struct variorum_counter_mux mux;
+    const uint64_t g0[2] = {1000, 2000};
+    const uint64_t g1[2] = {50, 0};
+    const uint64_t g0b[2] = {3000, 4000};
+
+    ASSERT_EQ(0, variorum_counter_mux_init(&mux, table, 5, "A,B,C", 2, 1));
+    ASSERT_EQ(2u, mux.ngroups);
+
+    // Group 0 counts for 10 us; C has not been measured yet.
+    EXPECT_EQ(1u, variorum_counter_mux_update(&mux, g0, 10000));
+    EXPECT_DOUBLE_EQ(1000.0, mux.deltas[0]);
+    EXPECT_DOUBLE_EQ(2000.0, mux.deltas[1]);
+    EXPECT_DOUBLE_EQ(0.0, mux.deltas[2]);
+
+    // Group 1 counts C for 20 us; A and B are extrapolated at their rates.
+    EXPECT_EQ(0u, variorum_counter_mux_update(&mux, g1, 20000));
+    EXPECT_DOUBLE_EQ(2000.0, mux.deltas[0]);
+    EXPECT_DOUBLE_EQ(4000.0, mux.deltas[1]);
+    EXPECT_DOUBLE_EQ(50.0, mux.deltas[2]);
+
+    // Back to group 0; C is extrapolated from its last rate.
+    EXPECT_EQ(1u, variorum_counter_mux_update(&mux, g0b, 40000));
+    EXPECT_DOUBLE_EQ(3000.0, mux.deltas[0]);
+    EXPECT_DOUBLE_EQ(4000.0, mux.deltas[1]);
+    EXPECT_DOUBLE_EQ(100.0, mux.deltas[2]);
+
+    EXPECT_EQ(50000u, mux.running_ns[0]);
+    EXPECT_EQ(20000u, mux.running_ns[2]);
+    EXPECT_EQ(70000u, mux.enabled_ns);
+    variorum_counter_mux_free(&mux);
+}
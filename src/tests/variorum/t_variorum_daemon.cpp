@@ -0,0 +1,259 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_daemon.h>
+}
+
+#define MOCK_WATTS 100.0
+#define NUM_CLIENTS 8
+#define NUM_CALLS 20
+
+static int reads = 0;
+static int node_cap = 0;
+static int socket_cap = 0;
+
+static int mock_read_energy(struct variorum_energy_counters *counters)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    __atomic_add_fetch(&reads, 1, __ATOMIC_RELAXED);
+    counters->pkg_joules = MOCK_WATTS * (t.tv_sec + t.tv_nsec / 1e9);
+    counters->dram_joules = 0.0;
+    counters->gpu_joules = 0.0;
+    return 0;
+}
+
+static int mock_cap_node(int watts)
+{
+    node_cap = watts;
+    return 0;
+}
+
+static int mock_cap_socket(int watts)
+{
+    socket_cap = watts;
+    return 0;
+}
+
+static const struct variorum_daemon_backend mock_backend =
+{
+    mock_read_energy,
+    mock_cap_node,
+    mock_cap_socket,
+};
+
+class variorum_daemon : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            snprintf(path, sizeof(path), "/tmp/variorumd-test-%d.sock", (int)getpid());
+            variorum_daemon_default_config(&config);
+            config.socket_path = path;
+            config.coalesce_us = 5000;
+            config.policy.cap_uids[config.policy.num_cap_uids++] = getuid();
+            config.policy.min_node_watts = 100;
+            config.policy.max_node_watts = 1000;
+            stop = 0;
+            reads = 0;
+            ASSERT_EQ(0, pthread_create(&thread, NULL, serve, this));
+            for (int i = 0; i < 1000 && access(path, F_OK) != 0; i++)
+            {
+                usleep(1000);
+            }
+        }
+
+        void TearDown() override
+        {
+            stop = 1;
+            pthread_join(thread, NULL);
+        }
+
+        static void *serve(void *arg)
+        {
+            variorum_daemon *t = (variorum_daemon *)arg;
+            t->ret = variorum_daemon_serve(&t->config, &mock_backend, &t->stop);
+            return NULL;
+        }
+
+        char path[108];
+        struct variorum_daemon_config config;
+        volatile int stop;
+        int ret;
+        pthread_t thread;
+};
+
+struct client_result
+{
+    const char *path;
+    int failures;
+};
+
+static void *client(void *arg)
+{
+    struct client_result *result = (struct client_result *)arg;
+    struct variorum_daemon_response r;
+    int fd = variorum_daemon_connect(result->path);
+
+    if (fd < 0)
+    {
+        result->failures = NUM_CALLS;
+        return NULL;
+    }
+    for (int i = 0; i < NUM_CALLS; i++)
+    {
+        if (variorum_daemon_call(fd, VARIORUM_DAEMON_OP_GET_POWER, 0, &r) != 0 ||
+                r.status != VARIORUM_DAEMON_OK)
+        {
+            result->failures++;
+        }
+    }
+    variorum_daemon_disconnect(fd);
+    return NULL;
+}
+
+TEST_F(variorum_daemon, power)
+{
+    struct variorum_daemon_response r;
+    int fd = variorum_daemon_connect(path);
+
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(0, variorum_daemon_call(fd, VARIORUM_DAEMON_OP_GET_POWER, 0, &r));
+    EXPECT_EQ(VARIORUM_DAEMON_OK, r.status);
+    EXPECT_EQ(VARIORUM_DAEMON_OP_GET_POWER, r.op);
+    EXPECT_EQ(0.0, r.energy.pkg_joules);
+    usleep(20000);
+    ASSERT_EQ(0, variorum_daemon_call(fd, VARIORUM_DAEMON_OP_GET_POWER, 0, &r));
+    EXPECT_NEAR(MOCK_WATTS, r.pkg_watts, 0.01 * MOCK_WATTS);
+    EXPECT_GT(r.energy.pkg_joules, 0.0);
+    EXPECT_EQ(2u, r.hardware_reads);
+    variorum_daemon_disconnect(fd);
+}
+
+TEST_F(variorum_daemon, concurrent_requests_are_coalesced)
+{
+    pthread_t threads[NUM_CLIENTS];
+    struct client_result results[NUM_CLIENTS];
+    int i;
+
+    for (i = 0; i < NUM_CLIENTS; i++)
+    {
+        results[i].path = path;
+        results[i].failures = 0;
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, client, &results[i]));
+    }
+    for (i = 0; i < NUM_CLIENTS; i++)
+    {
+        pthread_join(threads[i], NULL);
+        EXPECT_EQ(0, results[i].failures);
+    }
+    // Every client waits for its response, so at best all clients share
+    // each read.
+    EXPECT_GE(reads, NUM_CALLS);
+    EXPECT_LT(reads, NUM_CLIENTS * NUM_CALLS / 2);
+}
+
+TEST_F(variorum_daemon, cap_policy)
+{
+    struct variorum_daemon_response r;
+    int fd = variorum_daemon_connect(path);
+
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(0, variorum_daemon_call(fd, VARIORUM_DAEMON_OP_CAP_NODE_POWER, 500,
+                                      &r));
+    EXPECT_EQ(VARIORUM_DAEMON_OK, r.status);
+    EXPECT_EQ(500, node_cap);
+
+    // Outside the allowed range.
+    ASSERT_EQ(0, variorum_daemon_call(fd, VARIORUM_DAEMON_OP_CAP_NODE_POWER, 50,
+                                      &r));
+    EXPECT_EQ(VARIORUM_DAEMON_EPERM, r.status);
+    EXPECT_EQ(500, node_cap);
+
+    ASSERT_EQ(0, variorum_daemon_call(fd, VARIORUM_DAEMON_OP_CAP_SOCKET_POWER, 120,
+                                      &r));
+    EXPECT_EQ(VARIORUM_DAEMON_OK, r.status);
+    EXPECT_EQ(120, socket_cap);
+
+    ASSERT_EQ(0, variorum_daemon_call(fd, 42, 0, &r));
+    EXPECT_EQ(VARIORUM_DAEMON_EINVAL, r.status);
+    variorum_daemon_disconnect(fd);
+}
+
+TEST_F(variorum_daemon, stalled_client_is_dropped)
+{
+    struct variorum_daemon_request req;
+    struct variorum_daemon_response r;
+    struct timespec t0, t1;
+    int stalled = variorum_daemon_connect(path);
+    int fd = variorum_daemon_connect(path);
+    int dropped = 0;
+
+    ASSERT_GE(stalled, 0);
+    ASSERT_GE(fd, 0);
+    memset(&req, 0, sizeof(req));
+    req.magic = VARIORUM_DAEMON_MAGIC;
+    req.version = VARIORUM_DAEMON_VERSION;
+    req.op = 42;
+
+    // Send requests without ever reading the responses until the daemon
+    // gives up on this client.
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    do
+    {
+        if (send(stalled, &req, sizeof(req), MSG_NOSIGNAL | MSG_DONTWAIT) < 0)
+        {
+            if (errno != EAGAIN)
+            {
+                dropped = 1;
+                break;
+            }
+            usleep(1000);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+    }
+    while (t1.tv_sec - t0.tv_sec < 5);
+    EXPECT_TRUE(dropped);
+
+    ASSERT_EQ(0, variorum_daemon_call(fd, VARIORUM_DAEMON_OP_GET_POWER, 0, &r));
+    EXPECT_EQ(VARIORUM_DAEMON_OK, r.status);
+    variorum_daemon_disconnect(fd);
+    variorum_daemon_disconnect(stalled);
+}
+
+TEST(variorum_daemon_policy, check_cap)
+{
+    struct variorum_daemon_config config;
+
+    variorum_daemon_default_config(&config);
+    config.policy.cap_uids[config.policy.num_cap_uids++] = 1000;
+    config.policy.min_socket_watts = 50;
+    config.policy.max_socket_watts = 200;
+
+    // Root and listed users only.
+    EXPECT_EQ(VARIORUM_DAEMON_OK, variorum_daemon_check_cap(&config.policy, 0,
+              VARIORUM_DAEMON_OP_CAP_SOCKET_POWER, 100));
+    EXPECT_EQ(VARIORUM_DAEMON_OK, variorum_daemon_check_cap(&config.policy, 1000,
+              VARIORUM_DAEMON_OP_CAP_SOCKET_POWER, 100));
+    EXPECT_EQ(VARIORUM_DAEMON_EPERM, variorum_daemon_check_cap(&config.policy,
+              1001, VARIORUM_DAEMON_OP_CAP_SOCKET_POWER, 100));
+    // Bounds apply to everyone.
+    EXPECT_EQ(VARIORUM_DAEMON_EPERM, variorum_daemon_check_cap(&config.policy, 0,
+              VARIORUM_DAEMON_OP_CAP_SOCKET_POWER, 300));
+    EXPECT_EQ(VARIORUM_DAEMON_EINVAL, variorum_daemon_check_cap(&config.policy, 0,
+              VARIORUM_DAEMON_OP_GET_POWER, 100));
+}
@@ -0,0 +1,60 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_energy_window.h>
+}
+
+TEST(variorum_energy_window, update_interval)
+{
+    // Updates every 1000 ticks, one observed late.
+    const struct variorum_rapl_tick ticks[] =
+    {
+        {10, 990, 1010}, {20, 1990, 2010}, {30, 3400, 3420},
+        {40, 3990, 4010}, {50, 4990, 5010}
+    };
+
+    EXPECT_DOUBLE_EQ(1000.0, variorum_rapl_update_ticks(ticks, 5));
+    EXPECT_DOUBLE_EQ(0.0, variorum_rapl_update_ticks(ticks, 1));
+}
+
+TEST(variorum_energy_window, aligned_window)
+{
+    // 1 GHz timestamps, 2^14 units per joule, 10 ms at 100 W on one socket.
+    const double units[] = {16384.0};
+    const struct variorum_rapl_tick start[] = {{1000, 1000000, 1002000}};
+    const struct variorum_rapl_tick end[] = {{1000 + 16384, 11000000, 11002000}};
+    struct variorum_energy_window w;
+
+    variorum_energy_window_compute(start, end, units, 1, 1e9, 1e6, &w);
+    EXPECT_DOUBLE_EQ(1.0, w.joules);
+    EXPECT_DOUBLE_EQ(0.01, w.seconds);
+    EXPECT_DOUBLE_EQ(0.001, w.update_interval);
+    // One unit plus 100 W times 2 us of bracket.
+    EXPECT_NEAR(1.0 / 16384.0 + 100.0 * 2e-6, w.error_joules, 1e-12);
+}
+
+TEST(variorum_energy_window, counter_wrap)
+{
+    const double units[] = {1.0, 1.0};
+    const struct variorum_rapl_tick start[] =
+    {
+        {0xFFFFFF00ULL, 0, 0}, {500, 0, 0}
+    };
+    const struct variorum_rapl_tick end[] =
+    {
+        {0x100, 1000, 1000}, {700, 1000, 1000}
+    };
+    struct variorum_energy_window w;
+
+    variorum_energy_window_compute(start, end, units, 2, 1000.0, 1.0, &w);
+    EXPECT_DOUBLE_EQ(512.0 + 200.0, w.joules);
+    EXPECT_DOUBLE_EQ(1.0, w.seconds);
+    EXPECT_DOUBLE_EQ(2.0, w.error_joules);
+}
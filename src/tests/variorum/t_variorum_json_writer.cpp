@@ -0,0 +1,122 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <jansson.h>
+#include <variorum.h>
+#include <variorum_json_writer.h>
+}
+
+static json_t *build_reference(void)
+{
+    json_t *root = json_object();
+    json_t *node = json_object();
+    json_object_set_new(root, "host\"01", node);
+    json_object_set_new(node, "timestamp", json_integer(1700000000123456LL));
+    json_t *socket = json_object();
+    json_object_set_new(node, "socket_0", socket);
+    json_object_set_new(socket, "power_cpu_watts", json_real(85.123456789));
+    json_object_set_new(socket, "power_mem_watts", json_real(3.0));
+    json_object_set_new(socket, "tiny", json_real(1.5e-7));
+    json_object_set_new(socket, "huge", json_real(2.5e+21));
+    json_object_set_new(node, "empty", json_object());
+    json_object_set_new(node, "units", json_string("Watts\n"));
+    json_object_set_new(node, "power_node_watts", json_real(-0.1));
+    return root;
+}
+
+static void write_reference(struct variorum_json_writer *jw)
+{
+    variorum_json_writer_begin_object(jw, NULL);
+    variorum_json_writer_begin_object(jw, "host\"01");
+    variorum_json_writer_integer(jw, "timestamp", 1700000000123456LL);
+    variorum_json_writer_begin_object(jw, "socket_0");
+    variorum_json_writer_real(jw, "power_cpu_watts", 85.123456789);
+    variorum_json_writer_real(jw, "power_mem_watts", 3.0);
+    variorum_json_writer_real(jw, "tiny", 1.5e-7);
+    variorum_json_writer_real(jw, "huge", 2.5e+21);
+    variorum_json_writer_end_object(jw);
+    variorum_json_writer_begin_object(jw, "empty");
+    variorum_json_writer_end_object(jw);
+    variorum_json_writer_string(jw, "units", "Watts\n");
+    variorum_json_writer_real(jw, "power_node_watts", -0.1);
+    variorum_json_writer_end_object(jw);
+    variorum_json_writer_end_object(jw);
+}
+
+TEST(variorum_json_writer, test_matches_jansson_indent)
+{
+    char buf[1024];
+    struct variorum_json_writer jw;
+    json_t *ref = build_reference();
+    char *expected = json_dumps(ref, JSON_INDENT(4));
+
+    variorum_json_writer_init(&jw, buf, sizeof(buf), 4);
+    write_reference(&jw);
+    EXPECT_EQ(0, variorum_json_writer_finish(&jw));
+    EXPECT_STREQ(expected, buf);
+    EXPECT_EQ(strlen(expected), jw.len);
+
+    free(expected);
+    json_decref(ref);
+}
+
+TEST(variorum_json_writer, test_matches_jansson_compact)
+{
+    char buf[1024];
+    struct variorum_json_writer jw;
+    json_t *ref = build_reference();
+    char *expected = json_dumps(ref, JSON_COMPACT);
+
+    variorum_json_writer_init(&jw, buf, sizeof(buf), 0);
+    write_reference(&jw);
+    EXPECT_EQ(0, variorum_json_writer_finish(&jw));
+    EXPECT_STREQ(expected, buf);
+
+    free(expected);
+    json_decref(ref);
+}
+
+TEST(variorum_json_writer, test_overflow_reports_size)
+{
+    char small[16];
+    char big[1024];
+    struct variorum_json_writer jw;
+
+    variorum_json_writer_init(&jw, small, sizeof(small), 4);
+    write_reference(&jw);
+    EXPECT_EQ(-1, variorum_json_writer_finish(&jw));
+
+    size_t needed = jw.len;
+    variorum_json_writer_init(&jw, big, sizeof(big), 4);
+    write_reference(&jw);
+    EXPECT_EQ(0, variorum_json_writer_finish(&jw));
+    EXPECT_EQ(needed, jw.len);
+}
+
+TEST(variorum_json_writer, test_growable_buffer)
+{
+    char *buf = NULL;
+    size_t cap = 0;
+    struct variorum_json_writer jw;
+
+    variorum_json_writer_init_growable(&jw, &buf, &cap, 4);
+    write_reference(&jw);
+    EXPECT_EQ(0, variorum_json_writer_finish(&jw));
+    EXPECT_EQ(strlen(buf), jw.len);
+    EXPECT_GT(cap, jw.len);
+    free(buf);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,225 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <jansson.h>
+#include <nvml.h>
+#include <variorum.h>
+#include <variorum_region.h>
+}
+
+// Runs against the stub NVML library: 4 devices, device d at 100 + 10 * d
+// watts, so the node's GPUs draw 460 W. Once the driver rejects field value
+// queries Variorum stops issuing them, so the test without them comes after
+// the tests that count queries.
+
+static void sleep_ms(long ms)
+{
+    struct timespec t = {ms / 1000, (ms % 1000) * 1000000};
+
+    nanosleep(&t, NULL);
+}
+
+static double elapsed_s(const struct timespec &t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static double gpu_joules_over(long ms, double *seconds)
+{
+    struct variorum_energy_counters c0, c1;
+    struct timespec t0;
+
+    EXPECT_EQ(0, variorum_region_read_counters(&c0));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    sleep_ms(ms);
+    EXPECT_EQ(0, variorum_region_read_counters(&c1));
+    *seconds = elapsed_s(t0);
+    return c1.gpu_joules - c0.gpu_joules;
+}
+
+TEST(variorum_nvidia_gpu, energy_counters)
+{
+    double seconds;
+    double joules = gpu_joules_over(100, &seconds);
+
+    // The counters cover the time between the two reads, which includes the
+    // reads themselves.
+    EXPECT_GT(joules, 460.0 * 0.1 * 0.95);
+    EXPECT_LT(joules, 460.0 * seconds * 1.05);
+}
+
+TEST(variorum_nvidia_gpu, energy_counter_without_power)
+{
+    double seconds;
+    double joules;
+
+    // The energy counter is read even when the power reading fails.
+    setenv("NVML_STUB_NO_POWER", "1", 1);
+    joules = gpu_joules_over(100, &seconds);
+    unsetenv("NVML_STUB_NO_POWER");
+
+    EXPECT_GT(joules, 460.0 * 0.1 * 0.95);
+    EXPECT_LT(joules, 460.0 * seconds * 1.05);
+}
+
+TEST(variorum_nvidia_gpu, integrates_power_without_energy_counter)
+{
+    double seconds;
+    double joules;
+
+    setenv("NVML_STUB_NO_ENERGY", "1", 1);
+    // The first read only starts the integration.
+    gpu_joules_over(0, &seconds);
+    joules = gpu_joules_over(100, &seconds);
+    unsetenv("NVML_STUB_NO_ENERGY");
+
+    EXPECT_GT(joules, 460.0 * 0.1 * 0.95);
+    EXPECT_LT(joules, 460.0 * seconds * 1.05);
+}
+
+TEST(variorum_nvidia_gpu, one_query_per_device)
+{
+    struct variorum_energy_counters c;
+    unsigned queries;
+
+    ASSERT_EQ(0, variorum_region_read_counters(&c));
+    queries = nvml_stub_query_count();
+    ASSERT_EQ(0, variorum_region_read_counters(&c));
+    EXPECT_EQ(4u, nvml_stub_query_count() - queries);
+
+    // Without an energy counter, power comes from the same query.
+    setenv("NVML_STUB_NO_ENERGY", "1", 1);
+    queries = nvml_stub_query_count();
+    ASSERT_EQ(0, variorum_region_read_counters(&c));
+    EXPECT_EQ(4u, nvml_stub_query_count() - queries);
+    unsetenv("NVML_STUB_NO_ENERGY");
+}
+
+TEST(variorum_nvidia_gpu, integrates_driver_power_samples)
+{
+    double seconds;
+    double joules;
+    unsigned sample_reads = nvml_stub_samples_count();
+
+    setenv("NVML_STUB_NO_ENERGY", "1", 1);
+    setenv("VARIORUM_NVIDIA_GPU_POWER_SAMPLES", "1", 1);
+    gpu_joules_over(0, &seconds);
+    joules = gpu_joules_over(200, &seconds);
+    unsetenv("VARIORUM_NVIDIA_GPU_POWER_SAMPLES");
+    unsetenv("NVML_STUB_NO_ENERGY");
+
+    EXPECT_GT(nvml_stub_samples_count(), sample_reads);
+    // The driver samples every 20 ms, so the integral covers the interval up
+    // to one sample period at each end.
+    EXPECT_GT(joules, 460.0 * (0.2 - 0.02) * 0.95);
+    EXPECT_LT(joules, 460.0 * (seconds + 0.02) * 1.05);
+}
+
+TEST(variorum_nvidia_gpu, falls_back_without_field_values)
+{
+    char hostname[1024];
+    char *s = NULL;
+
+    setenv("NVML_STUB_NO_FIELDS", "1", 1);
+    gethostname(hostname, sizeof(hostname));
+    ASSERT_EQ(0, variorum_get_power_json(&s));
+    json_t *root = json_loads(s, 0, NULL);
+    free(s);
+    ASSERT_NE(nullptr, root);
+    json_t *gpus = json_object_get(json_object_get(json_object_get(root,
+                                   hostname), "socket_0"), "power_gpu_watts");
+    ASSERT_NE(nullptr, gpus);
+    EXPECT_NEAR(100.0, json_real_value(json_object_get(gpus, "GPU_0")), 1e-3);
+    json_decref(root);
+
+    double seconds;
+    double joules = gpu_joules_over(100, &seconds);
+    unsetenv("NVML_STUB_NO_FIELDS");
+    EXPECT_GT(joules, 460.0 * 0.1 * 0.95);
+    EXPECT_LT(joules, 460.0 * seconds * 1.05);
+}
+
+TEST(variorum_nvidia_gpu, energy_json)
+{
+    char hostname[1024];
+    char *s = NULL;
+
+    gethostname(hostname, sizeof(hostname));
+    ASSERT_EQ(0, variorum_get_energy_json(&s));
+    json_t *root = json_loads(s, 0, NULL);
+    free(s);
+    ASSERT_NE(nullptr, root);
+    json_t *gpus = json_object_get(json_object_get(json_object_get(root,
+                                   hostname), "socket_0"), "energy_gpu_joules");
+    ASSERT_NE(nullptr, gpus);
+    EXPECT_GT(json_real_value(json_object_get(gpus, "GPU_0")), 0.0);
+    json_decref(root);
+}
+
+TEST(variorum_nvidia_gpu, reports_enforced_power_limit)
+{
+    char buf[4096];
+    ssize_t n;
+    FILE *f = tmpfile();
+    int saved = dup(STDOUT_FILENO);
+
+    ASSERT_NE(nullptr, f);
+    setenv("NVML_STUB_ENFORCED_MW", "150000", 1);
+    fflush(stdout);
+    dup2(fileno(f), STDOUT_FILENO);
+    int err = variorum_print_power_limit();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    unsetenv("NVML_STUB_ENFORCED_MW");
+    ASSERT_EQ(0, err);
+
+    n = pread(fileno(f), buf, sizeof(buf) - 1, 0);
+    fclose(f);
+    ASSERT_GT(n, 0);
+    buf[n] = '\0';
+    // The management limit is 250 W; the enforced limit is lower.
+    EXPECT_NE(nullptr, strstr(buf, " 150.000"));
+    EXPECT_EQ(nullptr, strstr(buf, " 250.000"));
+}
+
+// Starts the region sampler, which then serves every counter read, so this
+// test comes last.
+TEST(variorum_nvidia_gpu, region_sampler_with_api_calls)
+{
+    struct variorum_region_stats stats;
+
+    setenv("VARIORUM_REGION_SAMPLER_MS", "1", 1);
+    ASSERT_EQ(0, variorum_region_begin("api_calls"));
+    // Each call exits the platform under the sampler's session.
+    for (int i = 0; i < 50; i++)
+    {
+        char *s = NULL;
+        ASSERT_EQ(0, variorum_get_power_json(&s));
+        free(s);
+    }
+    sleep_ms(20);
+    ASSERT_EQ(0, variorum_region_end("api_calls"));
+    ASSERT_EQ(0, variorum_region_get_stats("api_calls", &stats));
+    EXPECT_GT(stats.energy.gpu_joules, 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,53 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum.h>
+}
+
+TEST(variorum_perf_event, thread_counters)
+{
+    struct variorum_thread_counters a, b;
+    volatile double x = 1.0;
+    int i;
+
+    if (variorum_read_thread_counters(&a) != 0)
+    {
+        GTEST_SKIP() << "perf_event hardware counters unavailable";
+    }
+    for (i = 0; i < 100000; i++)
+    {
+        x = x * 1.000001;
+    }
+    ASSERT_EQ(0, variorum_read_thread_counters(&b));
+    EXPECT_GT(b.instructions - a.instructions, 100000u);
+    EXPECT_GT(b.cycles, a.cycles);
+}
+
+TEST(variorum_perf_event, power_json)
+{
+    char *s = NULL;
+
+    // Selected once per process, before the first call into variorum.
+    setenv("VARIORUM_CPU_BACKEND", "perf_event", 1);
+    if (variorum_get_power_json(&s) != 0 || s == NULL)
+    {
+        GTEST_SKIP() << "RAPL perf_event PMU unavailable";
+    }
+    EXPECT_NE(nullptr, strstr(s, "\"power_node_watts\""));
+    EXPECT_NE(nullptr, strstr(s, "\"socket_0\""));
+    free(s);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
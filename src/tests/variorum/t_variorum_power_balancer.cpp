@@ -0,0 +1,101 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_power_balancer.h>
+}
+
+static struct variorum_power_balancer_config config(double budget)
+{
+    struct variorum_power_balancer_config c;
+    c.budget_watts = budget;
+    c.min_cap_watts = 50.0;
+    c.max_cap_watts = 300.0;
+    c.margin_watts = 5.0;
+    c.max_step_watts = 40.0;
+    c.progress_tolerance = 0.05;
+    return c;
+}
+
+static double sum(const double *caps, int n)
+{
+    double total = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        total += caps[i];
+    }
+    return total;
+}
+
+TEST(variorum_power_balancer, balanced_job_is_unchanged)
+{
+    struct variorum_power_balancer_config c = config(400.0);
+    struct variorum_power_balancer_node nodes[2] = {{200, 199, 1.0}, {200, 200, 1.0}};
+    double caps[2];
+
+    ASSERT_EQ(0, variorum_power_balance(&c, nodes, 2, caps));
+    EXPECT_DOUBLE_EQ(200.0, caps[0]);
+    EXPECT_DOUBLE_EQ(200.0, caps[1]);
+}
+
+TEST(variorum_power_balancer, headroom_moves_to_capped_node)
+{
+    struct variorum_power_balancer_config c = config(400.0);
+    // Node 0 draws far below its cap, node 1 is held at its cap.
+    struct variorum_power_balancer_node nodes[2] = {{200, 120, 0.0}, {200, 200, 0.0}};
+    double caps[2];
+
+    ASSERT_EQ(0, variorum_power_balance(&c, nodes, 2, caps));
+    // Limited to one step per call.
+    EXPECT_DOUBLE_EQ(160.0, caps[0]);
+    EXPECT_DOUBLE_EQ(240.0, caps[1]);
+    EXPECT_LE(sum(caps, 2), 400.0 + 1e-9);
+}
+
+TEST(variorum_power_balancer, slow_node_gains_from_fast_node)
+{
+    struct variorum_power_balancer_config c = config(400.0);
+    // Both at their caps, node 1 progresses at half the rate.
+    struct variorum_power_balancer_node nodes[2] = {{200, 200, 2.0}, {200, 200, 1.0}};
+    double caps[2];
+
+    ASSERT_EQ(0, variorum_power_balance(&c, nodes, 2, caps));
+    EXPECT_LT(caps[0], 200.0);
+    EXPECT_GT(caps[1], 200.0);
+    EXPECT_NEAR(400.0, sum(caps, 2), 1e-9);
+}
+
+TEST(variorum_power_balancer, slowest_receives_most)
+{
+    struct variorum_power_balancer_config c = config(600.0);
+    struct variorum_power_balancer_node nodes[3] = {{150, 150, 1.0}, {150, 150, 0.5}, {150, 150, 1.0}};
+    double caps[3];
+
+    // 150W of unallocated budget goes to the capped nodes.
+    ASSERT_EQ(0, variorum_power_balance(&c, nodes, 3, caps));
+    EXPECT_GT(caps[1], caps[0]);
+    EXPECT_DOUBLE_EQ(caps[0], caps[2]);
+    EXPECT_LE(sum(caps, 3), 600.0 + 1e-9);
+    EXPECT_LE(caps[1], 190.0 + 1e-9);
+}
+
+TEST(variorum_power_balancer, budget_and_limits)
+{
+    struct variorum_power_balancer_config c = config(300.0);
+    struct variorum_power_balancer_node nodes[2] = {{250, 250, 0.0}, {350, 300, 0.0}};
+    double caps[2];
+
+    // Caps above the budget are scaled down first.
+    ASSERT_EQ(0, variorum_power_balance(&c, nodes, 2, caps));
+    EXPECT_LE(sum(caps, 2), 300.0 + 1e-9);
+    EXPECT_GE(caps[0], 50.0);
+    EXPECT_LE(caps[1], 300.0);
+
+    // The minimum caps alone exceed the budget.
+    c.budget_watts = 90.0;
+    EXPECT_EQ(-1, variorum_power_balance(&c, nodes, 2, caps));
+}
@@ -0,0 +1,180 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_powercap.h>
+}
+
+// A powercap class directory with two packages, each with a DRAM and a core
+// subzone, a platform zone, and an MMIO duplicate of package 0.
+class variorum_powercap_tree : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            char tmpl[] = "/tmp/variorum_powercapXXXXXX";
+            ASSERT_NE(nullptr, mkdtemp(tmpl));
+            root = tmpl;
+            zone("intel-rapl:0", "package-0", 1000000, 262143328850ULL);
+            zone("intel-rapl:0:0", "dram", 2000000, 65712999613ULL);
+            zone("intel-rapl:0:1", "core", 3000000, 262143328850ULL);
+            zone("intel-rapl:1", "package-1", 4000000, 262143328850ULL);
+            zone("intel-rapl:1:0", "dram", 5000000, 65712999613ULL);
+            zone("intel-rapl:2", "psys", 6000000, 262143328850ULL);
+            zone("intel-rapl-mmio:0", "package-0", 7000000, 262143328850ULL);
+            attr("intel-rapl:0", "constraint_0_power_limit_uw", "150000000");
+            attr("intel-rapl:1", "constraint_0_power_limit_uw", "150000000");
+        }
+
+        void TearDown() override
+        {
+            std::string cmd = "rm -rf " + root;
+            ASSERT_EQ(0, system(cmd.c_str()));
+        }
+
+        void attr(const char *zone, const char *name, const std::string &value)
+        {
+            std::string path = root + "/" + zone + "/" + name;
+            FILE *f = fopen(path.c_str(), "w");
+            ASSERT_NE(nullptr, f);
+            fprintf(f, "%s\n", value.c_str());
+            fclose(f);
+        }
+
+        std::string read_attr(const char *zone, const char *name)
+        {
+            std::string path = root + "/" + zone + "/" + name;
+            char buf[64] = {0};
+            FILE *f = fopen(path.c_str(), "r");
+            if (f == NULL || fgets(buf, sizeof(buf), f) == NULL)
+            {
+                return "";
+            }
+            fclose(f);
+            return buf;
+        }
+
+        void zone(const char *zone, const char *name, uint64_t uj, uint64_t max)
+        {
+            mkdir((root + "/" + zone).c_str(), 0755);
+            attr(zone, "name", name);
+            attr(zone, "energy_uj", std::to_string(uj));
+            attr(zone, "max_energy_range_uj", std::to_string(max));
+        }
+
+        std::string root;
+};
+
+TEST_F(variorum_powercap_tree, discovers_zones)
+{
+    struct variorum_powercap pc;
+
+    ASSERT_EQ(0, variorum_powercap_open(&pc, root.c_str()));
+    // Core subzones and MMIO zones are skipped.
+    ASSERT_EQ(5u, pc.nzones);
+    EXPECT_EQ(2u, pc.nsockets);
+
+    EXPECT_EQ(0u, pc.zones[0].socket);
+    EXPECT_EQ(VARIORUM_POWERCAP_PKG, pc.zones[0].domain);
+    EXPECT_EQ(0u, pc.zones[1].socket);
+    EXPECT_EQ(VARIORUM_POWERCAP_DRAM, pc.zones[1].domain);
+    EXPECT_EQ(0u, pc.zones[2].socket);
+    EXPECT_EQ(VARIORUM_POWERCAP_PSYS, pc.zones[2].domain);
+    EXPECT_EQ(1u, pc.zones[3].socket);
+    EXPECT_EQ(VARIORUM_POWERCAP_PKG, pc.zones[3].domain);
+    EXPECT_EQ(1u, pc.zones[4].socket);
+    EXPECT_EQ(VARIORUM_POWERCAP_DRAM, pc.zones[4].domain);
+    EXPECT_EQ(65712999613ULL, pc.zones[4].max_energy_uj);
+
+    variorum_powercap_close(&pc);
+}
+
+TEST_F(variorum_powercap_tree, accumulates_across_wrap)
+{
+    struct variorum_powercap pc;
+
+    ASSERT_EQ(0, variorum_powercap_open(&pc, root.c_str()));
+
+    // The descriptors stay open; the files are rewritten in place.
+    attr("intel-rapl:0", "energy_uj", "3500000");
+    attr("intel-rapl:0:0", "energy_uj", "1000");
+    ASSERT_EQ(0, variorum_powercap_read(&pc));
+    EXPECT_EQ(2500000u, pc.zones[0].total_uj);
+    EXPECT_EQ(65712999613ULL - 2000000 + 1000, pc.zones[1].total_uj);
+    EXPECT_EQ(0u, pc.zones[3].total_uj);
+    EXPECT_GT(pc.zones[0].watts, 0.0);
+
+    attr("intel-rapl:0", "energy_uj", "4500000");
+    ASSERT_EQ(0, variorum_powercap_read(&pc));
+    EXPECT_EQ(3500000u, pc.zones[0].total_uj);
+
+    variorum_powercap_close(&pc);
+}
+
+TEST_F(variorum_powercap_tree, unknown_wrap_point)
+{
+    struct variorum_powercap pc;
+
+    attr("intel-rapl:0", "max_energy_range_uj", "");
+    ASSERT_EQ(0, variorum_powercap_open(&pc, root.c_str()));
+    EXPECT_EQ(0u, pc.zones[0].max_energy_uj);
+
+    // A decrease cannot be unwrapped, so it adds nothing.
+    attr("intel-rapl:0", "energy_uj", "500000");
+    ASSERT_EQ(0, variorum_powercap_read(&pc));
+    EXPECT_EQ(0u, pc.zones[0].total_uj);
+    EXPECT_EQ(0.0, pc.zones[0].watts);
+
+    // Accumulation resumes from the new value.
+    attr("intel-rapl:0", "energy_uj", "1500000");
+    ASSERT_EQ(0, variorum_powercap_read(&pc));
+    EXPECT_EQ(1000000u, pc.zones[0].total_uj);
+
+    variorum_powercap_close(&pc);
+}
+
+TEST_F(variorum_powercap_tree, sets_socket_limit)
+{
+    struct variorum_powercap pc;
+    double watts;
+
+    ASSERT_EQ(0, variorum_powercap_open(&pc, root.c_str()));
+    ASSERT_EQ(0, variorum_powercap_get_limit(&pc.zones[0], &watts));
+    EXPECT_DOUBLE_EQ(150.0, watts);
+    // DRAM has no limit here.
+    EXPECT_EQ(-1, variorum_powercap_get_limit(&pc.zones[1], &watts));
+
+    ASSERT_EQ(0, variorum_powercap_set_socket_limit(&pc, 95));
+    EXPECT_EQ(0u, read_attr("intel-rapl:0",
+                            "constraint_0_power_limit_uw").find("95000000"));
+    EXPECT_EQ(0u, read_attr("intel-rapl:1",
+                            "constraint_0_power_limit_uw").find("95000000"));
+    ASSERT_EQ(0, variorum_powercap_get_limit(&pc.zones[3], &watts));
+    EXPECT_DOUBLE_EQ(95.0, watts);
+
+    variorum_powercap_close(&pc);
+}
+
+TEST(variorum_powercap, missing_root)
+{
+    struct variorum_powercap pc;
+
+    EXPECT_EQ(-1, variorum_powercap_open(&pc, "/nonexistent/powercap"));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,270 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_prometheus.h>
+}
+
+// Connect to the exporter, return the socket or -1.
+static int connect_local(int port)
+{
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Read until the exporter closes the connection.
+static std::string read_response(int fd)
+{
+    std::string response;
+    char buf[4096];
+    ssize_t n;
+
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+    {
+        response.append(buf, n);
+    }
+    return response;
+}
+
+// Issue a request with a plain socket and return the whole response.
+static std::string http_get(int port, const char *path)
+{
+    std::string response;
+    int fd = connect_local(port);
+
+    if (fd < 0)
+    {
+        return response;
+    }
+    std::string req = std::string("GET ") + path +
+                      " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(fd, req.data(), req.size(), 0);
+    response = read_response(fd);
+    close(fd);
+    return response;
+}
+
+static void push_sample(struct variorum_prometheus *e, double cpu0,
+                        double cpu1)
+{
+    variorum_prometheus_push(e, "variorum_node_power_watts", "Node power.",
+                             NULL, cpu0 + cpu1);
+    variorum_prometheus_push(e, "variorum_cpu_power_watts",
+                             "CPU package power of a socket.", "socket=\"0\"", cpu0);
+    variorum_prometheus_push(e, "variorum_cpu_power_watts",
+                             "CPU package power of a socket.", "socket=\"1\"", cpu1);
+}
+
+TEST(variorum_prometheus, serves_metrics)
+{
+    struct variorum_prometheus e;
+
+    ASSERT_EQ(0, variorum_prometheus_open(&e, "127.0.0.1", 0, "node1"));
+    ASSERT_GT(e.port, 0);
+
+    push_sample(&e, 100.5, 90.25);
+    ASSERT_EQ(0, variorum_prometheus_end_row(&e));
+
+    std::string r = http_get(e.port, "/metrics");
+    EXPECT_EQ(0u, r.find("HTTP/1.1 200 OK\r\n"));
+    EXPECT_NE(std::string::npos, r.find("Content-Type: text/plain; version=0.0.4"));
+    EXPECT_NE(std::string::npos,
+              r.find("# TYPE variorum_node_power_watts gauge\n"
+                     "variorum_node_power_watts{host=\"node1\"} 190.75\n"));
+    // HELP and TYPE appear once per family.
+    EXPECT_NE(std::string::npos,
+              r.find("# TYPE variorum_cpu_power_watts gauge\n"
+                     "variorum_cpu_power_watts{host=\"node1\",socket=\"0\"} 100.5\n"
+                     "variorum_cpu_power_watts{host=\"node1\",socket=\"1\"} 90.25\n"));
+    EXPECT_NE(std::string::npos,
+              r.find("variorum_exporter_scrapes_total{host=\"node1\"} 1\n"));
+
+    // A scrape sees the latest row.
+    push_sample(&e, 80, 70);
+    ASSERT_EQ(0, variorum_prometheus_end_row(&e));
+    r = http_get(e.port, "/metrics");
+    EXPECT_NE(std::string::npos,
+              r.find("variorum_node_power_watts{host=\"node1\"} 150\n"));
+    EXPECT_NE(std::string::npos,
+              r.find("variorum_exporter_scrapes_total{host=\"node1\"} 2\n"));
+
+    r = http_get(e.port, "/other");
+    EXPECT_EQ(0u, r.find("HTTP/1.1 404 Not Found\r\n"));
+
+    variorum_prometheus_close(&e);
+}
+
+TEST(variorum_prometheus, schema_is_fixed)
+{
+    struct variorum_prometheus e;
+    char buf[4096];
+    size_t n;
+
+    ASSERT_EQ(0, variorum_prometheus_open(&e, "127.0.0.1", 0, NULL));
+
+    // Nothing published yet, only the scrape counter.
+    n = variorum_prometheus_render(&e, buf, sizeof(buf));
+    ASSERT_LT(n, sizeof(buf));
+    EXPECT_EQ(std::string::npos, std::string(buf, n).find("power"));
+
+    push_sample(&e, 1, 2);
+    ASSERT_EQ(0, variorum_prometheus_end_row(&e));
+
+    // A row with another number of series is dropped.
+    variorum_prometheus_push(&e, "variorum_node_power_watts", "Node power.",
+                             NULL, 42);
+    EXPECT_EQ(-1, variorum_prometheus_end_row(&e));
+    n = variorum_prometheus_render(&e, buf, sizeof(buf));
+    std::string text(buf, n);
+    EXPECT_NE(std::string::npos, text.find("variorum_node_power_watts 3\n"));
+
+    // Small buffers are refused with a sufficient size.
+    n = variorum_prometheus_render(&e, buf, 16);
+    EXPECT_GT(n, 16u);
+    EXPECT_LE(variorum_prometheus_render(&e, buf, n), n);
+
+    variorum_prometheus_close(&e);
+}
+
+TEST(variorum_prometheus, loopback_by_default)
+{
+    struct variorum_prometheus e;
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    ASSERT_EQ(0, variorum_prometheus_open(&e, NULL, 0, NULL));
+    ASSERT_EQ(0, getsockname(e.listen_fd, (struct sockaddr *)&addr, &len));
+    EXPECT_EQ(htonl(INADDR_LOOPBACK), addr.sin_addr.s_addr);
+    variorum_prometheus_close(&e);
+
+    ASSERT_EQ(0, variorum_prometheus_open(&e, "0.0.0.0", 0, NULL));
+    ASSERT_EQ(0, getsockname(e.listen_fd, (struct sockaddr *)&addr, &len));
+    EXPECT_EQ(htonl(INADDR_ANY), addr.sin_addr.s_addr);
+    variorum_prometheus_close(&e);
+}
+
+TEST(variorum_prometheus, slow_client_does_not_block_others)
+{
+    struct variorum_prometheus e;
+
+    ASSERT_EQ(0, variorum_prometheus_open(&e, "127.0.0.1", 0, NULL));
+    push_sample(&e, 1, 2);
+    ASSERT_EQ(0, variorum_prometheus_end_row(&e));
+
+    // The first client sends half of its request and stalls.
+    int slow = connect_local(e.port);
+    ASSERT_GE(slow, 0);
+    ASSERT_EQ(9, send(slow, "GET /metr", 9, 0));
+
+    // Another scraper is served while the first one is pending.
+    EXPECT_EQ(0u, http_get(e.port, "/metrics").find("HTTP/1.1 200 OK\r\n"));
+
+    // The slow client is still tracked and answered once it is done.
+    const char rest[] = "ics HTTP/1.1\r\n\r\n";
+    ASSERT_EQ((ssize_t)sizeof(rest) - 1,
+              send(slow, rest, sizeof(rest) - 1, MSG_NOSIGNAL));
+    EXPECT_EQ(0u, read_response(slow).find("HTTP/1.1 200 OK\r\n"));
+    close(slow);
+    EXPECT_EQ(2u, __atomic_load_n(&e.scrapes, __ATOMIC_RELAXED));
+
+    variorum_prometheus_close(&e);
+}
+
+TEST(variorum_prometheus, stalled_client_is_dropped)
+{
+    struct variorum_prometheus e;
+    struct timeval tv = {10, 0};
+
+    ASSERT_EQ(0, variorum_prometheus_open(&e, "127.0.0.1", 0, NULL));
+
+    int slow = connect_local(e.port);
+    ASSERT_GE(slow, 0);
+    // Only guards the test against a server that never drops the client.
+    setsockopt(slow, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ASSERT_EQ(9, send(slow, "GET /metr", 9, 0));
+
+    // The connection is closed at its deadline, without a response.
+    char c;
+    EXPECT_EQ(0, recv(slow, &c, 1, 0));
+    close(slow);
+    EXPECT_EQ(0u, __atomic_load_n(&e.scrapes, __ATOMIC_RELAXED));
+
+    variorum_prometheus_close(&e);
+}
+
+TEST(variorum_prometheus, render_large_node)
+{
+    struct variorum_prometheus e;
+    char buf[16384];
+    char labels[32];
+    int i, s;
+    size_t n;
+
+    ASSERT_EQ(0, variorum_prometheus_open(&e, "127.0.0.1", 0, "node1"));
+    // A large node: 8 sockets with CPU, memory and 4 GPUs each.
+    for (s = 0; s < 8; s++)
+    {
+        snprintf(labels, sizeof(labels), "socket=\"%d\"", s);
+        variorum_prometheus_push(&e, "variorum_cpu_power_watts", "CPU power.",
+                                 labels, 123.456);
+    }
+    for (s = 0; s < 8; s++)
+    {
+        snprintf(labels, sizeof(labels), "socket=\"%d\"", s);
+        variorum_prometheus_push(&e, "variorum_mem_power_watts", "Memory power.",
+                                 labels, 12.5);
+    }
+    for (s = 0; s < 32; s++)
+    {
+        snprintf(labels, sizeof(labels), "gpu=\"%d\"", s);
+        variorum_prometheus_push(&e, "variorum_gpu_power_watts", "GPU power.",
+                                 labels, 301.25);
+    }
+    ASSERT_EQ(0, variorum_prometheus_end_row(&e));
+
+    n = variorum_prometheus_render(&e, buf, sizeof(buf));
+    ASSERT_LT(n, sizeof(buf));
+    std::string text(buf, n);
+
+    // One line per series, HELP and TYPE once per family, and the scrape
+    // counter with its own HELP and TYPE.
+    size_t lines = 0;
+    for (i = 0; i < (int)n; i++)
+    {
+        lines += buf[i] == '\n';
+    }
+    EXPECT_EQ(48u + 3 * 2 + 3, lines);
+    EXPECT_NE(std::string::npos,
+              text.find("variorum_cpu_power_watts{host=\"node1\",socket=\"7\"} 123.456\n"));
+    EXPECT_NE(std::string::npos,
+              text.find("variorum_gpu_power_watts{host=\"node1\",gpu=\"31\"} 301.25\n"));
+
+    // The rendering only depends on the published row.
+    EXPECT_EQ(n, variorum_prometheus_render(&e, buf, sizeof(buf)));
+    EXPECT_EQ(text, std::string(buf, n));
+
+    variorum_prometheus_close(&e);
+}
@@ -0,0 +1,114 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_region.h>
+}
+
+static struct variorum_energy_counters energy(double pkg, double dram)
+{
+    struct variorum_energy_counters e = {pkg, dram, 0.0};
+    return e;
+}
+
+TEST(variorum_region, nested)
+{
+    struct variorum_energy_counters e;
+    struct variorum_region_stats st;
+
+    variorum_region_reset();
+    e = energy(10.0, 1.0);
+    ASSERT_EQ(0, variorum_region_push("outer", 1.0, &e));
+    e = energy(12.0, 1.5);
+    ASSERT_EQ(0, variorum_region_push("inner", 1.5, &e));
+    e = energy(15.0, 2.0);
+    ASSERT_EQ(0, variorum_region_pop("inner", 2.0, &e));
+    e = energy(20.0, 3.0);
+    ASSERT_EQ(0, variorum_region_pop("outer", 3.0, &e));
+
+    ASSERT_EQ(0, variorum_region_get_stats("outer", &st));
+    EXPECT_EQ(1u, st.calls);
+    EXPECT_DOUBLE_EQ(2.0, st.seconds);
+    EXPECT_DOUBLE_EQ(10.0, st.energy.pkg_joules);
+    EXPECT_DOUBLE_EQ(2.0, st.energy.dram_joules);
+
+    ASSERT_EQ(0, variorum_region_get_stats("inner", &st));
+    EXPECT_EQ(1u, st.calls);
+    EXPECT_DOUBLE_EQ(0.5, st.seconds);
+    EXPECT_DOUBLE_EQ(3.0, st.energy.pkg_joules);
+    EXPECT_EQ(-1, variorum_region_get_stats("unknown", &st));
+}
+
+TEST(variorum_region, mismatched_end)
+{
+    struct variorum_energy_counters e = energy(0.0, 0.0);
+
+    variorum_region_reset();
+    EXPECT_EQ(-1, variorum_region_pop("a", 0.0, &e));
+    ASSERT_EQ(0, variorum_region_push("a", 0.0, &e));
+    EXPECT_EQ(-1, variorum_region_pop("b", 1.0, &e));
+    EXPECT_EQ(0, variorum_region_pop("a", 1.0, &e));
+}
+
+TEST(variorum_region, many_regions)
+{
+    struct variorum_energy_counters e = energy(0.0, 0.0);
+    struct variorum_region_stats st;
+    char name[32];
+    int i, rep;
+
+    variorum_region_reset();
+    for (rep = 0; rep < 3; rep++)
+    {
+        for (i = 0; i < 500; i++)
+        {
+            snprintf(name, sizeof(name), "region_%d", i);
+            ASSERT_EQ(0, variorum_region_push(name, 0.0, &e));
+            ASSERT_EQ(0, variorum_region_pop(name, 1.0, &e));
+        }
+    }
+    for (i = 0; i < 500; i++)
+    {
+        snprintf(name, sizeof(name), "region_%d", i);
+        ASSERT_EQ(0, variorum_region_get_stats(name, &st));
+        EXPECT_EQ(3u, st.calls);
+    }
+}
+
+TEST(variorum_region, threads)
+{
+    struct variorum_region_stats st;
+    std::vector<std::thread> threads;
+    int t;
+
+    variorum_region_reset();
+    for (t = 0; t < 8; t++)
+    {
+        threads.emplace_back([]()
+        {
+            struct variorum_energy_counters e = energy(0.0, 0.0);
+            for (int i = 0; i < 1000; i++)
+            {
+                e.pkg_joules = i;
+                variorum_region_push("parallel", i, &e);
+                e.pkg_joules = i + 1;
+                variorum_region_pop("parallel", i + 1, &e);
+            }
+        });
+    }
+    for (auto &th : threads)
+    {
+        th.join();
+    }
+    ASSERT_EQ(0, variorum_region_get_stats("parallel", &st));
+    EXPECT_EQ(8000u, st.calls);
+    EXPECT_DOUBLE_EQ(8000.0, st.energy.pkg_joules);
+}
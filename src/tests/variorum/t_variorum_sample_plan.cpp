@@ -0,0 +1,86 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <string.h>
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_sample_plan.h>
+}
+
+TEST(variorum_sample_plan, sort_by_cpu)
+{
+    struct variorum_sample_plan plan;
+    uint64_t d[4];
+
+    memset(&plan, 0, sizeof(plan));
+    ASSERT_EQ(0, variorum_sample_plan_add(&plan, 3, 0x611, &d[0]));
+    ASSERT_EQ(0, variorum_sample_plan_add(&plan, 0, 0x619, &d[1]));
+    ASSERT_EQ(0, variorum_sample_plan_add(&plan, 0, 0x611, &d[2]));
+    ASSERT_EQ(0, variorum_sample_plan_add(&plan, 1, 0xE7, &d[3]));
+    ASSERT_EQ(4, variorum_sample_plan_compile(&plan));
+
+    EXPECT_EQ(0u, plan.cpu[0]);
+    EXPECT_EQ(0x611u, plan.reg[0]);
+    EXPECT_EQ(0u, plan.cpu[1]);
+    EXPECT_EQ(0x619u, plan.reg[1]);
+    EXPECT_EQ(1u, plan.cpu[2]);
+    EXPECT_EQ(3u, plan.cpu[3]);
+    variorum_sample_plan_free(&plan);
+}
+
+TEST(variorum_sample_plan, dedup_and_scatter)
+{
+    struct variorum_sample_plan plan;
+    uint64_t a = 0, b = 0, c = 0;
+    const uint64_t values[] = {100, 200};
+
+    memset(&plan, 0, sizeof(plan));
+    ASSERT_EQ(0, variorum_sample_plan_add(&plan, 8, 0x610, &a));
+    ASSERT_EQ(0, variorum_sample_plan_add(&plan, 0, 0x610, &b));
+    ASSERT_EQ(0, variorum_sample_plan_add(&plan, 8, 0x610, &c));
+    ASSERT_EQ(2, variorum_sample_plan_compile(&plan));
+    EXPECT_EQ(3u, plan.nslots);
+
+    variorum_sample_plan_scatter(&plan, values, sizeof(uint64_t));
+    EXPECT_EQ(200u, a);
+    EXPECT_EQ(100u, b);
+    EXPECT_EQ(200u, c);
+    variorum_sample_plan_free(&plan);
+    EXPECT_EQ(0u, plan.nslots);
+}
+
+TEST(variorum_sample_plan, strided_scatter)
+{
+    struct op
+    {
+        uint32_t cpu;
+        uint32_t msr;
+        uint64_t data;
+    } ops[2] = {{0, 0x10, 7}, {1, 0x10, 9}};
+    struct variorum_sample_plan plan;
+    uint64_t x = 0, y = 0;
+
+    memset(&plan, 0, sizeof(plan));
+    ASSERT_EQ(0, variorum_sample_plan_add(&plan, 1, 0x10, &y));
+    ASSERT_EQ(0, variorum_sample_plan_add(&plan, 0, 0x10, &x));
+    ASSERT_EQ(2, variorum_sample_plan_compile(&plan));
+    variorum_sample_plan_scatter(&plan, &ops[0].data, sizeof(struct op));
+    EXPECT_EQ(7u, x);
+    EXPECT_EQ(9u, y);
+    variorum_sample_plan_free(&plan);
+}
+
+TEST(variorum_sample_plan, empty)
+{
+    struct variorum_sample_plan plan;
+
+    memset(&plan, 0, sizeof(plan));
+    EXPECT_EQ(0, variorum_sample_plan_compile(&plan));
+    EXPECT_EQ(-1, variorum_sample_plan_add(&plan, 0, 0x10, NULL));
+    variorum_sample_plan_free(&plan);
+}
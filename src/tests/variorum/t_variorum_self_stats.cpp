@@ -0,0 +1,83 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum.h>
+#include <variorum_self_stats.h>
+}
+
+TEST(variorum_self_stats, test_null_stats)
+{
+    EXPECT_EQ(-1, variorum_get_self_stats(NULL));
+}
+
+TEST(variorum_self_stats, test_reset_self_stats)
+{
+    struct variorum_self_stats st;
+
+    variorum_reset_self_stats();
+    EXPECT_EQ(0, variorum_get_self_stats(&st));
+    EXPECT_EQ(0u, st.enter_calls);
+    EXPECT_EQ(0u, st.json_dumps_calls);
+    EXPECT_EQ(0u, st.bytes_written);
+}
+
+TEST(variorum_self_stats, test_enter_is_counted)
+{
+    struct variorum_self_stats st;
+
+    variorum_reset_self_stats();
+    variorum_tester();
+    EXPECT_EQ(0, variorum_get_self_stats(&st));
+    EXPECT_EQ(1u, st.enter_calls);
+    EXPECT_GT(st.enter_ticks, 0u);
+}
+
+TEST(variorum_self_stats, test_power_json_is_counted)
+{
+    struct variorum_self_stats st;
+    char *s = NULL;
+
+    variorum_reset_self_stats();
+    if (variorum_get_power_json(&s) != 0)
+    {
+        GTEST_SKIP() << "power JSON is not available on this platform";
+    }
+    free(s);
+    // Counted on both the streaming and the jansson path.
+    EXPECT_EQ(0, variorum_get_self_stats(&st));
+    EXPECT_EQ(1u, st.json_dumps_calls);
+    EXPECT_GT(st.json_dumps_ticks, 0u);
+}
+
+TEST(variorum_self_stats, test_json_excludes_batch)
+{
+    struct variorum_self_stats st;
+    char *s = NULL;
+    uint64_t t0, t1;
+
+    variorum_reset_self_stats();
+    t0 = variorum_self_ticks();
+    if (variorum_get_power_json(&s) != 0)
+    {
+        GTEST_SKIP() << "power JSON is not available on this platform";
+    }
+    t1 = variorum_self_ticks();
+    free(s);
+    // The timers cover disjoint intervals within the call, so none of the
+    // MSR reads done while streaming is counted twice.
+    EXPECT_EQ(0, variorum_get_self_stats(&st));
+    EXPECT_LE(st.enter_ticks + st.batch_ticks + st.json_dumps_ticks, t1 - t0);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,199 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_telemetry.h>
+}
+
+#define HISTORY_LEN 8
+
+static void segment_name(char *name, size_t len, const char *test)
+{
+    snprintf(name, len, "/variorum-test-%s-%d", test, (int)getpid());
+}
+
+static struct variorum_telemetry_sample make_sample(double joules)
+{
+    struct variorum_telemetry_sample s;
+    memset(&s, 0, sizeof(s));
+    s.time = joules;
+    s.pkg_joules = joules;
+    s.dram_joules = 2 * joules;
+    s.gpu_joules = 3 * joules;
+    return s;
+}
+
+TEST(variorum_telemetry, latest_sample)
+{
+    struct variorum_telemetry_segment *writer, *reader;
+    struct variorum_telemetry_sample s;
+    char name[64];
+
+    segment_name(name, sizeof(name), "latest");
+    ASSERT_EQ(0, variorum_telemetry_create(name, HISTORY_LEN, 10, &writer));
+    reader = variorum_telemetry_attach(name);
+    ASSERT_NE(nullptr, reader);
+    EXPECT_EQ((uint32_t)HISTORY_LEN, reader->history_len);
+    EXPECT_EQ(10u, reader->interval_ms);
+    EXPECT_EQ(getpid(), reader->publisher_pid);
+
+    // Nothing published yet.
+    EXPECT_EQ(-1, variorum_telemetry_read(reader, &s));
+
+    s = make_sample(5.0);
+    variorum_telemetry_write(writer, &s);
+    s = make_sample(7.0);
+    variorum_telemetry_write(writer, &s);
+    ASSERT_EQ(0, variorum_telemetry_read(reader, &s));
+    EXPECT_EQ(1u, s.index);
+    EXPECT_EQ(7.0, s.pkg_joules);
+    EXPECT_EQ(14.0, s.dram_joules);
+
+    // A second publisher may not take over the segment.
+    struct variorum_telemetry_segment *other;
+    EXPECT_EQ(-1, variorum_telemetry_create(name, HISTORY_LEN, 10, &other));
+
+    variorum_telemetry_destroy(name, writer);
+    EXPECT_EQ(-1, variorum_telemetry_read(reader, &s));
+    variorum_telemetry_detach(reader);
+    EXPECT_EQ(nullptr, variorum_telemetry_attach(name));
+}
+
+TEST(variorum_telemetry, history_wraps)
+{
+    struct variorum_telemetry_segment *writer, *reader;
+    struct variorum_telemetry_sample s, history[2 * HISTORY_LEN];
+    char name[64];
+    int i, n;
+
+    segment_name(name, sizeof(name), "history");
+    ASSERT_EQ(0, variorum_telemetry_create(name, HISTORY_LEN, 10, &writer));
+    reader = variorum_telemetry_attach(name);
+    ASSERT_NE(nullptr, reader);
+
+    for (i = 0; i < 3; i++)
+    {
+        s = make_sample(i);
+        variorum_telemetry_write(writer, &s);
+    }
+    ASSERT_EQ(3, variorum_telemetry_read_history(reader, history, 2 * HISTORY_LEN));
+    EXPECT_EQ(0u, history[0].index);
+    EXPECT_EQ(2u, history[2].index);
+
+    for (i = 3; i < 20; i++)
+    {
+        s = make_sample(i);
+        variorum_telemetry_write(writer, &s);
+    }
+    // Only the newest samples remain, oldest first.
+    n = variorum_telemetry_read_history(reader, history, 2 * HISTORY_LEN);
+    ASSERT_EQ(HISTORY_LEN, n);
+    for (i = 0; i < n; i++)
+    {
+        EXPECT_EQ((uint64_t)(20 - HISTORY_LEN + i), history[i].index);
+        EXPECT_EQ(20.0 - HISTORY_LEN + i, history[i].pkg_joules);
+    }
+    ASSERT_EQ(2, variorum_telemetry_read_history(reader, history, 2));
+    EXPECT_EQ(18u, history[0].index);
+    EXPECT_EQ(19u, history[1].index);
+
+    variorum_telemetry_detach(reader);
+    variorum_telemetry_destroy(name, writer);
+}
+
+TEST(variorum_telemetry, version_mismatch)
+{
+    struct variorum_telemetry_segment *writer;
+    char name[64];
+
+    segment_name(name, sizeof(name), "version");
+    ASSERT_EQ(0, variorum_telemetry_create(name, HISTORY_LEN, 10, &writer));
+    writer->version = VARIORUM_TELEMETRY_VERSION + 1;
+    EXPECT_EQ(nullptr, variorum_telemetry_attach(name));
+    writer->version = VARIORUM_TELEMETRY_VERSION;
+    writer->sample_size = sizeof(struct variorum_telemetry_sample) + 8;
+    EXPECT_EQ(nullptr, variorum_telemetry_attach(name));
+    variorum_telemetry_destroy(name, writer);
+}
+
+TEST(variorum_telemetry, stale_segment_is_replaced)
+{
+    struct variorum_telemetry_segment *writer, *next;
+    char name[64];
+
+    segment_name(name, sizeof(name), "stale");
+    ASSERT_EQ(0, variorum_telemetry_create(name, HISTORY_LEN, 10, &writer));
+    // Left behind by a publisher that stopped without removing it.
+    writer->closed = 1;
+    ASSERT_EQ(0, variorum_telemetry_create(name, 2 * HISTORY_LEN, 10, &next));
+    EXPECT_EQ((uint32_t)(2 * HISTORY_LEN), next->history_len);
+    variorum_telemetry_destroy(name, next);
+}
+
+struct writer_args
+{
+    struct variorum_telemetry_segment *segment;
+    int samples;
+};
+
+static void *write_samples(void *arg)
+{
+    struct writer_args *args = (struct writer_args *)arg;
+    struct variorum_telemetry_sample s;
+    int i;
+
+    for (i = 1; i <= args->samples; i++)
+    {
+        s = make_sample(i);
+        variorum_telemetry_write(args->segment, &s);
+    }
+    return NULL;
+}
+
+TEST(variorum_telemetry, concurrent_reads_are_consistent)
+{
+    struct variorum_telemetry_segment *writer, *reader;
+    struct variorum_telemetry_sample s;
+    struct writer_args args;
+    pthread_t thread;
+    char name[64];
+    int torn = 0, reads = 0;
+    uint64_t last = 0;
+
+    segment_name(name, sizeof(name), "concurrent");
+    ASSERT_EQ(0, variorum_telemetry_create(name, HISTORY_LEN, 10, &writer));
+    reader = variorum_telemetry_attach(name);
+    ASSERT_NE(nullptr, reader);
+
+    args.segment = writer;
+    args.samples = 200000;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, write_samples, &args));
+    do
+    {
+        if (variorum_telemetry_read(reader, &s) == 0)
+        {
+            reads++;
+            last = s.index + 1;
+            if (s.dram_joules != 2 * s.pkg_joules || s.gpu_joules != 3 * s.pkg_joules ||
+                    s.index + 1 != (uint64_t)s.pkg_joules)
+            {
+                torn++;
+            }
+        }
+    }
+    while (last < (uint64_t)args.samples);
+    pthread_join(thread, NULL);
+
+    EXPECT_GT(reads, 0);
+    EXPECT_EQ(0, torn);
+    variorum_telemetry_detach(reader);
+    variorum_telemetry_destroy(name, writer);
+}
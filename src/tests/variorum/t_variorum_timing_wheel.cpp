@@ -0,0 +1,65 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum_timing_wheel.h>
+}
+
+TEST(variorum_timing_wheel, common_tick)
+{
+    struct variorum_timing_wheel wheel;
+    const unsigned long periods[] = {10, 100, 1000};
+
+    ASSERT_EQ(0, variorum_timing_wheel_init(&wheel, periods, 3));
+    EXPECT_EQ(10ul, wheel.tick_ms);
+    EXPECT_EQ(1ul, wheel.period[0]);
+    EXPECT_EQ(10ul, wheel.period[1]);
+    EXPECT_EQ(100ul, wheel.period[2]);
+
+    const unsigned long coprime[] = {6, 4};
+    ASSERT_EQ(0, variorum_timing_wheel_init(&wheel, coprime, 2));
+    EXPECT_EQ(2ul, wheel.tick_ms);
+}
+
+TEST(variorum_timing_wheel, due_metrics)
+{
+    struct variorum_timing_wheel wheel;
+    const unsigned long periods[] = {1, 100, 1000};
+    unsigned count[3] = {0, 0, 0};
+    unsigned t, i;
+
+    ASSERT_EQ(0, variorum_timing_wheel_init(&wheel, periods, 3));
+    // Everything is due on the first tick.
+    EXPECT_EQ(7u, variorum_timing_wheel_advance(&wheel));
+    EXPECT_EQ(1u, variorum_timing_wheel_advance(&wheel));
+    for (t = 2; t < 3000; t++)
+    {
+        uint32_t due = variorum_timing_wheel_advance(&wheel);
+        for (i = 0; i < 3; i++)
+        {
+            if (due & (1u << i))
+            {
+                EXPECT_EQ(0u, t % periods[i]);
+                count[i]++;
+            }
+        }
+    }
+    EXPECT_EQ(2998u, count[0]);
+    EXPECT_EQ(29u, count[1]);
+    EXPECT_EQ(2u, count[2]);
+}
+
+TEST(variorum_timing_wheel, invalid)
+{
+    struct variorum_timing_wheel wheel;
+    const unsigned long periods[] = {10, 0};
+
+    EXPECT_EQ(-1, variorum_timing_wheel_init(&wheel, periods, 2));
+    EXPECT_EQ(-1, variorum_timing_wheel_init(&wheel, periods, 0));
+}
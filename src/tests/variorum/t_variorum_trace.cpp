@@ -0,0 +1,112 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <variorum.h>
+#include <variorum_trace.h>
+}
+
+#define NCOLS 3
+
+static void make_sample(unsigned i, int64_t *ts, int64_t *vals)
+{
+    // Jittered timestamps, a decreasing column, and a large counter.
+    *ts = 1700000000000LL + 50 * i + (i % 3);
+    vals[0] = 85123456 - 1000 * (int64_t)i;
+    vals[1] = (i % 7 == 0) ? -5 : 120000000;
+    vals[2] = 0x7fffffff00000000LL + 3000000LL * i;
+}
+
+static void round_trip(unsigned nsamples, unsigned block_rows)
+{
+    const char *names[NCOLS] = {"pkg0_joules", "pkg0_lim1watts", "TSC0"};
+    const unsigned decimals[NCOLS] = {6, 6, 0};
+    struct variorum_trace t;
+    struct variorum_trace_reader r;
+    int64_t ts, vals[NCOLS];
+    int64_t rts, rvals[NCOLS];
+    FILE *f = tmpfile();
+    unsigned i;
+
+    ASSERT_NE(f, (FILE *)NULL);
+    ASSERT_EQ(0, variorum_trace_open(&t, f, NCOLS, names, decimals, block_rows,
+                                     0));
+    for (i = 0; i < nsamples; i++)
+    {
+        make_sample(i, &ts, vals);
+        ASSERT_EQ(0, variorum_trace_append(&t, ts, vals));
+    }
+    ASSERT_EQ(0, variorum_trace_close(&t));
+
+    rewind(f);
+    ASSERT_EQ(0, variorum_trace_reader_open(&r, f));
+    EXPECT_EQ((unsigned)NCOLS, r.ncols);
+    for (i = 0; i < nsamples; i++)
+    {
+        make_sample(i, &ts, vals);
+        ASSERT_EQ(1, variorum_trace_read(&r, &rts, rvals));
+        EXPECT_EQ(ts, rts);
+        EXPECT_EQ(vals[0], rvals[0]);
+        EXPECT_EQ(vals[1], rvals[1]);
+        EXPECT_EQ(vals[2], rvals[2]);
+    }
+    EXPECT_EQ(0, variorum_trace_read(&r, &rts, rvals));
+    variorum_trace_reader_close(&r);
+    fclose(f);
+}
+
+TEST(variorum_trace, round_trip_full_blocks)
+{
+    round_trip(128, 64);
+}
+
+TEST(variorum_trace, round_trip_partial_block)
+{
+    round_trip(1000, 64);
+    round_trip(1, 64);
+    round_trip(5, 1);
+}
+
+TEST(variorum_trace, empty_trace)
+{
+    round_trip(0, 64);
+}
+
+TEST(variorum_trace, smaller_than_text)
+{
+    const char *names[NCOLS] = {"a", "b", "c"};
+    struct variorum_trace t;
+    int64_t ts, vals[NCOLS];
+    FILE *f = tmpfile();
+    long text_bytes = 0;
+    unsigned i;
+
+    ASSERT_NE(f, (FILE *)NULL);
+    ASSERT_EQ(0, variorum_trace_open(&t, f, NCOLS, names, NULL, 0, 0));
+    for (i = 0; i < 640; i++)
+    {
+        make_sample(i, &ts, vals);
+        text_bytes += snprintf(NULL, 0, "_VAR_MONITOR %ld %ld %ld %ld\n",
+                               (long)ts, (long)vals[0], (long)vals[1],
+                               (long)vals[2]);
+        ASSERT_EQ(0, variorum_trace_append(&t, ts, vals));
+    }
+    ASSERT_EQ(0, variorum_trace_close(&t));
+    EXPECT_LT(ftell(f) * 4, text_bytes);
+    fclose(f);
+}
+
+TEST(variorum_trace, set_monitoring_format)
+{
+    EXPECT_EQ(0, variorum_set_monitoring_format(VARIORUM_MONITORING_ENCODED));
+    EXPECT_EQ(-1, variorum_set_monitoring_format(42));
+    EXPECT_EQ(0, variorum_set_monitoring_format(VARIORUM_MONITORING_TEXT));
+    EXPECT_EQ(0, variorum_monitoring_flush());
+}
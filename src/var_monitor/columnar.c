@@ -0,0 +1,191 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <variorum_self_stats.h>
+
+#include "columnar.h"
+
+#define COLUMNAR_VERSION 1
+#define COLUMNAR_BOM 0x01020304U
+
+static size_t write_padded(FILE *out, const char *buf, size_t len)
+{
+    static const char zeros[8] = {0};
+    size_t pad = (8 - (len % 8)) % 8;
+
+    if (fwrite(buf, 1, len, out) != len || fwrite(zeros, 1, pad, out) != pad)
+    {
+        return 0;
+    }
+    return len + pad;
+}
+
+static int write_header(struct columnar_sink *s)
+{
+    uint32_t hdr[4];
+    uint32_t col[2];
+    size_t nbytes = 0;
+    unsigned i;
+
+    hdr[0] = COLUMNAR_VERSION;
+    hdr[1] = s->ncols;
+    hdr[2] = (uint32_t)strlen(s->hostname);
+    hdr[3] = COLUMNAR_BOM;
+    if (fwrite(COLUMNAR_MAGIC, 1, 8, s->out) != 8 ||
+            fwrite(hdr, sizeof(hdr), 1, s->out) != 1)
+    {
+        return -1;
+    }
+    nbytes += 8 + sizeof(hdr) + write_padded(s->out, s->hostname, hdr[2]);
+    for (i = 0; i < s->ncols; i++)
+    {
+        col[0] = s->types[i];
+        col[1] = (uint32_t)strlen(s->names[i]);
+        if (fwrite(col, sizeof(col), 1, s->out) != 1)
+        {
+            return -1;
+        }
+        nbytes += sizeof(col) + write_padded(s->out, s->names[i], col[1]);
+    }
+    VARIORUM_SELF_STATS_BYTES(nbytes);
+    s->header_written = 1;
+    return 0;
+}
+
+static int push(struct columnar_sink *s, const char *name,
+                enum columnar_type_e type, uint64_t bits)
+{
+    if (!s->header_written && s->nrows == 0)
+    {
+        /* First row defines the schema. */
+        if (s->col == s->cap_cols)
+        {
+            unsigned cap = s->cap_cols ? 2 * s->cap_cols : 16;
+            char **names = realloc(s->names, cap * sizeof(char *));
+            enum columnar_type_e *types = realloc(s->types, cap * sizeof(*types));
+            uint64_t *data = realloc(s->data,
+                                     (size_t)cap * s->chunk_rows * sizeof(uint64_t));
+            if (names == NULL || types == NULL || data == NULL)
+            {
+                return -1;
+            }
+            s->names = names;
+            s->types = types;
+            s->data = data;
+            s->cap_cols = cap;
+        }
+        s->names[s->col] = strdup(name);
+        s->types[s->col] = type;
+        s->ncols = s->col + 1;
+    }
+    else if (s->col >= s->ncols || s->types[s->col] != type)
+    {
+        /* Schema mismatch, discard the rest of this row at end_row. */
+        s->col = s->ncols + 1;
+        return -1;
+    }
+    s->data[(size_t)s->col * s->chunk_rows + s->nrows] = bits;
+    s->col++;
+    return 0;
+}
+
+int columnar_open(struct columnar_sink *s, FILE *out, const char *hostname,
+                  unsigned chunk_rows)
+{
+    memset(s, 0, sizeof(*s));
+    s->out = out;
+    s->chunk_rows = chunk_rows ? chunk_rows : COLUMNAR_DEFAULT_CHUNK_ROWS;
+    strncpy(s->hostname, hostname, sizeof(s->hostname) - 1);
+    return out == NULL ? -1 : 0;
+}
+
+int columnar_push_int64(struct columnar_sink *s, const char *name,
+                        int64_t value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return push(s, name, COLUMNAR_INT64, bits);
+}
+
+int columnar_push_float64(struct columnar_sink *s, const char *name,
+                          double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return push(s, name, COLUMNAR_FLOAT64, bits);
+}
+
+int columnar_end_row(struct columnar_sink *s)
+{
+    if (s->col != s->ncols || s->ncols == 0)
+    {
+        s->col = 0;
+        return -1;
+    }
+    s->col = 0;
+    s->nrows++;
+    if (s->nrows == s->chunk_rows)
+    {
+        return columnar_flush(s);
+    }
+    return 0;
+}
+
+int columnar_flush(struct columnar_sink *s)
+{
+    uint64_t t0 = variorum_self_ticks();
+    uint32_t chunk[2];
+    unsigned i;
+
+    if (s->nrows == 0)
+    {
+        return 0;
+    }
+    if (!s->header_written && write_header(s) != 0)
+    {
+        return -1;
+    }
+    memcpy(&chunk[0], "CHNK", 4);
+    chunk[1] = s->nrows;
+    if (fwrite(chunk, sizeof(chunk), 1, s->out) != 1)
+    {
+        return -1;
+    }
+    for (i = 0; i < s->ncols; i++)
+    {
+        if (fwrite(s->data + (size_t)i * s->chunk_rows, sizeof(uint64_t),
+                   s->nrows, s->out) != s->nrows)
+        {
+            return -1;
+        }
+    }
+    fflush(s->out);
+    VARIORUM_SELF_STATS_TIME(io, t0);
+    VARIORUM_SELF_STATS_BYTES(sizeof(chunk) + (size_t)s->ncols * s->nrows * 8);
+    s->nrows = 0;
+    return 0;
+}
+
+int columnar_close(struct columnar_sink *s)
+{
+    unsigned i;
+    int rc = columnar_flush(s);
+
+    for (i = 0; i < s->ncols; i++)
+    {
+        free(s->names[i]);
+    }
+    free(s->names);
+    free(s->types);
+    free(s->data);
+    s->names = NULL;
+    s->types = NULL;
+    s->data = NULL;
+    s->ncols = 0;
+    return rc;
+}
@@ -0,0 +1,100 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/// @brief Magic bytes at the start of a columnar trace file.
+#define COLUMNAR_MAGIC "VARCOL01"
+
+/// @brief Number of rows buffered per column chunk by default.
+#define COLUMNAR_DEFAULT_CHUNK_ROWS 1024
+
+/// @brief Element type of a column. All elements are 8 bytes wide.
+enum columnar_type_e
+{
+    COLUMNAR_INT64 = 1,
+    COLUMNAR_FLOAT64 = 2,
+};
+
+/// @brief Columnar trace writer.
+///
+/// File layout (native byte order, every array 8-byte aligned):
+///   header: magic[8], u32 version, u32 ncols, u32 hostname_len,
+///           u32 byte_order_mark (0x01020304), hostname padded to 8,
+///           ncols x { u32 type, u32 name_len, name padded to 8 }
+///   chunks: "CHNK", u32 nrows, then ncols contiguous arrays of nrows
+///           8-byte values, in column order.
+/// The schema is taken from the first row and must not change afterwards,
+/// so chunks can be appended in real time and located by size alone.
+struct columnar_sink
+{
+    /// @brief Destination file.
+    FILE *out;
+    /// @brief Hostname stored in the file header.
+    char hostname[64];
+    /// @brief Number of rows per chunk.
+    unsigned chunk_rows;
+    /// @brief Number of rows currently buffered.
+    unsigned nrows;
+    /// @brief Number of columns (fixed after the first row).
+    unsigned ncols;
+    /// @brief Column being filled in the current row.
+    unsigned col;
+    /// @brief Whether the header (and thus the schema) has been written.
+    int header_written;
+    /// @brief Column names and types, captured from the first row.
+    char **names;
+    enum columnar_type_e *types;
+    /// @brief Buffered column data, ncols x chunk_rows 8-byte values.
+    uint64_t *data;
+    /// @brief Allocated number of columns.
+    unsigned cap_cols;
+};
+
+/// @brief Start a columnar trace on an open file.
+int columnar_open(
+    struct columnar_sink *s,
+    FILE *out,
+    const char *hostname,
+    unsigned chunk_rows
+);
+
+/// @brief Append an integer value to the next column of the current row.
+int columnar_push_int64(
+    struct columnar_sink *s,
+    const char *name,
+    int64_t value
+);
+
+/// @brief Append a real value to the next column of the current row.
+int columnar_push_float64(
+    struct columnar_sink *s,
+    const char *name,
+    double value
+);
+
+/// @brief Finish the current row, writing a chunk if it is full.
+///
+/// @return 0 on success, -1 if the row does not match the schema (the row is
+/// discarded) or the write failed.
+int columnar_end_row(
+    struct columnar_sink *s
+);
+
+/// @brief Write out buffered rows as a (possibly short) chunk.
+int columnar_flush(
+    struct columnar_sink *s
+);
+
+/// @brief Flush and release the writer. The file is not closed.
+int columnar_close(
+    struct columnar_sink *s
+);
+
+#endif
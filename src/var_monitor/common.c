@@ -7,30 +7,307 @@
 #include <stdbool.h>
 
 #include <variorum.h>
+#include <variorum_json_obj.h>
+#include <variorum_prometheus.h>
+#include <variorum_self_stats.h>
 #include <variorum_topology.h>
 #include <variorum_timers.h>
+#include <variorum_timing_wheel.h>
 #include <jansson.h>
 
+#include "columnar.h"
+
+/* Metric groups with their own sampling period (-r), bit i of the fresh mask
+ * is metric i. */
+enum sampled_metric
+{
+    METRIC_POWER,
+    METRIC_COUNTERS,
+    METRIC_UTIL,
+    METRIC_SELF_STATS,
+    NUM_SAMPLED_METRICS
+};
+
+static const char *sampled_metric_names[NUM_SAMPLED_METRICS] =
+{
+    "power", "counters", "util", "self"
+};
+
 struct thread_args
 {
     bool measure_all;
     unsigned long sample_interval;
     bool power_with_util;
+    // Per-metric periods in ms, used when scheduled is set.
+    bool scheduled;
+    unsigned long period_ms[NUM_SAMPLED_METRICS];
+    // Built from period_ms before the sampling thread starts.
+    struct variorum_timing_wheel wheel;
 };
 
+// Append the sampler's own overhead counters as extra columns.
+static bool self_stats_columns = false;
+
+// When set, power samples go to a columnar trace instead of CSV text.
+static struct columnar_sink *colsink = NULL;
+
+// When set, power samples are also served on /metrics.
+static struct variorum_prometheus *exporter = NULL;
+
+// Append IPC and memory bandwidth per watt from counter sampling.
+static bool counter_columns = false;
+
+// Metrics are refreshed at their own periods and a fresh mask column marks
+// which of them were refreshed since the previous power sample.
+static bool scheduled_columns = false;
+static uint32_t scheduled_metrics = 0;
+static uint32_t fresh_mask = 0;
+
+// Last refreshed counter metrics and overhead counters.
+static double counter_ipc = 0.0;
+static double counter_mbps = 0.0;
+static struct variorum_self_stats self_st;
+
+/* Cache lines brought in by last-level cache misses. */
+#define LLC_MISS_BYTES 64.0
+
+static double self_ticks_to_us(uint64_t ticks, double ticks_per_usec)
+{
+    return ticks_per_usec > 0.0 ? ticks / ticks_per_usec : 0.0;
+}
+
+/* Replace the trailing newline of the header and value rows with the self
+ * overhead column group. */
+void append_self_stats(char *header_str, char *value_str, bool write_header)
+{
+    struct variorum_self_stats st;
+    char temp_value_str[256];
+    size_t len;
+
+    if (scheduled_columns == false)
+    {
+        variorum_get_self_stats(&self_st);
+    }
+    st = self_st;
+
+    if (write_header == true)
+    {
+        len = strlen(header_str);
+        if (len > 0 && header_str[len - 1] == '\n')
+        {
+            header_str[len - 1] = ',';
+        }
+        strcat(header_str, "Self Enter (us),Self Batch (us),Self JSON (us),"
+               "Self IO (us),Self Syscalls,Self Bytes Written,"
+               "Self Dropped Samples\n");
+    }
+
+    len = strlen(value_str);
+    if (len > 0 && value_str[len - 1] == '\n')
+    {
+        value_str[len - 1] = ',';
+    }
+    sprintf(temp_value_str, "%0.2lf,%0.2lf,%0.2lf,%0.2lf,%lu,%lu,%lu\n",
+            self_ticks_to_us(st.enter_ticks, st.ticks_per_usec),
+            self_ticks_to_us(st.batch_ticks, st.ticks_per_usec),
+            self_ticks_to_us(st.json_dumps_ticks, st.ticks_per_usec),
+            self_ticks_to_us(st.io_ticks, st.ticks_per_usec),
+            st.syscalls, st.bytes_written, st.dropped_samples);
+    strcat(value_str, temp_value_str);
+}
+
+/* Power the bandwidth is normalized by: node power if available, otherwise
+ * the sum of CPU and memory power. */
+static double sample_watts(json_t *node_obj, int num_sockets)
+{
+    json_t *socket_obj;
+    char socketID[20];
+    double watts = 0.0;
+    int i;
+
+    if (json_object_get(node_obj, "power_node_watts") != NULL)
+    {
+        return json_real_value(json_object_get(node_obj, "power_node_watts"));
+    }
+    for (i = 0; i < num_sockets; ++i)
+    {
+        snprintf(socketID, 20, "socket_%d", i);
+        socket_obj = json_object_get(node_obj, socketID);
+        watts += json_real_value(json_object_get(socket_obj, "power_cpu_watts"));
+        watts += json_real_value(json_object_get(socket_obj, "power_mem_watts"));
+    }
+    return watts;
+}
+
+/* Node-wide IPC and LLC-miss bandwidth over the last counter interval. */
+static void sample_counter_metrics(void)
+{
+    static int miss_idx = -2;
+    struct variorum_counter_sample cs;
+    double inst = 0.0, cycles = 0.0, misses = 0.0;
+    unsigned t, e;
+
+    counter_ipc = counter_mbps = 0.0;
+    if (variorum_sample_counters(&cs) != 0 || cs.elapsed_ns == 0)
+    {
+        return;
+    }
+    if (miss_idx == -2)
+    {
+        miss_idx = -1;
+        for (e = 0; e < cs.nevents; e++)
+        {
+            if (strcmp(cs.names[e], "LONGEST_LAT_CACHE.MISS") == 0)
+            {
+                miss_idx = e;
+            }
+        }
+    }
+    for (t = 0; t < cs.nthreads; t++)
+    {
+        // The fixed counters come first.
+        inst += cs.deltas[t * cs.nevents + 0];
+        cycles += cs.deltas[t * cs.nevents + 1];
+        if (miss_idx >= 0)
+        {
+            misses += cs.deltas[t * cs.nevents + miss_idx];
+        }
+    }
+    counter_ipc = cycles > 0.0 ? inst / cycles : 0.0;
+    counter_mbps = misses * LLC_MISS_BYTES / (cs.elapsed_ns / 1e9) / 1e6;
+}
+
+/* Counter metrics of the current power sample. Unless metrics are scheduled
+ * separately, counters are sampled along with power. */
+static void counter_metrics(double watts, double *ipc, double *mbps,
+                            double *mb_per_joule)
+{
+    if (scheduled_columns == false)
+    {
+        sample_counter_metrics();
+    }
+    *ipc = counter_ipc;
+    *mbps = counter_mbps;
+    *mb_per_joule = watts > 0.0 ? counter_mbps / watts : 0.0;
+}
+
+/* Replace the trailing newline of the header and value rows with the counter
+ * metric column group. */
+void append_counter_metrics(char *header_str, char *value_str,
+                            bool write_header, double watts)
+{
+    char temp_value_str[128];
+    double ipc, mbps, mb_per_joule;
+    size_t len;
+
+    counter_metrics(watts, &ipc, &mbps, &mb_per_joule);
+
+    if (write_header == true)
+    {
+        len = strlen(header_str);
+        if (len > 0 && header_str[len - 1] == '\n')
+        {
+            header_str[len - 1] = ',';
+        }
+        strcat(header_str, "IPC,Mem BW (MB/s),Mem BW per Watt (MB/J)\n");
+    }
+
+    len = strlen(value_str);
+    if (len > 0 && value_str[len - 1] == '\n')
+    {
+        value_str[len - 1] = ',';
+    }
+    sprintf(temp_value_str, "%0.3lf,%0.2lf,%0.3lf\n", ipc, mbps, mb_per_joule);
+    strcat(value_str, temp_value_str);
+}
+
+/* Replace the trailing newline of the header and value rows with the mask of
+ * metrics refreshed since the previous power sample. */
+void append_fresh_mask(char *header_str, char *value_str, bool write_header)
+{
+    char temp_value_str[32];
+    size_t len;
+
+    if (write_header == true)
+    {
+        len = strlen(header_str);
+        if (len > 0 && header_str[len - 1] == '\n')
+        {
+            header_str[len - 1] = ',';
+        }
+        strcat(header_str, "Fresh Mask\n");
+    }
+
+    len = strlen(value_str);
+    if (len > 0 && value_str[len - 1] == '\n')
+    {
+        value_str[len - 1] = ',';
+    }
+    sprintf(temp_value_str, "%u\n", fresh_mask);
+    strcat(value_str, temp_value_str);
+}
+
+/* Parse "metric=ms,..." into per-metric periods. Metrics not listed keep their
+ * period. */
+int parse_metric_periods(const char *spec, unsigned long *period_ms)
+{
+    char *copy = strdup(spec);
+    char *tok, *save = NULL;
+    int i, ret = 0;
+
+    if (copy == NULL)
+    {
+        return -1;
+    }
+    for (tok = strtok_r(copy, ",", &save); tok != NULL;
+            tok = strtok_r(NULL, ",", &save))
+    {
+        char *val = strchr(tok, '=');
+        char *end;
+        unsigned long ms;
+
+        if (val == NULL)
+        {
+            ret = -1;
+            break;
+        }
+        *val++ = '\0';
+        ms = strtoul(val, &end, 10);
+        if (end == val || *end != '\0' || ms == 0)
+        {
+            ret = -1;
+            break;
+        }
+        for (i = 0; i < NUM_SAMPLED_METRICS; i++)
+        {
+            if (strcmp(tok, sampled_metric_names[i]) == 0)
+            {
+                period_ms[i] = ms;
+                break;
+            }
+        }
+        if (i == NUM_SAMPLED_METRICS)
+        {
+            ret = -1;
+            break;
+        }
+    }
+    free(copy);
+    return ret;
+}
+
 int init_data(void)
 {
     return 0;
 }
 
-void parse_json_power_obj(char *s, int num_sockets)
+void parse_json_power_obj(json_t *power_obj, int num_sockets)
 {
     const char *hostname = NULL;
-    char header_str[500] = {'\0'}; //A big allocation at the moment.
+    char header_str[700] = {'\0'}; //A big allocation at the moment.
     char value_str[1000] = {'\0'}; //A big allocation at the moment.
     char temp_value_str[100] = {'\0'};
     json_t *node_obj = NULL;
-    json_t *power_obj = json_loads(s, JSON_DECODE_ANY, NULL);
     void *iter = json_object_iter(power_obj);
 
     static bool write_header = true;
@@ -199,23 +476,224 @@ void parse_json_power_obj(char *s, int num_sockets)
             }
         }
 
-        if ((i + 1) == num_sockets)
+    }
+
+    if (counter_columns == true)
+    {
+        append_counter_metrics(header_str, value_str, write_header,
+                               sample_watts(node_obj, num_sockets));
+    }
+
+    if (self_stats_columns == true)
+    {
+        append_self_stats(header_str, value_str, write_header);
+    }
+
+    if (scheduled_columns == true)
+    {
+        append_fresh_mask(header_str, value_str, write_header);
+    }
+
+    uint64_t t0 = variorum_self_ticks();
+    int nbytes = 0;
+    if (write_header == true)
+    {
+        // Write the header and set flag to false
+        nbytes += fprintf(logfile, "%s", header_str);
+        write_header = false;
+    }
+
+    //Write the values now
+    nbytes += fprintf(logfile, "%s", value_str);
+    VARIORUM_SELF_STATS_TIME(io, t0);
+    VARIORUM_SELF_STATS_BYTES(nbytes);
+}
+
+/* Same traversal as parse_json_power_obj, but appends typed values to the
+ * columnar sink. Column names match the CSV header. */
+void parse_json_power_obj_columnar(json_t *power_obj, int num_sockets)
+{
+    json_t *node_obj = NULL;
+    void *iter = json_object_iter(power_obj);
+    char name[64];
+    int i;
+
+    while (iter)
+    {
+        node_obj = json_object_iter_value(iter);
+        iter = json_object_iter_next(power_obj, iter);
+    }
+    if (node_obj == NULL)
+    {
+        printf("JSON object not found");
+        exit(0);
+    }
+
+    columnar_push_int64(colsink, "Timestamp",
+                        json_integer_value(json_object_get(node_obj, "timestamp")));
+    if (json_object_get(node_obj, "power_node_watts") != NULL)
+    {
+        columnar_push_float64(colsink, "Node Power (W)",
+                              json_real_value(json_object_get(node_obj, "power_node_watts")));
+    }
+
+    for (i = 0; i < num_sockets; ++i)
+    {
+        snprintf(name, sizeof(name), "socket_%d", i);
+        json_t *socket_obj = json_object_get(node_obj, name);
+        if (socket_obj == NULL)
+        {
+            printf("Socket object not found!\n");
+            exit(0);
+        }
+        if (json_object_get(socket_obj, "power_cpu_watts") != NULL)
+        {
+            snprintf(name, sizeof(name), "Socket_%d Power (W)", i);
+            columnar_push_float64(colsink, name,
+                                  json_real_value(json_object_get(socket_obj, "power_cpu_watts")));
+        }
+        if (json_object_get(socket_obj, "power_mem_watts") != NULL)
+        {
+            snprintf(name, sizeof(name), "Mem_%d Power (W)", i);
+            columnar_push_float64(colsink, name,
+                                  json_real_value(json_object_get(socket_obj, "power_mem_watts")));
+        }
+
+        json_t *gpu_obj = json_object_get(socket_obj, "power_gpu_watts");
+        if (gpu_obj != NULL)
+        {
+            const char *key;
+            json_t *gpu_value;
+            json_object_foreach(gpu_obj, key, gpu_value)
+            {
+                snprintf(name, sizeof(name), "%s Power (W)", key);
+                columnar_push_float64(colsink, name, json_real_value(gpu_value));
+            }
+        }
+    }
+
+    if (counter_columns == true)
+    {
+        double ipc, mbps, mb_per_joule;
+        counter_metrics(sample_watts(node_obj, num_sockets), &ipc, &mbps,
+                        &mb_per_joule);
+        columnar_push_float64(colsink, "IPC", ipc);
+        columnar_push_float64(colsink, "Mem BW (MB/s)", mbps);
+        columnar_push_float64(colsink, "Mem BW per Watt (MB/J)", mb_per_joule);
+    }
+
+    if (self_stats_columns == true)
+    {
+        struct variorum_self_stats st;
+        if (scheduled_columns == false)
         {
-            // Write the header and set flag to false
-            fprintf(logfile, "%s", header_str);
-            write_header = false;
+            variorum_get_self_stats(&self_st);
         }
+        st = self_st;
+        columnar_push_float64(colsink, "Self Enter (us)",
+                              self_ticks_to_us(st.enter_ticks, st.ticks_per_usec));
+        columnar_push_float64(colsink, "Self Batch (us)",
+                              self_ticks_to_us(st.batch_ticks, st.ticks_per_usec));
+        columnar_push_float64(colsink, "Self JSON (us)",
+                              self_ticks_to_us(st.json_dumps_ticks, st.ticks_per_usec));
+        columnar_push_float64(colsink, "Self IO (us)",
+                              self_ticks_to_us(st.io_ticks, st.ticks_per_usec));
+        columnar_push_int64(colsink, "Self Syscalls", st.syscalls);
+        columnar_push_int64(colsink, "Self Bytes Written", st.bytes_written);
+        columnar_push_int64(colsink, "Self Dropped Samples", st.dropped_samples);
+    }
 
+    if (scheduled_columns == true)
+    {
+        columnar_push_int64(colsink, "Fresh Mask", fresh_mask);
     }
 
-    //Write the values now
-    fprintf(logfile, "%s", value_str);
+    if (columnar_end_row(colsink) != 0)
+    {
+        printf("Columnar sample does not match the trace schema, dropped.\n");
+    }
+}
 
-    // Clean up memory.
-    json_decref(power_obj);
+/* Hand the power values of a JSON sample to the Prometheus exporter, which
+ * keeps them in binary until a scrape formats them. */
+void export_json_power_obj(json_t *power_obj, int num_sockets)
+{
+    json_t *node_obj = NULL;
+    void *iter = json_object_iter(power_obj);
+    char name[64];
+    char labels[96];
+    int i;
+
+    while (iter)
+    {
+        node_obj = json_object_iter_value(iter);
+        iter = json_object_iter_next(power_obj, iter);
+    }
+    if (node_obj == NULL)
+    {
+        return;
+    }
+
+    variorum_prometheus_push(exporter, "variorum_sample_timestamp_seconds",
+                             "Wall-clock time of the last power sample.", NULL,
+                             json_integer_value(json_object_get(node_obj, "timestamp")) / 1e6);
+    if (json_object_get(node_obj, "power_node_watts") != NULL)
+    {
+        variorum_prometheus_push(exporter, "variorum_node_power_watts",
+                                 "Node power.", NULL,
+                                 json_real_value(json_object_get(node_obj, "power_node_watts")));
+    }
+
+    // Series of a family must be contiguous in the exposition format.
+    for (i = 0; i < num_sockets; ++i)
+    {
+        snprintf(name, sizeof(name), "socket_%d", i);
+        snprintf(labels, sizeof(labels), "socket=\"%d\"", i);
+        json_t *value = json_object_get(json_object_get(node_obj, name),
+                                        "power_cpu_watts");
+        if (value != NULL)
+        {
+            variorum_prometheus_push(exporter, "variorum_cpu_power_watts",
+                                     "CPU package power of a socket.", labels,
+                                     json_real_value(value));
+        }
+    }
+    for (i = 0; i < num_sockets; ++i)
+    {
+        snprintf(name, sizeof(name), "socket_%d", i);
+        snprintf(labels, sizeof(labels), "socket=\"%d\"", i);
+        json_t *value = json_object_get(json_object_get(node_obj, name),
+                                        "power_mem_watts");
+        if (value != NULL)
+        {
+            variorum_prometheus_push(exporter, "variorum_mem_power_watts",
+                                     "Memory power of a socket.", labels,
+                                     json_real_value(value));
+        }
+    }
+    for (i = 0; i < num_sockets; ++i)
+    {
+        const char *key;
+        json_t *gpu_value;
+
+        snprintf(name, sizeof(name), "socket_%d", i);
+        json_t *gpu_obj = json_object_get(json_object_get(node_obj, name),
+                                          "power_gpu_watts");
+        json_object_foreach(gpu_obj, key, gpu_value)
+        {
+            snprintf(labels, sizeof(labels), "socket=\"%d\",gpu=\"%s\"", i, key);
+            variorum_prometheus_push(exporter, "variorum_gpu_power_watts",
+                                     "GPU power.", labels, json_real_value(gpu_value));
+        }
+    }
+
+    if (variorum_prometheus_end_row(exporter) != 0)
+    {
+        printf("Exported sample does not match the first sample, dropped.\n");
+    }
 }
 
-void parse_json_util_obj(char *util_str, int num_sockets)
+void parse_json_util_obj(json_t *util_obj, int num_sockets)
 {
     int i, j;
     const char *hostname = NULL;
@@ -227,8 +705,6 @@ void parse_json_util_obj(char *util_str, int num_sockets)
     static bool write_util_header = true;
     uint64_t timestamp;
 
-    /* Load the string as a JSON object using Jansson */
-    json_t *util_obj = json_loads(util_str, JSON_DECODE_ANY, NULL);
     void *iter = json_object_iter(util_obj);
     json_t *host_obj = NULL;
 
@@ -337,7 +813,62 @@ void parse_json_util_obj(char *util_str, int num_sockets)
             }
         }
     }
-    /*Deallocate JSON object*/
+}
+
+static int sampled_num_sockets(void)
+{
+    int num_sockets = variorum_get_num_sockets();
+
+    if (num_sockets <= 0)
+    {
+        printf("HWLOC returned an invalid number of sockets. Exiting.\n");
+        exit(-1);
+    }
+    return num_sockets;
+}
+
+static void write_power_sample(int num_sockets)
+{
+    // Extract power information from Variorum JSON API. The object is
+    // walked as is, instead of being serialized and parsed again.
+    int ret;
+    json_t *power_obj = NULL;
+
+    ret = variorum_get_power_json_obj(&power_obj);
+    if (ret != 0)
+    {
+        printf("JSON get node power failed. Exiting.\n");
+        exit(-1);
+    }
+
+    // Write out to logfile
+    if (colsink != NULL)
+    {
+        parse_json_power_obj_columnar(power_obj, num_sockets);
+    }
+    else
+    {
+        parse_json_power_obj(power_obj, num_sockets);
+    }
+    if (exporter != NULL)
+    {
+        export_json_power_obj(power_obj, num_sockets);
+    }
+    json_decref(power_obj);
+}
+
+static void write_util_sample(int num_sockets)
+{
+    int ret_util;
+    json_t *util_obj = NULL;
+
+    ret_util = variorum_get_utilization_json_obj(&util_obj);
+    if (ret_util != 0)
+    {
+        printf("JSON get node utilization failed. Exiting.\n");
+        exit(-1);
+    }
+    parse_json_util_obj(util_obj, num_sockets);
     json_decref(util_obj);
 }
 
@@ -355,44 +886,14 @@ void take_measurement(bool measure_all, bool power_with_util)
     // Default is to just dump out instantaneous power samples
     if (measure_all == false)
     {
-        // Extract power information from Variorum JSON API
-        int ret;
-        int num_sockets = 0;
-        char *s = NULL;
+        int num_sockets = sampled_num_sockets();
 
-        num_sockets = variorum_get_num_sockets();
-
-        if (num_sockets <= 0)
-        {
-            printf("HWLOC returned an invalid number of sockets. Exiting.\n");
-            exit(-1);
-        }
-
-        ret = variorum_get_power_json(&s);
-        if (ret != 0)
-        {
-            printf("JSON get node power failed. Exiting.\n");
-            free(s);
-            exit(-1);
-        }
-
-        // Write out to logfile
-        parse_json_power_obj(s, num_sockets);
+        write_power_sample(num_sockets);
 
         // Also print utilization if that is requested
         if (power_with_util == true)
         {
-            int ret_util;
-            char *util_str = NULL;
-
-            ret_util = variorum_get_utilization_json(&util_str);
-            if (ret_util != 0)
-            {
-                printf("JSON get node utilization failed. Exiting.\n");
-                free(util_str);
-                exit(-1);
-            }
-            parse_json_util_obj(util_str, num_sockets);
+            write_util_sample(num_sockets);
         }
     }
 
@@ -428,13 +929,72 @@ void take_measurement(bool measure_all, bool power_with_util)
     pthread_mutex_unlock(&mlock);
 }
 
+/* Refresh the metrics due on this tick. Power rows carry the latest value of
+ * every other metric; the fresh mask tells which were refreshed since the
+ * previous row. */
+void take_scheduled_measurement(uint32_t due, bool power_with_util)
+{
+    int num_sockets;
+
+    due &= scheduled_metrics;
+    if (due == 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&mlock);
+    num_sockets = sampled_num_sockets();
+
+    if (due & (1u << METRIC_COUNTERS))
+    {
+        sample_counter_metrics();
+    }
+    if (due & (1u << METRIC_SELF_STATS))
+    {
+        variorum_get_self_stats(&self_st);
+    }
+    fresh_mask |= due & ~(1u << METRIC_UTIL);
+    if (due & (1u << METRIC_POWER))
+    {
+        write_power_sample(num_sockets);
+        fresh_mask = 0;
+    }
+    if (power_with_util == true && (due & (1u << METRIC_UTIL)))
+    {
+        write_util_sample(num_sockets);
+    }
+    pthread_mutex_unlock(&mlock);
+}
+
 void *power_measurement(void *arg)
 {
     struct mstimer timer;
-    struct thread_args th_args;
-    th_args.sample_interval = (*(struct thread_args *)arg).sample_interval;
-    th_args.measure_all = (*(struct thread_args *)arg).measure_all;
-    th_args.power_with_util = (*(struct thread_args *)arg).power_with_util;
+    struct thread_args th_args = *(struct thread_args *)arg;
+    struct variorum_timing_wheel wheel = th_args.wheel;
+
+    if (th_args.scheduled)
+    {
+        int i;
+
+        for (i = 0; i < NUM_SAMPLED_METRICS; i++)
+        {
+            if (scheduled_metrics & (1u << i))
+            {
+                printf("Using %s sampling interval of: %ld ms\n",
+                       sampled_metric_names[i], th_args.period_ms[i]);
+            }
+        }
+        init_msTimer(&timer, wheel.tick_ms);
+        start = now_ms();
+
+        timer_sleep(&timer);
+        while (running)
+        {
+            take_scheduled_measurement(variorum_timing_wheel_advance(&wheel),
+                                       th_args.power_with_util);
+            timer_sleep(&timer);
+        }
+        return arg;
+    }
 
     // According to the Intel docs, the counter wraps at most once per second.
     // 50 ms should be short enough to always get good information (this is
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+
+# This script decodes the encoded trace written by 'var_monitor -v -f encoded' (or
+# 'encoded-zstd') and prints it in the _VAR_MONITOR text layout or as CSV.
+#
+# Requirements:
+#   zstandard (only for traces written with -f encoded-zstd)
+#
+# How to run the script?
+#   ./var_monitor-decode-trace.py [options] hostname.var_monitor.vtr
+#
+# Options:
+#   --csv: print comma-separated values with a header row instead of the
+#     _VAR_MONITOR text layout.
+#   --block N: decode only block N (0-based). Blocks are located from their headers
+#     without decoding the blocks before them.
+#   --info: print the columns and the block index, then exit.
+#
+# File layout (native byte order, see src/variorum/variorum_trace.h):
+#   header: magic "VARTRC01", u32 version, u32 ncols, u32 block_rows, u32 reserved,
+#           ncols x { u32 name_len, name, u32 decimals }
+#   blocks: u32 magic, u32 flags, u32 nrows, u32 raw_len, u32 stored_len,
+#           u32 reserved, i64 first_timestamp, payload[stored_len]
+# The payload holds zigzag varints, row by row: the timestamp delta-of-delta,
+# followed by the delta of each column. Decoder state resets at every block.
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"VARTRC01"
+BLOCK_MAGIC = 0x4B4C4256
+FLAG_ZSTD = 0x1
+BLOCK_HEADER = struct.Struct("=6Iq")
+
+
+def read_header(f):
+    if f.read(8) != MAGIC:
+        sys.exit("Error: not a var_monitor encoded trace")
+    version, ncols, block_rows, _ = struct.unpack("=4I", f.read(16))
+    names, decimals = [], []
+    for _ in range(ncols):
+        (name_len,) = struct.unpack("=I", f.read(4))
+        names.append(f.read(name_len).decode())
+        (dec,) = struct.unpack("=I", f.read(4))
+        decimals.append(dec)
+    return names, decimals
+
+
+def block_index(f):
+    """Return (offset, flags, nrows, raw_len, stored_len, first_ts) per block."""
+    blocks = []
+    while True:
+        offset = f.tell()
+        hdr = f.read(BLOCK_HEADER.size)
+        if len(hdr) < BLOCK_HEADER.size:
+            break
+        magic, flags, nrows, raw_len, stored_len, _, first_ts = BLOCK_HEADER.unpack(hdr)
+        if magic != BLOCK_MAGIC:
+            sys.exit("Error: corrupt block at offset %d" % offset)
+        blocks.append((offset, flags, nrows, raw_len, stored_len, first_ts))
+        f.seek(stored_len, 1)
+    return blocks
+
+
+def read_payload(f, block):
+    offset, flags, _, raw_len, stored_len, _ = block
+    f.seek(offset + BLOCK_HEADER.size)
+    payload = f.read(stored_len)
+    if flags & FLAG_ZSTD:
+        try:
+            import zstandard
+        except ImportError:
+            sys.exit("Error: the zstandard module is needed for compressed traces")
+        payload = zstandard.ZstdDecompressor().decompress(payload, max_output_size=raw_len)
+    return payload
+
+
+def decode_block(payload, nrows, ncols):
+    pos = 0
+    prev_ts = 0
+    prev_delta = 0
+    prev = [0] * ncols
+    for _ in range(nrows):
+        row = []
+        for _ in range(ncols + 1):
+            value = 0
+            shift = 0
+            while True:
+                b = payload[pos]
+                pos += 1
+                value |= (b & 0x7F) << shift
+                if not b & 0x80:
+                    break
+                shift += 7
+            row.append((value >> 1) ^ -(value & 1))
+        prev_delta += row[0]
+        prev_ts += prev_delta
+        for i in range(ncols):
+            prev[i] += row[i + 1]
+        yield prev_ts, prev
+
+
+def format_value(value, dec):
+    if dec == 0:
+        return str(value)
+    # Same 6-digit rendering as printf("%lf") in the text output.
+    return "%.*f" % (dec, value / 10 ** dec)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a var_monitor encoded trace.")
+    parser.add_argument("trace", help="hostname.var_monitor.vtr file")
+    parser.add_argument("--csv", action="store_true", help="print CSV instead of text")
+    parser.add_argument("--block", type=int, help="decode only this block")
+    parser.add_argument("--info", action="store_true", help="print columns and blocks")
+    args = parser.parse_args()
+
+    with open(args.trace, "rb") as f:
+        names, decimals = read_header(f)
+        blocks = block_index(f)
+
+        if args.info:
+            print("columns: %d" % len(names))
+            for name, dec in zip(names, decimals):
+                print("  %s (decimals=%d)" % (name, dec))
+            for i, b in enumerate(blocks):
+                print("block %d: offset=%d rows=%d first_time=%d bytes=%d%s"
+                      % (i, b[0], b[2], b[5], b[4], " zstd" if b[1] & FLAG_ZSTD else ""))
+            return
+
+        if args.block is not None:
+            if not 0 <= args.block < len(blocks):
+                sys.exit("Error: trace has %d blocks" % len(blocks))
+            blocks = [blocks[args.block]]
+
+        if args.csv:
+            print(",".join(["time"] + names))
+        else:
+            print("_VAR_MONITOR time " + " ".join(names))
+        sep = "," if args.csv else " "
+        prefix = "" if args.csv else "_VAR_MONITOR "
+        for b in blocks:
+            for ts, values in decode_block(read_payload(f, b), b[2], len(names)):
+                print(prefix + str(ts) + sep
+                      + sep.join(format_value(v, d) for v, d in zip(values, decimals)))
+
+
+if __name__ == "__main__":
+    main()
@@ -26,6 +26,10 @@
 #     four plots, mean, max, min, median.
 #   --description or -d: required to add a title of the figure.
 #
+# Both the CSV output (*.dat) and the columnar output of 'var_monitor -f columnar'
+# (*.col) are read. Columnar files are memory-mapped and their column chunks are
+# used as numpy arrays without parsing or copying.
+#
 # Examples:
 #   1. ./var_monitor-plot.py --input "/path/to/PowerData" --type per-node
 #     To plot power data located in "/path/to/PowerData" per node and save plots in
@@ -37,7 +41,9 @@
 import os
 import sys
 import argparse
+import struct
 
+import numpy as np
 import pandas as pd
 import matplotlib.pyplot as plt
 
@@ -50,6 +56,82 @@ def readCsvFile(csvFile):
     return powData
 
 
+# ---------------------------------------------------------------------
+# Read columnar files (var_monitor -f columnar)
+# ---------------------------------------------------------------------
+COLUMNAR_MAGIC = b"VARCOL01"
+COLUMNAR_TYPES = {1: np.int64, 2: np.float64}
+
+
+def _pad8(n):
+    return (n + 7) & ~7
+
+
+def readColumnarChunks(colFile):
+    """Return the column names and, for each chunk, a dict of column arrays.
+
+    The arrays are views of the memory-mapped file, so nothing is copied.
+    """
+    buf = np.memmap(colFile, dtype=np.uint8, mode="r")
+    if bytes(buf[0:8]) != COLUMNAR_MAGIC:
+        sys.exit("{0} is not a var_monitor columnar file".format(colFile))
+    version, ncols, hostLen, bom = struct.unpack_from("<4I", buf, 8)
+    if bom != 0x01020304:
+        sys.exit("{0} was written with a different byte order".format(colFile))
+    off = 24 + _pad8(hostLen)
+    names = []
+    types = []
+    for _ in range(ncols):
+        ctype, nameLen = struct.unpack_from("<2I", buf, off)
+        off += 8
+        names.append(bytes(buf[off : off + nameLen]).decode())
+        types.append(COLUMNAR_TYPES[ctype])
+        off += _pad8(nameLen)
+
+    # Each chunk holds ncols contiguous arrays.
+    chunks = []
+    while off + 8 <= len(buf):
+        tag = bytes(buf[off : off + 4])
+        (nrows,) = struct.unpack_from("<I", buf, off + 4)
+        off += 8
+        if tag != b"CHNK" or off + ncols * nrows * 8 > len(buf):
+            break  # truncated trailing chunk of a live trace
+        chunk = {}
+        for i in range(ncols):
+            chunk[names[i]] = np.frombuffer(
+                buf, dtype=types[i], count=nrows, offset=off
+            )
+            off += nrows * 8
+        chunks.append(chunk)
+    return names, chunks
+
+
+def readColumnarFile(colFile):
+    """Return the columnar file as one DataFrame.
+
+    A single-chunk file is used in place. Columns spanning several chunks
+    are copied once into contiguous arrays; use readColumnarChunks() to
+    process the chunks without copying.
+    """
+    names, chunks = readColumnarChunks(colFile)
+    cols = {}
+    for name in names:
+        parts = [chunk[name] for chunk in chunks]
+        if len(parts) == 1:
+            cols[name] = parts[0]
+        elif parts:
+            cols[name] = np.concatenate(parts)
+        else:
+            cols[name] = np.empty(0)
+    return pd.DataFrame(cols, copy=False)
+
+
+def readPowerFile(dataFile):
+    if dataFile.endswith(".col"):
+        return readColumnarFile(dataFile)
+    return readCsvFile(dataFile)
+
+
 # ---------------------------------------------------------------------
 # plot descriptive stats of power data
 # ---------------------------------------------------------------------
@@ -268,14 +350,14 @@ if __name__ == "__main__":
     if not os.path.exists(outputPath):
         os.makedirs(outputPath)
 
-    # find csv files
-    csvFiles = list_files(inputPath, ".dat")
+    # find csv and columnar files
+    csvFiles = list_files(inputPath, ".dat") + list_files(inputPath, ".col")
 
     if pltType == "per-node" or pltType is None:
         for csv in csvFiles:
             host = csv.split(".")[0]
             hostFile = "{0}/{1}".format(inputPath, csv)
-            hostdf = readCsvFile(hostFile)
+            hostdf = readPowerFile(hostFile)
             plotPowData(hostdf, host, outputPath, desc)
 
     if pltType == "aggregate":
@@ -287,7 +369,7 @@ if __name__ == "__main__":
         for csv in csvFiles:
             host = csv.split(".")[0]
             hostFile = "{0}/{1}".format(inputPath, csv)
-            hostdf = readCsvFile(hostFile)
+            hostdf = readPowerFile(hostFile)
             hostMean, hostMin, hostMax, hostMedian = findStats(hostdf, host)
             allMeans.append(hostMean)
             allMaxs.append(hostMax)
@@ -22,6 +22,10 @@
 #include "highlander.h"
 
 #define FASTEST_SAMPLE_INTERVAL_MS 50
+// Counter sampling (-e) is cheap enough for a finer interval.
+#define FASTEST_COUNTER_SAMPLE_INTERVAL_MS 10
+// With per-metric periods (-r), slow metrics no longer burden every sample.
+#define FASTEST_SCHEDULED_INTERVAL_MS 1
 
 #if 0
 /********/
@@ -87,6 +91,48 @@ int main(int argc, char **argv)
                         "\n"
                         "    -u\n"
                         "        Sampling and printing node utilization \n"
+                        "\n"
+                        "    -f format\n"
+                        "        Output format for power samples: csv (default) or columnar.\n"
+                        "        The columnar format writes typed column chunks to\n"
+                        "        hostname.var_monitor.col (see scripts/var_monitor-plot.py).\n"
+                        "        With -v, encoded or encoded-zstd write a delta/varint encoded\n"
+                        "        trace to hostname.var_monitor.vtr (see\n"
+                        "        scripts/var_monitor-decode-trace.py).\n"
+                        "\n"
+                        "    -e events\n"
+                        "        Sample performance counters with each power sample and append\n"
+                        "        IPC and memory bandwidth per watt columns. events is a\n"
+                        "        comma-separated list of event names or \"default\". Events\n"
+                        "        beyond the available counters are time-multiplexed. Allows\n"
+                        "        sampling intervals down to 10 ms.\n"
+                        "\n"
+                        "    -s\n"
+                        "        Append the sampler's own overhead (time in Variorum, JSON and\n"
+                        "        file I/O, syscalls, bytes written, dropped samples) as columns.\n"
+                        "\n"
+                        "    -r metric=ms[,metric=ms...]\n"
+                        "        Per-metric sampling intervals. Metrics are power, counters\n"
+                        "        (-e), util (-u) and self (-s); unlisted metrics use the -i\n"
+                        "        interval. Metrics are scheduled on a common tick and only due\n"
+                        "        metrics are read. Power rows carry the latest value of the\n"
+                        "        other metrics and end with a Fresh Mask column (1 = power,\n"
+                        "        2 = counters, 8 = self) of what was refreshed since the\n"
+                        "        previous row. Allows power intervals down to 1 ms, e.g.,\n"
+                        "        -r power=1,counters=10,util=1000.\n"
+                        "\n"
+                        "    -H cpus\n"
+                        "        Housekeeping CPUs, e.g., 35,71 or 32-35,68-71. Socket-scope\n"
+                        "        registers are read from the first listed CPU of each socket\n"
+                        "        by a sampler thread pinned to it, instead of interrupting the\n"
+                        "        first core of each socket.\n"
+                        "\n"
+                        "    -m [address:]port\n"
+                        "        Serve the latest power sample in the Prometheus text format\n"
+                        "        on http://address:port/metrics (127.0.0.1 by default, use\n"
+                        "        0.0.0.0 to serve on all interfaces).\n"
+                        "        Scrapes only format the cached sample and never read the\n"
+                        "        hardware, e.g., curl localhost:9101/metrics.\n"
                         "\n";
 
     if (argc == 1 || (argc > 1 && (
@@ -107,8 +153,20 @@ int main(int argc, char **argv)
     th_args.sample_interval = FASTEST_SAMPLE_INTERVAL_MS;
     th_args.measure_all = false;
     th_args.power_with_util = false;
-
-    while ((opt = getopt(argc, argv, "ca:p:i:v:u")) != -1)
+    th_args.scheduled = false;
+    bool use_columnar = false;
+    struct columnar_sink sink;
+    int monitoring_format = VARIORUM_MONITORING_TEXT;
+    const char *ext;
+    char *counter_events = NULL;
+    long requested_interval = 0;
+    char *metric_periods = NULL;
+    char *metrics_addr = NULL;
+    int metrics_port = -1;
+    struct variorum_prometheus prometheus;
+    int m;
+
+    while ((opt = getopt(argc, argv, "ca:p:i:vusf:e:H:r:m:")) != -1)
     {
         switch (opt)
         {
@@ -124,13 +182,7 @@ int main(int argc, char **argv)
                 logpath = strdup(optarg);
                 break;
             case 'i':
-                th_args.sample_interval = atol(optarg);
-                if (th_args.sample_interval < FASTEST_SAMPLE_INTERVAL_MS)
-                {
-                    printf("Warning: Specified sample interval (-i) is faster than default. Setting to default sampling interval of %d milliseconds.\n",
-                           FASTEST_SAMPLE_INTERVAL_MS);
-                    th_args.sample_interval = FASTEST_SAMPLE_INTERVAL_MS;
-                }
+                requested_interval = atol(optarg);
                 break;
             case 'v':
                 th_args.measure_all = true;
@@ -138,6 +190,51 @@ int main(int argc, char **argv)
             case 'u':
                 th_args.power_with_util = true;
                 break;
+            case 's':
+                self_stats_columns = true;
+                break;
+            case 'r':
+                metric_periods = optarg;
+                break;
+            case 'm':
+            {
+                char *colon = strrchr(optarg, ':');
+                if (colon != NULL)
+                {
+                    *colon = '\0';
+                    metrics_addr = optarg;
+                }
+                metrics_port = atoi(colon != NULL ? colon + 1 : optarg);
+                break;
+            }
+            case 'H':
+                setenv("VARIORUM_HOUSEKEEPING_CPUS", optarg, 1);
+                setenv("VARIORUM_SOCKET_READERS", "1", 1);
+                break;
+            case 'e':
+                counter_columns = true;
+                counter_events = strcmp(optarg, "default") == 0 ? NULL : optarg;
+                break;
+            case 'f':
+                if (strcmp(optarg, "columnar") == 0)
+                {
+                    use_columnar = true;
+                }
+                else if (strcmp(optarg, "encoded") == 0)
+                {
+                    monitoring_format = VARIORUM_MONITORING_ENCODED;
+                }
+                else if (strcmp(optarg, "encoded-zstd") == 0)
+                {
+                    monitoring_format = VARIORUM_MONITORING_ENCODED_ZSTD;
+                }
+                else if (strcmp(optarg, "csv") != 0)
+                {
+                    fprintf(stderr, "\nError: unknown output format \"%s\"\n", optarg);
+                    fprintf(stderr, "%s", usage);
+                    return 1;
+                }
+                break;
             case '?':
                 if (optopt == 'a')
                 {
@@ -158,6 +255,89 @@ int main(int argc, char **argv)
         }
     }
 
+    if (requested_interval > 0)
+    {
+        long fastest = counter_columns ? FASTEST_COUNTER_SAMPLE_INTERVAL_MS :
+                       FASTEST_SAMPLE_INTERVAL_MS;
+        th_args.sample_interval = requested_interval;
+        if (requested_interval < fastest)
+        {
+            printf("Warning: Specified sample interval (-i) is faster than default. Setting to default sampling interval of %ld milliseconds.\n",
+                   fastest);
+            th_args.sample_interval = fastest;
+        }
+    }
+
+    if (metric_periods != NULL && th_args.measure_all)
+    {
+        printf("Warning: Per-metric intervals (-r) apply to the default power samples. Ignoring them in verbose mode.\n");
+        metric_periods = NULL;
+    }
+    if (metric_periods != NULL)
+    {
+        for (m = 0; m < NUM_SAMPLED_METRICS; m++)
+        {
+            th_args.period_ms[m] = requested_interval > 0 ? requested_interval :
+                                   FASTEST_SAMPLE_INTERVAL_MS;
+        }
+        if (parse_metric_periods(metric_periods, th_args.period_ms) != 0)
+        {
+            fprintf(stderr, "\nError: invalid metric intervals \"%s\"\n",
+                    metric_periods);
+            fprintf(stderr, "%s", usage);
+            return 1;
+        }
+        for (m = 0; m < NUM_SAMPLED_METRICS; m++)
+        {
+            if (th_args.period_ms[m] < FASTEST_SCHEDULED_INTERVAL_MS)
+            {
+                th_args.period_ms[m] = FASTEST_SCHEDULED_INTERVAL_MS;
+            }
+        }
+        th_args.scheduled = true;
+        scheduled_columns = true;
+    }
+
+    if (counter_columns && th_args.measure_all)
+    {
+        printf("Warning: Counter sampling (-e) applies to the default power samples. Ignoring it in verbose mode.\n");
+        counter_columns = false;
+    }
+
+    if (use_columnar && th_args.measure_all)
+    {
+        printf("Warning: Columnar output (-f columnar) only covers the default power samples. Using text output for verbose mode.\n");
+        use_columnar = false;
+    }
+    if (metrics_port >= 0 && th_args.measure_all)
+    {
+        printf("Warning: The metrics endpoint (-m) only covers the default power samples. Ignoring it in verbose mode.\n");
+        metrics_port = -1;
+    }
+    if (monitoring_format != VARIORUM_MONITORING_TEXT && !th_args.measure_all)
+    {
+        printf("Warning: Encoded output (-f encoded) requires verbose mode (-v). Using text output.\n");
+        monitoring_format = VARIORUM_MONITORING_TEXT;
+    }
+    if (monitoring_format != VARIORUM_MONITORING_TEXT &&
+            variorum_set_monitoring_format(monitoring_format) != 0)
+    {
+        printf("Warning: Encoded output format is not available. Using text output.\n");
+        monitoring_format = VARIORUM_MONITORING_TEXT;
+    }
+    if (use_columnar)
+    {
+        ext = "col";
+    }
+    else if (monitoring_format != VARIORUM_MONITORING_TEXT)
+    {
+        ext = "vtr";
+    }
+    else
+    {
+        ext = "dat";
+    }
+
     if (!set_app)
     {
         printf("Error: Must specify -a flag with application and arguments in quotes.\n");
@@ -205,7 +385,8 @@ int main(int argc, char **argv)
         if (logpath)
         {
             /* Output trace data into the specified location. */
-            rc = asprintf(&fname_dat, "%s/%s.var_monitor.dat", logpath, hostname);
+            rc = asprintf(&fname_dat, "%s/%s.var_monitor.%s", logpath, hostname,
+                          ext);
             if (rc == -1)
             {
                 fprintf(stderr,
@@ -229,7 +410,8 @@ int main(int argc, char **argv)
         else
         {
             /* Output trace data into the default location. */
-            rc = asprintf(&fname_dat, "%s.var_monitor.dat", hostname);
+            rc = asprintf(&fname_dat, "%s.var_monitor.%s", hostname,
+                          ext);
             if (rc == -1)
             {
                 fprintf(stderr,
@@ -268,6 +450,40 @@ int main(int argc, char **argv)
             return 1;
         }
 
+        if (use_columnar)
+        {
+            if (columnar_open(&sink, logfile, hostname,
+                              COLUMNAR_DEFAULT_CHUNK_ROWS) != 0)
+            {
+                fprintf(stderr, "Fatal Error: %s on %s cannot start the columnar trace in %s.\n",
+                        argv[0], hostname, fname_dat);
+                return 1;
+            }
+            colsink = &sink;
+        }
+
+        if (metrics_port >= 0)
+        {
+            if (variorum_prometheus_open(&prometheus, metrics_addr, metrics_port,
+                                         hostname) == 0)
+            {
+                printf("Serving metrics on port %d at /metrics\n", prometheus.port);
+                exporter = &prometheus;
+            }
+            else
+            {
+                printf("Warning: Cannot serve metrics on port %d. Continuing without it.\n",
+                       metrics_port);
+            }
+        }
+
+        if (counter_columns &&
+                variorum_start_counter_sampling(counter_events) != 0)
+        {
+            printf("Warning: Counter sampling (-e) is not available. Continuing without it.\n");
+            counter_columns = false;
+        }
+
         // Open the utilization file if the option is selected.
         if (th_args.power_with_util)
         {
@@ -301,11 +517,34 @@ int main(int argc, char **argv)
             printf("Trace and summary files will be dumped in ./\n");
         }
 
+        if (th_args.scheduled)
+        {
+            scheduled_metrics = 1u << METRIC_POWER;
+            scheduled_metrics |= counter_columns ? 1u << METRIC_COUNTERS : 0;
+            scheduled_metrics |= th_args.power_with_util ? 1u << METRIC_UTIL : 0;
+            scheduled_metrics |= self_stats_columns ? 1u << METRIC_SELF_STATS : 0;
+            /* Metrics that are not sampled must not shorten the tick. */
+            for (m = 0; m < NUM_SAMPLED_METRICS; m++)
+            {
+                if (!(scheduled_metrics & (1u << m)))
+                {
+                    th_args.period_ms[m] = th_args.period_ms[METRIC_POWER];
+                }
+            }
+            if (variorum_timing_wheel_init(&th_args.wheel, th_args.period_ms,
+                                           NUM_SAMPLED_METRICS) != 0)
+            {
+                fprintf(stderr,
+                        "Fatal Error: %s on %s cannot schedule the metric intervals.\n",
+                        argv[0], hostname);
+                return 1;
+            }
+        }
+
         /* Start power measurement thread. */
         pthread_attr_t mattr;
         pthread_t mthread;
         pthread_attr_init(&mattr);
-        pthread_attr_setdetachstate(&mattr, PTHREAD_CREATE_DETACHED);
         pthread_mutex_init(&mlock, NULL);
         pthread_create(&mthread, &mattr, power_measurement, (void *) &th_args);
 
@@ -333,8 +572,42 @@ int main(int argc, char **argv)
 
         /* Stop power measurement thread. */
         running = 0;
-        take_measurement(th_args.measure_all, th_args.power_with_util);
+        pthread_join(mthread, NULL);
+        if (th_args.scheduled)
+        {
+            take_scheduled_measurement(scheduled_metrics, th_args.power_with_util);
+        }
+        else
+        {
+            take_measurement(th_args.measure_all, th_args.power_with_util);
+        }
         end = now_ms();
+        if (colsink != NULL)
+        {
+            pthread_mutex_lock(&mlock);
+            columnar_close(colsink);
+            colsink = NULL;
+            pthread_mutex_unlock(&mlock);
+        }
+        if (exporter != NULL)
+        {
+            pthread_mutex_lock(&mlock);
+            exporter = NULL;
+            pthread_mutex_unlock(&mlock);
+            variorum_prometheus_close(&prometheus);
+        }
+        if (counter_columns)
+        {
+            pthread_mutex_lock(&mlock);
+            variorum_stop_counter_sampling();
+            pthread_mutex_unlock(&mlock);
+        }
+        if (monitoring_format != VARIORUM_MONITORING_TEXT)
+        {
+            pthread_mutex_lock(&mlock);
+            variorum_monitoring_flush();
+            pthread_mutex_unlock(&mlock);
+        }
 
         if (logpath)
         {
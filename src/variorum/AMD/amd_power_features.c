@@ -19,35 +19,113 @@
 #include <cprintf.h>
 #endif
 
+static int read_sysfs_uint(const char *path, unsigned *value)
+{
+    char buf[32];
+    ssize_t n;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+    n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0)
+    {
+        return -1;
+    }
+    buf[n] = '\0';
+    *value = (unsigned)strtoul(buf, NULL, 10);
+    return 0;
+}
+
+/* Find the first hardware thread of every core, in order of CPU number.
+ * Linux usually numbers the first thread of every core first, so core i is
+ * CPU i, but this is checked against the thread siblings of each CPU. Falls
+ * back to CPU i if sysfs does not describe ncores cores. */
+static const unsigned *core_cpus(unsigned ncores)
+{
+    static unsigned *cpus = NULL;
+    static unsigned ncached = 0;
+    char path[128];
+    unsigned nthreads = 0;
+    unsigned cpu, first, n = 0;
+
+    if (cpus != NULL && ncached == ncores)
+    {
+        return cpus;
+    }
+    free(cpus);
+    ncached = 0;
+    cpus = (unsigned *) malloc(ncores * sizeof(unsigned));
+    if (cpus == NULL)
+    {
+        return NULL;
+    }
+    ncached = ncores;
+#ifdef VARIORUM_WITH_AMD_CPU
+    variorum_get_topology(NULL, NULL, &nthreads, P_AMD_CPU_IDX);
+#endif
+    for (cpu = 0; cpu < nthreads && n < ncores; cpu++)
+    {
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+        /* The list starts with the lowest-numbered sibling. */
+        if (read_sysfs_uint(path, &first))
+        {
+            break;
+        }
+        if (first == cpu)
+        {
+            cpus[n++] = cpu;
+        }
+    }
+    if (n != ncores)
+    {
+        for (n = 0; n < ncores; n++)
+        {
+            cpus[n] = n;
+        }
+    }
+    return cpus;
+}
+
+/* One operation per core: the energy status of a core is shared by its
+ * hardware threads, so it is read on the first thread of each core. */
 static void create_rapl_data_batch(struct rapl_data *rapl,
                                    off_t msr_core_energy_status)
 {
-    unsigned ncores;
+    const unsigned *cpus;
+    unsigned ncores = 0;
+    unsigned i;
 #ifdef VARIORUM_WITH_AMD_CPU
     variorum_get_topology(NULL, &ncores, NULL, P_AMD_CPU_IDX);
 #endif
+    cpus = core_cpus(ncores);
 
-    allocate_batch(RAPL_DATA, 2UL * ncores);
+    allocate_batch(RAPL_DATA, ncores);
 
     rapl->core_bits = (uint64_t **) calloc(ncores, sizeof(uint64_t *));
+    rapl->core_prev = (uint64_t *) calloc(ncores, sizeof(uint64_t));
+    rapl->core_ticks = (uint64_t *) calloc(ncores, sizeof(uint64_t));
     rapl->core_joules = (double *) calloc(ncores, sizeof(double));
-    load_thread_batch(msr_core_energy_status, rapl->core_bits, RAPL_DATA);
+    for (i = 0; i < ncores; i++)
+    {
+        create_batch_op(msr_core_energy_status, cpus != NULL ? cpus[i] : i,
+                        &rapl->core_bits[i], RAPL_DATA);
+    }
 }
 
 static int rapl_storage(struct rapl_data **data)
 {
     static struct rapl_data *rapl = NULL;
-    static unsigned ncores = 0;
     static int init = 0;
 
     if (!init)
     {
         init = 1;
-#ifdef VARIORUM_WITH_AMD_CPU
-        variorum_get_topology(NULL, &ncores, NULL, P_AMD_CPU_IDX);
-#endif
-
-        rapl = (struct rapl_data *) malloc(ncores * sizeof(struct rapl_data));
+        rapl = (struct rapl_data *) calloc(1, sizeof(struct rapl_data));
 
         if (data != NULL)
         {
@@ -56,8 +134,6 @@ static int rapl_storage(struct rapl_data **data)
 #ifdef VARIORUM_DEBUG
         fprintf(stderr, "%s %s::%d DEBUG: (storage) initialized rapl data at %p\n",
                 getenv("HOSTNAME"), __FILE__, __LINE__, rapl);
-        fprintf(stderr, "DEBUG: socket 0 has pkg_bits at %p\n",
-                &rapl[0].core_bits);
 #endif
         return 0;
     }
@@ -68,87 +144,226 @@ static int rapl_storage(struct rapl_data **data)
     return 0;
 }
 
-static int read_rapl_data(off_t msr_core_energy_status)
+/* The energy status unit does not change, so it is read once. */
+static int get_rapl_unit(off_t msr_rapl_unit, double *energy_val)
 {
-    static struct rapl_data *rapl = NULL;
-    static int init = 0;
-    static unsigned ncores = 0;
-    int i;
+    static double joules_per_tick = 0.0;
+    struct rapl_units ru;
+    uint64_t **val;
+    unsigned nsockets = 0;
 
-    if (!init)
+    if (joules_per_tick == 0.0)
     {
 #ifdef VARIORUM_WITH_AMD_CPU
-        variorum_get_topology(NULL, &ncores, NULL, P_AMD_CPU_IDX);
+        variorum_get_topology(&nsockets, NULL, NULL, P_AMD_CPU_IDX);
 #endif
-        if (rapl_storage(&rapl))
+        val = (uint64_t **) calloc(nsockets, sizeof(uint64_t *));
+        if (val == NULL)
         {
             return -1;
         }
+        allocate_batch(RAPL_UNIT, nsockets);
+        load_socket_batch(msr_rapl_unit, val, RAPL_UNIT);
+        if (read_batch(RAPL_UNIT))
+        {
+            free(val);
+            return -1;
+        }
+        ru.msr_rapl_power_unit = *val[0];
+        ru.joules = (double)(1 << (MASK_VAL(ru.msr_rapl_power_unit, 12, 8)));
+        joules_per_tick = 1 / ru.joules;
+        free(val);
+    }
+    *energy_val = joules_per_tick;
+    return 0;
+}
+
+int core_energy_batch_available(void)
+{
+    static int available = -1;
+    int batchfd;
+
+    if (available < 0)
+    {
+        batchfd = open(MSR_BATCH_PATH, O_RDWR);
+        available = batchfd >= 0;
+        if (batchfd >= 0)
+        {
+            close(batchfd);
+        }
+    }
+    return available;
+}
+
+/* The core energy batch is shared by every consumer and created once. */
+static struct rapl_data *core_energy_batch(off_t msr_core_energy_status)
+{
+    static struct rapl_data *rapl = NULL;
+
+    if (rapl == NULL)
+    {
+        rapl_storage(&rapl);
         create_rapl_data_batch(rapl, msr_core_energy_status);
-        for (i = 0; i < (int)ncores; i++)
+    }
+    return rapl;
+}
+
+int read_core_energy(off_t msr_rapl_unit, off_t msr_core_energy_status,
+                     const double **core_joules)
+{
+    unsigned ncores = 0;
+    struct rapl_data *rapl;
+    uint64_t cur;
+    double unit;
+    unsigned i;
+
+    if (get_rapl_unit(msr_rapl_unit, &unit))
+    {
+        return -1;
+    }
+    rapl = core_energy_batch(msr_core_energy_status);
+    if (read_batch(RAPL_DATA))
+    {
+        return -1;
+    }
+#ifdef VARIORUM_WITH_AMD_CPU
+    variorum_get_topology(NULL, &ncores, NULL, P_AMD_CPU_IDX);
+#endif
+    if (!rapl->core_baseline)
+    {
+        /* The baseline is the first successful read; a failed read leaves
+         * the batch values undefined. Start from the current counter values,
+         * as the raw counters do. */
+        rapl->core_baseline = 1;
+        for (i = 0; i < ncores; i++)
         {
-            rapl->core_joules[i] = 0;
+            rapl->core_prev[i] = *rapl->core_bits[i] & 0xFFFFFFFF;
+            rapl->core_ticks[i] = rapl->core_prev[i];
         }
     }
-    read_batch(RAPL_DATA);
-    init = 1;
+
+    for (i = 0; i < ncores; i++)
+    {
+        cur = *rapl->core_bits[i] & 0xFFFFFFFF;
+        /* Unsigned 32-bit subtraction absorbs one wraparound. */
+        rapl->core_ticks[i] += (uint32_t)(cur - rapl->core_prev[i]);
+        rapl->core_prev[i] = cur;
+        rapl->core_joules[i] = rapl->core_ticks[i] * unit;
+    }
+    *core_joules = rapl->core_joules;
     return 0;
 }
 
-static int get_rapl_unit(off_t msr_rapl_unit, double *energy_val)
+int read_core_energy_raw(off_t msr_rapl_unit, off_t msr_core_energy_status,
+                         uint32_t *raw, double *joules_per_tick)
 {
-    static struct rapl_units *ru = NULL;
-    static uint64_t **val = NULL;
-
-    ru = (struct rapl_units *) malloc(1 * sizeof(struct rapl_units));
-    val = (uint64_t **) malloc(1 * sizeof(uint64_t *));
-    allocate_batch(RAPL_UNIT, 1);
-    load_socket_batch(msr_rapl_unit, val, RAPL_UNIT);
-    read_batch(RAPL_UNIT);
-    ru[1].msr_rapl_power_unit = *val[1];
-    ru[1].joules = (double)(1 << (MASK_VAL(ru[1].msr_rapl_power_unit, 12, 8)));
-    *energy_val = (1 / ru[1].joules);
-
-    free(ru);
-    ru = NULL;
-    free(val);
-    val = NULL;
+    struct rapl_data *rapl;
+    unsigned ncores = 0;
+    unsigned i;
+
+    if (get_rapl_unit(msr_rapl_unit, joules_per_tick))
+    {
+        return -1;
+    }
+    rapl = core_energy_batch(msr_core_energy_status);
+    if (read_batch(RAPL_DATA))
+    {
+        return -1;
+    }
+#ifdef VARIORUM_WITH_AMD_CPU
+    variorum_get_topology(NULL, &ncores, NULL, P_AMD_CPU_IDX);
+#endif
+    /* Gather the values scattered over the batch operations. */
+    for (i = 0; i < ncores; i++)
+    {
+        raw[i] = (uint32_t)(*rapl->core_bits[i]);
+    }
+    return 0;
+}
+
+int core_ccd_map(unsigned ncores, unsigned *core_ccd, unsigned *ccd_socket,
+                 unsigned *nccds)
+{
+    char path[128];
+    const unsigned *cpus;
+    unsigned *l3_ids;
+    unsigned core, cpu, ccd, l3, socket;
+    unsigned cores_per_socket;
+    unsigned nsockets = 1;
+
+#ifdef VARIORUM_WITH_AMD_CPU
+    variorum_get_topology(&nsockets, NULL, NULL, P_AMD_CPU_IDX);
+#endif
+    cores_per_socket = nsockets > 0 ? ncores / nsockets : ncores;
+    if (cores_per_socket == 0)
+    {
+        cores_per_socket = 1;
+    }
+    l3_ids = (unsigned *) malloc(ncores * sizeof(unsigned));
+    if (l3_ids == NULL)
+    {
+        return -1;
+    }
+    *nccds = 0;
+    cpus = core_cpus(ncores);
+    for (core = 0; core < ncores; core++)
+    {
+        cpu = cpus != NULL ? cpus[core] : core;
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/cache/index3/id", cpu);
+        if (read_sysfs_uint(path, &l3))
+        {
+            /* A CCD has 8 cores on Zen 3 and Zen 4. */
+            l3 = (1u << 31) | (core / 8);
+        }
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+        if (read_sysfs_uint(path, &socket))
+        {
+            socket = core / cores_per_socket;
+        }
+        /* Number the L3 domains densely in order of appearance. */
+        for (ccd = 0; ccd < *nccds && l3_ids[ccd] != l3; ccd++)
+        {
+        }
+        if (ccd == *nccds)
+        {
+            l3_ids[ccd] = l3;
+            ccd_socket[ccd] = socket;
+            (*nccds)++;
+        }
+        core_ccd[core] = ccd;
+    }
+    free(l3_ids);
     return 0;
 }
 
 int print_energy_data(FILE *writedest, off_t msr_rapl_unit,
                       off_t msr_core_energy_status)
 {
-    static struct rapl_data *rapl = NULL;
-    static int init = 0;
+    const double *core_joules;
     unsigned ncores = 0;
     // TODO: We can't test this API yet due to privilege issues. We need to
     // update the printing format here to include hostname and prefix
     // _AMDENERGY once we have ability to test.
     // char hostname[1024];
-    int i, batchfd;
-    double val;
+    int i;
 
-    if ((batchfd = open(MSR_BATCH_PATH, O_RDWR)) < 0)
+    if (!core_energy_batch_available())
     {
         perror(MSR_BATCH_PATH);
-        return batchfd;
+        return -1;
     }
 
 #ifdef VARIORUM_WITH_AMD_CPU
     variorum_get_topology(NULL, &ncores, NULL, P_AMD_CPU_IDX);
 #endif
 
-    read_rapl_data(msr_core_energy_status);
-
-    if (!init)
+    if (read_core_energy(msr_rapl_unit, msr_core_energy_status, &core_joules))
     {
-        rapl_storage(&rapl);
-        init = 1;
+        return -1;
     }
 
-    get_rapl_unit(msr_rapl_unit, &val);
-
 #ifdef LIBJUSTIFY_FOUND
     cfprintf(writedest, "%s  | %s  |\n", "Core", "Energy (J)");
 #else
@@ -158,9 +373,9 @@ int print_energy_data(FILE *writedest, off_t msr_rapl_unit,
     for (i = 0; i < (int)ncores; i++)
     {
 #ifdef LIBJUSTIFY_FOUND
-        cprintf(writedest, "%d  | %f  |\n", i, (*rapl->core_bits[i]) * val);
+        cprintf(writedest, "%d  | %f  |\n", i, core_joules[i]);
 #else
-        fprintf(writedest, "%6d  | %10f  |\n", i, (*rapl->core_bits[i]) * val);
+        fprintf(writedest, "%6d  | %10f  |\n", i, core_joules[i]);
 #endif
     }
 
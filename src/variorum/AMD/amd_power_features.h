@@ -28,10 +28,76 @@ struct EPYC_19h_offsets
 
 struct rapl_data
 {
+    /// @brief Raw 32-bit MSR_CORE_ENERGY_STATUS of each core, pointing into
+    /// the batch.
     uint64_t **core_bits;
+    /// @brief Value of core_bits at the previous read.
+    uint64_t *core_prev;
+    /// @brief Core energy extended to 64 bits, in energy status units.
+    uint64_t *core_ticks;
+    /// @brief Core energy (J).
     double *core_joules;
+    /// @brief Set once core_prev holds a successful read.
+    int core_baseline;
 };
 
+/// @brief Whether the msr-safe batch device can be opened.
+///
+/// @return 1 if available, otherwise 0.
+int core_energy_batch_available(
+    void
+);
+
+/// @brief Read the energy of every core with one batch operation.
+///
+/// The 32-bit counters are extended to 64 bits on every read, so the values
+/// never wrap as long as consecutive reads are less than one wrap apart.
+///
+/// @param [in] msr_rapl_unit Unique MSR address for MSR_RAPL_POWER_UNIT.
+/// @param [in] msr_core_energy_status Unique MSR address for
+///             MSR_CORE_ENERGY_STATUS.
+/// @param [out] core_joules Energy of each core (J), valid until the next
+///              call.
+///
+/// @return 0 if successful, otherwise -1.
+int read_core_energy(
+    off_t msr_rapl_unit,
+    off_t msr_core_energy_status,
+    const double **core_joules
+);
+
+/// @brief Read the raw 32-bit energy counter of every core with one batch
+/// operation.
+///
+/// @param [in] msr_rapl_unit Unique MSR address for MSR_RAPL_POWER_UNIT.
+/// @param [in] msr_core_energy_status Unique MSR address for
+///             MSR_CORE_ENERGY_STATUS.
+/// @param [out] raw Counter of each core, one entry per core.
+/// @param [out] joules_per_tick Energy status unit (J).
+///
+/// @return 0 if successful, otherwise -1.
+int read_core_energy_raw(
+    off_t msr_rapl_unit,
+    off_t msr_core_energy_status,
+    uint32_t *raw,
+    double *joules_per_tick
+);
+
+/// @brief Map each core to its CCD (L3 domain) and each CCD to its socket.
+///
+/// @param [in] ncores Number of cores.
+/// @param [out] core_ccd CCD of each core, ncores entries.
+/// @param [out] ccd_socket Socket of each CCD, up to ncores entries.
+/// @param [out] nccds Number of CCDs.
+///
+/// @return 0 if successful, otherwise -1.
+int core_ccd_map(
+    unsigned ncores,
+    unsigned *core_ccd,
+    unsigned *ccd_socket,
+    unsigned *nccds
+);
+
 int print_energy_data(
     FILE *writedest,
     off_t msr_rapl_unit,
@@ -10,6 +10,7 @@
 #include <config_amd.h>
 #include <config_architecture.h>
 #include <epyc.h>
+#include <variorum_powercap.h>
 #include <variorum_error.h>
 
 uint64_t *detect_amd_arch(void)
@@ -35,6 +36,31 @@ uint64_t *detect_amd_arch(void)
     return fh_model;
 }
 
+/* E-SMI is initialized on the first call into variorum and stays open until
+ * the process exits, instead of being opened and closed around every API
+ * call. */
+esmi_status_t amd_esmi_session(void)
+{
+    static int init = 0;
+    static esmi_status_t status;
+
+    if (!init)
+    {
+        init = 1;
+        status = esmi_init();
+        if (status == ESMI_SUCCESS)
+        {
+            atexit(esmi_exit);
+        }
+        else
+        {
+            fprintf(stdout, "ESMI not initialized, drivers not found. "
+                    "Msg[%d]: %s\n", status, esmi_get_err_msg(status));
+        }
+    }
+    return status;
+}
+
 int set_amd_func_ptrs(int idx)
 {
     int ret = 0;
@@ -60,7 +86,7 @@ int set_amd_func_ptrs(int idx)
     }
 
     /* smi monitor initialization */
-    ret = esmi_init();
+    ret = amd_esmi_session();
     switch (ret)
     {
         case 0:
@@ -80,11 +106,30 @@ int set_amd_func_ptrs(int idx)
             g_platform[idx].variorum_get_node_power_domain_info_json =
                 amd_cpu_epyc_get_node_power_domain_info_json;
             g_platform[idx].variorum_get_frequency_json = amd_cpu_epyc_get_json_boostlimit;
+            g_platform[idx].variorum_sample_core_power = amd_cpu_epyc_sample_core_power;
+            g_platform[idx].variorum_get_core_power_json =
+                amd_cpu_epyc_get_core_power_json;
             break;
         default:
-            fprintf(stdout, "ESMI not initialized, drivers not found. "
-                    "Msg[%d]: %s\n", ret, esmi_get_err_msg(ret));
             g_platform[idx].variorum_print_energy = amd_cpu_epyc_print_energy;
+            // Core energy can still be read through msr-safe.
+            g_platform[idx].variorum_sample_core_power = amd_cpu_epyc_sample_core_power;
+            g_platform[idx].variorum_get_core_power_json =
+                amd_cpu_epyc_get_core_power_json;
+            // The kernel's RAPL driver also covers AMD processors, so use the
+            // powercap class where it is readable.
+            if (powercap_available())
+            {
+                g_platform[idx].variorum_print_power = powercap_get_power;
+                g_platform[idx].variorum_print_energy = powercap_get_energy;
+                g_platform[idx].variorum_print_power_limit = powercap_get_power_limits;
+                g_platform[idx].variorum_cap_each_socket_power_limit =
+                    powercap_cap_each_socket_power_limit;
+                g_platform[idx].variorum_get_power_json = powercap_get_power_json;
+                g_platform[idx].variorum_get_energy_json = powercap_get_energy_json;
+                g_platform[idx].variorum_get_energy_counters =
+                    powercap_get_energy_counters;
+            }
             ret = 0;
     }
     return ret;
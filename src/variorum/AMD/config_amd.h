@@ -17,4 +17,8 @@ int set_amd_func_ptrs(
     int idx
 );
 
+esmi_status_t amd_esmi_session(
+    void
+);
+
 #endif
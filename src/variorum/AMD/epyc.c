@@ -3,14 +3,18 @@
 //
 // SPDX-License-Identifier: MIT
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <config_amd.h>
 #include <config_architecture.h>
 #include <epyc.h>
+#include <variorum_core_power.h>
 #include <variorum_error.h>
 #include <e_smi/e_smi.h>
 
@@ -21,6 +25,99 @@
 #include <cprintf.h>
 #endif
 
+/* Cores of one socket to query through E-SMI. */
+struct socket_cores_query
+{
+    int first_core;
+    int ncores;
+    /* Energy of each core (uJ), or NULL. */
+    uint64_t *energy;
+    /* Boost limit of each core (MHz), or NULL. */
+    uint32_t *boostlimit;
+    /* E-SMI status of each core. */
+    esmi_status_t *err;
+};
+
+static void *query_socket_cores(void *arg)
+{
+    struct socket_cores_query *q = (struct socket_cores_query *) arg;
+    int i;
+
+    for (i = q->first_core; i < q->first_core + q->ncores; i++)
+    {
+        q->err[i] = ESMI_SUCCESS;
+        if (q->energy != NULL)
+        {
+            q->energy[i] = 0;
+            q->err[i] = esmi_core_energy_get(i, &q->energy[i]);
+        }
+        if (q->boostlimit != NULL && q->err[i] == ESMI_SUCCESS)
+        {
+            q->boostlimit[i] = 0;
+            q->err[i] = esmi_core_boostlimit_get(i, &q->boostlimit[i]);
+        }
+    }
+    return NULL;
+}
+
+/* Each per-core E-SMI query is a round trip to the SMU mailbox of the core's
+ * socket, so query the sockets in parallel, one thread each, and the cores
+ * of a socket in turn. */
+static int query_cores(uint64_t *energy, uint32_t *boostlimit,
+                       esmi_status_t *err)
+{
+    int num_sockets = 1;
+    int total_cores = 0;
+    struct socket_cores_query *q;
+    pthread_t *threads;
+    int *started;
+    int socket;
+
+#ifdef VARIORUM_WITH_AMD_CPU
+    num_sockets = g_platform[P_AMD_CPU_IDX].num_sockets;
+    total_cores = g_platform[P_AMD_CPU_IDX].total_cores;
+#endif
+    q = (struct socket_cores_query *) malloc(num_sockets * sizeof(*q));
+    threads = (pthread_t *) malloc(num_sockets * sizeof(pthread_t));
+    started = (int *) calloc(num_sockets, sizeof(int));
+    if (q == NULL || threads == NULL || started == NULL)
+    {
+        free(q);
+        free(threads);
+        free(started);
+        return -1;
+    }
+    for (socket = 0; socket < num_sockets; socket++)
+    {
+        q[socket].first_core = socket * (total_cores / num_sockets);
+        q[socket].ncores = total_cores / num_sockets;
+        q[socket].energy = energy;
+        q[socket].boostlimit = boostlimit;
+        q[socket].err = err;
+        /* The calling thread takes the last socket. */
+        if (socket < num_sockets - 1)
+        {
+            started[socket] = pthread_create(&threads[socket], NULL,
+                                             query_socket_cores, &q[socket]) == 0;
+        }
+        if (!started[socket])
+        {
+            query_socket_cores(&q[socket]);
+        }
+    }
+    for (socket = 0; socket < num_sockets; socket++)
+    {
+        if (started[socket])
+        {
+            pthread_join(threads[socket], NULL);
+        }
+    }
+    free(q);
+    free(threads);
+    free(started);
+    return 0;
+}
+
 int amd_cpu_epyc_get_power(int long_ver)
 {
     char *val = getenv("VARIORUM_LOG");
@@ -377,10 +474,14 @@ int amd_cpu_epyc_print_energy(int long_ver)
     }
 
     int ret;
-    if (!esmi_init() && long_ver == 0)
+    if (amd_esmi_session() == ESMI_SUCCESS && long_ver == 0)
     {
         int i;
+        int total_cores = 0;
         uint64_t energy;
+        uint64_t *core_energy;
+        esmi_status_t *err;
+        const double *core_joules = NULL;
 
         fprintf(stdout, "_SOCKET_ENERGY :\n");
 #ifdef LIBJUSTIFY_FOUND
@@ -413,6 +514,27 @@ int amd_cpu_epyc_print_energy(int long_ver)
             }
         }
 
+#ifdef VARIORUM_WITH_AMD_CPU
+        total_cores = g_platform[P_AMD_CPU_IDX].total_cores;
+#endif
+        core_energy = (uint64_t *) calloc(total_cores, sizeof(uint64_t));
+        err = (esmi_status_t *) calloc(total_cores, sizeof(esmi_status_t));
+        if (core_energy == NULL || err == NULL)
+        {
+            free(core_energy);
+            free(err);
+            return -1;
+        }
+        /* One batch operation for all cores where msr-safe is loaded,
+         * otherwise one E-SMI query per core, sockets in parallel. */
+        if (!core_energy_batch_available() ||
+                read_core_energy(msrs.msr_rapl_power_unit, msrs.msr_core_energy_stat,
+                                 &core_joules))
+        {
+            core_joules = NULL;
+            query_cores(core_energy, NULL, err);
+        }
+
 #ifdef LIBJUSTIFY_FOUND
         cflush();
         printf("\n_CORE_ENERGY :\n");
@@ -422,29 +544,28 @@ int amd_cpu_epyc_print_energy(int long_ver)
         fprintf(stdout, "   Core |  Energy (uJoules) |\n");
 #endif
 
-#ifdef VARIORUM_WITH_AMD_CPU
-        for (i = 0; i < g_platform[P_AMD_CPU_IDX].total_cores; i++)
-#endif
+        for (i = 0; i < total_cores; i++)
         {
-            energy = 0;
-            ret = esmi_core_energy_get(i, &energy);
-            if (ret != 0)
+            if (core_joules != NULL)
+            {
+                core_energy[i] = (uint64_t)(core_joules[i] * 1000000);
+            }
+            else if (err[i] != ESMI_SUCCESS)
             {
                 fprintf(stdout, "Failed to get core[%d] _COREENERGY, Err[%d]:%s\n",
-                        i, ret, esmi_get_err_msg(ret));
+                        i, err[i], esmi_get_err_msg(err[i]));
                 continue;
             }
-            else
-            {
 #if LIBJUSTIFY_FOUND
-                cfprintf(stdout, "%d |  %.06f |\n",
-                         i, (double)energy / 1000000);
+            cfprintf(stdout, "%d |  %.06f |\n",
+                     i, (double)core_energy[i] / 1000000);
 #else
-                fprintf(stdout, " %6d | %17.06f | \n",
-                        i, (double)energy / 1000000);
+            fprintf(stdout, " %6d | %17.06f | \n",
+                    i, (double)core_energy[i] / 1000000);
 #endif
-            }
         }
+        free(core_energy);
+        free(err);
         return 0;
     }
 energy_batch:
@@ -463,7 +584,22 @@ int amd_cpu_epyc_print_boostlimit(int long_ver)
     }
 
     int i, ret;
-    uint32_t boostlimit;
+    int total_cores = 0;
+    uint32_t *boostlimit;
+    esmi_status_t *err;
+
+#ifdef VARIORUM_WITH_AMD_CPU
+    total_cores = g_platform[P_AMD_CPU_IDX].total_cores;
+#endif
+    boostlimit = (uint32_t *) calloc(total_cores, sizeof(uint32_t));
+    err = (esmi_status_t *) calloc(total_cores, sizeof(esmi_status_t));
+    if (boostlimit == NULL || err == NULL)
+    {
+        free(boostlimit);
+        free(err);
+        return -1;
+    }
+    query_cores(NULL, boostlimit, err);
 
 #ifdef LIBJUSTIFY_FOUND
     cfprintf(stdout, "%s |  %s  |\n", "Core", "Freq(MHz)");
@@ -471,27 +607,28 @@ int amd_cpu_epyc_print_boostlimit(int long_ver)
     fprintf(stdout, " Core   | Freq (MHz)  |\n");
 #endif
 
-#ifdef VARIORUM_WITH_AMD_CPU
-    for (i = 0; i < g_platform[P_AMD_CPU_IDX].total_cores; i++)
-#endif
+    for (i = 0; i < total_cores; i++)
     {
-        boostlimit = 0;
-        ret = esmi_core_boostlimit_get(i, &boostlimit);
+        ret = err[i];
         if (ret != 0)
         {
             fprintf(stdout, "Failed to get core[%u] _BOOSTLIMIT, Err[%d]:%s\n",
                     i, ret, esmi_get_err_msg(ret));
+            free(boostlimit);
+            free(err);
             return ret;
         }
         else
         {
 #ifdef LIBJUSTIFY_FOUND
-            cfprintf(stdout, "%d |  %u  |\n", i, boostlimit);
+            cfprintf(stdout, "%d |  %u  |\n", i, boostlimit[i]);
 #else
-            fprintf(stdout, "%6d  | %10u  |\n", i, boostlimit);
+            fprintf(stdout, "%6d  | %10u  |\n", i, boostlimit[i]);
 #endif
         }
     }
+    free(boostlimit);
+    free(err);
 
 #ifdef LIBJUSTIFY_FOUND
     cflush();
@@ -508,14 +645,25 @@ int amd_cpu_epyc_get_json_boostlimit(json_t *get_clock_obj_json)
         printf("Running %s\n\n", __FUNCTION__);
     }
 
-    int socket, core,  ret;
-    uint32_t boostlimit;
+    int socket, core;
+    uint32_t *boostlimit;
+    esmi_status_t *err;
 
     int num_sockets = g_platform[P_AMD_CPU_IDX].num_sockets;
     int total_cores = g_platform[P_AMD_CPU_IDX].total_cores;
     int cores_per_socket = total_cores / num_sockets;
     int current_core = 0;
 
+    boostlimit = (uint32_t *) calloc(total_cores, sizeof(uint32_t));
+    err = (esmi_status_t *) calloc(total_cores, sizeof(esmi_status_t));
+    if (boostlimit == NULL || err == NULL)
+    {
+        free(boostlimit);
+        free(err);
+        return -1;
+    }
+    query_cores(NULL, boostlimit, err);
+
     for (socket = 0; socket < num_sockets; ++socket)
     {
         char socket_name[16];
@@ -535,13 +683,15 @@ int amd_cpu_epyc_get_json_boostlimit(json_t *get_clock_obj_json)
 
         for (core = 0; core < cores_per_socket; ++core)
         {
-            ret = esmi_core_boostlimit_get(current_core, &boostlimit);
             char core_avg_string[24];
             snprintf(core_avg_string, 24, "core_%d_avg_freq_mhz", current_core);
-            json_object_set_new(core_obj, core_avg_string, json_real(boostlimit));
+            json_object_set_new(core_obj, core_avg_string,
+                                json_real(boostlimit[current_core]));
             current_core++;
         }
     }
+    free(boostlimit);
+    free(err);
     return 0;
 }
 
@@ -785,3 +935,147 @@ int amd_cpu_epyc_get_node_power_domain_info_json(char **get_domain_obj_str)
 
     return 0;
 }
+
+/* Per-core power time series, created on the first sample. */
+static struct variorum_core_power core_power;
+
+enum core_energy_source
+{
+    CORE_ENERGY_UNSET,
+    CORE_ENERGY_MSR,
+    CORE_ENERGY_ESMI
+};
+
+/* Sample the energy counter of every core. The source is chosen on the first
+ * sample and kept, since the series is scaled by that source's energy unit:
+ * one batch operation for all cores where msr-safe is loaded, otherwise
+ * E-SMI. The 32-bit MSRs are extended in software; E-SMI's 64-bit microjoule
+ * counters are used as they are. */
+static int sample_core_power(void)
+{
+    static enum core_energy_source source = CORE_ENERGY_UNSET;
+    static uint32_t *raw = NULL;
+    static uint64_t *energy = NULL;
+    static esmi_status_t *err = NULL;
+    struct timespec ts;
+    double joules_per_tick = 1e-6;
+    unsigned ncores = 0;
+    unsigned i;
+
+#ifdef VARIORUM_WITH_AMD_CPU
+    ncores = g_platform[P_AMD_CPU_IDX].total_cores;
+#endif
+    if (raw == NULL)
+    {
+        raw = (uint32_t *) malloc(ncores * sizeof(uint32_t));
+        energy = (uint64_t *) malloc(ncores * sizeof(uint64_t));
+        err = (esmi_status_t *) malloc(ncores * sizeof(esmi_status_t));
+        if (raw == NULL || energy == NULL || err == NULL)
+        {
+            free(raw);
+            free(energy);
+            free(err);
+            raw = NULL;
+            return -1;
+        }
+    }
+
+    if (source == CORE_ENERGY_UNSET)
+    {
+        source = core_energy_batch_available() ? CORE_ENERGY_MSR : CORE_ENERGY_ESMI;
+    }
+    if (source == CORE_ENERGY_MSR)
+    {
+        if (read_core_energy_raw(msrs.msr_rapl_power_unit, msrs.msr_core_energy_stat,
+                                 raw, &joules_per_tick))
+        {
+            /* Fall back to E-SMI only before the series has started. */
+            if (core_power.ncores != 0)
+            {
+                return -1;
+            }
+            source = CORE_ENERGY_ESMI;
+        }
+    }
+    if (source == CORE_ENERGY_ESMI)
+    {
+        if (amd_esmi_session() != ESMI_SUCCESS)
+        {
+            return -1;
+        }
+        joules_per_tick = 1e-6;
+        query_cores(energy, NULL, err);
+        for (i = 0; i < ncores; i++)
+        {
+            if (err[i] != ESMI_SUCCESS)
+            {
+                return -1;
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    if (core_power.ncores == 0)
+    {
+        unsigned *core_ccd = (unsigned *) malloc(ncores * sizeof(unsigned));
+        unsigned *ccd_socket = (unsigned *) malloc(ncores * sizeof(unsigned));
+        unsigned nccds = 0;
+        int ret = -1;
+
+        if (core_ccd != NULL && ccd_socket != NULL &&
+                core_ccd_map(ncores, core_ccd, ccd_socket, &nccds) == 0)
+        {
+            ret = variorum_core_power_init(&core_power, ncores, core_ccd, nccds,
+                                           ccd_socket, joules_per_tick);
+        }
+        free(core_ccd);
+        free(ccd_socket);
+        if (ret)
+        {
+            return -1;
+        }
+    }
+    if (source == CORE_ENERGY_ESMI)
+    {
+        variorum_core_power_update64(&core_power, energy,
+                                     ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+    }
+    else
+    {
+        variorum_core_power_update(&core_power, raw,
+                                   ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+    }
+    return 0;
+}
+
+int amd_cpu_epyc_sample_core_power(struct variorum_core_power_sample *sample)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (sample_core_power())
+    {
+        return -1;
+    }
+    variorum_core_power_get_sample(&core_power, sample);
+    return 0;
+}
+
+int amd_cpu_epyc_get_core_power_json(json_t *get_core_power_obj)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (sample_core_power())
+    {
+        return -1;
+    }
+    variorum_core_power_to_json(&core_power, get_core_power_obj);
+    return 0;
+}
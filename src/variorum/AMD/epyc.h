@@ -8,6 +8,8 @@
 
 #include <jansson.h>
 
+#include <variorum.h>
+
 int amd_cpu_epyc_get_power(
     int long_ver
 );
@@ -25,7 +27,7 @@ int amd_cpu_epyc_set_and_verify_best_effort_node_power_limit(
 );
 
 int amd_cpu_epyc_print_energy(
-    void
+    int long_ver
 );
 
 int amd_cpu_epyc_print_boostlimit(
@@ -58,4 +60,12 @@ int amd_cpu_epyc_get_json_boostlimit(
     json_t *get_clock_obj_json
 );
 
+int amd_cpu_epyc_sample_core_power(
+    struct variorum_core_power_sample *sample
+);
+
+int amd_cpu_epyc_get_core_power_json(
+    json_t *get_core_power_obj
+);
+
 #endif
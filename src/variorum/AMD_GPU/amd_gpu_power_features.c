@@ -3,6 +3,8 @@
 //
 // SPDX-License-Identifier: MIT
 
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -17,17 +19,194 @@
 #include <cprintf.h>
 #endif
 
-void get_power_data(int chipid, int total_sockets, int verbose, FILE *output)
+/* Metrics read by sample_devices(). */
+#define AMD_GPU_POWER           0x01
+#define AMD_GPU_POWER_LIMIT     0x02
+#define AMD_GPU_THERMALS        0x04
+#define AMD_GPU_CLOCKS          0x08
+#define AMD_GPU_UTILIZATION     0x10
+#define AMD_GPU_ENERGY          0x20
+/* Not a metric: set the power cap of each device. */
+#define AMD_GPU_SET_POWER_LIMIT 0x40
+
+/* Default number of threads, including the caller, that query devices. */
+#define AMD_GPU_DEFAULT_WORKERS 8
+
+struct amd_gpu_sample
 {
+    /* First RSMI call that failed for this device, if any. */
     rsmi_status_t ret;
+    /* Power, power cap, and power cap range (uW). */
+    uint64_t power;
+    uint64_t cap;
+    uint64_t cap_min;
+    uint64_t cap_max;
+    /* Edge temperature (millidegrees C). */
+    int64_t temp;
+    /* Current system and memory clocks (Hz). */
+    uint64_t sys_clk;
+    uint64_t mem_clk;
+    /* Percentage of time the device was busy. */
+    uint32_t busy;
+    /* Energy since an arbitrary origin (uJ). */
+    double energy;
+};
+
+static struct
+{
+    pthread_once_t once;
+    /* 1 once RSMI is initialized, -1 if it could not be. */
+    int state;
     uint32_t num_devices;
-    int gpus_per_socket;
-    char hostname[1024];
-    static int init = 0;
-    static struct timeval start;
-    struct timeval now;
+    unsigned nworkers;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    /* One collection at a time uses the workers. */
+    pthread_mutex_t lock;
+    /* Current collection. */
+    uint32_t first;
+    uint32_t count;
+    unsigned metrics;
+    uint64_t cap;
+    struct amd_gpu_sample *out;
+} rsmi =
+{
+    .once = PTHREAD_ONCE_INIT,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
 
-    gethostname(hostname, 1024);
+static void read_device(uint32_t dev, struct amd_gpu_sample *s)
+{
+    rsmi_status_t ret = RSMI_STATUS_SUCCESS;
+
+    if (rsmi.metrics & AMD_GPU_POWER)
+    {
+        /* Variorum v0.8 will support the new API from ROCm 6.0.2, which
+         * adds the RSMI_POWER_TYPE enum and the rsmi_dev_power_get() API.
+         * If using an older version of ROCm, replace this call with
+         * rsmi_dev_power_ave_get(dev, 0, &s->power). We're not adding
+         * backward compatibility checks at the moment due to lack of
+         * resources and time. */
+        RSMI_POWER_TYPE pwr_type = RSMI_AVERAGE_POWER;
+        ret = rsmi_dev_power_get(dev, &s->power, &pwr_type);
+    }
+    if ((rsmi.metrics & AMD_GPU_POWER_LIMIT) && ret == RSMI_STATUS_SUCCESS)
+    {
+        ret = rsmi_dev_power_cap_get(dev, 0, &s->cap);
+        if (ret == RSMI_STATUS_SUCCESS)
+        {
+            ret = rsmi_dev_power_cap_range_get(dev, 0, &s->cap_max, &s->cap_min);
+        }
+    }
+    if ((rsmi.metrics & AMD_GPU_THERMALS) && ret == RSMI_STATUS_SUCCESS)
+    {
+        ret = rsmi_dev_temp_metric_get(dev, RSMI_TEMP_TYPE_EDGE, RSMI_TEMP_CURRENT,
+                                       &s->temp);
+    }
+    if ((rsmi.metrics & AMD_GPU_CLOCKS) && ret == RSMI_STATUS_SUCCESS)
+    {
+        rsmi_frequencies_t f_sys, f_mem;
+
+        ret = rsmi_dev_gpu_clk_freq_get(dev, RSMI_CLK_TYPE_SYS, &f_sys);
+        if (ret == RSMI_STATUS_SUCCESS)
+        {
+            s->sys_clk = f_sys.frequency[f_sys.current];
+            ret = rsmi_dev_gpu_clk_freq_get(dev, RSMI_CLK_TYPE_MEM, &f_mem);
+        }
+        if (ret == RSMI_STATUS_SUCCESS)
+        {
+            s->mem_clk = f_mem.frequency[f_mem.current];
+        }
+    }
+    if ((rsmi.metrics & AMD_GPU_UTILIZATION) && ret == RSMI_STATUS_SUCCESS)
+    {
+        ret = rsmi_dev_busy_percent_get(dev, &s->busy);
+    }
+    if ((rsmi.metrics & AMD_GPU_ENERGY) && ret == RSMI_STATUS_SUCCESS)
+    {
+        uint64_t count, timestamp;
+        float resolution;
+
+        ret = rsmi_dev_energy_count_get(dev, &count, &resolution, &timestamp);
+        s->energy = count * (double)resolution;
+    }
+    if ((rsmi.metrics & AMD_GPU_SET_POWER_LIMIT) && ret == RSMI_STATUS_SUCCESS)
+    {
+        ret = rsmi_dev_power_cap_set(dev, 0, rsmi.cap);
+    }
+    s->ret = ret;
+}
+
+/* Worker w (the caller is worker 0) reads devices w, w + nworkers, ... of
+ * the current collection. */
+static void read_devices(unsigned w)
+{
+    uint32_t i;
+
+    for (i = w; i < rsmi.count; i += rsmi.nworkers)
+    {
+        read_device(rsmi.first + i, &rsmi.out[i]);
+    }
+}
+
+static void *device_reader_main(void *arg)
+{
+    unsigned w = (unsigned)(uintptr_t)arg;
+
+    while (1)
+    {
+        pthread_barrier_wait(&rsmi.start);
+        read_devices(w);
+        pthread_barrier_wait(&rsmi.done);
+    }
+    return NULL;
+}
+
+static void start_device_readers(void)
+{
+    char *val = getenv("VARIORUM_AMD_GPU_WORKERS");
+    unsigned w;
+
+    rsmi.nworkers = AMD_GPU_DEFAULT_WORKERS;
+    if (val != NULL && atoi(val) > 0)
+    {
+        rsmi.nworkers = atoi(val);
+    }
+    if (rsmi.nworkers > rsmi.num_devices)
+    {
+        rsmi.nworkers = rsmi.num_devices;
+    }
+    if (rsmi.nworkers <= 1)
+    {
+        rsmi.nworkers = 1;
+        return;
+    }
+    pthread_barrier_init(&rsmi.start, NULL, rsmi.nworkers);
+    pthread_barrier_init(&rsmi.done, NULL, rsmi.nworkers);
+    for (w = 1; w < rsmi.nworkers; w++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, device_reader_main, (void *)(uintptr_t)w))
+        {
+            variorum_error_handler("Could not start GPU reader thread",
+                                   VARIORUM_ERROR_RUNTIME, getenv("HOSTNAME"),
+                                   __FILE__, __FUNCTION__, __LINE__);
+            /* Threads already started stay parked, never use them. */
+            rsmi.nworkers = 1;
+            return;
+        }
+        pthread_detach(thread);
+    }
+}
+
+static void rsmi_session_exit(void)
+{
+    rsmi_shut_down();
+}
+
+static void rsmi_session_init(void)
+{
+    rsmi_status_t ret;
 
     ret = rsmi_init(0);
     if (ret != RSMI_STATUS_SUCCESS)
@@ -36,19 +215,128 @@ void get_power_data(int chipid, int total_sockets, int verbose, FILE *output)
                                VARIORUM_ERROR_PLATFORM_ENV,
                                getenv("HOSTNAME"), __FILE__, __FUNCTION__,
                                __LINE__);
-        exit(-1);
+        rsmi.state = -1;
+        return;
     }
+    atexit(rsmi_session_exit);
 
-    ret = rsmi_num_monitor_devices(&num_devices);
+    ret = rsmi_num_monitor_devices(&rsmi.num_devices);
     if (ret != RSMI_STATUS_SUCCESS)
     {
         variorum_error_handler("Could not get number of GPU devices",
                                VARIORUM_ERROR_PLATFORM_ENV,
                                getenv("HOSTNAME"), __FILE__, __FUNCTION__,
                                __LINE__);
+        rsmi.num_devices = 0;
     }
+    start_device_readers();
+    rsmi.state = 1;
+}
 
-    gpus_per_socket = num_devices / total_sockets;
+/* RSMI is initialized on first use and shut down when the process exits,
+ * since rsmi_init() enumerates every device through sysfs. */
+static int rsmi_session(uint32_t *num_devices)
+{
+    pthread_once(&rsmi.once, rsmi_session_init);
+    if (rsmi.state < 0)
+    {
+        return -1;
+    }
+    *num_devices = rsmi.num_devices;
+    return 0;
+}
+
+/* Devices of a socket: the devices are split evenly across sockets. */
+static int socket_devices(int chipid, int total_sockets, uint32_t *first,
+                          uint32_t *count)
+{
+    uint32_t num_devices;
+
+    if (rsmi_session(&num_devices))
+    {
+        return -1;
+    }
+    *count = num_devices / total_sockets;
+    *first = chipid * *count;
+    return 0;
+}
+
+/* Read the given metrics of count devices starting at first, each device in
+ * one pass and the devices in parallel, since each RSMI query takes up to a
+ * few milliseconds. */
+static void sample_devices(uint32_t first, uint32_t count, unsigned metrics,
+                           uint64_t cap, struct amd_gpu_sample *out)
+{
+    pthread_mutex_lock(&rsmi.lock);
+    rsmi.first = first;
+    rsmi.count = count;
+    rsmi.metrics = metrics;
+    rsmi.cap = cap;
+    rsmi.out = out;
+    if (rsmi.nworkers > 1 && count > 1)
+    {
+        pthread_barrier_wait(&rsmi.start);
+        read_devices(0);
+        pthread_barrier_wait(&rsmi.done);
+    }
+    else
+    {
+        uint32_t i;
+        for (i = 0; i < count; i++)
+        {
+            read_device(first + i, &out[i]);
+        }
+    }
+    pthread_mutex_unlock(&rsmi.lock);
+}
+
+static struct amd_gpu_sample *sample_socket(int chipid, int total_sockets,
+        unsigned metrics, uint64_t cap, uint32_t *first, uint32_t *count)
+{
+    struct amd_gpu_sample *out;
+    uint32_t i;
+
+    if (socket_devices(chipid, total_sockets, first, count))
+    {
+        return NULL;
+    }
+    out = (struct amd_gpu_sample *) calloc(*count + 1, sizeof(*out));
+    if (out == NULL)
+    {
+        return NULL;
+    }
+    sample_devices(*first, *count, metrics, cap, out);
+    for (i = 0; i < *count; i++)
+    {
+        if (out[i].ret != RSMI_STATUS_SUCCESS &&
+                !(metrics & AMD_GPU_SET_POWER_LIMIT))
+        {
+            variorum_error_handler("RSMI API was not successful",
+                                   VARIORUM_ERROR_PLATFORM_ENV,
+                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                                   __LINE__);
+        }
+    }
+    return out;
+}
+
+void get_power_data(int chipid, int total_sockets, int verbose, FILE *output)
+{
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
+    char hostname[1024];
+    static int init = 0;
+    static struct timeval start;
+    struct timeval now;
+
+    gethostname(hostname, 1024);
+
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_POWER, 0, &first,
+                            &count);
+    if (samples == NULL)
+    {
+        return;
+    }
 
     if (!init)
     {
@@ -69,46 +357,23 @@ void get_power_data(int chipid, int total_sockets, int verbose, FILE *output)
 
     gettimeofday(&now, NULL);
 
-    for (int i = chipid * gpus_per_socket;
-         i < (chipid + 1) * gpus_per_socket; i++)
+    for (i = 0; i < count; i++)
     {
-        uint64_t pwr_val = 0;
-        double pwr_val_flt = -1.0;
-
-        /* Variorum v0.8 will support the new API from ROCm 6.0.2, which
-         * adds the RSMI_POWER_TYPE enum and the rsmi_dev_power_get() API.
-         * If using an older version of ROCm, please use the code segment
-         * with the rsmi_dev_power_ave_get() API below on line 85 and comment
-         * lines 88 and 89. We're not adding backward compatibility checks
-         * at the moment due to lack of resources and time.
-         *
-         *  ret = rsmi_dev_power_ave_get(i, 0, &pwr_val);
-         */
-
-        RSMI_POWER_TYPE pwr_type = RSMI_AVERAGE_POWER;
-        ret = rsmi_dev_power_get(i, &pwr_val, &pwr_type);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-
-        pwr_val_flt = (double)(pwr_val / (1000 * 1000)); // Convert to Watts.
+        int d = first + i;
+        double pwr_val_flt = (double)(samples[i].power / (1000 * 1000)); // Convert to Watts.
 
         if (verbose == 1)
         {
 #ifdef LIBJUSTIFY_FOUND
             cfprintf(output, "%s: %s, %s: %d, %s: %d, %s: %0.2lf, %s: %lf sec\n",
                      "_AMD_GPU_POWER_USAGE", hostname, "Socket", chipid,
-                     "DeviceID", i, "Power", pwr_val_flt, "Timestamp",
+                     "DeviceID", d, "Power", pwr_val_flt, "Timestamp",
                      (now.tv_usec - start.tv_usec) / 1000000.0);
 #else
             fprintf(output,
                     "_AMD_GPU_POWER_USAGE Host: %s, Socket: %d, DeviceID: %d,"
                     " Power: %0.2lf W, Timestamp: %lf sec\n",
-                    hostname, chipid, i, pwr_val_flt,
+                    hostname, chipid, d, pwr_val_flt,
                     (now.tv_usec - start.tv_usec) / 1000000.0);
 #endif
         }
@@ -116,11 +381,11 @@ void get_power_data(int chipid, int total_sockets, int verbose, FILE *output)
         {
 #ifdef LIBJUSTIFY_FOUND
             cfprintf(output, "_AMD_GPU_POWER_USAGE %s %d %d %0.2lf %lf\n",
-                     hostname, chipid, i, pwr_val_flt,
+                     hostname, chipid, d, pwr_val_flt,
                      (now.tv_usec - start.tv_usec) / 1000000.0);
 #else
             fprintf(output, "_AMD_GPU_POWER_USAGE %s %d %d %0.2lf %lf\n",
-                    hostname, chipid, i, pwr_val_flt,
+                    hostname, chipid, d, pwr_val_flt,
                     (now.tv_usec - start.tv_usec) / 1000000.0);
 #endif
         }
@@ -131,22 +396,14 @@ void get_power_data(int chipid, int total_sockets, int verbose, FILE *output)
     cflush();
 #endif
 
-    ret = rsmi_shut_down();
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
+    free(samples);
 }
 
 void get_power_limit_data(int chipid, int total_sockets, int verbose,
                           FILE *output)
 {
-    rsmi_status_t ret;
-    uint32_t num_devices;
-    int gpus_per_socket;
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
     char hostname[1024];
     static int init = 0;
     static struct timeval start;
@@ -154,27 +411,13 @@ void get_power_limit_data(int chipid, int total_sockets, int verbose,
 
     gethostname(hostname, 1024);
 
-    ret = rsmi_init(0);
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not initialize RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-        exit(-1);
-    }
-
-    ret = rsmi_num_monitor_devices(&num_devices);
-    if (ret != RSMI_STATUS_SUCCESS)
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_POWER_LIMIT, 0,
+                            &first, &count);
+    if (samples == NULL)
     {
-        variorum_error_handler("Could not get number of GPU devices",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
+        return;
     }
 
-    gpus_per_socket = num_devices / total_sockets;
-
     if (!init)
     {
         init = 1;
@@ -196,33 +439,12 @@ void get_power_limit_data(int chipid, int total_sockets, int verbose,
 
     gettimeofday(&now, NULL);
 
-    for (int i = chipid * gpus_per_socket;
-         i < (chipid + 1) * gpus_per_socket; i++)
+    for (i = 0; i < count; i++)
     {
-        uint64_t pwr_val = 0, pwr_min = 0, pwr_max = 0;
-        double pwr_val_flt = 0.0;
-
-        ret = rsmi_dev_power_cap_get(i, 0, &pwr_val);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-
-        ret = rsmi_dev_power_cap_range_get(i, 0, &pwr_max, &pwr_min);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-
-        pwr_val_flt = (double)(pwr_val / (1000 * 1000)); // Convert to Watts.
-        pwr_max = (pwr_max / (1000 * 1000)); // Convert to Watts.
-        pwr_min = (pwr_min / (1000 * 1000)); // Convert to Watts.
+        int d = first + i;
+        double pwr_val_flt = (double)(samples[i].cap / (1000 * 1000)); // Convert to Watts.
+        uint64_t pwr_max = (samples[i].cap_max / (1000 * 1000)); // Convert to Watts.
+        uint64_t pwr_min = (samples[i].cap_min / (1000 * 1000)); // Convert to Watts.
 
         if (verbose == 1)
         {
@@ -231,7 +453,7 @@ void get_power_limit_data(int chipid, int total_sockets, int verbose,
                      "%s: %s, %s: %d, %s: %d, %s: %0.2lf, %s: %ld, %s: %ld, %s: %lf sec\n",
                      "_AMD_GPU_POWER_CAP", hostname,
                      "Socket", chipid,
-                     "DeviceID", i,
+                     "DeviceID", d,
                      "PowerCap_Current", pwr_val_flt,
                      "PowerCap_Min", pwr_min,
                      "PowerCap_Max", pwr_max,
@@ -241,7 +463,7 @@ void get_power_limit_data(int chipid, int total_sockets, int verbose,
                     "_AMD_GPU_POWER_CAP Host: %s, Socket: %d, DeviceID: %d,"
                     " PowerCap_Current: %0.2lf W, PowerCap_Min: %ld W, PowerCap_Max: %ld W,"
                     "Timestamp: %lf sec\n",
-                    hostname, chipid, i, pwr_val_flt, pwr_min, pwr_max,
+                    hostname, chipid, d, pwr_val_flt, pwr_min, pwr_max,
                     (now.tv_usec - start.tv_usec) / 1000000.0);
 #endif
         }
@@ -249,12 +471,12 @@ void get_power_limit_data(int chipid, int total_sockets, int verbose,
         {
 #ifdef LIBJUSTIFY_FOUND
             cfprintf(output, "%s %s %d %d %0.2lf %ld %ld %lf\n",
-                     "_AMD_GPU_POWER_CAP", hostname, chipid, i, pwr_val_flt,
+                     "_AMD_GPU_POWER_CAP", hostname, chipid, d, pwr_val_flt,
                      pwr_min, pwr_max,
                      (now.tv_usec - start.tv_usec) / 1000000.0);
 #else
             fprintf(output, "_AMD_GPU_POWER_CAP %s %d %d %0.2lf %ld %ld %lf\n",
-                    hostname, chipid, i, pwr_val_flt, pwr_min, pwr_max,
+                    hostname, chipid, d, pwr_val_flt, pwr_min, pwr_max,
                     (now.tv_usec - start.tv_usec) / 1000000.0);
 #endif
         }
@@ -265,50 +487,27 @@ void get_power_limit_data(int chipid, int total_sockets, int verbose,
     cflush();
 #endif
 
-    ret = rsmi_shut_down();
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
+    free(samples);
 }
 
 void get_thermals_data(int chipid, int total_sockets, int verbose, FILE *output)
 {
-    rsmi_status_t ret;
-    uint32_t num_devices;
-    int gpus_per_socket;
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
     char hostname[1024];
     static int init = 0;
     static struct timeval start;
     struct timeval now;
-    int i;
 
     gethostname(hostname, 1024);
 
-    ret = rsmi_init(0);
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not initialize RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-        exit(-1);
-    }
-
-    ret = rsmi_num_monitor_devices(&num_devices);
-    if (ret != RSMI_STATUS_SUCCESS)
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_THERMALS, 0, &first,
+                            &count);
+    if (samples == NULL)
     {
-        variorum_error_handler("Could not get number of GPU devices",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
+        return;
     }
 
-    gpus_per_socket = num_devices / total_sockets;
-
     if (!init)
     {
         init = 1;
@@ -328,22 +527,10 @@ void get_thermals_data(int chipid, int total_sockets, int verbose, FILE *output)
 
     gettimeofday(&now, NULL);
 
-    for (i = chipid * gpus_per_socket; i < (chipid + 1) * gpus_per_socket; i++)
+    for (i = 0; i < count; i++)
     {
-        int64_t temp_val = -1;
-        double temp_val_flt = -1.0;
-
-        ret = rsmi_dev_temp_metric_get(i, RSMI_TEMP_TYPE_EDGE, RSMI_TEMP_CURRENT,
-                                       &temp_val);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-
-        temp_val_flt = (double)(temp_val / (1000)); // Convert to Celcius.
+        int d = first + i;
+        double temp_val_flt = (double)(samples[i].temp / (1000)); // Convert to Celcius.
 
         if (verbose == 1)
         {
@@ -352,14 +539,14 @@ void get_thermals_data(int chipid, int total_sockets, int verbose, FILE *output)
                      "%s: %s, %s: %d, %s: %d, %s: %0.2lf, %s: %lf sec\n",
                      "_AMD_GPU_TEMPERATURE Host", hostname,
                      "Socket", chipid,
-                     "DeviceID", i,
+                     "DeviceID", d,
                      "Temperature", temp_val_flt,
                      "Timestamp", (now.tv_usec - start.tv_usec) / 1000000.0);
 #else
             fprintf(output,
                     "_AMD_GPU_TEMPERATURE Host: %s, Socket: %d, DeviceID: %d,"
                     " Temperature: %0.2lf C, Timestamp: %lf sec\n",
-                    hostname, chipid, i, temp_val_flt,
+                    hostname, chipid, d, temp_val_flt,
                     (now.tv_usec - start.tv_usec) / 1000000.0);
 #endif
         }
@@ -367,11 +554,11 @@ void get_thermals_data(int chipid, int total_sockets, int verbose, FILE *output)
         {
 #ifdef LIBJUSTIFY_FOUND
             cfprintf(output, "%s %s %d %d %0.2lf %lf\n",
-                     "_AMD_GPU_TEMPERATURE", hostname, chipid, i, temp_val_flt,
+                     "_AMD_GPU_TEMPERATURE", hostname, chipid, d, temp_val_flt,
                      (now.tv_usec - start.tv_usec) / 1000000.0);
 #else
             fprintf(output, "_AMD_GPU_TEMPERATURE %s %d %d %0.2lf %lf\n",
-                    hostname, chipid, i, temp_val_flt,
+                    hostname, chipid, d, temp_val_flt,
                     (now.tv_usec - start.tv_usec) / 1000000.0);
 #endif
         }
@@ -380,46 +567,21 @@ void get_thermals_data(int chipid, int total_sockets, int verbose, FILE *output)
 #ifdef LIBJUSTIFY_FOUND
     cflush();
 #endif
-    ret = rsmi_shut_down();
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
+    free(samples);
 }
 
 void get_thermals_json(int chipid, int total_sockets, json_t *output)
 {
-    rsmi_status_t ret;
-    uint32_t num_devices;
-    int gpus_per_socket;
-    char hostname[1024];
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
 
-    gethostname(hostname, 1024);
-
-    ret = rsmi_init(0);
-    if (ret != RSMI_STATUS_SUCCESS)
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_THERMALS, 0, &first,
+                            &count);
+    if (samples == NULL)
     {
-        variorum_error_handler("Could not initialize RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-        exit(-1);
-    }
-
-    ret = rsmi_num_monitor_devices(&num_devices);
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not get number of GPU devices",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
+        return;
     }
 
-    gpus_per_socket = num_devices / total_sockets;
-
     char socketid[12];
     snprintf(socketid, 12, "socket_%d", chipid);
 
@@ -435,46 +597,23 @@ void get_thermals_json(int chipid, int total_sockets, json_t *output)
     json_t *gpu_obj = json_object();
     json_object_set_new(socket_obj, "GPU", gpu_obj);
 
-    int i;
-    for (i = chipid * gpus_per_socket; i < (chipid + 1) * gpus_per_socket; i++)
+    for (i = 0; i < count; i++)
     {
-        int64_t temp_val = -1;
-        double temp_val_flt = -1.0;
-
-        ret = rsmi_dev_temp_metric_get(i, RSMI_TEMP_TYPE_EDGE, RSMI_TEMP_CURRENT,
-                                       &temp_val);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-
-        temp_val_flt = (double)(temp_val / (1000)); // Convert to Celcius.
+        double temp_val_flt = (double)(samples[i].temp / (1000)); // Convert to Celcius.
 
         // gpu entry
         char gpuid[32];
-        snprintf(gpuid, 32, "temp_celsius_gpu_%d", i);
+        snprintf(gpuid, 32, "temp_celsius_gpu_%d", first + i);
         json_object_set_new(gpu_obj, gpuid, json_real(temp_val_flt));
     }
 
-    ret = rsmi_shut_down();
-
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
+    free(samples);
 }
 
 void get_clocks_data(int chipid, int total_sockets, int verbose, FILE *output)
 {
-    rsmi_status_t ret;
-    uint32_t num_devices;
-    int gpus_per_socket;
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
     char hostname[1024];
     static int init = 0;
     static struct timeval start;
@@ -482,27 +621,13 @@ void get_clocks_data(int chipid, int total_sockets, int verbose, FILE *output)
 
     gethostname(hostname, 1024);
 
-    ret = rsmi_init(0);
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not initialize RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-        exit(-1);
-    }
-
-    ret = rsmi_num_monitor_devices(&num_devices);
-    if (ret != RSMI_STATUS_SUCCESS)
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_CLOCKS, 0, &first,
+                            &count);
+    if (samples == NULL)
     {
-        variorum_error_handler("Could not get number of GPU devices",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
+        return;
     }
 
-    gpus_per_socket = num_devices / total_sockets;
-
     if (!init)
     {
         init = 1;
@@ -523,32 +648,11 @@ void get_clocks_data(int chipid, int total_sockets, int verbose, FILE *output)
 
     gettimeofday(&now, NULL);
 
-    for (int i = chipid * gpus_per_socket;
-         i < (chipid + 1) * gpus_per_socket; i++)
+    for (i = 0; i < count; i++)
     {
-        rsmi_frequencies_t f_sys, f_mem;
-        uint32_t f_sys_val, f_mem_val;
-
-        ret = rsmi_dev_gpu_clk_freq_get(i, RSMI_CLK_TYPE_SYS, &f_sys);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-
-        ret = rsmi_dev_gpu_clk_freq_get(i, RSMI_CLK_TYPE_MEM, &f_mem);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-
-        f_sys_val = f_sys.frequency[f_sys.current] / (1000 * 1000); // Convert to MHz
-        f_mem_val = f_mem.frequency[f_mem.current] / (1000 * 1000); // Convert to MHz
+        int d = first + i;
+        uint32_t f_sys_val = samples[i].sys_clk / (1000 * 1000); // Convert to MHz
+        uint32_t f_mem_val = samples[i].mem_clk / (1000 * 1000); // Convert to MHz
 
         if (verbose == 1)
         {
@@ -557,7 +661,7 @@ void get_clocks_data(int chipid, int total_sockets, int verbose, FILE *output)
                      "%s: %s, %s: %d, %s: %d, %s: %d MHz, %s: %d MHz, %s: %lf sec\n",
                      "_AMD_GPU_CLOCKS", hostname,
                      "Socket", chipid,
-                     "DeviceID", i,
+                     "DeviceID", d,
                      "SystemClock", f_sys_val,
                      "MemoryClock", f_mem_val,
                      "Timestamp", (now.tv_usec - start.tv_usec) / 1000000.0);
@@ -565,14 +669,14 @@ void get_clocks_data(int chipid, int total_sockets, int verbose, FILE *output)
             fprintf(output,
                     "_AMD_GPU_CLOCKS Host: %s, Socket: %d, DeviceID: %d,"
                     " SystemClock: %d MHz, MemoryClock: %d MHz, Timestamp: %lf sec\n",
-                    hostname, chipid, i, f_sys_val, f_mem_val,
+                    hostname, chipid, d, f_sys_val, f_mem_val,
                     (now.tv_usec - start.tv_usec) / 1000000.0);
 #endif
         }
         else
         {
             fprintf(output, "_AMD_GPU_CLOCKS %s %d %d %d %d %lf\n",
-                    hostname, chipid, i, f_sys_val, f_mem_val,
+                    hostname, chipid, d, f_sys_val, f_mem_val,
                     (now.tv_usec - start.tv_usec) / 1000000.0);
         }
 
@@ -580,45 +684,24 @@ void get_clocks_data(int chipid, int total_sockets, int verbose, FILE *output)
 #ifdef LIBJUSTIFY_FOUND
     cflush();
 #endif
-    ret = rsmi_shut_down();
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
+    free(samples);
 }
 
 void get_clocks_json(int chipid, int total_sockets, json_t *output)
 {
-    rsmi_status_t ret;
-    uint32_t num_devices;
-    int gpus_per_socket;
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
     char socketID[16];
 
     snprintf(socketID, 16, "socket_%d", chipid);
 
-    ret = rsmi_init(0);
-    if (ret != RSMI_STATUS_SUCCESS)
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_CLOCKS, 0, &first,
+                            &count);
+    if (samples == NULL)
     {
-        variorum_error_handler("Could not initialize RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
+        return;
     }
 
-    ret = rsmi_num_monitor_devices(&num_devices);
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not get number of GPU devices",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
-
-    gpus_per_socket = num_devices / total_sockets;
-
     json_t *socket_obj = json_object_get(output, socketID);
     if (socket_obj == NULL)
     {
@@ -629,59 +712,29 @@ void get_clocks_json(int chipid, int total_sockets, json_t *output)
     json_t *gpu_obj = json_object();
     json_object_set_new(socket_obj, "GPU", gpu_obj);
 
-    for (int i = chipid * gpus_per_socket;
-         i < (chipid + 1) * gpus_per_socket; i++)
+    for (i = 0; i < count; i++)
     {
-        rsmi_frequencies_t f_sys, f_mem;
-        uint32_t f_sys_val, f_mem_val;
-
-        ret = rsmi_dev_gpu_clk_freq_get(i, RSMI_CLK_TYPE_SYS, &f_sys);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-
-        ret = rsmi_dev_gpu_clk_freq_get(i, RSMI_CLK_TYPE_MEM, &f_mem);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-
-        f_sys_val = f_sys.frequency[f_sys.current] / (1000 * 1000); // Convert to MHz
-        f_mem_val = f_mem.frequency[f_mem.current] / (1000 * 1000); // Convert to MHz
+        uint32_t f_sys_val = samples[i].sys_clk / (1000 * 1000); // Convert to MHz
+        uint32_t f_mem_val = samples[i].mem_clk / (1000 * 1000); // Convert to MHz
 
         char gpu_clock_string[32];
-        snprintf(gpu_clock_string, 32, "gpu_%d_freq_mhz", i);
+        snprintf(gpu_clock_string, 32, "gpu_%d_freq_mhz", first + i);
 
         char gpu_mem_clock_string[32];
-        snprintf(gpu_mem_clock_string, 32, "gpu_%d_mem_freq_mhz", i);
+        snprintf(gpu_mem_clock_string, 32, "gpu_%d_mem_freq_mhz", first + i);
 
         json_object_set_new(gpu_obj, gpu_clock_string, json_integer(f_sys_val));
         json_object_set_new(gpu_obj, gpu_mem_clock_string, json_integer(f_mem_val));
     }
 
-    ret = rsmi_shut_down();
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
+    free(samples);
 }
 
 void get_gpu_utilization_data(int chipid, int total_sockets, int verbose,
                               FILE *output)
 {
-    rsmi_status_t ret;
-    uint32_t num_devices;
-    int gpus_per_socket;
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
     char hostname[1024];
     static int init = 0;
     static struct timeval start;
@@ -689,27 +742,13 @@ void get_gpu_utilization_data(int chipid, int total_sockets, int verbose,
 
     gethostname(hostname, 1024);
 
-    ret = rsmi_init(0);
-    if (ret != RSMI_STATUS_SUCCESS)
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_UTILIZATION, 0,
+                            &first, &count);
+    if (samples == NULL)
     {
-        variorum_error_handler("Could not initialize RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-        exit(-1);
+        return;
     }
 
-    ret = rsmi_num_monitor_devices(&num_devices);
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not get number of GPU devices",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
-
-    gpus_per_socket = num_devices / total_sockets;
-
     if (!init)
     {
         init = 1;
@@ -729,19 +768,10 @@ void get_gpu_utilization_data(int chipid, int total_sockets, int verbose,
 
     gettimeofday(&now, NULL);
 
-    for (int i = chipid * gpus_per_socket;
-         i < (chipid + 1) * gpus_per_socket; i++)
+    for (i = 0; i < count; i++)
     {
-        uint32_t utilpercent; // Percentage of time the GPU was busy
-
-        ret = rsmi_dev_busy_percent_get(i, &utilpercent);
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
+        int d = first + i;
+        uint32_t utilpercent = samples[i].busy; // Percentage of time the GPU was busy
 
         if (verbose == 1)
         {
@@ -750,22 +780,22 @@ void get_gpu_utilization_data(int chipid, int total_sockets, int verbose,
                      "%s: %s, %s: %d, %s: %d, %s: %d%%\n", //TODO NOT SURE IF THIS WILL WORK
                      "_AMD_GPU_UTILIZATION Host", hostname,
                      "Socket", chipid,
-                     "DeviceID", i,
+                     "DeviceID", d,
                      "Util", utilpercent);
 #else
             fprintf(output,
                     "_AMD_GPU_UTILIZATION Host: %s, Socket: %d, DeviceID: %d,"
-                    "Util: %d%%\n", hostname, chipid, i, utilpercent);
+                    "Util: %d%%\n", hostname, chipid, d, utilpercent);
 #endif
         }
         else
         {
 #ifdef LIBJUSTIFY_FOUND
             cfprintf(output, "%s %s %d %d %d\n",
-                     "_AMD_GPU_UTILIZATION", hostname, chipid, i, utilpercent);
+                     "_AMD_GPU_UTILIZATION", hostname, chipid, d, utilpercent);
 #else
             fprintf(output, "_AMD_GPU_UTILIZATION %s %d %d %d\n",
-                    hostname, chipid, i, utilpercent);
+                    hostname, chipid, d, utilpercent);
 #endif
         }
 
@@ -773,28 +803,17 @@ void get_gpu_utilization_data(int chipid, int total_sockets, int verbose,
 #ifdef LIBJUSTIFY_FOUND
     cflush();
 #endif
-    ret = rsmi_shut_down();
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
+    free(samples);
 }
 
 void get_gpu_utilization_data_json(int chipid, int total_sockets,
                                    json_t *get_gpu_util_obj)
 {
-    rsmi_status_t ret;
-    uint32_t num_devices;
-    int gpus_per_socket;
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
     char socket_id[12];
     char hostname[1024];
     char device_id[12];
-    static int init = 0;
-    static struct timeval start;
-    struct timeval now;
     struct timeval tv;
     uint64_t ts;
 
@@ -830,170 +849,86 @@ void get_gpu_utilization_data_json(int chipid, int total_sockets,
         json_object_set_new(gpu_obj, socket_id, socket_obj);
     }
 
-    ret = rsmi_init(0);
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not initialize RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
-
-    ret = rsmi_num_monitor_devices(&num_devices);
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not get number of GPU devices",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
-
-    gpus_per_socket = num_devices / total_sockets;
-
-    if (!init)
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_UTILIZATION, 0,
+                            &first, &count);
+    if (samples == NULL)
     {
-        init = 1;
-        gettimeofday(&start, NULL);
+        return;
     }
 
-    gettimeofday(&now, NULL);
-    int i;
-    for (i = chipid * gpus_per_socket; i < (chipid + 1) * gpus_per_socket; i++)
+    for (i = 0; i < count; i++)
     {
-        uint32_t utilpercent = 0; // Percentage of time the GPU was busy
-        if (ret != RSMI_STATUS_SUCCESS)
-        {
-            variorum_error_handler("RSMI API was not successful",
-                                   VARIORUM_ERROR_PLATFORM_ENV,
-                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                                   __LINE__);
-        }
-        snprintf(device_id, 12, "GPU%d_util%%", i);
-        json_object_set_new(socket_obj, device_id, json_integer(utilpercent));
+        snprintf(device_id, 12, "GPU%d_util%%", first + i);
+        json_object_set_new(socket_obj, device_id, json_integer(samples[i].busy));
     }
 
-    ret = rsmi_shut_down();
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
+    free(samples);
 }
 
 void cap_each_gpu_power_limit(int chipid, int total_sockets,
                               unsigned int powerlimit)
 {
-    rsmi_status_t ret;
-    uint32_t num_devices;
-    int gpus_per_socket;
-    char hostname[1024];
-    static int init = 0;
-    static struct timeval start;
-    struct timeval now;
-    unsigned int powerlimit_uwatts = powerlimit * 1000000;
-
-    gethostname(hostname, 1024);
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
+    uint64_t powerlimit_uwatts = (uint64_t)powerlimit * 1000000;
 
-    ret = rsmi_init(0);
-    if (ret != RSMI_STATUS_SUCCESS)
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_SET_POWER_LIMIT,
+                            powerlimit_uwatts, &first, &count);
+    if (samples == NULL)
     {
-        variorum_error_handler("Could not initialize RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-        exit(-1);
+        return;
     }
 
-    ret = rsmi_num_monitor_devices(&num_devices);
-    if (ret != RSMI_STATUS_SUCCESS)
+    for (i = 0; i < count; i++)
     {
-        variorum_error_handler("Could not get number of GPU devices",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
-
-    gpus_per_socket = num_devices / total_sockets;
-
-    if (!init)
-    {
-        init = 1;
-        gettimeofday(&start, NULL);
-    }
-
-    gettimeofday(&now, NULL);
-
-    int i;
-    for (i = chipid * gpus_per_socket; i < (chipid + 1) * gpus_per_socket; i++)
-    {
-        ret = rsmi_dev_power_cap_set(i, 0, powerlimit_uwatts);
-        if (ret != RSMI_STATUS_SUCCESS)
+        if (samples[i].ret == RSMI_STATUS_PERMISSION)
         {
-            if (ret == RSMI_STATUS_PERMISSION)
-            {
-                variorum_error_handler(
-                    "Insufficient permissions to set the GPU power limit",
-                    VARIORUM_ERROR_PLATFORM_ENV, getenv("HOSTNAME"),
-                    __FILE__, __FUNCTION__, __LINE__);
-            }
-            else
-            {
-                variorum_error_handler(
-                    "Could not set the specified GPU power limit",
-                    VARIORUM_ERROR_PLATFORM_ENV, getenv("HOSTNAME"),
-                    __FILE__, __FUNCTION__, __LINE__);
-            }
+            variorum_error_handler(
+                "Insufficient permissions to set the GPU power limit",
+                VARIORUM_ERROR_PLATFORM_ENV, getenv("HOSTNAME"),
+                __FILE__, __FUNCTION__, __LINE__);
+        }
+        else if (samples[i].ret != RSMI_STATUS_SUCCESS)
+        {
+            variorum_error_handler(
+                "Could not set the specified GPU power limit",
+                VARIORUM_ERROR_PLATFORM_ENV, getenv("HOSTNAME"),
+                __FILE__, __FUNCTION__, __LINE__);
         }
     }
-    ret = rsmi_shut_down();
-    if (ret != RSMI_STATUS_SUCCESS)
-    {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-    }
+
+    free(samples);
 }
 
 void get_json_power_data(json_t *get_power_obj, int total_sockets)
 {
-    int chipid;
+    struct amd_gpu_sample *samples;
     uint32_t num_devices;
     int gpus_per_socket;
-    uint64_t pwr_val = 0;
     double pwr_val_flt = 0.0;
     double total_gpu_power = 0.0;
+    int chipid;
     int d;
 
-    rsmi_status_t ret;
-
     static size_t devIDlen = 24; // Long enough to avoid format truncation.
     char devID[devIDlen];
     char socketID[24];
 
-    ret = rsmi_init(0);
-    if (ret != RSMI_STATUS_SUCCESS)
+    if (rsmi_session(&num_devices))
     {
-        variorum_error_handler("Could not initialize RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-        exit(-1);
+        return;
     }
 
-    ret = rsmi_num_monitor_devices(&num_devices);
-    if (ret != RSMI_STATUS_SUCCESS)
+    gpus_per_socket = num_devices / total_sockets;
+
+    /* Read every device of the node at once. */
+    samples = (struct amd_gpu_sample *) calloc(num_devices + 1,
+              sizeof(*samples));
+    if (samples == NULL)
     {
-        variorum_error_handler("Could not get number of GPU devices",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
-        exit(-1);
+        return;
     }
-
-    gpus_per_socket = num_devices / total_sockets;
+    sample_devices(0, gpus_per_socket * total_sockets, AMD_GPU_POWER, 0, samples);
 
     json_object_set_new(get_power_obj, "num_gpus_per_socket",
                         json_integer(gpus_per_socket));
@@ -1016,21 +951,7 @@ void get_json_power_data(json_t *get_power_obj, int total_sockets)
         for (d = chipid * gpus_per_socket;
              d < (chipid + 1) * gpus_per_socket; ++d)
         {
-
-            /* Variorum v0.8 will support the new API from ROCm 6.0.2, which
-             * adds the RSMI_POWER_TYPE enum and the rsmi_dev_power_get() API.
-             * If using an older version of ROCm, please use the code segment
-             * with the rsmi_dev_power_ave_get() API below on line 85 and comment
-             * lines 88 and 89. We're not adding backward compatibility checks
-             * at the moment due to lack of resources and time.
-             *
-             * ret = rsmi_dev_power_ave_get(d, 0, &pwr_val);
-             *
-             */
-
-            RSMI_POWER_TYPE pwr_type = RSMI_AVERAGE_POWER;
-            ret = rsmi_dev_power_get(d, &pwr_val, &pwr_type);
-            pwr_val_flt = (double)(pwr_val / (1000 * 1000)); // Convert to Watts
+            pwr_val_flt = (double)(samples[d].power / (1000 * 1000)); // Convert to Watts
             snprintf(devID, devIDlen, "GPU_%d", d);
             json_object_set_new(gpu_obj, devID, json_real(pwr_val_flt));
             total_gpu_power += pwr_val_flt;
@@ -1047,14 +968,89 @@ void get_json_power_data(json_t *get_power_obj, int total_sockets)
                         json_real(power_node + total_gpu_power));
     }
 
+    free(samples);
+}
 
-    ret = rsmi_shut_down();
-    if (ret != RSMI_STATUS_SUCCESS)
+/* The energy accumulator of each device counts in the SMU firmware, so the
+ * difference of two reads is exact regardless of how the power changed in
+ * between, unlike integrating the average power. */
+int get_gpu_energy_counters(struct variorum_energy_counters *counters)
+{
+    struct amd_gpu_sample *samples;
+    uint32_t num_devices, d;
+
+    if (rsmi_session(&num_devices))
     {
-        variorum_error_handler("Could not shutdown RSMI",
-                               VARIORUM_ERROR_PLATFORM_ENV,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
-                               __LINE__);
+        return -1;
+    }
+    samples = (struct amd_gpu_sample *) calloc(num_devices + 1,
+              sizeof(*samples));
+    if (samples == NULL)
+    {
+        return -1;
+    }
+    sample_devices(0, num_devices, AMD_GPU_ENERGY, 0, samples);
+    for (d = 0; d < num_devices; d++)
+    {
+        if (samples[d].ret != RSMI_STATUS_SUCCESS)
+        {
+            variorum_error_handler("RSMI API was not successful",
+                                   VARIORUM_ERROR_PLATFORM_ENV,
+                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                                   __LINE__);
+            free(samples);
+            return -1;
+        }
+        counters->gpu_joules += samples[d].energy / 1e6;
+    }
+    free(samples);
+    return 0;
+}
+
+void get_gpu_energy_json(int chipid, int total_sockets,
+                         json_t *get_energy_obj)
+{
+    struct amd_gpu_sample *samples;
+    uint32_t first, count, i;
+    double total_gpu_energy = 0.0;
+    char devID[24];
+    char socketID[24];
+
+    samples = sample_socket(chipid, total_sockets, AMD_GPU_ENERGY, 0, &first,
+                            &count);
+    if (samples == NULL)
+    {
+        return;
+    }
+
+    snprintf(socketID, sizeof(socketID), "socket_%d", chipid);
+    json_t *socket_obj = json_object_get(get_energy_obj, socketID);
+    if (socket_obj == NULL)
+    {
+        socket_obj = json_object();
+        json_object_set_new(get_energy_obj, socketID, socket_obj);
+    }
+
+    json_t *gpu_obj = json_object();
+    json_object_set_new(socket_obj, "energy_gpu_joules", gpu_obj);
+
+    for (i = 0; i < count; i++)
+    {
+        double joules = samples[i].energy / 1e6;
+        snprintf(devID, sizeof(devID), "GPU_%d", first + i);
+        json_object_set_new(gpu_obj, devID, json_real(joules));
+        total_gpu_energy += joules;
+    }
+
+    // If we have an existing CPU object with energy_node_joules, update its value.
+    if (json_object_get(get_energy_obj, "energy_node_joules") != NULL)
+    {
+        double energy_node;
+        energy_node = json_real_value(json_object_get(get_energy_obj,
+                                      "energy_node_joules"));
+        json_object_set_new(get_energy_obj, "energy_node_joules",
+                            json_real(energy_node + total_gpu_energy));
     }
 
+    free(samples);
 }
@@ -12,6 +12,8 @@
 
 #include <rocm_smi/rocm_smi.h>
 
+#include <variorum_region.h>
+
 void get_power_data(
     int chipid,
     int total_sockets,
@@ -76,4 +78,14 @@ void get_gpu_utilization_data_json(
     json_t *get_gpu_util_obj
 );
 
+int get_gpu_energy_counters(
+    struct variorum_energy_counters *counters
+);
+
+void get_gpu_energy_json(
+    int chipid,
+    int total_sockets,
+    json_t *get_energy_obj
+);
+
 #endif
@@ -42,6 +42,10 @@ int set_amd_gpu_func_ptrs(int idx)
             amd_gpu_instinct_cap_each_gpu_power_limit;
         /* Initialize JSON interfaces */
         g_platform[idx].variorum_get_power_json = amd_gpu_instinct_get_power_json;
+        g_platform[idx].variorum_get_energy_json = amd_gpu_instinct_get_energy_json;
+        /* Initialize energy counters used by regions and the sampler */
+        g_platform[idx].variorum_get_energy_counters =
+            amd_gpu_instinct_get_energy_counters;
     }
     else
     {
@@ -228,3 +228,30 @@ int amd_gpu_instinct_get_power_json(json_t *get_power_obj)
 
     return 0;
 }
+
+int amd_gpu_instinct_get_energy_counters(struct variorum_energy_counters
+        *counters)
+{
+    return get_gpu_energy_counters(counters);
+}
+
+int amd_gpu_instinct_get_energy_json(json_t *get_energy_obj)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    unsigned iter = 0;
+    unsigned nsockets;
+
+    variorum_get_topology(&nsockets, NULL, NULL, P_AMD_GPU_IDX);
+
+    for (iter = 0; iter < nsockets; iter++)
+    {
+        get_gpu_energy_json(iter, nsockets, get_energy_obj);
+    }
+
+    return 0;
+}
@@ -9,6 +9,8 @@
 #include <jansson.h>
 #include <sys/time.h>
 
+#include <variorum_region.h>
+
 int amd_gpu_instinct_get_power(
     int verbose
 );
@@ -49,4 +51,12 @@ int amd_gpu_instinct_get_gpu_utilization_json(
     char **get_gpu_util_obj_str
 );
 
+int amd_gpu_instinct_get_energy_counters(
+    struct variorum_energy_counters *counters
+);
+
+int amd_gpu_instinct_get_energy_json(
+    json_t *get_energy_obj
+);
+
 #endif
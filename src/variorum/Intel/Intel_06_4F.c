@@ -333,6 +333,80 @@ int intel_cpu_fm_06_4f_get_counters(int long_ver)
     return 0;
 }
 
+int intel_cpu_fm_06_4f_start_counter_sampling(const char *events)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    return counter_sampling_start(events, PMC_LOAD_MISS_HSW,
+                                  msrs.ia32_fixed_counters, msrs.ia32_perf_global_ctrl,
+                                  msrs.ia32_fixed_ctr_ctrl, msrs.ia32_perfevtsel_counters,
+                                  msrs.ia32_perfmon_counters);
+}
+
+int intel_cpu_fm_06_4f_sample_counters(struct variorum_counter_sample *sample)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    return counter_sampling_read(sample);
+}
+
+int intel_cpu_fm_06_4f_stop_counter_sampling(void)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    return counter_sampling_stop();
+}
+
+int intel_cpu_fm_06_4f_start_energy_window(void)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    return energy_window_start(msrs.msr_rapl_power_unit,
+                               msrs.msr_pkg_energy_status);
+}
+
+int intel_cpu_fm_06_4f_stop_energy_window(struct variorum_energy_window
+        *window)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    return energy_window_stop(msrs.msr_pkg_energy_status, window);
+}
+
+int intel_cpu_fm_06_4f_get_energy_counters(struct variorum_energy_counters
+        *counters)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    return get_energy_counters(msrs.msr_rapl_power_unit,
+                               msrs.msr_pkg_energy_status,
+                               msrs.msr_dram_energy_status, counters);
+}
+
 int intel_cpu_fm_06_4f_get_clocks(int long_ver)
 {
     char *val = getenv("VARIORUM_LOG");
@@ -370,6 +444,20 @@ int intel_cpu_fm_06_4f_get_clocks_json(json_t *get_clock_obj_json)
     return 0;
 }
 
+int intel_cpu_fm_06_4f_write_clocks_json(struct variorum_json_writer *jw)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    write_clocks_data_json(jw, msrs.ia32_aperf, msrs.ia32_mperf,
+                           msrs.ia32_time_stamp_counter, msrs.ia32_perf_status, msrs.msr_platform_info,
+                           CORE);
+    return 0;
+}
+
 int intel_cpu_fm_06_4f_get_power(int long_ver)
 {
     char *val = getenv("VARIORUM_LOG");
@@ -485,6 +573,21 @@ int intel_cpu_fm_06_4f_get_power_json(json_t *get_power_obj)
     return 0;
 }
 
+int intel_cpu_fm_06_4f_write_power_json(struct variorum_json_writer *jw)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    write_power_data_json(jw, msrs.msr_pkg_power_limit,
+                          msrs.msr_rapl_power_unit, msrs.msr_pkg_energy_status,
+                          msrs.msr_dram_energy_status);
+
+    return 0;
+}
+
 int intel_cpu_fm_06_4f_get_node_power_domain_info_json(char
         **get_domain_obj_str)
 {
@@ -9,6 +9,12 @@
 #include <jansson.h>
 #include <sys/types.h>
 
+#include <variorum_json_writer.h>
+
+struct variorum_counter_sample;
+struct variorum_energy_window;
+struct variorum_energy_counters;
+
 /// @brief List of unique addresses for Broadwell Family/Model 4FH.
 struct broadwell_4f_offsets
 {
@@ -103,6 +109,30 @@ int intel_cpu_fm_06_4f_get_counters(
     int long_ver
 );
 
+int intel_cpu_fm_06_4f_start_counter_sampling(
+    const char *events
+);
+
+int intel_cpu_fm_06_4f_sample_counters(
+    struct variorum_counter_sample *sample
+);
+
+int intel_cpu_fm_06_4f_stop_counter_sampling(
+    void
+);
+
+int intel_cpu_fm_06_4f_start_energy_window(
+    void
+);
+
+int intel_cpu_fm_06_4f_stop_energy_window(
+    struct variorum_energy_window *window
+);
+
+int intel_cpu_fm_06_4f_get_energy_counters(
+    struct variorum_energy_counters *counters
+);
+
 int intel_cpu_fm_06_4f_get_clocks(
     int long_ver
 );
@@ -139,6 +169,10 @@ int intel_cpu_fm_06_4f_get_power_json(
     json_t *get_power_obj
 );
 
+int intel_cpu_fm_06_4f_write_power_json(
+    struct variorum_json_writer *jw
+);
+
 int intel_cpu_fm_06_4f_get_node_power_domain_info_json(
     char **get_domain_obj_str
 );
@@ -159,6 +193,10 @@ int intel_cpu_fm_06_4f_get_clocks_json(
     json_t *get_clock_obj_json
 );
 
+int intel_cpu_fm_06_4f_write_clocks_json(
+    struct variorum_json_writer *jw
+);
+
 int intel_cpu_fm_06_4f_get_energy_json(
     json_t *get_energy_obj
 );
@@ -9,6 +9,12 @@
 #include <jansson.h>
 #include <sys/types.h>
 
+#include <variorum_json_writer.h>
+
+struct variorum_counter_sample;
+struct variorum_energy_window;
+struct variorum_energy_counters;
+
 /// @brief List of unique addresses for Skylake Family/Model 55H.
 struct skylake_55_offsets
 {
@@ -103,6 +109,30 @@ int intel_cpu_fm_06_55_get_counters(
     int long_ver
 );
 
+int intel_cpu_fm_06_55_start_counter_sampling(
+    const char *events
+);
+
+int intel_cpu_fm_06_55_sample_counters(
+    struct variorum_counter_sample *sample
+);
+
+int intel_cpu_fm_06_55_stop_counter_sampling(
+    void
+);
+
+int intel_cpu_fm_06_55_start_energy_window(
+    void
+);
+
+int intel_cpu_fm_06_55_stop_energy_window(
+    struct variorum_energy_window *window
+);
+
+int intel_cpu_fm_06_55_get_energy_counters(
+    struct variorum_energy_counters *counters
+);
+
 int intel_cpu_fm_06_55_get_clocks(
     int long_ver
 );
@@ -126,6 +156,10 @@ int intel_cpu_fm_06_55_get_power_json(
     json_t *get_power_obj
 );
 
+int intel_cpu_fm_06_55_write_power_json(
+    struct variorum_json_writer *jw
+);
+
 int intel_cpu_fm_06_55_cap_best_effort_node_power_limit(
     int node_power_limit
 );
@@ -138,6 +172,12 @@ int intel_cpu_fm_06_55_cap_frequency(
     int core_freq_mhz
 );
 
+int intel_cpu_fm_06_55_cap_cpu_frequency_targets(
+    int ncpus,
+    const int *cpus,
+    const int *cpu_freq_mhz
+);
+
 int intel_cpu_fm_06_55_get_frequencies(
     void
 );
@@ -150,6 +190,10 @@ int intel_cpu_fm_06_55_get_clocks_json(
     json_t *get_clock_obj_json
 );
 
+int intel_cpu_fm_06_55_write_clocks_json(
+    struct variorum_json_writer *jw
+);
+
 int intel_cpu_fm_06_55_get_energy_json(
     json_t *get_energy_obj
 );
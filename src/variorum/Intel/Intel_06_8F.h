@@ -9,6 +9,8 @@
 #include <jansson.h>
 #include <sys/types.h>
 
+#include <variorum_json_writer.h>
+
 /// @brief List of unique addresses for Sapphire Rapids Family/Model 6AH.
 struct sapphire_rapids_6a_offsets
 {
@@ -65,6 +67,10 @@ int fm_06_8f_get_power_json(
     json_t *get_power_obj
 );
 
+int fm_06_8f_write_power_json(
+    struct variorum_json_writer *jw
+);
+
 int fm_06_8f_get_node_power_domain_info_json(
     char **get_domain_obj_str
 );
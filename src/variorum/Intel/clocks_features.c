@@ -66,7 +66,7 @@ void perf_storage_temp(struct perf_data **pd, off_t msr_perf_ctl,
             case SOCKET:
                 d.perf_ctl = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
                 allocate_batch(PERF_CTRL, 2UL * nsockets);
-                load_socket_batch(msr_perf_ctl, d.perf_ctl, PERF_CTRL);
+                load_socket_core_batch(msr_perf_ctl, d.perf_ctl, PERF_CTRL);
                 break;
             case CORE:
                 d.perf_ctl = (uint64_t **) malloc(nthreads * sizeof(uint64_t *));
@@ -95,7 +95,9 @@ void perf_storage(struct perf_data **pd, off_t msr_perf_status)
 #endif
         d.perf_status = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(PERF_DATA, 2UL * nsockets);
-        load_socket_batch(msr_perf_status, d.perf_status, PERF_DATA);
+        /* IA32_PERF_STATUS is per core, so read the first core of each
+         * socket rather than the socket reader CPU. */
+        load_socket_core_batch(msr_perf_status, d.perf_status, PERF_DATA);
         //d.perf_ctl = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         //allocate_batch(PERF_CTL, 2UL * nsockets());
         //load_socket_batch(IA32_PERF_CTL, d.perf_ctl, PERF_CTL);
@@ -389,6 +391,91 @@ int get_clocks_data_json(json_t *output, off_t msr_aperf, off_t msr_mperf,
     return 0;
 }
 
+int write_clocks_data_json(struct variorum_json_writer *jw, off_t msr_aperf,
+                           off_t msr_mperf, off_t msr_tsc, off_t msr_perf_status,
+                           off_t msr_platform_info, enum ctl_domains_e control_domains)
+{
+    static struct clocks_data *cd;
+    static struct perf_data *pd;
+    static char (*socket_keys)[16] = NULL;
+    static char (*core_keys)[24] = NULL;
+    unsigned i, j, k;
+    int idx;
+    unsigned nsockets, ncores, nthreads;
+    int max_non_turbo_ratio;
+    int err;
+    double core_freq;
+    float socket_average_freq = 0.0;
+
+    err = get_max_non_turbo_ratio(msr_platform_info, &max_non_turbo_ratio);
+    if (err)
+    {
+        variorum_error_handler("Error retrieving max non-turbo ratio",
+                               VARIORUM_ERROR_FUNCTION, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+
+    variorum_get_topology(&nsockets, &ncores, &nthreads, P_INTEL_CPU_IDX);
+
+    /* Keys only depend on the topology, so build them once. */
+    if (socket_keys == NULL)
+    {
+        socket_keys = malloc(nsockets * sizeof(*socket_keys));
+        core_keys = malloc((ncores / nsockets) * sizeof(*core_keys));
+        for (i = 0; i < nsockets; i++)
+        {
+            snprintf(socket_keys[i], 16, "socket_%d", i);
+        }
+        for (j = 0; j < ncores / nsockets; j++)
+        {
+            snprintf(core_keys[j], 24, "core_%d_avg_freq_mhz", j);
+        }
+    }
+
+    clocks_storage(&cd, msr_aperf, msr_mperf, msr_tsc);
+    perf_storage(&pd, msr_perf_status);
+    read_batch(CLOCKS_DATA);
+    read_batch(PERF_DATA);
+
+    switch (control_domains)
+    {
+        case CORE:
+            for (i = 0; i < nsockets; i++)
+            {
+                socket_average_freq = 0.0;
+                variorum_json_writer_begin_object(jw, socket_keys[i]);
+                variorum_json_writer_begin_object(jw, "CPU");
+                variorum_json_writer_begin_object(jw, "core");
+
+                for (j = 0; j < ncores / nsockets; j++)
+                {
+                    core_freq = 0.0;
+                    for (k = 0; k < nthreads / ncores; k++)
+                    {
+                        idx = (k * nsockets * (ncores / nsockets)) + (i * (ncores / nsockets)) + j;
+                        core_freq += (max_non_turbo_ratio * (*cd->aperf[idx] /
+                                                             (double)(*cd->mperf[idx])));
+                    }
+                    core_freq /= 2;
+                    socket_average_freq += core_freq;
+
+                    variorum_json_writer_real(jw, core_keys[j], core_freq);
+                }
+                variorum_json_writer_end_object(jw);
+                socket_average_freq /= (ncores / nsockets);
+                variorum_json_writer_real(jw, "cpu_avg_freq_mhz", socket_average_freq);
+                variorum_json_writer_end_object(jw);
+                variorum_json_writer_end_object(jw);
+            }
+            break;
+        default:
+            fprintf(stderr, "Not a valid control domain.\n");
+            break;
+    }
+    return 0;
+}
+
 //void print_verbose_clocks_data_socket(FILE *writedest, off_t msr_aperf, off_t msr_mperf, off_t msr_tsc, off_t msr_perf_status, off_t msr_platform_info)
 //{
 //    static struct clocks_data *cd;
@@ -499,6 +586,69 @@ void cap_p_state(int cpu_freq_mhz, enum ctl_domains_e domain,
     }
 }
 
+int cap_cpu_p_states(int ncpus, const int *cpus, const int *cpu_freq_mhz,
+                     off_t msr_perf_ctl)
+{
+    static unsigned nthreads = 0;
+    static uint64_t **perf_ctl = NULL;
+    static unsigned char *changed = NULL;
+    int i, nchanged = 0;
+
+    if (perf_ctl == NULL)
+    {
+#ifdef VARIORUM_WITH_INTEL_CPU
+        variorum_get_topology(NULL, NULL, &nthreads, P_INTEL_CPU_IDX);
+#endif
+        perf_ctl = (uint64_t **) malloc(nthreads * sizeof(uint64_t *));
+        changed = (unsigned char *) malloc(nthreads);
+        if (perf_ctl == NULL || changed == NULL)
+        {
+            free(perf_ctl);
+            free(changed);
+            perf_ctl = NULL;
+            changed = NULL;
+            return -1;
+        }
+        allocate_batch(PERF_CTRL_TARGETS, nthreads);
+        load_thread_batch(msr_perf_ctl, perf_ctl, PERF_CTRL_TARGETS);
+    }
+    for (i = 0; i < ncpus; i++)
+    {
+        if (cpus[i] < 0 || (unsigned)cpus[i] >= nthreads || cpu_freq_mhz[i] < 100)
+        {
+            variorum_error_handler("Invalid CPU or frequency",
+                                   VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                                   __FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+    }
+    /* Keep the other fields, e.g., IDA engage, as the hardware has them. */
+    if (read_batch(PERF_CTRL_TARGETS))
+    {
+        return -1;
+    }
+    memset(changed, 0, nthreads);
+    for (i = 0; i < ncpus; i++)
+    {
+        uint64_t ratio = (uint64_t)(cpu_freq_mhz[i] / 100) & 0xFF;
+        uint64_t val = (*perf_ctl[cpus[i]] & ~0xFF00ULL) | (ratio << 8);
+
+        if (val != *perf_ctl[cpus[i]])
+        {
+            *perf_ctl[cpus[i]] = val;
+            changed[cpus[i]] = 1;
+            nchanged++;
+        }
+    }
+    /* The batch has one operation per thread, in CPU order. Only the threads
+     * whose target changed are written. */
+    if (nchanged && write_batch_selected(PERF_CTRL_TARGETS, changed))
+    {
+        return -1;
+    }
+    return 0;
+}
+
 //void set_p_state(unsigned socket, uint64_t pstate)
 //{
 //    static uint64_t procs = 0;
@@ -160,6 +160,16 @@ int get_clocks_data_json(
     enum ctl_domains_e control_domain
 );
 
+int write_clocks_data_json(
+    struct variorum_json_writer *jw,
+    off_t msr_aperf,
+    off_t msr_mperf,
+    off_t msr_tsc,
+    off_t msr_perf_status,
+    off_t msr_platform_info,
+    enum ctl_domains_e control_domains
+);
+
 json_t *make_socket_obj(
     json_t *node_obj,
     int socket_index
@@ -183,6 +193,25 @@ void cap_p_state(
     off_t msr_perf_status
 );
 
+/// @brief Request a frequency for each of a set of logical CPUs.
+///
+/// @note Only the ratio field of IA32_PERF_CTL is replaced. CPUs whose
+/// target is already set are skipped, and the remaining requests are
+/// issued as one batched write.
+///
+/// @param [in] ncpus Number of entries in cpus and cpu_freq_mhz.
+/// @param [in] cpus Logical CPU identifiers.
+/// @param [in] cpu_freq_mhz Desired frequency of each CPU in MHz.
+/// @param [in] msr_perf_ctl Unique MSR address for IA32_PERF_CTL.
+///
+/// @return 0 if successful, otherwise -1
+int cap_cpu_p_states(
+    int ncpus,
+    const int *cpus,
+    const int *cpu_freq_mhz,
+    off_t msr_perf_ctl
+);
+
 ///****************************************/
 ///* Software Controlled Clock Modulation */
 ///****************************************/
@@ -5,6 +5,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <config_intel.h>
 #include <config_architecture.h>
@@ -18,6 +20,8 @@
 #include <Intel_06_55.h>
 #include <Intel_06_6A.h>
 #include <Intel_06_8F.h>
+#include <perf_event_features.h>
+#include <variorum_powercap.h>
 
 uint64_t *detect_intel_arch(void)
 {
@@ -56,6 +60,89 @@ int gpu_power_ratio_unimplemented(int long_ver)
     return 0;
 }
 
+/* Read energy and power limits through the MSRs by default. Without access
+ * to an MSR device (e.g., unprivileged users without msr-safe), fall back to
+ * the powercap class, which also supports power capping, and then to the
+ * perf_event power PMU. VARIORUM_CPU_BACKEND=msr|powercap|perf_event selects
+ * a backend explicitly.
+ */
+int intel_cpu_backend(void)
+{
+    static int backend = -1;
+    char *env;
+
+    if (backend >= 0)
+    {
+        return backend;
+    }
+    env = getenv("VARIORUM_CPU_BACKEND");
+    if (env != NULL && strcmp(env, "msr") == 0)
+    {
+        backend = INTEL_CPU_BACKEND_MSR;
+    }
+    else if (env != NULL && strcmp(env, "powercap") == 0)
+    {
+        backend = INTEL_CPU_BACKEND_POWERCAP;
+    }
+    else if (env != NULL && strcmp(env, "perf_event") == 0)
+    {
+        backend = INTEL_CPU_BACKEND_PERF_EVENT;
+    }
+    else if (access("/dev/cpu/0/msr_safe", R_OK | W_OK) == 0 ||
+             access("/dev/cpu/0/msr", R_OK | W_OK) == 0)
+    {
+        backend = INTEL_CPU_BACKEND_MSR;
+    }
+    else if (powercap_available())
+    {
+        backend = INTEL_CPU_BACKEND_POWERCAP;
+    }
+    else if (perf_event_rapl_available())
+    {
+        backend = INTEL_CPU_BACKEND_PERF_EVENT;
+    }
+    else
+    {
+        backend = INTEL_CPU_BACKEND_MSR;
+    }
+    return backend;
+}
+
+int set_intel_powercap_func_ptrs(int idx)
+{
+    g_platform[idx].variorum_cap_gpu_power_ratio = gpu_power_ratio_unimplemented;
+    g_platform[idx].variorum_print_power = powercap_get_power;
+    g_platform[idx].variorum_print_energy = powercap_get_energy;
+    g_platform[idx].variorum_print_power_limit = powercap_get_power_limits;
+    g_platform[idx].variorum_cap_each_socket_power_limit =
+        powercap_cap_each_socket_power_limit;
+    g_platform[idx].variorum_get_power_json = powercap_get_power_json;
+    g_platform[idx].variorum_write_power_json = powercap_write_power_json;
+    g_platform[idx].variorum_get_energy_json = powercap_get_energy_json;
+    g_platform[idx].variorum_get_energy_counters = powercap_get_energy_counters;
+
+    return 0;
+}
+
+int set_intel_perf_event_func_ptrs(int idx)
+{
+    g_platform[idx].variorum_cap_gpu_power_ratio = gpu_power_ratio_unimplemented;
+    g_platform[idx].variorum_print_power = perf_event_get_power;
+    g_platform[idx].variorum_print_energy = perf_event_get_energy;
+    g_platform[idx].variorum_get_power_json = perf_event_get_power_json;
+    g_platform[idx].variorum_write_power_json = perf_event_write_power_json;
+    g_platform[idx].variorum_get_energy_json = perf_event_get_energy_json;
+    g_platform[idx].variorum_get_energy_counters = perf_event_get_energy_counters;
+    g_platform[idx].variorum_print_counters = perf_event_get_counters;
+    g_platform[idx].variorum_start_counter_sampling =
+        perf_event_start_counter_sampling;
+    g_platform[idx].variorum_sample_counters = perf_event_sample_counters;
+    g_platform[idx].variorum_stop_counter_sampling =
+        perf_event_stop_counter_sampling;
+
+    return 0;
+}
+
 /* 02/25/2019 SB
  *    If implementation is identical, have function pointer use the same function.
  *    If it is different, implement a new function.
@@ -78,6 +165,17 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_print_features = intel_cpu_fm_06_2a_get_features;
         g_platform[idx].variorum_print_thermals = intel_cpu_fm_06_2a_get_thermals;
         g_platform[idx].variorum_print_counters = intel_cpu_fm_06_2a_get_counters;
+        g_platform[idx].variorum_start_counter_sampling =
+            intel_cpu_fm_06_2a_start_counter_sampling;
+        g_platform[idx].variorum_sample_counters = intel_cpu_fm_06_2a_sample_counters;
+        g_platform[idx].variorum_stop_counter_sampling =
+            intel_cpu_fm_06_2a_stop_counter_sampling;
+        g_platform[idx].variorum_start_energy_window =
+            intel_cpu_fm_06_2a_start_energy_window;
+        g_platform[idx].variorum_stop_energy_window =
+            intel_cpu_fm_06_2a_stop_energy_window;
+        g_platform[idx].variorum_get_energy_counters =
+            intel_cpu_fm_06_2a_get_energy_counters;
         g_platform[idx].variorum_print_frequency = intel_cpu_fm_06_2a_get_clocks;
         g_platform[idx].variorum_print_power = intel_cpu_fm_06_2a_get_power;
         g_platform[idx].variorum_print_energy = intel_cpu_fm_06_2a_get_energy;
@@ -90,6 +188,8 @@ int set_intel_func_ptrs(int idx)
         //    intel_cpu_fm_06_2a_cap_frequency;
         g_platform[idx].variorum_get_power_json =
             intel_cpu_fm_06_2a_get_power_json;
+        g_platform[idx].variorum_write_power_json =
+            intel_cpu_fm_06_2a_write_power_json;
         g_platform[idx].variorum_get_node_power_domain_info_json =
             intel_cpu_fm_06_2a_get_node_power_domain_info_json;
         g_platform[idx].variorum_cap_best_effort_node_power_limit =
@@ -100,6 +200,8 @@ int set_intel_func_ptrs(int idx)
             intel_cpu_fm_06_2a_get_thermals_json;
         g_platform[idx].variorum_get_frequency_json =
             intel_cpu_fm_06_2a_get_clocks_json;
+        g_platform[idx].variorum_write_frequency_json =
+            intel_cpu_fm_06_2a_write_clocks_json;
     }
     else if (*g_platform[idx].arch_id == FM_06_2D)
     {
@@ -110,6 +212,17 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_print_features = intel_cpu_fm_06_2d_get_features;
         g_platform[idx].variorum_print_thermals = intel_cpu_fm_06_2d_get_thermals;
         g_platform[idx].variorum_print_counters = intel_cpu_fm_06_2d_get_counters;
+        g_platform[idx].variorum_start_counter_sampling =
+            intel_cpu_fm_06_2d_start_counter_sampling;
+        g_platform[idx].variorum_sample_counters = intel_cpu_fm_06_2d_sample_counters;
+        g_platform[idx].variorum_stop_counter_sampling =
+            intel_cpu_fm_06_2d_stop_counter_sampling;
+        g_platform[idx].variorum_start_energy_window =
+            intel_cpu_fm_06_2d_start_energy_window;
+        g_platform[idx].variorum_stop_energy_window =
+            intel_cpu_fm_06_2d_stop_energy_window;
+        g_platform[idx].variorum_get_energy_counters =
+            intel_cpu_fm_06_2d_get_energy_counters;
         g_platform[idx].variorum_print_frequency = intel_cpu_fm_06_2d_get_clocks;
         g_platform[idx].variorum_print_power = intel_cpu_fm_06_2d_get_power;
         g_platform[idx].variorum_print_energy = intel_cpu_fm_06_2d_get_energy;
@@ -122,6 +235,8 @@ int set_intel_func_ptrs(int idx)
         //    intel_cpu_fm_06_2d_cap_frequency;
         g_platform[idx].variorum_get_power_json =
             intel_cpu_fm_06_2d_get_power_json;
+        g_platform[idx].variorum_write_power_json =
+            intel_cpu_fm_06_2d_write_power_json;
         g_platform[idx].variorum_get_node_power_domain_info_json =
             intel_cpu_fm_06_2d_get_node_power_domain_info_json;
         g_platform[idx].variorum_cap_best_effort_node_power_limit =
@@ -132,6 +247,8 @@ int set_intel_func_ptrs(int idx)
             intel_cpu_fm_06_2d_get_thermals_json;
         g_platform[idx].variorum_get_frequency_json =
             intel_cpu_fm_06_2d_get_clocks_json;
+        g_platform[idx].variorum_write_frequency_json =
+            intel_cpu_fm_06_2d_write_clocks_json;
     }
     // Ivy Bridge 06_3E
     else if (*g_platform[idx].arch_id == FM_06_3E)
@@ -143,6 +260,17 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_print_features = intel_cpu_fm_06_3e_get_features;
         g_platform[idx].variorum_print_thermals = intel_cpu_fm_06_3e_get_thermals;
         g_platform[idx].variorum_print_counters = intel_cpu_fm_06_3e_get_counters;
+        g_platform[idx].variorum_start_counter_sampling =
+            intel_cpu_fm_06_3e_start_counter_sampling;
+        g_platform[idx].variorum_sample_counters = intel_cpu_fm_06_3e_sample_counters;
+        g_platform[idx].variorum_stop_counter_sampling =
+            intel_cpu_fm_06_3e_stop_counter_sampling;
+        g_platform[idx].variorum_start_energy_window =
+            intel_cpu_fm_06_3e_start_energy_window;
+        g_platform[idx].variorum_stop_energy_window =
+            intel_cpu_fm_06_3e_stop_energy_window;
+        g_platform[idx].variorum_get_energy_counters =
+            intel_cpu_fm_06_3e_get_energy_counters;
         g_platform[idx].variorum_print_frequency = intel_cpu_fm_06_3e_get_clocks;
         g_platform[idx].variorum_print_power = intel_cpu_fm_06_3e_get_power;
         g_platform[idx].variorum_print_energy = intel_cpu_fm_06_3e_get_energy;
@@ -155,6 +283,8 @@ int set_intel_func_ptrs(int idx)
         //    intel_cpu_fm_06_3e_cap_frequency;
         g_platform[idx].variorum_get_power_json =
             intel_cpu_fm_06_3e_get_power_json;
+        g_platform[idx].variorum_write_power_json =
+            intel_cpu_fm_06_3e_write_power_json;
         g_platform[idx].variorum_get_node_power_domain_info_json =
             intel_cpu_fm_06_3e_get_node_power_domain_info_json;
         g_platform[idx].variorum_cap_best_effort_node_power_limit =
@@ -165,6 +295,8 @@ int set_intel_func_ptrs(int idx)
             intel_cpu_fm_06_3e_get_thermals_json;
         g_platform[idx].variorum_get_frequency_json =
             intel_cpu_fm_06_3e_get_clocks_json;
+        g_platform[idx].variorum_write_frequency_json =
+            intel_cpu_fm_06_3e_write_clocks_json;
     }
     // Haswell 06_3F
     else if (*g_platform[idx].arch_id == FM_06_3F)
@@ -176,6 +308,17 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_print_features = intel_cpu_fm_06_3f_get_features;
         g_platform[idx].variorum_print_thermals = intel_cpu_fm_06_3f_get_thermals;
         g_platform[idx].variorum_print_counters = intel_cpu_fm_06_3f_get_counters;
+        g_platform[idx].variorum_start_counter_sampling =
+            intel_cpu_fm_06_3f_start_counter_sampling;
+        g_platform[idx].variorum_sample_counters = intel_cpu_fm_06_3f_sample_counters;
+        g_platform[idx].variorum_stop_counter_sampling =
+            intel_cpu_fm_06_3f_stop_counter_sampling;
+        g_platform[idx].variorum_start_energy_window =
+            intel_cpu_fm_06_3f_start_energy_window;
+        g_platform[idx].variorum_stop_energy_window =
+            intel_cpu_fm_06_3f_stop_energy_window;
+        g_platform[idx].variorum_get_energy_counters =
+            intel_cpu_fm_06_3f_get_energy_counters;
         g_platform[idx].variorum_print_frequency = intel_cpu_fm_06_3f_get_clocks;
         g_platform[idx].variorum_print_power = intel_cpu_fm_06_3f_get_power;
         g_platform[idx].variorum_print_energy = intel_cpu_fm_06_3f_get_energy;
@@ -188,6 +331,8 @@ int set_intel_func_ptrs(int idx)
         //    intel_cpu_fm_06_3f_cap_frequency;
         g_platform[idx].variorum_get_power_json =
             intel_cpu_fm_06_3f_get_power_json;
+        g_platform[idx].variorum_write_power_json =
+            intel_cpu_fm_06_3f_write_power_json;
         g_platform[idx].variorum_get_node_power_domain_info_json =
             intel_cpu_fm_06_3f_get_node_power_domain_info_json;
         g_platform[idx].variorum_cap_best_effort_node_power_limit =
@@ -209,6 +354,17 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_print_features = intel_cpu_fm_06_4f_get_features;
         g_platform[idx].variorum_print_thermals = intel_cpu_fm_06_4f_get_thermals;
         g_platform[idx].variorum_print_counters = intel_cpu_fm_06_4f_get_counters;
+        g_platform[idx].variorum_start_counter_sampling =
+            intel_cpu_fm_06_4f_start_counter_sampling;
+        g_platform[idx].variorum_sample_counters = intel_cpu_fm_06_4f_sample_counters;
+        g_platform[idx].variorum_stop_counter_sampling =
+            intel_cpu_fm_06_4f_stop_counter_sampling;
+        g_platform[idx].variorum_start_energy_window =
+            intel_cpu_fm_06_4f_start_energy_window;
+        g_platform[idx].variorum_stop_energy_window =
+            intel_cpu_fm_06_4f_stop_energy_window;
+        g_platform[idx].variorum_get_energy_counters =
+            intel_cpu_fm_06_4f_get_energy_counters;
         g_platform[idx].variorum_print_frequency = intel_cpu_fm_06_4f_get_clocks;
         g_platform[idx].variorum_print_power = intel_cpu_fm_06_4f_get_power;
         g_platform[idx].variorum_print_energy = intel_cpu_fm_06_4f_get_energy;
@@ -221,6 +377,8 @@ int set_intel_func_ptrs(int idx)
         //    intel_cpu_fm_06_4f_cap_frequency;
         g_platform[idx].variorum_get_power_json =
             intel_cpu_fm_06_4f_get_power_json;
+        g_platform[idx].variorum_write_power_json =
+            intel_cpu_fm_06_4f_write_power_json;
         g_platform[idx].variorum_get_node_power_domain_info_json =
             intel_cpu_fm_06_4f_get_node_power_domain_info_json;
         g_platform[idx].variorum_cap_best_effort_node_power_limit =
@@ -231,6 +389,8 @@ int set_intel_func_ptrs(int idx)
             intel_cpu_fm_06_4f_get_thermals_json;
         g_platform[idx].variorum_get_frequency_json =
             intel_cpu_fm_06_4f_get_clocks_json;
+        g_platform[idx].variorum_write_frequency_json =
+            intel_cpu_fm_06_4f_write_clocks_json;
         g_platform[idx].variorum_get_energy_json =
             intel_cpu_fm_06_4f_get_energy_json;
     }
@@ -244,6 +404,17 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_print_features = intel_cpu_fm_06_55_get_features;
         g_platform[idx].variorum_print_thermals = intel_cpu_fm_06_55_get_thermals;
         g_platform[idx].variorum_print_counters = intel_cpu_fm_06_55_get_counters;
+        g_platform[idx].variorum_start_counter_sampling =
+            intel_cpu_fm_06_55_start_counter_sampling;
+        g_platform[idx].variorum_sample_counters = intel_cpu_fm_06_55_sample_counters;
+        g_platform[idx].variorum_stop_counter_sampling =
+            intel_cpu_fm_06_55_stop_counter_sampling;
+        g_platform[idx].variorum_start_energy_window =
+            intel_cpu_fm_06_55_start_energy_window;
+        g_platform[idx].variorum_stop_energy_window =
+            intel_cpu_fm_06_55_stop_energy_window;
+        g_platform[idx].variorum_get_energy_counters =
+            intel_cpu_fm_06_55_get_energy_counters;
         g_platform[idx].variorum_print_frequency = intel_cpu_fm_06_55_get_clocks;
         g_platform[idx].variorum_print_power = intel_cpu_fm_06_55_get_power;
         g_platform[idx].variorum_print_energy = intel_cpu_fm_06_55_get_energy;
@@ -254,18 +425,24 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_monitoring = intel_cpu_fm_06_55_monitoring;
         g_platform[idx].variorum_get_power_json =
             intel_cpu_fm_06_55_get_power_json;
+        g_platform[idx].variorum_write_power_json =
+            intel_cpu_fm_06_55_write_power_json;
         g_platform[idx].variorum_get_node_power_domain_info_json =
             intel_cpu_fm_06_55_get_node_power_domain_info_json;
         g_platform[idx].variorum_cap_best_effort_node_power_limit =
             intel_cpu_fm_06_55_cap_best_effort_node_power_limit;
         g_platform[idx].variorum_cap_each_core_frequency_limit =
             intel_cpu_fm_06_55_cap_frequency;
+        g_platform[idx].variorum_cap_cpu_frequency_targets =
+            intel_cpu_fm_06_55_cap_cpu_frequency_targets;
         g_platform[idx].variorum_print_available_frequencies =
             intel_cpu_fm_06_55_get_frequencies;
         g_platform[idx].variorum_get_thermals_json =
             intel_cpu_fm_06_55_get_thermals_json;
         g_platform[idx].variorum_get_frequency_json =
             intel_cpu_fm_06_55_get_clocks_json;
+        g_platform[idx].variorum_write_frequency_json =
+            intel_cpu_fm_06_55_write_clocks_json;
         g_platform[idx].variorum_get_energy_json =
             intel_cpu_fm_06_55_get_energy_json;
     }
@@ -279,6 +456,17 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_print_features = intel_cpu_fm_06_9e_get_features;
         g_platform[idx].variorum_print_thermals = intel_cpu_fm_06_9e_get_thermals;
         g_platform[idx].variorum_print_counters = intel_cpu_fm_06_9e_get_counters;
+        g_platform[idx].variorum_start_counter_sampling =
+            intel_cpu_fm_06_9e_start_counter_sampling;
+        g_platform[idx].variorum_sample_counters = intel_cpu_fm_06_9e_sample_counters;
+        g_platform[idx].variorum_stop_counter_sampling =
+            intel_cpu_fm_06_9e_stop_counter_sampling;
+        g_platform[idx].variorum_start_energy_window =
+            intel_cpu_fm_06_9e_start_energy_window;
+        g_platform[idx].variorum_stop_energy_window =
+            intel_cpu_fm_06_9e_stop_energy_window;
+        g_platform[idx].variorum_get_energy_counters =
+            intel_cpu_fm_06_9e_get_energy_counters;
         g_platform[idx].variorum_print_frequency = intel_cpu_fm_06_9e_get_clocks;
         g_platform[idx].variorum_print_power = intel_cpu_fm_06_9e_get_power;
         g_platform[idx].variorum_print_energy = intel_cpu_fm_06_9e_get_energy;
@@ -289,6 +477,8 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_monitoring = intel_cpu_fm_06_9e_monitoring;
         g_platform[idx].variorum_get_power_json =
             intel_cpu_fm_06_9e_get_power_json;
+        g_platform[idx].variorum_write_power_json =
+            intel_cpu_fm_06_9e_write_power_json;
         g_platform[idx].variorum_get_node_power_domain_info_json =
             intel_cpu_fm_06_9e_get_node_power_domain_info_json;
         g_platform[idx].variorum_cap_best_effort_node_power_limit =
@@ -299,6 +489,8 @@ int set_intel_func_ptrs(int idx)
             intel_cpu_fm_06_9e_get_thermals_json;
         g_platform[idx].variorum_get_frequency_json =
             intel_cpu_fm_06_9e_get_clocks_json;
+        g_platform[idx].variorum_write_frequency_json =
+            intel_cpu_fm_06_9e_write_clocks_json;
     }
     // Ice Lake 06_6A
     else if (*g_platform[idx].arch_id == FM_06_6A)
@@ -318,6 +510,8 @@ int set_intel_func_ptrs(int idx)
         g_platform[idx].variorum_print_energy = fm_06_8f_get_energy;
         g_platform[idx].variorum_get_power_json =
             fm_06_8f_get_power_json;
+        g_platform[idx].variorum_write_power_json =
+            fm_06_8f_write_power_json;
         g_platform[idx].variorum_get_node_power_domain_info_json =
             fm_06_8f_get_node_power_domain_info_json;
         g_platform[idx].variorum_monitoring = fm_06_8f_monitoring;
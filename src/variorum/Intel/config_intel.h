@@ -16,6 +16,25 @@ int set_intel_func_ptrs(
     int idx
 );
 
+enum intel_cpu_backend
+{
+    INTEL_CPU_BACKEND_MSR,
+    INTEL_CPU_BACKEND_POWERCAP,
+    INTEL_CPU_BACKEND_PERF_EVENT
+};
+
+int intel_cpu_backend(
+    void
+);
+
+int set_intel_powercap_func_ptrs(
+    int idx
+);
+
+int set_intel_perf_event_func_ptrs(
+    int idx
+);
+
 int gpu_power_ratio_unimplemented(
     int long_ver
 );
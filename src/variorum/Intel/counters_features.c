@@ -3,11 +3,14 @@
 //
 // SPDX-License-Identifier: MIT
 
+#include <math.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <clocks_features.h>
@@ -15,9 +18,11 @@
 #include <config_architecture.h>
 #include <msr_core.h>
 #include <intel_power_features.h>
+#include <variorum.h>
 #include <variorum_cpuid.h>
 #include <variorum_error.h>
 #include <variorum_timers.h>
+#include <variorum_trace.h>
 
 #ifdef LIBJUSTIFY_FOUND
 #include <cprintf.h>
@@ -1273,6 +1278,74 @@ void print_verbose_unc_counter_data(FILE *writedest,
     }
 }
 
+/* Floating-point columns of the encoded trace keep the 6 decimal digits of
+ * the %lf text output. */
+#define POWER_TRACE_DECIMALS 6
+#define POWER_TRACE_SCALE 1e6
+
+static struct variorum_trace power_trace;
+
+/* Returns 0 if the trace was started. */
+static int open_power_data_trace(FILE *writedest, unsigned nsockets,
+                                 unsigned nthreads)
+{
+    static const char *pkg_fmt[5] =
+    {
+        "pkg%u_joules", "pkg%u_lim1watts", "pkg%u_lim2watts", "dram%u_joules",
+        "dram%u_limwatts"
+    };
+    static const char *thread_fmt[6] =
+    {
+        "InstRet%u", "UnhaltClkCycles%u", "UnhaltRefCycles%u", "APERF%u",
+        "MPERF%u", "TSC%u"
+    };
+    unsigned ncols = nsockets * 5 + nthreads * 6;
+    char **names = (char **) malloc(sizeof(char *) * ncols);
+    unsigned *decimals = (unsigned *) malloc(sizeof(unsigned) * ncols);
+    unsigned i, j, col = 0;
+    int zstd_level = variorum_trace_format() == VARIORUM_MONITORING_ENCODED_ZSTD ?
+                     3 : 0;
+    int err;
+
+    if (names == NULL || decimals == NULL)
+    {
+        printf("malloc of size %u failed!\n", ncols);
+        exit(1);
+    }
+    for (i = 0; i < nsockets; i++)
+    {
+        for (j = 0; j < 5; j++, col++)
+        {
+            names[col] = (char *) malloc(32);
+            snprintf(names[col], 32, pkg_fmt[j], i);
+            decimals[col] = POWER_TRACE_DECIMALS;
+        }
+    }
+    for (i = 0; i < nthreads; i++)
+    {
+        for (j = 0; j < 6; j++, col++)
+        {
+            names[col] = (char *) malloc(32);
+            snprintf(names[col], 32, thread_fmt[j], i);
+            decimals[col] = 0;
+        }
+    }
+    err = variorum_trace_open(&power_trace, writedest, ncols,
+                              (const char *const *) names, decimals,
+                              VARIORUM_TRACE_BLOCK_ROWS, zstd_level);
+    if (err == 0)
+    {
+        variorum_trace_set_active(&power_trace);
+    }
+    for (i = 0; i < ncols; i++)
+    {
+        free(names[i]);
+    }
+    free(names);
+    free(decimals);
+    return err;
+}
+
 void get_all_power_data_fixed(FILE *writedest, off_t msr_pkg_power_limit,
                               off_t msr_dram_power_limit, off_t msr_rapl_unit,
                               off_t msr_package_energy_status, off_t msr_dram_energy_status,
@@ -1286,7 +1359,11 @@ void get_all_power_data_fixed(FILE *writedest, off_t msr_pkg_power_limit,
     static struct fixed_counter *c0, *c1, *c2;
     static struct clocks_data *cd;
     static int init_get_power_data = 0;
+    static int plan_ready = 0;
     static unsigned nsockets, nthreads;
+    static int64_t *vals;
+    /* Set once the encoded trace has been started. */
+    static int encoded = 0;
     char hostname[1024];
     unsigned i;
     int rlim_idx = 0;
@@ -1296,6 +1373,11 @@ void get_all_power_data_fixed(FILE *writedest, off_t msr_pkg_power_limit,
 #endif
     gethostname(hostname, 1024);
 
+    /* After the first sample created every batch, read them all at once. */
+    if (plan_ready)
+    {
+        sample_plan_begin();
+    }
     get_power(msr_rapl_unit, msr_package_energy_status, msr_dram_energy_status);
 
     if (!init_get_power_data)
@@ -1314,86 +1396,107 @@ void get_all_power_data_fixed(FILE *writedest, off_t msr_pkg_power_limit,
         enable_fixed_counters(msrs_fixed_ctrs, msr_perf_global_ctrl,
                               msr_fixed_counter_ctrl);
         clocks_storage(&cd, msr_aperf, msr_mperf, msr_tsc);
-#ifdef LIBJUSTIFY_FOUND
-        int pkglabels = 5;
-        int threadlabels = 6;
-        int max_str_len = 128;
-        char pkg_strs[nsockets][pkglabels][max_str_len];
-        char thread_strs[nthreads][threadlabels][max_str_len];
-
-        for (i = 0; i < nsockets; i++)
+        if (variorum_trace_format() != VARIORUM_MONITORING_TEXT)
         {
-            snprintf(pkg_strs[i][0], max_str_len, "pkg%d_joules", i);
-            snprintf(pkg_strs[i][1], max_str_len, "pkg%d_limwatts", i);
-            snprintf(pkg_strs[i][2], max_str_len, "pkg%d_lim2watts", i);
-            snprintf(pkg_strs[i][3], max_str_len, "dram%d_joules", i);
-            snprintf(pkg_strs[i][4], max_str_len, "dram%d_limwatts", i);
+            vals = (int64_t *) malloc(sizeof(int64_t) *
+                                      (nsockets * 5 + nthreads * 6));
+            if (vals == NULL)
+            {
+                printf("malloc of size %d failed!\n", nsockets * 5 + nthreads * 6);
+                exit(1);
+            }
+            encoded = open_power_data_trace(writedest, nsockets, nthreads) == 0;
+            if (!encoded)
+            {
+                fprintf(stderr, "Warning: Cannot start the encoded trace. Falling back to text output.\n");
+                free(vals);
+                vals = NULL;
+            }
         }
-        for (i = 0; i < nthreads; i++)
+        if (!encoded)
         {
-            snprintf(thread_strs[i][0], max_str_len, "InstRet%d", i);
-            snprintf(thread_strs[i][1], max_str_len, "UnhaltClkCycles%d", i);
-            snprintf(thread_strs[i][2], max_str_len, "UnhaltRefCycles%d", i);
-            snprintf(thread_strs[i][3], max_str_len, "APERF%d", i);
-            snprintf(thread_strs[i][4], max_str_len, "MPERF%d", i);
-            snprintf(thread_strs[i][4], max_str_len, "TSC%d", i);
-        }
-
-        cfprintf(writedest, "%-s %s ", "_VAR_MONITOR", "time");
+#ifdef LIBJUSTIFY_FOUND
+            int pkglabels = 5;
+            int threadlabels = 6;
+            int max_str_len = 128;
+            char pkg_strs[nsockets][pkglabels][max_str_len];
+            char thread_strs[nthreads][threadlabels][max_str_len];
+
+            for (i = 0; i < nsockets; i++)
+            {
+                snprintf(pkg_strs[i][0], max_str_len, "pkg%d_joules", i);
+                snprintf(pkg_strs[i][1], max_str_len, "pkg%d_limwatts", i);
+                snprintf(pkg_strs[i][2], max_str_len, "pkg%d_lim2watts", i);
+                snprintf(pkg_strs[i][3], max_str_len, "dram%d_joules", i);
+                snprintf(pkg_strs[i][4], max_str_len, "dram%d_limwatts", i);
+            }
+            for (i = 0; i < nthreads; i++)
+            {
+                snprintf(thread_strs[i][0], max_str_len, "InstRet%d", i);
+                snprintf(thread_strs[i][1], max_str_len, "UnhaltClkCycles%d", i);
+                snprintf(thread_strs[i][2], max_str_len, "UnhaltRefCycles%d", i);
+                snprintf(thread_strs[i][3], max_str_len, "APERF%d", i);
+                snprintf(thread_strs[i][4], max_str_len, "MPERF%d", i);
+                snprintf(thread_strs[i][4], max_str_len, "TSC%d", i);
+            }
+
+            cfprintf(writedest, "%-s %s ", "_VAR_MONITOR", "time");
 #else
 
-        fprintf(writedest, "_VAR_MONITOR time");
+            fprintf(writedest, "_VAR_MONITOR time");
 #endif
 
-        for (i = 0; i < nsockets; i++)
-        {
+            for (i = 0; i < nsockets; i++)
+            {
 #ifdef LIBJUSTIFY_FOUND
-            cfprintf(writedest, "%s %s %s %s %s ",
-                     pkg_strs[i][0], pkg_strs[i][1],
-                     pkg_strs[i][2], pkg_strs[i][3],
-                     pkg_strs[i][4]);
+                cfprintf(writedest, "%s %s %s %s %s ",
+                         pkg_strs[i][0], pkg_strs[i][1],
+                         pkg_strs[i][2], pkg_strs[i][3],
+                         pkg_strs[i][4]);
 #else
-            fprintf(writedest,
-                    " pkg%d_joules pkg%d_lim1watts pkg%d_lim2watts dram%d_joules dram%d_limwatts",
-                    i, i, i, i, i);
+                fprintf(writedest,
+                        " pkg%d_joules pkg%d_lim1watts pkg%d_lim2watts dram%d_joules dram%d_limwatts",
+                        i, i, i, i, i);
 #endif
-            get_package_rapl_limit(i, &(rlim[rlim_idx]), &(rlim[rlim_idx + 1]),
-                                   msr_pkg_power_limit, msr_rapl_unit);
-            get_dram_rapl_limit(i, &(rlim[rlim_idx + 2]), msr_dram_power_limit,
-                                msr_rapl_unit);
-            rlim_idx += 3;
-            // rlim[0] = first socket, power limit 1
-            // rlim[1] = first socket, power limit 2
-            // rlim[2] = first socket, dram power limit
-            // rlim[3] = second socket, power limit 1
-            // rlim[4] = second socket, power limit 2
-            // rlim[5] = second socket, dram power limit
-
-            // This code assumed dual socket system.
-            //get_package_rapl_limit(0, &(rlim[0]), &(rlim[1]), msr_pkg_power_limit, msr_rapl_unit);
-            //get_package_rapl_limit(1, &(rlim[2]), &(rlim[3]), msr_pkg_power_limit, msr_rapl_unit);
-            //get_dram_rapl_limit(0, &(rlim[4]), msr_dram_power_limit, msr_rapl_unit);
-            //get_dram_rapl_limit(1, &(rlim[5]), msr_dram_power_limit, msr_rapl_unit);
-        }
-
-        for (i = 0; i < nthreads; i++)
-        {
+                get_package_rapl_limit_batch(i, &(rlim[rlim_idx]),
+                                             &(rlim[rlim_idx + 1]),
+                                             msr_pkg_power_limit, msr_rapl_unit);
+                get_dram_rapl_limit_batch(i, &(rlim[rlim_idx + 2]),
+                                          msr_dram_power_limit, msr_rapl_unit);
+                rlim_idx += 3;
+                // rlim[0] = first socket, power limit 1
+                // rlim[1] = first socket, power limit 2
+                // rlim[2] = first socket, dram power limit
+                // rlim[3] = second socket, power limit 1
+                // rlim[4] = second socket, power limit 2
+                // rlim[5] = second socket, dram power limit
+
+                // This code assumed dual socket system.
+                //get_package_rapl_limit(0, &(rlim[0]), &(rlim[1]), msr_pkg_power_limit, msr_rapl_unit);
+                //get_package_rapl_limit(1, &(rlim[2]), &(rlim[3]), msr_pkg_power_limit, msr_rapl_unit);
+                //get_dram_rapl_limit(0, &(rlim[4]), msr_dram_power_limit, msr_rapl_unit);
+                //get_dram_rapl_limit(1, &(rlim[5]), msr_dram_power_limit, msr_rapl_unit);
+            }
+
+            for (i = 0; i < nthreads; i++)
+            {
 #ifdef LIBJUSTIFY_FOUND
-            cfprintf(writedest, "%s %s %s %s %s ",
-                     thread_strs[i][0], thread_strs[i][1],
-                     thread_strs[i][2], thread_strs[i][3],
-                     thread_strs[i][4], thread_strs[i][5]);
+                cfprintf(writedest, "%s %s %s %s %s ",
+                         thread_strs[i][0], thread_strs[i][1],
+                         thread_strs[i][2], thread_strs[i][3],
+                         thread_strs[i][4], thread_strs[i][5]);
 #else
-            fprintf(writedest,
-                    " InstRet%d UnhaltClkCycles%d UnhaltRefCycles%d APERF%d MPERF%d TSC%d", i, i, i,
-                    i, i, i);
+                fprintf(writedest,
+                        " InstRet%d UnhaltClkCycles%d UnhaltRefCycles%d APERF%d MPERF%d TSC%d", i, i, i,
+                        i, i, i);
 #endif
-        }
+            }
 #ifdef LIBJUSTIFY_FOUND
-        cfprintf(writedest, "\n");
+            cfprintf(writedest, "\n");
 #else
-        fprintf(writedest, "\n");
+            fprintf(writedest, "\n");
 #endif
+        }
     }
 
     read_batch(FIXED_COUNTERS_DATA);
@@ -1401,15 +1504,49 @@ void get_all_power_data_fixed(FILE *writedest, off_t msr_pkg_power_limit,
     rlim_idx = 0;
     for (i = 0; i < nsockets; i++)
     {
-        get_package_rapl_limit(i, &(rlim[rlim_idx]), &(rlim[rlim_idx + 1]),
-                               msr_pkg_power_limit, msr_rapl_unit);
-        get_dram_rapl_limit(i, &(rlim[rlim_idx + 2]), msr_dram_power_limit,
-                            msr_rapl_unit);
+        get_package_rapl_limit_batch(i, &(rlim[rlim_idx]), &(rlim[rlim_idx + 1]),
+                                     msr_pkg_power_limit, msr_rapl_unit);
+        get_dram_rapl_limit_batch(i, &(rlim[rlim_idx + 2]), msr_dram_power_limit,
+                                  msr_rapl_unit);
         rlim_idx += 3;
     }
+    if (!plan_ready)
+    {
+        plan_ready = 1;
+        /* Power limits are cached, see set_batch_cache_class(). */
+        sample_plan_subscribe(RAPL_DATA);
+        sample_plan_subscribe(FIXED_COUNTERS_DATA);
+        sample_plan_subscribe(CLOCKS_DATA);
+    }
+    sample_plan_end();
 
     rlim_idx = 0;
 
+    if (encoded)
+    {
+        unsigned col = 0;
+        for (i = 0; i < nsockets; i++)
+        {
+            vals[col++] = llround(rapl->pkg_delta_joules[i] * POWER_TRACE_SCALE);
+            vals[col++] = llround(rlim[rlim_idx].watts * POWER_TRACE_SCALE);
+            vals[col++] = llround(rlim[rlim_idx + 1].watts * POWER_TRACE_SCALE);
+            vals[col++] = llround(rapl->dram_delta_joules[i] * POWER_TRACE_SCALE);
+            vals[col++] = llround(rlim[rlim_idx + 2].watts * POWER_TRACE_SCALE);
+            rlim_idx += 3;
+        }
+        for (i = 0; i < nthreads; i++)
+        {
+            vals[col++] = (int64_t)(*c0->value[i]);
+            vals[col++] = (int64_t)(*c1->value[i]);
+            vals[col++] = (int64_t)(*c2->value[i]);
+            vals[col++] = (int64_t)(*cd->aperf[i]);
+            vals[col++] = (int64_t)(*cd->mperf[i]);
+            vals[col++] = (int64_t)(*cd->tsc[i]);
+        }
+        variorum_trace_append(&power_trace, now_ms(), vals);
+        return;
+    }
+
 #ifdef LIBJUSTIFY_FOUND
     cfprintf(writedest, "%-s %ld ", "_VAR_MONITOR", now_ms());
 #else
@@ -1447,3 +1584,320 @@ void get_all_power_data_fixed(FILE *writedest, off_t msr_pkg_power_limit,
     fprintf(writedest, "\n");
 #endif
 };
+
+/********************************/
+/* Multiplexed Counter Sampling */
+/********************************/
+
+/* Fixed counters reported ahead of the programmable events. */
+#define NUM_FIXED_SAMPLED 3
+/* EN | OS | USR */
+#define PMC_SAMPLING_FLAGS 0x43
+#define PMC_COUNTER_MASK ((1ULL << 48) - 1)
+
+static const char *fixed_event_names[NUM_FIXED_SAMPLED] =
+{
+    "INST_RETIRED.ANY", "CPU_CLK_UNHALTED.THREAD", "CPU_CLK_UNHALTED.REF_TSC"
+};
+
+/* Events available to counter sampling, see Intel SDM Vol 3B, Chapter 19.
+ * The last entry is filled with the model's retired-load miss event. */
+#define NUM_PMC_EVENTS 10
+
+static const struct variorum_pmc_event pmc_common_events[NUM_PMC_EVENTS - 1] =
+{
+    {"INST_RETIRED.ANY_P",              0xC0, 0x00, 0x00},
+    {"CPU_CLK_UNHALTED.THREAD_P",       0x3C, 0x00, 0x00},
+    {"CPU_CLK_UNHALTED.REF_XCLK",       0x3C, 0x01, 0x00},
+    {"LONGEST_LAT_CACHE.REFERENCE",     0x2E, 0x4F, 0x00},
+    {"LONGEST_LAT_CACHE.MISS",          0x2E, 0x41, 0x00},
+    {"BR_INST_RETIRED.ALL_BRANCHES",    0xC4, 0x00, 0x00},
+    {"BR_MISP_RETIRED.ALL_BRANCHES",    0xC5, 0x00, 0x00},
+    {"L1D.REPLACEMENT",                 0x51, 0x01, 0x00},
+    {"OFFCORE_REQUESTS.DEMAND_DATA_RD", 0xB0, 0x01, 0x00},
+};
+
+static const struct variorum_pmc_event pmc_load_miss_events[] =
+{
+    [PMC_LOAD_MISS_SNB] = {"MEM_LOAD_UOPS_MISC_RETIRED.LLC_MISS", 0xD4, 0x02, 0x00},
+    [PMC_LOAD_MISS_IVB] = {"MEM_LOAD_UOPS_RETIRED.LLC_MISS",      0xD1, 0x20, 0x00},
+    [PMC_LOAD_MISS_HSW] = {"MEM_LOAD_UOPS_RETIRED.L3_MISS",       0xD1, 0x20, 0x00},
+    [PMC_LOAD_MISS_SKL] = {"MEM_LOAD_RETIRED.L3_MISS",            0xD1, 0x20, 0x00},
+};
+
+static struct
+{
+    int running;
+    unsigned nthreads;
+    unsigned avail;
+    struct variorum_counter_mux mux;
+    /* Event table of the processor model, referenced by mux. */
+    struct variorum_pmc_event events[NUM_PMC_EVENTS];
+    /* IA32_PERF_GLOBAL_CTRL of each thread before sampling started. */
+    uint64_t **perf_global_ctrl;
+    uint64_t *global_ctrl_saved;
+    struct fixed_counter *c0, *c1, *c2;
+    struct pmc *p;
+    off_t *msrs_perfevtsel_ctrs;
+    off_t *msrs_perfmon_ctrs;
+    uint64_t *fixed_prev;
+    uint64_t *pmc_prev;
+    uint64_t *raw;
+    double *deltas;
+    const char **names;
+    uint64_t last_ns;
+} sampler;
+
+static uint64_t sampler_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t **pmc_slot(struct pmc *p, unsigned slot)
+{
+    switch (slot)
+    {
+        case 0:
+            return p->pmc0;
+        case 1:
+            return p->pmc1;
+        case 2:
+            return p->pmc2;
+        case 3:
+            return p->pmc3;
+        case 4:
+            return p->pmc4;
+        case 5:
+            return p->pmc5;
+        case 6:
+            return p->pmc6;
+        case 7:
+            return p->pmc7;
+    }
+    return NULL;
+}
+
+/* Program the event select registers with one group and zero the counters. */
+static void program_counter_group(unsigned group)
+{
+    const struct variorum_pmc_event *e;
+    unsigned slot, t;
+
+    for (slot = 0; slot < sampler.avail; slot++)
+    {
+        e = variorum_counter_mux_event(&sampler.mux, group, slot);
+        for (t = 0; t < sampler.nthreads; t++)
+        {
+            if (e != NULL)
+            {
+                set_pmc_ctrl_flags(e->cmask, PMC_SAMPLING_FLAGS, e->umask, e->event,
+                                   slot + 1, t, sampler.msrs_perfevtsel_ctrs);
+            }
+            else
+            {
+                set_pmc_ctrl_flags(0, 0, 0, 0, slot + 1, t,
+                                   sampler.msrs_perfevtsel_ctrs);
+            }
+        }
+    }
+    write_batch(COUNTERS_CTRL);
+    clear_all_pmc(sampler.msrs_perfmon_ctrs);
+    memset(sampler.pmc_prev, 0,
+           (size_t)sampler.nthreads * sampler.avail * sizeof(uint64_t));
+}
+
+static void free_counter_sampling(void)
+{
+    variorum_counter_mux_free(&sampler.mux);
+    free(sampler.fixed_prev);
+    free(sampler.pmc_prev);
+    free(sampler.raw);
+    free(sampler.deltas);
+    free(sampler.names);
+    free(sampler.global_ctrl_saved);
+    sampler.fixed_prev = sampler.pmc_prev = sampler.raw = NULL;
+    sampler.global_ctrl_saved = NULL;
+    sampler.deltas = NULL;
+    sampler.names = NULL;
+    sampler.running = 0;
+}
+
+int counter_sampling_start(const char *events, enum pmc_load_miss_e load_miss,
+                           off_t *msrs_fixed_ctrs, off_t msr_perf_global_ctrl,
+                           off_t msr_fixed_counter_ctrl, off_t *msrs_perfevtsel_ctrs,
+                           off_t *msrs_perfmon_ctrs)
+{
+    unsigned nthreads = 0;
+    unsigned ncols, i, t;
+    int avail = cpuid_num_pmc();
+
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(NULL, NULL, &nthreads, P_INTEL_CPU_IDX);
+#endif
+    if (avail < 1)
+    {
+        variorum_error_handler("No general-purpose performance counters available",
+                               VARIORUM_ERROR_FEATURE_NOT_AVAILABLE,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+    if (sampler.running)
+    {
+        counter_sampling_stop();
+    }
+    memcpy(sampler.events, pmc_common_events, sizeof(pmc_common_events));
+    sampler.events[NUM_PMC_EVENTS - 1] = pmc_load_miss_events[load_miss];
+    if (variorum_counter_mux_init(&sampler.mux, sampler.events, NUM_PMC_EVENTS,
+                                  events, avail, nthreads) != 0)
+    {
+        return -1;
+    }
+
+    sampler.nthreads = nthreads;
+    sampler.avail = avail;
+    sampler.msrs_perfevtsel_ctrs = msrs_perfevtsel_ctrs;
+    sampler.msrs_perfmon_ctrs = msrs_perfmon_ctrs;
+    ncols = NUM_FIXED_SAMPLED + sampler.mux.nevents;
+    sampler.fixed_prev = (uint64_t *) calloc((size_t)nthreads * NUM_FIXED_SAMPLED,
+                         sizeof(uint64_t));
+    sampler.pmc_prev = (uint64_t *) calloc((size_t)nthreads * avail,
+                                           sizeof(uint64_t));
+    sampler.raw = (uint64_t *) calloc((size_t)nthreads * avail, sizeof(uint64_t));
+    sampler.deltas = (double *) calloc((size_t)nthreads * ncols, sizeof(double));
+    sampler.names = (const char **) malloc(ncols * sizeof(char *));
+    sampler.global_ctrl_saved = (uint64_t *) malloc(nthreads * sizeof(uint64_t));
+    if (sampler.fixed_prev == NULL || sampler.pmc_prev == NULL ||
+            sampler.raw == NULL || sampler.deltas == NULL || sampler.names == NULL ||
+            sampler.global_ctrl_saved == NULL)
+    {
+        free_counter_sampling();
+        return -1;
+    }
+    for (i = 0; i < NUM_FIXED_SAMPLED; i++)
+    {
+        sampler.names[i] = fixed_event_names[i];
+    }
+    for (i = 0; i < sampler.mux.nevents; i++)
+    {
+        sampler.names[NUM_FIXED_SAMPLED + i] = sampler.mux.events[i]->name;
+    }
+
+    fixed_counter_storage(&sampler.c0, &sampler.c1, &sampler.c2,
+                          msrs_fixed_ctrs);
+    enable_fixed_counters(msrs_fixed_ctrs, msr_perf_global_ctrl,
+                          msr_fixed_counter_ctrl);
+    /* enable_fixed_counters() leaves the PMC enable bits untouched. */
+    fixed_counter_ctrl_storage(&sampler.perf_global_ctrl, NULL,
+                               msr_perf_global_ctrl, msr_fixed_counter_ctrl);
+    read_batch(FIXED_COUNTERS_CTRL_DATA);
+    for (t = 0; t < nthreads; t++)
+    {
+        sampler.global_ctrl_saved[t] = *sampler.perf_global_ctrl[t];
+        *sampler.perf_global_ctrl[t] |= (1ULL << avail) - 1;
+    }
+    write_batch(FIXED_COUNTERS_CTRL_DATA);
+
+    pmc_storage(&sampler.p, msrs_perfmon_ctrs);
+    program_counter_group(0);
+
+    read_batch(FIXED_COUNTERS_DATA);
+    for (t = 0; t < nthreads; t++)
+    {
+        sampler.fixed_prev[t * NUM_FIXED_SAMPLED + 0] = *sampler.c0->value[t];
+        sampler.fixed_prev[t * NUM_FIXED_SAMPLED + 1] = *sampler.c1->value[t];
+        sampler.fixed_prev[t * NUM_FIXED_SAMPLED + 2] = *sampler.c2->value[t];
+    }
+    sampler.last_ns = sampler_now_ns();
+    sampler.running = 1;
+    return 0;
+}
+
+int counter_sampling_read(struct variorum_counter_sample *sample)
+{
+    struct fixed_counter *fixed[NUM_FIXED_SAMPLED];
+    unsigned ncols, next, t, i;
+    uint64_t now, cur;
+
+    if (!sampler.running)
+    {
+        return -1;
+    }
+    fixed[0] = sampler.c0;
+    fixed[1] = sampler.c1;
+    fixed[2] = sampler.c2;
+    ncols = NUM_FIXED_SAMPLED + sampler.mux.nevents;
+
+    read_batch(FIXED_COUNTERS_DATA);
+    read_batch(COUNTERS_DATA);
+    now = sampler_now_ns();
+
+    for (t = 0; t < sampler.nthreads; t++)
+    {
+        for (i = 0; i < NUM_FIXED_SAMPLED; i++)
+        {
+            uint64_t *prev = &sampler.fixed_prev[t * NUM_FIXED_SAMPLED + i];
+            cur = *fixed[i]->value[t];
+            sampler.deltas[(size_t)t * ncols + i] = (double)((cur - *prev) &
+                                                    PMC_COUNTER_MASK);
+            *prev = cur;
+        }
+        for (i = 0; i < sampler.avail; i++)
+        {
+            uint64_t *prev = &sampler.pmc_prev[t * sampler.avail + i];
+            cur = *pmc_slot(sampler.p, i)[t];
+            sampler.raw[t * sampler.avail + i] = (cur - *prev) & PMC_COUNTER_MASK;
+            *prev = cur;
+        }
+    }
+
+    next = variorum_counter_mux_update(&sampler.mux, sampler.raw,
+                                       now - sampler.last_ns);
+    for (t = 0; t < sampler.nthreads; t++)
+    {
+        memcpy(&sampler.deltas[(size_t)t * ncols + NUM_FIXED_SAMPLED],
+               &sampler.mux.deltas[(size_t)t * sampler.mux.nevents],
+               sampler.mux.nevents * sizeof(double));
+    }
+    if (sampler.mux.ngroups > 1)
+    {
+        program_counter_group(next);
+    }
+
+    sample->nthreads = sampler.nthreads;
+    sample->nevents = ncols;
+    sample->names = sampler.names;
+    sample->deltas = sampler.deltas;
+    sample->elapsed_ns = now - sampler.last_ns;
+    sampler.last_ns = now;
+    return 0;
+}
+
+int counter_sampling_stop(void)
+{
+    unsigned slot, t;
+
+    if (!sampler.running)
+    {
+        return -1;
+    }
+    for (slot = 0; slot < sampler.avail; slot++)
+    {
+        for (t = 0; t < sampler.nthreads; t++)
+        {
+            set_pmc_ctrl_flags(0, 0, 0, 0, slot + 1, t, sampler.msrs_perfevtsel_ctrs);
+        }
+    }
+    write_batch(COUNTERS_CTRL);
+    read_batch(FIXED_COUNTERS_CTRL_DATA);
+    for (t = 0; t < sampler.nthreads; t++)
+    {
+        *sampler.perf_global_ctrl[t] = sampler.global_ctrl_saved[t];
+    }
+    write_batch(FIXED_COUNTERS_CTRL_DATA);
+    free_counter_sampling();
+    return 0;
+}
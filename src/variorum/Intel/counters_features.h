@@ -9,6 +9,24 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <variorum_counter_mux.h>
+
+struct variorum_counter_sample;
+
+/// @brief Retired-load last-level cache miss event, the only counter sampling
+/// event whose encoding differs between the supported microarchitectures.
+enum pmc_load_miss_e
+{
+    /// @brief MEM_LOAD_UOPS_MISC_RETIRED.LLC_MISS (Sandy Bridge).
+    PMC_LOAD_MISS_SNB,
+    /// @brief MEM_LOAD_UOPS_RETIRED.LLC_MISS (Ivy Bridge).
+    PMC_LOAD_MISS_IVB,
+    /// @brief MEM_LOAD_UOPS_RETIRED.L3_MISS (Haswell, Broadwell).
+    PMC_LOAD_MISS_HSW,
+    /// @brief MEM_LOAD_RETIRED.L3_MISS (Skylake, Kaby Lake).
+    PMC_LOAD_MISS_SKL,
+};
+
 /// @brief Structure containing configuration data for each fixed-function
 /// performance counter as encoded in IA32_PERF_GLOBAL_CTL and
 /// IA32_FIXED_CTR_CTL.
@@ -420,4 +438,48 @@ void get_all_power_data_fixed(
     off_t msr_tsc
 );
 
+/// @brief Program a set of named events for periodic sampling. Events beyond
+/// the number of programmable counters are time-multiplexed in groups, and
+/// the fixed counters are always included.
+///
+/// @param [in] events Comma-separated event names, or NULL for all events
+///        supported by the processor model.
+/// @param [in] load_miss Retired-load miss event of the processor model.
+/// @param [in] msrs_fixed_ctrs Array of unique addresses for fixed counters.
+/// @param [in] msr_perf_global_ctrl Unique address for IA32_PERF_GLOBAL_CTRL.
+/// @param [in] msr_fixed_counter_ctrl Unique address for
+///        IA32_FIXED_CTR_CTRL.
+/// @param [in] msrs_perfevtsel_ctrs Array of unique addresses for
+///        PERFEVTSEL_CTRS.
+/// @param [in] msrs_perfmon_ctrs Array of unique addresses for PERFMON_CTRS.
+///
+/// @return 0 if successful, else -1.
+int counter_sampling_start(
+    const char *events,
+    enum pmc_load_miss_e load_miss,
+    off_t *msrs_fixed_ctrs,
+    off_t msr_perf_global_ctrl,
+    off_t msr_fixed_counter_ctrl,
+    off_t *msrs_perfevtsel_ctrs,
+    off_t *msrs_perfmon_ctrs
+);
+
+/// @brief Read per-thread counter deltas since the previous sample and
+/// rotate to the next event group.
+///
+/// @param [out] sample Deltas, valid until the next call.
+///
+/// @return 0 if successful, else -1 if sampling was not started.
+int counter_sampling_read(
+    struct variorum_counter_sample *sample
+);
+
+/// @brief Disable the programmed events, restore IA32_PERF_GLOBAL_CTRL, and
+/// release the sampling state.
+///
+/// @return 0 if successful, else -1 if sampling was not started.
+int counter_sampling_stop(
+    void
+);
+
 #endif
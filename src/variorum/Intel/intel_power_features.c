@@ -9,12 +9,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <intel_power_features.h>
 #include <config_architecture.h>
 #include <msr_core.h>
+#include <msr_readers.h>
+#include <variorum_energy_window.h>
 #include <variorum_error.h>
+#include <variorum_region.h>
+#include <variorum_self_stats.h>
 #include <variorum_timers.h>
 
 #ifdef LIBJUSTIFY_FOUND
@@ -364,6 +369,7 @@ int get_rapl_power_unit(struct rapl_units *ru, off_t msr)
         init_get_rapl_power_unit = 1;
         val = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(RAPL_UNIT, nsockets);
+        set_batch_cache_class(RAPL_UNIT, MSR_CACHE_INVARIANT);
         load_socket_batch(msr, val, RAPL_UNIT);
     }
     read_batch(RAPL_UNIT);
@@ -771,6 +777,61 @@ int get_dram_rapl_limit(const unsigned socket, struct rapl_limit *limit,
     return 0;
 }
 
+static uint64_t **rapl_limit_batch(int batchnum, off_t msr_power_limit)
+{
+    static uint64_t **bits[2] = {NULL, NULL};
+    int idx = (batchnum == DRAM_POWER_LIMIT);
+    unsigned nsockets;
+
+    if (bits[idx] == NULL)
+    {
+#ifdef VARIORUM_WITH_INTEL_CPU
+        variorum_get_topology(&nsockets, NULL, NULL, P_INTEL_CPU_IDX);
+#endif
+        bits[idx] = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
+        allocate_batch(batchnum, nsockets);
+        /* Only changes when written, cap_*_power_limit() invalidates it. */
+        set_batch_cache_class(batchnum, MSR_CACHE_SLOW);
+        load_socket_batch(msr_power_limit, bits[idx], batchnum);
+    }
+    read_batch(batchnum);
+    return bits[idx];
+}
+
+int get_package_rapl_limit_batch(const unsigned socket,
+                                 struct rapl_limit *limit1, struct rapl_limit *limit2,
+                                 off_t msr_power_limit, off_t msr_rapl_unit)
+{
+    uint64_t **bits = rapl_limit_batch(PKG_POWER_LIMIT, msr_power_limit);
+
+    if (limit1 != NULL)
+    {
+        limit1->bits = *bits[socket];
+        limit1->translate_bits = 1;
+    }
+    if (limit2 != NULL)
+    {
+        limit2->bits = *bits[socket];
+        limit2->translate_bits = 1;
+    }
+    calc_package_rapl_limit(socket, limit1, limit2, msr_rapl_unit);
+    return 0;
+}
+
+int get_dram_rapl_limit_batch(const unsigned socket, struct rapl_limit *limit,
+                              off_t msr_power_limit, off_t msr_rapl_unit)
+{
+    uint64_t **bits = rapl_limit_batch(DRAM_POWER_LIMIT, msr_power_limit);
+
+    if (limit != NULL)
+    {
+        limit->bits = *bits[socket];
+        limit->translate_bits = 1;
+    }
+    calc_dram_rapl_limit(socket, limit, msr_rapl_unit);
+    return 0;
+}
+
 int cap_package_power_limit(const unsigned socket, int package_power_limit,
                             off_t msr_power_limit, off_t msr_rapl_unit)
 {
@@ -1242,6 +1303,28 @@ void print_power_data(FILE *writedest, off_t msr_rapl_unit,
 #endif
 }
 
+/* Once the batches of a power sample exist, they are read with one batch
+ * operation through the sample plan. */
+static int power_sample_plan_ready = 0;
+
+static void power_sample_begin(void)
+{
+    if (power_sample_plan_ready)
+    {
+        sample_plan_begin();
+    }
+}
+
+static void power_sample_end(void)
+{
+    if (!power_sample_plan_ready)
+    {
+        power_sample_plan_ready = 1;
+        sample_plan_subscribe(RAPL_DATA);
+    }
+    sample_plan_end();
+}
+
 void json_get_power_data(json_t *get_power_obj, off_t msr_power_limit,
                          off_t msr_rapl_unit, off_t msr_pkg_energy_status, off_t msr_dram_energy_status)
 {
@@ -1256,6 +1339,7 @@ void json_get_power_data(json_t *get_power_obj, off_t msr_power_limit,
     variorum_get_topology(&nsockets, NULL, NULL, P_INTEL_CPU_IDX);
 #endif
 
+    power_sample_begin();
     get_power(msr_rapl_unit, msr_pkg_energy_status, msr_dram_energy_status);
     if (!init)
     {
@@ -1270,7 +1354,8 @@ void json_get_power_data(json_t *get_power_obj, off_t msr_power_limit,
         json_t *socket_obj = json_object();
         json_object_set_new(get_power_obj, socketid, socket_obj);
 
-        get_package_rapl_limit(i, &l1, &l2, msr_power_limit, msr_rapl_unit);
+        get_package_rapl_limit_batch(i, &l1, &l2, msr_power_limit,
+                                     msr_rapl_unit);
 
         json_object_set_new(socket_obj, "power_cpu_watts",
                             json_real(rapl->pkg_watts[i]));
@@ -1278,12 +1363,60 @@ void json_get_power_data(json_t *get_power_obj, off_t msr_power_limit,
                             json_real(rapl->dram_watts[i]));
         node_power += rapl->pkg_watts[i] + rapl->dram_watts[i];
     }
+    power_sample_end();
 
     // Set the node power key with pwrnode value.
     json_object_set_new(get_power_obj, "power_node_watts",
                         json_real(node_power));
 }
 
+void write_power_data_json(struct variorum_json_writer *jw,
+                           off_t msr_power_limit, off_t msr_rapl_unit,
+                           off_t msr_pkg_energy_status, off_t msr_dram_energy_status)
+{
+    static struct rapl_data *rapl = NULL;
+    static char (*socket_keys)[12] = NULL;
+    struct rapl_limit l1, l2;
+    unsigned nsockets = 0;
+    unsigned i;
+    double node_power = 0.0;
+
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(&nsockets, NULL, NULL, P_INTEL_CPU_IDX);
+#endif
+
+    power_sample_begin();
+    get_power(msr_rapl_unit, msr_pkg_energy_status, msr_dram_energy_status);
+    if (rapl == NULL)
+    {
+        rapl_storage(&rapl);
+    }
+    /* Keys only depend on the topology, so build them once. */
+    if (socket_keys == NULL)
+    {
+        socket_keys = malloc(nsockets * sizeof(*socket_keys));
+        for (i = 0; i < nsockets; i++)
+        {
+            snprintf(socket_keys[i], 12, "socket_%d", i);
+        }
+    }
+
+    for (i = 0; i < nsockets; i++)
+    {
+        get_package_rapl_limit_batch(i, &l1, &l2, msr_power_limit,
+                                     msr_rapl_unit);
+
+        variorum_json_writer_begin_object(jw, socket_keys[i]);
+        variorum_json_writer_real(jw, "power_cpu_watts", rapl->pkg_watts[i]);
+        variorum_json_writer_real(jw, "power_mem_watts", rapl->dram_watts[i]);
+        variorum_json_writer_end_object(jw);
+        node_power += rapl->pkg_watts[i] + rapl->dram_watts[i];
+    }
+    power_sample_end();
+
+    variorum_json_writer_real(jw, "power_node_watts", node_power);
+}
+
 void json_get_power_domain_info(json_t *get_domain_obj,
                                 off_t msr_pkg_power_info, off_t
                                 msr_dram_power_info, off_t msr_rapl_unit, off_t msr_power_limit)
@@ -1394,6 +1527,10 @@ int read_rapl_data(off_t msr_rapl_unit, off_t msr_pkg_energy_status,
     static struct rapl_data *rapl = NULL;
     static int init = 0;
     static unsigned nsockets = 0;
+    /* Bits seen by the previous sample. The batch storage itself may already
+     * hold the current sample when the sample plan filled it. */
+    static uint64_t *last_pkg_bits = NULL;
+    static uint64_t *last_dram_bits = NULL;
     unsigned i;
 
     if (!init)
@@ -1405,6 +1542,8 @@ int read_rapl_data(off_t msr_rapl_unit, off_t msr_pkg_energy_status,
         {
             return -1;
         }
+        last_pkg_bits = (uint64_t *) calloc(nsockets, sizeof(uint64_t));
+        last_dram_bits = (uint64_t *) calloc(nsockets, sizeof(uint64_t));
         create_rapl_data_batch(rapl, msr_pkg_energy_status, msr_dram_energy_status);
         rapl->now.tv_sec = 0;
         rapl->now.tv_usec = 0;
@@ -1442,13 +1581,13 @@ int read_rapl_data(off_t msr_rapl_unit, off_t msr_pkg_energy_status,
             fprintf(stderr, "DEBUG: socket %u msr 0x611 has destination %p\n", nsockets,
                     rapl->pkg_bits);
 #endif
-            rapl->old_pkg_bits[i] = *rapl->pkg_bits[i];
+            rapl->old_pkg_bits[i] = last_pkg_bits[i];
             rapl->old_pkg_joules[i] = rapl->pkg_joules[i];
 #ifdef VARIORUM_DEBUG
             fprintf(stderr, "DEBUG: (read_rapl_data): made it to 1st mark\n");
 #endif
 
-            rapl->old_dram_bits[i]  = *rapl->dram_bits[i];
+            rapl->old_dram_bits[i]  = last_dram_bits[i];
             rapl->old_dram_joules[i] = rapl->dram_joules[i];
 
             ///* Make sure the pkg perf status register exists. */
@@ -1466,6 +1605,8 @@ int read_rapl_data(off_t msr_rapl_unit, off_t msr_pkg_energy_status,
     read_batch(RAPL_DATA);
     for (i = 0; i < nsockets; i++)
     {
+        last_pkg_bits[i] = *rapl->pkg_bits[i];
+        last_dram_bits[i] = *rapl->dram_bits[i];
         //        if (*rapl_flags & DRAM_ENERGY_STATUS)
         //        {
         //#ifdef VARIORUM_DEBUG
@@ -1761,3 +1902,257 @@ void json_get_energy_data(json_t *get_energy_obj, off_t msr_rapl_unit,
     json_object_set_new(get_energy_obj, "energy_node_joules",
                         json_real(node_energy));
 }
+
+/* Updates observed to measure the energy counter cadence. */
+#define ENERGY_WINDOW_CALIBRATION_TICKS 16
+/* Give up waiting for an update after this long. */
+#define ENERGY_WINDOW_TIMEOUT_NS 100000000ULL
+
+static struct
+{
+    int calibrated;
+    int started;
+    double ticks_per_sec;
+    double update_ticks;
+    double *units_per_joule;
+    struct variorum_rapl_tick *start;
+} energy_window;
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+/* Poll a socket's energy counter on its reader CPU until the value changes,
+ * bracketing the update with timestamp counter reads. */
+static int wait_rapl_tick(unsigned socket, off_t msr,
+                          struct variorum_rapl_tick *tick)
+{
+    unsigned cpu = socket_reader_cpu(socket);
+    uint64_t deadline = monotonic_ns() + ENERGY_WINDOW_TIMEOUT_NS;
+    uint64_t old, val, before;
+
+    tick->before = variorum_self_ticks();
+    if (read_msr_by_idx(cpu, msr, &old))
+    {
+        return -1;
+    }
+    old &= VARIORUM_RAPL_ENERGY_MASK;
+    do
+    {
+        before = variorum_self_ticks();
+        if (read_msr_by_idx(cpu, msr, &val))
+        {
+            return -1;
+        }
+        val &= VARIORUM_RAPL_ENERGY_MASK;
+        if (val != old)
+        {
+            tick->raw = val;
+            tick->after = variorum_self_ticks();
+            return 0;
+        }
+        tick->before = before;
+    }
+    while (monotonic_ns() < deadline);
+    variorum_error_handler("Energy status counter did not update",
+                           VARIORUM_ERROR_RUNTIME, getenv("HOSTNAME"),
+                           __FILE__, __FUNCTION__, __LINE__);
+    return -1;
+}
+
+/* Measure the update interval of the energy counter and the frequency of the
+ * timestamp counter against the monotonic clock. */
+static int calibrate_energy_window(off_t msr_rapl_unit,
+                                   off_t msr_pkg_energy_status)
+{
+    struct variorum_rapl_tick ticks[ENERGY_WINDOW_CALIBRATION_TICKS];
+    struct rapl_units *ru;
+    static unsigned nsockets, ncores, nthreads;
+    uint64_t ns0, ns1, tsc0, tsc1;
+    unsigned i;
+
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(&nsockets, &ncores, &nthreads, P_INTEL_CPU_IDX);
+#endif
+    ru = (struct rapl_units *) malloc(nsockets * sizeof(struct rapl_units));
+    if (energy_window.start == NULL)
+    {
+        energy_window.units_per_joule = (double *) malloc(nsockets * sizeof(double));
+        energy_window.start = (struct variorum_rapl_tick *)
+                              malloc(nsockets * sizeof(struct variorum_rapl_tick));
+    }
+    if (ru == NULL || energy_window.units_per_joule == NULL ||
+            energy_window.start == NULL)
+    {
+        free(ru);
+        return -1;
+    }
+    get_rapl_power_unit(ru, msr_rapl_unit);
+    for (i = 0; i < nsockets; i++)
+    {
+        energy_window.units_per_joule[i] = ru[i].joules;
+    }
+    free(ru);
+
+    /* The first update is observed at an arbitrary phase, so start timing
+     * from it. */
+    if (wait_rapl_tick(0, msr_pkg_energy_status, &ticks[0]))
+    {
+        return -1;
+    }
+    ns0 = monotonic_ns();
+    tsc0 = variorum_self_ticks();
+    for (i = 1; i < ENERGY_WINDOW_CALIBRATION_TICKS; i++)
+    {
+        if (wait_rapl_tick(0, msr_pkg_energy_status, &ticks[i]))
+        {
+            return -1;
+        }
+    }
+    ns1 = monotonic_ns();
+    tsc1 = variorum_self_ticks();
+
+    energy_window.ticks_per_sec = (double)(tsc1 - tsc0) / ((ns1 - ns0) / 1e9);
+    energy_window.update_ticks = variorum_rapl_update_ticks(ticks,
+                                 ENERGY_WINDOW_CALIBRATION_TICKS);
+    energy_window.calibrated = 1;
+    return 0;
+}
+
+int energy_window_start(off_t msr_rapl_unit, off_t msr_pkg_energy_status)
+{
+    static unsigned nsockets, ncores, nthreads;
+    unsigned i;
+
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(&nsockets, &ncores, &nthreads, P_INTEL_CPU_IDX);
+#endif
+    if (!energy_window.calibrated &&
+            calibrate_energy_window(msr_rapl_unit, msr_pkg_energy_status))
+    {
+        return -1;
+    }
+    for (i = 0; i < nsockets; i++)
+    {
+        if (wait_rapl_tick(i, msr_pkg_energy_status, &energy_window.start[i]))
+        {
+            return -1;
+        }
+    }
+    energy_window.started = 1;
+    return 0;
+}
+
+int energy_window_stop(off_t msr_pkg_energy_status,
+                       struct variorum_energy_window *window)
+{
+    static unsigned nsockets, ncores, nthreads;
+    struct variorum_rapl_tick *end;
+    unsigned i;
+
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(&nsockets, &ncores, &nthreads, P_INTEL_CPU_IDX);
+#endif
+    if (!energy_window.started)
+    {
+        variorum_error_handler("No energy window was started",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    end = (struct variorum_rapl_tick *)
+          malloc(nsockets * sizeof(struct variorum_rapl_tick));
+    if (end == NULL)
+    {
+        return -1;
+    }
+    for (i = 0; i < nsockets; i++)
+    {
+        if (wait_rapl_tick(i, msr_pkg_energy_status, &end[i]))
+        {
+            free(end);
+            return -1;
+        }
+    }
+    variorum_energy_window_compute(energy_window.start, end,
+                                   energy_window.units_per_joule, nsockets,
+                                   energy_window.ticks_per_sec,
+                                   energy_window.update_ticks, window);
+    energy_window.started = 0;
+    free(end);
+    return 0;
+}
+
+int get_energy_counters(off_t msr_rapl_unit, off_t msr_pkg_energy_status,
+                        off_t msr_dram_energy_status,
+                        struct variorum_energy_counters *counters)
+{
+    /* Raw counter values and their 64-bit accumulation across wraps. */
+    static uint64_t *last_pkg = NULL;
+    static uint64_t *last_dram = NULL;
+    static uint64_t *pkg_total = NULL;
+    static uint64_t *dram_total = NULL;
+    static int have_dram = 1;
+    static unsigned nsockets;
+    double joules;
+    uint64_t bits;
+    unsigned i;
+
+    if (last_pkg == NULL)
+    {
+#ifdef VARIORUM_WITH_INTEL_CPU
+        variorum_get_topology(&nsockets, NULL, NULL, P_INTEL_CPU_IDX);
+#endif
+        pkg_total = (uint64_t *) calloc(nsockets, sizeof(uint64_t));
+        dram_total = (uint64_t *) calloc(nsockets, sizeof(uint64_t));
+        last_dram = (uint64_t *) calloc(nsockets, sizeof(uint64_t));
+        last_pkg = (uint64_t *) calloc(nsockets, sizeof(uint64_t));
+        if (pkg_total == NULL || dram_total == NULL || last_dram == NULL ||
+                last_pkg == NULL)
+        {
+            return -1;
+        }
+        for (i = 0; i < nsockets; i++)
+        {
+            if (read_msr_by_idx(socket_reader_cpu(i), msr_pkg_energy_status,
+                                &last_pkg[i]))
+            {
+                return -1;
+            }
+            /* Client parts have no DRAM domain. */
+            if (have_dram && read_msr_by_idx(socket_reader_cpu(i),
+                                             msr_dram_energy_status, &last_dram[i]))
+            {
+                have_dram = 0;
+            }
+        }
+    }
+
+    for (i = 0; i < nsockets; i++)
+    {
+        if (read_msr_by_idx(socket_reader_cpu(i), msr_pkg_energy_status, &bits))
+        {
+            return -1;
+        }
+        pkg_total[i] += (bits - last_pkg[i]) & VARIORUM_RAPL_ENERGY_MASK;
+        last_pkg[i] = bits;
+        translate(i, &pkg_total[i], &joules, BITS_TO_JOULES, msr_rapl_unit,
+                  P_INTEL_CPU_IDX);
+        counters->pkg_joules += joules;
+
+        if (!have_dram ||
+                read_msr_by_idx(socket_reader_cpu(i), msr_dram_energy_status, &bits))
+        {
+            continue;
+        }
+        dram_total[i] += (bits - last_dram[i]) & VARIORUM_RAPL_ENERGY_MASK;
+        last_dram[i] = bits;
+        translate(i, &dram_total[i], &joules, BITS_TO_JOULES_DRAM, msr_rapl_unit,
+                  P_INTEL_CPU_IDX);
+        counters->dram_joules += joules;
+    }
+    return 0;
+}
@@ -11,6 +11,11 @@
 #include <stdio.h>
 #include <sys/types.h>
 
+#include <variorum_json_writer.h>
+
+struct variorum_energy_window;
+struct variorum_energy_counters;
+
 #define UINT_MAX 4294967295U // taken from limits.h
 #define STD_ENERGY_UNIT 65536.0
 
@@ -215,6 +220,25 @@ int get_dram_rapl_limit(
     off_t msr_rapl_unit
 );
 
+/// @brief Same as get_package_rapl_limit(), but the limits of all sockets are
+/// read as one batch (PKG_POWER_LIMIT) that the sample plan can merge.
+int get_package_rapl_limit_batch(
+    const unsigned socket,
+    struct rapl_limit *limit1,
+    struct rapl_limit *limit2,
+    off_t msr_power_limit,
+    off_t msr_rapl_unit
+);
+
+/// @brief Same as get_dram_rapl_limit(), but the limits of all sockets are
+/// read as one batch (DRAM_POWER_LIMIT) that the sample plan can merge.
+int get_dram_rapl_limit_batch(
+    const unsigned socket,
+    struct rapl_limit *limit,
+    off_t msr_power_limit,
+    off_t msr_rapl_unit
+);
+
 void print_rapl_power_unit(
     FILE *writedest,
     off_t msr
@@ -311,6 +335,14 @@ void json_get_power_data(
     off_t msr_dram_energy_status
 );
 
+void write_power_data_json(
+    struct variorum_json_writer *jw,
+    off_t msr_power_limit,
+    off_t msr_rapl_unit,
+    off_t msr_pkg_energy_status,
+    off_t msr_dram_energy_status
+);
+
 void json_get_power_domain_info(
     json_t *get_domain_obj,
     off_t msr_pkg_power_info,
@@ -379,6 +411,36 @@ void json_get_energy_data(
     off_t msr_dram_energy_status
 );
 
+/// @brief Detect the update interval of the package energy counter on first
+/// use, then wait for the next update of each socket's counter.
+///
+/// @return 0 if successful, else -1 if a counter did not update.
+int energy_window_start(
+    off_t msr_rapl_unit,
+    off_t msr_pkg_energy_status
+);
+
+/// @brief Wait for the next update of each socket's package energy counter
+/// and compute the energy since energy_window_start().
+///
+/// @return 0 if successful, else -1 if no window was started or a counter
+/// did not update.
+int energy_window_stop(
+    off_t msr_pkg_energy_status,
+    struct variorum_energy_window *window
+);
+
+/// @brief Add the package and DRAM energy accumulated since the first call
+/// to a snapshot. Counter wraps between calls are accounted for.
+///
+/// @return 0 if successful, else -1 if the package counter cannot be read.
+int get_energy_counters(
+    off_t msr_rapl_unit,
+    off_t msr_pkg_energy_status,
+    off_t msr_dram_energy_status,
+    struct variorum_energy_counters *counters
+);
+
 #endif
 
 ///* intel_power_features.h */
@@ -35,6 +35,7 @@ int get_max_non_turbo_ratio(off_t msr_platform_info, int *val)
     {
         raw_val = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(PLATFORM_INFO, nsockets);
+        set_batch_cache_class(PLATFORM_INFO, MSR_CACHE_INVARIANT);
         load_socket_batch(msr_platform_info, raw_val, PLATFORM_INFO);
         init = 1;
     }
@@ -80,6 +81,7 @@ int get_max_efficiency_ratio(off_t msr_platform_info, int *val)
     {
         raw_val = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(MAX_EFFICIENCY, nsockets);
+        set_batch_cache_class(MAX_EFFICIENCY, MSR_CACHE_INVARIANT);
         load_socket_batch(msr_platform_info, raw_val, MAX_EFFICIENCY);
         init = 1;
     }
@@ -125,6 +127,7 @@ int get_min_operating_ratio(off_t msr_platform_info, int *val)
     {
         raw_val = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(MIN_OPERATING_RATIO, nsockets);
+        set_batch_cache_class(MIN_OPERATING_RATIO, MSR_CACHE_INVARIANT);
         load_socket_batch(msr_platform_info, raw_val, MIN_OPERATING_RATIO);
         init = 1;
     }
@@ -164,6 +167,7 @@ int get_turbo_ratio_limit(off_t msr_turbo_ratio_limit)
     {
         val = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(TURBO_RATIO_LIMIT, nsockets);
+        set_batch_cache_class(TURBO_RATIO_LIMIT, MSR_CACHE_SLOW);
         load_socket_batch(msr_turbo_ratio_limit, val, TURBO_RATIO_LIMIT);
         init = 1;
     }
@@ -224,10 +228,12 @@ int get_turbo_ratio_limits(off_t msr_turbo_ratio_limit,
         val = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         val2 = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(TURBO_RATIO_LIMIT, nsockets);
+        set_batch_cache_class(TURBO_RATIO_LIMIT, MSR_CACHE_SLOW);
 #ifdef LIBJUSTIFY_FOUND
         cflush();
 #endif
         allocate_batch(TURBO_RATIO_LIMIT1, nsockets);
+        set_batch_cache_class(TURBO_RATIO_LIMIT1, MSR_CACHE_SLOW);
         load_socket_batch(msr_turbo_ratio_limit, val, TURBO_RATIO_LIMIT);
         load_socket_batch(msr_turbo_ratio_limit1, val2, TURBO_RATIO_LIMIT1);
         init = 1;
@@ -299,7 +305,9 @@ int get_turbo_ratio_limits_skx(off_t msr_turbo_ratio_limit,
         val = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         val2 = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(TURBO_RATIO_LIMIT, nsockets);
+        set_batch_cache_class(TURBO_RATIO_LIMIT, MSR_CACHE_SLOW);
         allocate_batch(TURBO_RATIO_LIMIT_CORES, nsockets);
+        set_batch_cache_class(TURBO_RATIO_LIMIT_CORES, MSR_CACHE_SLOW);
         load_socket_batch(msr_turbo_ratio_limit, val, TURBO_RATIO_LIMIT);
         load_socket_batch(msr_turbo_ratio_limit_cores, val2, TURBO_RATIO_LIMIT_CORES);
         init = 1;
@@ -355,6 +363,7 @@ int config_tdp(int nlevels, off_t msr_config_tdp_level)
     {
         l = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(TDP_CONFIG, nsockets);
+        set_batch_cache_class(TDP_CONFIG, MSR_CACHE_SLOW);
         load_socket_batch(msr_config_tdp_level, l, TDP_CONFIG);
         init = 1;
     }
@@ -423,6 +432,7 @@ int get_avx_limits(off_t *msr_platform_info, off_t *msr_config_tdp_l1,
     {
         val = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(TDP_DEFS, nsockets);
+        set_batch_cache_class(TDP_DEFS, MSR_CACHE_SLOW);
         load_socket_batch(*msr_platform_info, val, TDP_DEFS);
         init = 1;
     }
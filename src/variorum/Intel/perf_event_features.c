@@ -0,0 +1,1034 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <config_architecture.h>
+#include <perf_event_features.h>
+#include <variorum_error.h>
+
+#define POWER_PMU_PATH "/sys/bus/event_source/devices/power"
+
+enum rapl_event
+{
+    RAPL_PKG,
+    RAPL_RAM,
+    RAPL_PSYS,
+    NUM_RAPL_EVENTS
+};
+
+static const char *rapl_event_names[NUM_RAPL_EVENTS] =
+{
+    "energy-pkg", "energy-ram", "energy-psys"
+};
+
+/* Fixed counters, in the order of struct variorum_thread_counters and of the
+ * fixed columns of the MSR counter sampling. */
+#define NUM_FIXED 3
+
+static const uint64_t fixed_event_config[NUM_FIXED] =
+{
+    PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_REF_CPU_CYCLES
+};
+
+static const char *fixed_event_names[NUM_FIXED] =
+{
+    "INST_RETIRED.ANY", "CPU_CLK_UNHALTED.THREAD", "CPU_CLK_UNHALTED.REF_TSC"
+};
+
+/* The energy events of each socket form one group, so a sample is one read()
+ * per socket. The kernel accumulates the 32-bit hardware counters into 64
+ * bits, so no wraparound handling is needed here. */
+static struct
+{
+    /* 0 if not probed yet, 1 if available, -1 if not. */
+    int probed;
+    unsigned nsockets;
+    uint64_t config[NUM_RAPL_EVENTS];
+    double scale[NUM_RAPL_EVENTS];
+    /* Group leader of each socket. */
+    int *leader;
+    /* Position of each event in the group read, -1 if not opened, indexed
+     * [socket * NUM_RAPL_EVENTS + event]. */
+    int *slot;
+    /* Energy since the groups were opened (J) and power between the last two
+     * reads (W), indexed like slot. */
+    double *joules;
+    double *watts;
+    double start;
+    double last;
+    double elapsed;
+} rapl;
+
+static long perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu,
+                            int group_fd, unsigned long flags)
+{
+    return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+static double perf_event_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int read_sysfs(const char *path, char *buf, size_t len)
+{
+    ssize_t n;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+    n = read(fd, buf, len - 1);
+    close(fd);
+    if (n <= 0)
+    {
+        return -1;
+    }
+    buf[n] = '\0';
+    return 0;
+}
+
+/* Parse an event description such as "event=0x02". */
+static int parse_event_config(const char *desc, uint64_t *config)
+{
+    const char *p = strstr(desc, "event=");
+
+    if (p == NULL)
+    {
+        return -1;
+    }
+    *config = strtoull(p + strlen("event="), NULL, 0);
+    return 0;
+}
+
+/* One CPU of each socket from the PMU's cpumask, e.g., "0,28". */
+static void rapl_reader_cpus(int *cpus, unsigned nsockets)
+{
+    char buf[1024], path[128];
+    char *p, *end;
+    unsigned next = 0, s;
+    long cpu, pkg;
+
+    for (s = 0; s < nsockets; s++)
+    {
+        cpus[s] = -1;
+    }
+    if (read_sysfs(POWER_PMU_PATH "/cpumask", buf, sizeof(buf)))
+    {
+        cpus[0] = 0;
+        return;
+    }
+    for (p = buf; *p != '\0' && *p != '\n'; p = end)
+    {
+        cpu = strtol(p, &end, 10);
+        if (end == p)
+        {
+            break;
+        }
+        /* Skip the rest of a range. */
+        while (*end != '\0' && *end != ',' && *end != '\n')
+        {
+            end++;
+        }
+        if (*end == ',')
+        {
+            end++;
+        }
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%ld/topology/physical_package_id", cpu);
+        pkg = -1;
+        if (read_sysfs(path, path, sizeof(path)) == 0)
+        {
+            pkg = strtol(path, NULL, 10);
+        }
+        if (pkg < 0 || pkg >= (long)nsockets || cpus[pkg] != -1)
+        {
+            /* Package IDs are not dense; fall back to the listed order. */
+            pkg = next;
+        }
+        if (pkg < (long)nsockets)
+        {
+            cpus[pkg] = cpu;
+        }
+        next++;
+    }
+}
+
+static void rapl_close(void)
+{
+    unsigned s;
+
+    for (s = 0; rapl.leader != NULL && s < rapl.nsockets; s++)
+    {
+        if (rapl.leader[s] >= 0)
+        {
+            close(rapl.leader[s]);
+        }
+    }
+    free(rapl.leader);
+    free(rapl.slot);
+    free(rapl.joules);
+    free(rapl.watts);
+    rapl.leader = NULL;
+    rapl.slot = NULL;
+    rapl.joules = NULL;
+    rapl.watts = NULL;
+}
+
+/* Open one group per socket. The descriptors stay open for the lifetime of
+ * the process, so later samples cost one read() per socket. */
+static int rapl_open(void)
+{
+    struct perf_event_attr attr;
+    char buf[256], path[256];
+    int have[NUM_RAPL_EVENTS];
+    int *cpus;
+    int type, nslots, fd;
+    unsigned s, e;
+
+    if (rapl.probed)
+    {
+        return rapl.probed > 0 ? 0 : -1;
+    }
+    rapl.probed = -1;
+
+    if (read_sysfs(POWER_PMU_PATH "/type", buf, sizeof(buf)))
+    {
+        return -1;
+    }
+    type = atoi(buf);
+    for (e = 0; e < NUM_RAPL_EVENTS; e++)
+    {
+        have[e] = 0;
+        snprintf(path, sizeof(path), POWER_PMU_PATH "/events/%s",
+                 rapl_event_names[e]);
+        if (read_sysfs(path, buf, sizeof(buf)) ||
+                parse_event_config(buf, &rapl.config[e]))
+        {
+            continue;
+        }
+        snprintf(path, sizeof(path), POWER_PMU_PATH "/events/%s.scale",
+                 rapl_event_names[e]);
+        if (read_sysfs(path, buf, sizeof(buf)))
+        {
+            continue;
+        }
+        rapl.scale[e] = strtod(buf, NULL);
+        have[e] = 1;
+    }
+
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(&rapl.nsockets, NULL, NULL, P_INTEL_CPU_IDX);
+#endif
+    if (rapl.nsockets == 0)
+    {
+        return -1;
+    }
+    rapl.leader = (int *) malloc(rapl.nsockets * sizeof(int));
+    rapl.slot = (int *) malloc(rapl.nsockets * NUM_RAPL_EVENTS * sizeof(int));
+    rapl.joules = (double *) calloc(rapl.nsockets * NUM_RAPL_EVENTS,
+                                    sizeof(double));
+    rapl.watts = (double *) calloc(rapl.nsockets * NUM_RAPL_EVENTS,
+                                   sizeof(double));
+    cpus = (int *) malloc(rapl.nsockets * sizeof(int));
+    if (rapl.leader == NULL || rapl.slot == NULL || rapl.joules == NULL ||
+            rapl.watts == NULL || cpus == NULL)
+    {
+        free(cpus);
+        rapl_close();
+        return -1;
+    }
+    rapl_reader_cpus(cpus, rapl.nsockets);
+
+    for (s = 0; s < rapl.nsockets; s++)
+    {
+        rapl.leader[s] = -1;
+        nslots = 0;
+        for (e = 0; e < NUM_RAPL_EVENTS; e++)
+        {
+            rapl.slot[s * NUM_RAPL_EVENTS + e] = -1;
+            /* The platform domain is not per socket. */
+            if (!have[e] || cpus[s] < 0 || (e == RAPL_PSYS && s != 0))
+            {
+                continue;
+            }
+            memset(&attr, 0, sizeof(attr));
+            attr.type = type;
+            attr.size = sizeof(attr);
+            attr.config = rapl.config[e];
+            attr.read_format = PERF_FORMAT_GROUP;
+            fd = perf_event_open(&attr, -1, cpus[s], rapl.leader[s],
+                                 PERF_FLAG_FD_CLOEXEC);
+            if (fd < 0)
+            {
+                continue;
+            }
+            if (rapl.leader[s] < 0)
+            {
+                rapl.leader[s] = fd;
+            }
+            rapl.slot[s * NUM_RAPL_EVENTS + e] = nslots++;
+        }
+    }
+    free(cpus);
+
+    if (rapl.leader[0] < 0)
+    {
+        rapl_close();
+        return -1;
+    }
+    rapl.start = rapl.last = perf_event_now();
+    rapl.probed = 1;
+    return 0;
+}
+
+/* Sample every socket with one read() each. */
+static int rapl_read(void)
+{
+    uint64_t buf[1 + NUM_RAPL_EVENTS];
+    double now, joules;
+    unsigned s, e;
+    int slot;
+
+    if (rapl_open())
+    {
+        return -1;
+    }
+    now = perf_event_now();
+    rapl.elapsed = now - rapl.last;
+    for (s = 0; s < rapl.nsockets; s++)
+    {
+        if (rapl.leader[s] < 0)
+        {
+            continue;
+        }
+        if (read(rapl.leader[s], buf, sizeof(buf)) < (ssize_t)sizeof(uint64_t))
+        {
+            return -1;
+        }
+        for (e = 0; e < NUM_RAPL_EVENTS; e++)
+        {
+            slot = rapl.slot[s * NUM_RAPL_EVENTS + e];
+            if (slot < 0 || (uint64_t)slot >= buf[0])
+            {
+                continue;
+            }
+            joules = buf[1 + slot] * rapl.scale[e];
+            if (rapl.elapsed > 0)
+            {
+                rapl.watts[s * NUM_RAPL_EVENTS + e] =
+                    (joules - rapl.joules[s * NUM_RAPL_EVENTS + e]) / rapl.elapsed;
+            }
+            rapl.joules[s * NUM_RAPL_EVENTS + e] = joules;
+        }
+    }
+    rapl.last = now;
+    return 0;
+}
+
+static int rapl_has(unsigned socket, enum rapl_event e)
+{
+    return rapl.slot[socket * NUM_RAPL_EVENTS + e] >= 0;
+}
+
+static double rapl_joules(unsigned socket, enum rapl_event e)
+{
+    return rapl.joules[socket * NUM_RAPL_EVENTS + e];
+}
+
+static double rapl_watts(unsigned socket, enum rapl_event e)
+{
+    return rapl.watts[socket * NUM_RAPL_EVENTS + e];
+}
+
+/* Node power is the platform domain where the processor has one, otherwise
+ * the sum of the package and DRAM domains as with the MSR backend. */
+static double rapl_node(double (*value)(unsigned, enum rapl_event))
+{
+    double node = 0.0;
+    unsigned s;
+
+    if (rapl_has(0, RAPL_PSYS))
+    {
+        return value(0, RAPL_PSYS);
+    }
+    for (s = 0; s < rapl.nsockets; s++)
+    {
+        node += value(s, RAPL_PKG) + value(s, RAPL_RAM);
+    }
+    return node;
+}
+
+int perf_event_rapl_available(void)
+{
+    return rapl_open() == 0;
+}
+
+static void print_rapl(FILE *writedest, int long_ver, int with_power)
+{
+    static const char *labels[NUM_RAPL_EVENTS] =
+    {
+        "_PACKAGE_ENERGY", "_DRAM_ENERGY", "_PLATFORM_ENERGY"
+    };
+    static int init[2] = {0, 0};
+    char hostname[1024];
+    double ts = rapl.last - rapl.start;
+    unsigned s, e;
+
+    gethostname(hostname, 1024);
+    for (e = 0; e < NUM_RAPL_EVENTS; e++)
+    {
+        if (!rapl_has(0, e))
+        {
+            continue;
+        }
+        if (long_ver == 0 && !init[with_power])
+        {
+            if (with_power)
+            {
+                fprintf(writedest, "%s Host Socket Energy_J Power_W Elapsed_sec Timestamp_sec\n",
+                        labels[e]);
+            }
+            else
+            {
+                fprintf(writedest, "%s Host Socket Energy_J\n", labels[e]);
+            }
+        }
+        for (s = 0; s < rapl.nsockets; s++)
+        {
+            if (!rapl_has(s, e))
+            {
+                continue;
+            }
+            if (long_ver == 0 && with_power)
+            {
+                fprintf(writedest, "%s %s %d %lf %lf %lf %lf\n", labels[e], hostname, s,
+                        rapl_joules(s, e), rapl_watts(s, e), rapl.elapsed, ts);
+            }
+            else if (long_ver == 0)
+            {
+                fprintf(writedest, "%s %s %d %lf\n", labels[e], hostname, s,
+                        rapl_joules(s, e));
+            }
+            else if (with_power)
+            {
+                fprintf(writedest,
+                        "%s Host: %s, Socket: %d, Energy: %lf J, Power: %lf W, Elapsed: %lf sec, Timestamp: %lf sec\n",
+                        labels[e], hostname, s, rapl_joules(s, e), rapl_watts(s, e),
+                        rapl.elapsed, ts);
+            }
+            else
+            {
+                fprintf(writedest, "%s Host: %s, Socket: %d, Energy: %lf J\n",
+                        labels[e], hostname, s, rapl_joules(s, e));
+            }
+        }
+    }
+    init[with_power] = 1;
+}
+
+int perf_event_get_power(int long_ver)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (rapl_read())
+    {
+        return -1;
+    }
+    print_rapl(stdout, long_ver, 1);
+    return 0;
+}
+
+int perf_event_get_energy(int long_ver)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (rapl_read())
+    {
+        return -1;
+    }
+    print_rapl(stdout, long_ver, 0);
+    return 0;
+}
+
+int perf_event_get_power_json(json_t *get_power_obj)
+{
+    char socketid[12];
+    unsigned s;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (rapl_read())
+    {
+        return -1;
+    }
+    for (s = 0; s < rapl.nsockets; s++)
+    {
+        json_t *socket_obj = json_object();
+
+        snprintf(socketid, sizeof(socketid), "socket_%d", s);
+        json_object_set_new(get_power_obj, socketid, socket_obj);
+        if (rapl_has(s, RAPL_PKG))
+        {
+            json_object_set_new(socket_obj, "power_cpu_watts",
+                                json_real(rapl_watts(s, RAPL_PKG)));
+        }
+        if (rapl_has(s, RAPL_RAM))
+        {
+            json_object_set_new(socket_obj, "power_mem_watts",
+                                json_real(rapl_watts(s, RAPL_RAM)));
+        }
+    }
+    json_object_set_new(get_power_obj, "power_node_watts",
+                        json_real(rapl_node(rapl_watts)));
+    return 0;
+}
+
+int perf_event_write_power_json(struct variorum_json_writer *jw)
+{
+    char socketid[12];
+    unsigned s;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (rapl_read())
+    {
+        return -1;
+    }
+    for (s = 0; s < rapl.nsockets; s++)
+    {
+        snprintf(socketid, sizeof(socketid), "socket_%d", s);
+        variorum_json_writer_begin_object(jw, socketid);
+        if (rapl_has(s, RAPL_PKG))
+        {
+            variorum_json_writer_real(jw, "power_cpu_watts", rapl_watts(s, RAPL_PKG));
+        }
+        if (rapl_has(s, RAPL_RAM))
+        {
+            variorum_json_writer_real(jw, "power_mem_watts", rapl_watts(s, RAPL_RAM));
+        }
+        variorum_json_writer_end_object(jw);
+    }
+    variorum_json_writer_real(jw, "power_node_watts", rapl_node(rapl_watts));
+    return 0;
+}
+
+int perf_event_get_energy_json(json_t *get_energy_obj)
+{
+    char socketid[12];
+    unsigned s;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (rapl_read())
+    {
+        return -1;
+    }
+    for (s = 0; s < rapl.nsockets; s++)
+    {
+        json_t *socket_obj = json_object();
+
+        snprintf(socketid, sizeof(socketid), "socket_%d", s);
+        json_object_set_new(get_energy_obj, socketid, socket_obj);
+        if (rapl_has(s, RAPL_PKG))
+        {
+            json_object_set_new(socket_obj, "energy_cpu_joules",
+                                json_real(rapl_joules(s, RAPL_PKG)));
+        }
+        if (rapl_has(s, RAPL_RAM))
+        {
+            json_object_set_new(socket_obj, "energy_mem_joules",
+                                json_real(rapl_joules(s, RAPL_RAM)));
+        }
+    }
+    json_object_set_new(get_energy_obj, "energy_node_joules",
+                        json_real(rapl_node(rapl_joules)));
+    return 0;
+}
+
+int perf_event_get_energy_counters(struct variorum_energy_counters *counters)
+{
+    unsigned s;
+
+    if (rapl_read())
+    {
+        return -1;
+    }
+    for (s = 0; s < rapl.nsockets; s++)
+    {
+        counters->pkg_joules += rapl_joules(s, RAPL_PKG);
+        counters->dram_joules += rapl_joules(s, RAPL_RAM);
+    }
+    return 0;
+}
+
+/*******************************/
+/* System-Wide Fixed Counters  */
+/*******************************/
+
+/* Group read with PERF_FORMAT_TOTAL_TIME_ENABLED | RUNNING. */
+struct fixed_read
+{
+    uint64_t nr;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[NUM_FIXED];
+};
+
+static struct
+{
+    int running;
+    unsigned nthreads;
+    /* Group leader of each hardware thread, -1 if it could not be opened. */
+    int *leader;
+    struct fixed_read *prev;
+    double *deltas;
+    uint64_t last_ns;
+} fixed;
+
+static uint64_t fixed_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void fixed_close(void)
+{
+    unsigned t;
+
+    for (t = 0; fixed.leader != NULL && t < fixed.nthreads; t++)
+    {
+        if (fixed.leader[t] >= 0)
+        {
+            close(fixed.leader[t]);
+        }
+    }
+    free(fixed.leader);
+    free(fixed.prev);
+    free(fixed.deltas);
+    fixed.leader = NULL;
+    fixed.prev = NULL;
+    fixed.deltas = NULL;
+    fixed.running = 0;
+}
+
+static int fixed_read_thread(unsigned t, struct fixed_read *r)
+{
+    memset(r, 0, sizeof(*r));
+    if (fixed.leader[t] < 0)
+    {
+        return -1;
+    }
+    if (read(fixed.leader[t], r, sizeof(*r)) < (ssize_t)(3 * sizeof(uint64_t)))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/* Open the fixed counters of every hardware thread, one group each. */
+static int fixed_open(void)
+{
+    struct perf_event_attr attr;
+    unsigned t, i, opened = 0;
+    int fd;
+
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(NULL, NULL, &fixed.nthreads, P_INTEL_CPU_IDX);
+#endif
+    fixed.leader = (int *) malloc(fixed.nthreads * sizeof(int));
+    fixed.prev = (struct fixed_read *) calloc(fixed.nthreads,
+                 sizeof(struct fixed_read));
+    fixed.deltas = (double *) calloc((size_t)fixed.nthreads * NUM_FIXED,
+                                     sizeof(double));
+    if (fixed.leader == NULL || fixed.prev == NULL || fixed.deltas == NULL)
+    {
+        fixed_close();
+        return -1;
+    }
+    for (t = 0; t < fixed.nthreads; t++)
+    {
+        fixed.leader[t] = -1;
+        for (i = 0; i < NUM_FIXED; i++)
+        {
+            memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = fixed_event_config[i];
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd = perf_event_open(&attr, -1, t, fixed.leader[t], PERF_FLAG_FD_CLOEXEC);
+            if (fd < 0)
+            {
+                /* The group is all or nothing. */
+                if (fixed.leader[t] >= 0)
+                {
+                    close(fixed.leader[t]);
+                    fixed.leader[t] = -1;
+                }
+                break;
+            }
+            if (fixed.leader[t] < 0)
+            {
+                fixed.leader[t] = fd;
+            }
+        }
+        opened += fixed.leader[t] >= 0;
+    }
+    if (opened == 0)
+    {
+        variorum_error_handler("Could not open fixed counters with perf_event",
+                               VARIORUM_ERROR_FEATURE_NOT_AVAILABLE,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        fixed_close();
+        return -1;
+    }
+    return 0;
+}
+
+int perf_event_get_counters(int long_ver)
+{
+    static int init = 0;
+    struct fixed_read r;
+    char hostname[1024];
+    unsigned t;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (fixed.leader == NULL && fixed_open())
+    {
+        return -1;
+    }
+    gethostname(hostname, 1024);
+    if (long_ver == 0 && !init)
+    {
+        fprintf(stdout, "%s %s %s %s %s %s\n", "_FIXED_COUNTERS", "Host", "Thread",
+                "InstRet", "UnhaltClkCycles", "UnhaltRefCycles");
+        init = 1;
+    }
+    for (t = 0; t < fixed.nthreads; t++)
+    {
+        if (fixed_read_thread(t, &r))
+        {
+            continue;
+        }
+        if (long_ver == 0)
+        {
+            fprintf(stdout, "%s %s %d %lu %lu %lu\n", "_FIXED_COUNTERS", hostname, t,
+                    r.values[0], r.values[1], r.values[2]);
+        }
+        else
+        {
+            fprintf(stdout,
+                    "_FIXED_COUNTERS Host: %s, Thread: %d, InstRet: %lu, UnhaltClkCycles: %lu, UnhaltRefCycles: %lu\n",
+                    hostname, t, r.values[0], r.values[1], r.values[2]);
+        }
+    }
+    return 0;
+}
+
+int perf_event_start_counter_sampling(const char *events)
+{
+    unsigned t;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (events != NULL)
+    {
+        variorum_error_handler("Only the fixed counters can be sampled through perf_event",
+                               VARIORUM_ERROR_FEATURE_NOT_AVAILABLE,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+    if (fixed.leader == NULL && fixed_open())
+    {
+        return -1;
+    }
+    for (t = 0; t < fixed.nthreads; t++)
+    {
+        fixed_read_thread(t, &fixed.prev[t]);
+    }
+    fixed.last_ns = fixed_now_ns();
+    fixed.running = 1;
+    return 0;
+}
+
+int perf_event_sample_counters(struct variorum_counter_sample *sample)
+{
+    struct fixed_read r;
+    uint64_t now, enabled, running;
+    double scale;
+    unsigned t, i;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (!fixed.running)
+    {
+        return -1;
+    }
+    now = fixed_now_ns();
+    for (t = 0; t < fixed.nthreads; t++)
+    {
+        if (fixed_read_thread(t, &r))
+        {
+            continue;
+        }
+        /* Scale up if the group shared the counters with other users. */
+        enabled = r.time_enabled - fixed.prev[t].time_enabled;
+        running = r.time_running - fixed.prev[t].time_running;
+        scale = running > 0 ? (double)enabled / running : 0.0;
+        for (i = 0; i < NUM_FIXED; i++)
+        {
+            fixed.deltas[(size_t)t * NUM_FIXED + i] =
+                (r.values[i] - fixed.prev[t].values[i]) * scale;
+        }
+        fixed.prev[t] = r;
+    }
+    sample->nthreads = fixed.nthreads;
+    sample->nevents = NUM_FIXED;
+    sample->names = fixed_event_names;
+    sample->deltas = fixed.deltas;
+    sample->elapsed_ns = now - fixed.last_ns;
+    fixed.last_ns = now;
+    return 0;
+}
+
+int perf_event_stop_counter_sampling(void)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (!fixed.running)
+    {
+        return -1;
+    }
+    fixed_close();
+    return 0;
+}
+
+/***********************************/
+/* Self-Monitoring Thread Counters */
+/***********************************/
+
+/* Counters of one thread. Each event page is mapped so the thread can read
+ * its counters with rdpmc instead of a system call. */
+struct thread_counters
+{
+    int fd[NUM_FIXED];
+    struct perf_event_mmap_page *page[NUM_FIXED];
+};
+
+static __thread struct thread_counters *self = NULL;
+/* 0 if not opened yet, 1 if open, -1 if not available to this thread. */
+static __thread int self_state = 0;
+static pthread_key_t self_key;
+static pthread_once_t self_key_once = PTHREAD_ONCE_INIT;
+static long page_size;
+
+static void close_thread_counters(void *arg)
+{
+    struct thread_counters *c = (struct thread_counters *) arg;
+    int i;
+
+    for (i = NUM_FIXED - 1; i >= 0; i--)
+    {
+        if (c->page[i] != NULL)
+        {
+            munmap(c->page[i], page_size);
+        }
+        if (c->fd[i] >= 0)
+        {
+            close(c->fd[i]);
+        }
+    }
+    free(c);
+}
+
+static void make_self_key(void)
+{
+    page_size = sysconf(_SC_PAGESIZE);
+    pthread_key_create(&self_key, close_thread_counters);
+}
+
+static int open_thread_counters(void)
+{
+    struct perf_event_attr attr;
+    struct thread_counters *c;
+    void *page;
+    int i;
+
+    pthread_once(&self_key_once, make_self_key);
+    self_state = -1;
+    c = (struct thread_counters *) malloc(sizeof(*c));
+    if (c == NULL)
+    {
+        return -1;
+    }
+    for (i = 0; i < NUM_FIXED; i++)
+    {
+        c->fd[i] = -1;
+        c->page[i] = NULL;
+    }
+    for (i = 0; i < NUM_FIXED; i++)
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = fixed_event_config[i];
+        /* User-level counting is allowed without privileges. */
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        c->fd[i] = perf_event_open(&attr, 0, -1, i == 0 ? -1 : c->fd[0],
+                                   PERF_FLAG_FD_CLOEXEC);
+        if (c->fd[i] < 0)
+        {
+            close_thread_counters(c);
+            return -1;
+        }
+        page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, c->fd[i], 0);
+        c->page[i] = page == MAP_FAILED ? NULL : (struct perf_event_mmap_page *) page;
+    }
+    self = c;
+    self_state = 1;
+    pthread_setspecific(self_key, c);
+    return 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t rdpmc(uint32_t counter)
+{
+    uint32_t lo, hi;
+
+    __asm__ volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+    return lo | ((uint64_t)hi << 32);
+}
+#endif
+
+/* Read one counter from its mapped page, following the protocol described in
+ * linux/perf_event.h. Returns -1 if rdpmc cannot be used right now. */
+static int read_mapped_counter(struct perf_event_mmap_page *pc, uint64_t *value)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t seq, idx;
+    uint64_t count;
+    int64_t pmc;
+    unsigned width;
+
+    do
+    {
+        seq = __atomic_load_n(&pc->lock, __ATOMIC_ACQUIRE);
+        idx = pc->index;
+        count = pc->offset;
+        if (!pc->cap_user_rdpmc || idx == 0)
+        {
+            return -1;
+        }
+        width = pc->pmc_width;
+        pmc = rdpmc(idx - 1);
+        pmc <<= 64 - width;
+        pmc >>= 64 - width;
+        count += pmc;
+        __atomic_signal_fence(__ATOMIC_ACQUIRE);
+    }
+    while (__atomic_load_n(&pc->lock, __ATOMIC_ACQUIRE) != seq);
+    *value = count;
+    return 0;
+#else
+    (void)pc;
+    (void)value;
+    return -1;
+#endif
+}
+
+int perf_event_read_thread_counters(struct variorum_thread_counters *counters)
+{
+    uint64_t values[NUM_FIXED];
+    int i;
+
+    if (self_state == 0 && open_thread_counters())
+    {
+        variorum_error_handler("Could not open thread counters with perf_event",
+                               VARIORUM_ERROR_FEATURE_NOT_AVAILABLE,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+    if (self_state < 0)
+    {
+        return -1;
+    }
+    for (i = 0; i < NUM_FIXED; i++)
+    {
+        if (self->page[i] != NULL && read_mapped_counter(self->page[i],
+                &values[i]) == 0)
+        {
+            continue;
+        }
+        /* Not scheduled or rdpmc not allowed: ask the kernel. */
+        if (read(self->fd[i], &values[i], sizeof(uint64_t)) != sizeof(uint64_t))
+        {
+            return -1;
+        }
+    }
+    counters->instructions = values[0];
+    counters->cycles = values[1];
+    counters->ref_cycles = values[2];
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef PERF_EVENT_FEATURES_H_INCLUDE
+#define PERF_EVENT_FEATURES_H_INCLUDE
+
+#include <jansson.h>
+#include <stdio.h>
+
+#include <variorum.h>
+#include <variorum_json_writer.h>
+#include <variorum_region.h>
+
+/// @brief Whether the kernel exposes RAPL energy through the perf_event
+/// power PMU and this process may open it.
+///
+/// @return 1 if available, otherwise 0.
+int perf_event_rapl_available(
+    void
+);
+
+/// @brief Print package and DRAM energy and power of each socket.
+///
+/// @param [in] long_ver Toggle between CSV formatted and long formatted
+///        output.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_get_power(
+    int long_ver
+);
+
+/// @brief Print package and DRAM energy of each socket.
+///
+/// @param [in] long_ver Toggle between CSV formatted and long formatted
+///        output.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_get_energy(
+    int long_ver
+);
+
+/// @brief Add the power of each socket and the node to a JSON object.
+///
+/// @param [out] get_power_obj Node object.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_get_power_json(
+    json_t *get_power_obj
+);
+
+/// @brief Stream the power of each socket and the node into a writer.
+///
+/// @param [in,out] jw JSON writer.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_write_power_json(
+    struct variorum_json_writer *jw
+);
+
+/// @brief Add the energy of each socket and the node to a JSON object.
+///
+/// @param [out] get_energy_obj Node object.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_get_energy_json(
+    json_t *get_energy_obj
+);
+
+/// @brief Add the package and DRAM energy of all sockets to a snapshot.
+///
+/// @param [in,out] counters Snapshot.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_get_energy_counters(
+    struct variorum_energy_counters *counters
+);
+
+/// @brief Print the fixed counters of each hardware thread.
+///
+/// @param [in] long_ver Toggle between CSV formatted and long formatted
+///        output.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_get_counters(
+    int long_ver
+);
+
+/// @brief Start sampling the fixed counters of every hardware thread.
+///
+/// @param [in] events Must be NULL; programmable events need the MSR
+///        backend.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_start_counter_sampling(
+    const char *events
+);
+
+/// @brief Read the fixed counter deltas of every hardware thread since the
+/// previous sample.
+///
+/// @param [out] sample Deltas, valid until the next call.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_sample_counters(
+    struct variorum_counter_sample *sample
+);
+
+/// @brief Close the counters opened by perf_event_start_counter_sampling().
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_stop_counter_sampling(
+    void
+);
+
+/// @brief Read the fixed counters of the calling thread, with rdpmc where
+/// the kernel allows it.
+///
+/// @param [out] counters Counts since the thread's first call.
+///
+/// @return 0 if successful, otherwise -1.
+int perf_event_read_thread_counters(
+    struct variorum_thread_counters *counters
+);
+
+#endif
@@ -35,6 +35,7 @@ void get_temp_target(struct msr_temp_target *s, off_t msr)
         init_tt = 1;
         val = (uint64_t **) malloc(nsockets * sizeof(uint64_t *));
         allocate_batch(TEMP_TARGET, nsockets);
+        set_batch_cache_class(TEMP_TARGET, MSR_CACHE_SLOW);
         load_socket_batch(msr, val, TEMP_TARGET);
     }
 
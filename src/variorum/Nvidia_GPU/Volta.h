@@ -8,6 +8,8 @@
 
 #include <jansson.h>
 
+#include <variorum_region.h>
+
 int volta_get_power(
     int long_ver
 );
@@ -48,4 +50,12 @@ int volta_get_gpu_utilization_json(
     char **get_gpu_util_obj_str
 );
 
+int volta_get_energy_counters(
+    struct variorum_energy_counters *counters
+);
+
+int volta_get_energy_json(
+    json_t *get_energy_obj
+);
+
 #endif
@@ -38,6 +38,8 @@ int set_nvidia_func_ptrs(int idx)
         g_platform[idx].variorum_cap_each_gpu_power_limit =
             volta_cap_each_gpu_power_limit;
         g_platform[idx].variorum_get_power_json = volta_get_power_json;
+        g_platform[idx].variorum_get_energy_json = volta_get_energy_json;
+        g_platform[idx].variorum_get_energy_counters = volta_get_energy_counters;
     }
     else
     {
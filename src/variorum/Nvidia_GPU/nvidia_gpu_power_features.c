@@ -6,6 +6,7 @@
 #include <jansson.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -18,11 +19,36 @@
 #include <cprintf.h>
 #endif
 
+/* Metrics read by nvidia_gpu_read_device(). */
+#define NVIDIA_GPU_POWER       0x01
+#define NVIDIA_GPU_POWER_LIMIT 0x02
+#define NVIDIA_GPU_ENERGY      0x04
+
+/* Power samples the driver keeps between reads, when
+ * VARIORUM_NVIDIA_GPU_POWER_SAMPLES=1. */
+#define NVIDIA_GPU_MAX_POWER_SAMPLES 1024
+
 unsigned m_total_unit_devices;
 nvmlDevice_t *m_unit_devices_file_desc;
 unsigned m_gpus_per_socket;
 char m_hostname[1024];
 
+struct nvidia_gpu_sample
+{
+    /* First NVML call that failed for this device, if any. */
+    nvmlReturn_t ret;
+    /* Metrics that were read. */
+    unsigned valid;
+    /* Power and enforced power limit (mW). */
+    unsigned int power;
+    unsigned int limit;
+    /* Energy since the driver was loaded (mJ). */
+    unsigned long long energy;
+};
+
+/* Set once the driver rejects field value queries, e.g., older drivers. */
+static int m_no_field_values = 0;
+
 void initNVML(void)
 {
     unsigned int d;
@@ -71,10 +97,132 @@ void shutdownNVML(void)
     nvmlShutdown();
 }
 
+/* Integer value of an NVML field or sample. */
+static int nvml_value(nvmlValueType_t type, const nvmlValue_t *value,
+                      unsigned long long *out)
+{
+    switch (type)
+    {
+        case NVML_VALUE_TYPE_UNSIGNED_INT:
+            *out = value->uiVal;
+            break;
+        case NVML_VALUE_TYPE_UNSIGNED_LONG:
+            *out = value->ulVal;
+            break;
+        case NVML_VALUE_TYPE_UNSIGNED_LONG_LONG:
+            *out = value->ullVal;
+            break;
+        case NVML_VALUE_TYPE_SIGNED_LONG_LONG:
+            *out = value->sllVal;
+            break;
+        case NVML_VALUE_TYPE_SIGNED_INT:
+            *out = value->siVal;
+            break;
+        case NVML_VALUE_TYPE_DOUBLE:
+            *out = value->dVal;
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+/* Read the given metrics of device d with one nvmlDeviceGetFieldValues()
+ * call, a single driver round trip, instead of one call per metric. Metrics
+ * the driver does not report as fields (older drivers lack the power fields)
+ * are read with their own NVML call. There is no field for the enforced
+ * power limit, the minimum over all limiters; NVML_FI_DEV_POWER_CURRENT_LIMIT
+ * is only the power management limit, so the limit always uses its own
+ * call. */
+static void nvidia_gpu_read_device(int d, unsigned metrics,
+                                   struct nvidia_gpu_sample *s)
+{
+    nvmlDevice_t dev = m_unit_devices_file_desc[d];
+    nvmlFieldValue_t fields[2];
+    unsigned long long value;
+    unsigned todo;
+    int fields_read;
+    nvmlReturn_t ret = NVML_ERROR_NOT_SUPPORTED;
+    int nfields = 0;
+    int i;
+
+    memset(s, 0, sizeof(*s));
+    memset(fields, 0, sizeof(fields));
+#ifdef NVML_FI_DEV_POWER_AVERAGE
+    if (metrics & NVIDIA_GPU_POWER)
+    {
+        fields[nfields++].fieldId = NVML_FI_DEV_POWER_AVERAGE;
+    }
+#endif
+    if (metrics & NVIDIA_GPU_ENERGY)
+    {
+        fields[nfields++].fieldId = NVML_FI_DEV_TOTAL_ENERGY_CONSUMPTION;
+    }
+
+    if (nfields > 0 && !m_no_field_values)
+    {
+        ret = nvmlDeviceGetFieldValues(dev, nfields, fields);
+        if (ret == NVML_ERROR_NOT_SUPPORTED)
+        {
+            m_no_field_values = 1;
+        }
+    }
+    fields_read = ret == NVML_SUCCESS;
+    if (fields_read)
+    {
+        for (i = 0; i < nfields; i++)
+        {
+            if (fields[i].nvmlReturn != NVML_SUCCESS ||
+                    nvml_value(fields[i].valueType, &fields[i].value, &value))
+            {
+                continue;
+            }
+            switch (fields[i].fieldId)
+            {
+#ifdef NVML_FI_DEV_POWER_AVERAGE
+                case NVML_FI_DEV_POWER_AVERAGE:
+                    s->power = value;
+                    s->valid |= NVIDIA_GPU_POWER;
+                    break;
+#endif
+                case NVML_FI_DEV_TOTAL_ENERGY_CONSUMPTION:
+                    s->energy = value;
+                    s->valid |= NVIDIA_GPU_ENERGY;
+                    break;
+            }
+        }
+    }
+
+    ret = NVML_SUCCESS;
+    todo = metrics & ~s->valid;
+    if (todo & NVIDIA_GPU_POWER)
+    {
+        ret = nvmlDeviceGetPowerUsage(dev, &s->power);
+        s->valid |= ret == NVML_SUCCESS ? NVIDIA_GPU_POWER : 0;
+    }
+    if ((todo & NVIDIA_GPU_POWER_LIMIT) && ret == NVML_SUCCESS)
+    {
+        ret = nvmlDeviceGetEnforcedPowerLimit(dev, &s->limit);
+        s->valid |= ret == NVML_SUCCESS ? NVIDIA_GPU_POWER_LIMIT : 0;
+    }
+    if ((todo & NVIDIA_GPU_ENERGY) && ret == NVML_SUCCESS)
+    {
+        /* A failed energy field means the device has no energy counter, so
+         * only ask again if the fields could not be read at all. */
+        ret = NVML_ERROR_NOT_SUPPORTED;
+        if (!fields_read)
+        {
+            ret = nvmlDeviceGetTotalEnergyConsumption(dev, &s->energy);
+        }
+        s->valid |= ret == NVML_SUCCESS ? NVIDIA_GPU_ENERGY : 0;
+    }
+    s->ret = ret;
+}
+
 //TODO REALLY TEST THIS ONE FOR LIBJUSTIFY
 void nvidia_gpu_get_power_data(int chipid, int verbose, FILE *output)
 {
-    unsigned int power;
+    struct nvidia_gpu_sample sample;
     double value = 0.0;
     int d;
     static int init_output = 0;
@@ -83,8 +231,8 @@ void nvidia_gpu_get_power_data(int chipid, int verbose, FILE *output)
     for (d = chipid * (int)m_gpus_per_socket;
          d < (chipid + 1) * (int)m_gpus_per_socket; ++d)
     {
-        nvmlDeviceGetPowerUsage(m_unit_devices_file_desc[d], &power);
-        value = (double)power * 0.001f;
+        nvidia_gpu_read_device(d, NVIDIA_GPU_POWER, &sample);
+        value = (double)sample.power * 0.001f;
 
         if (verbose)
         {
@@ -209,26 +357,24 @@ void nvidia_gpu_get_thermal_json(int chipid, json_t *output)
 
 void nvidia_gpu_get_power_limits_data(int chipid, int verbose, FILE *output)
 {
-    unsigned int power_limit;
+    struct nvidia_gpu_sample sample;
     double value = 0.0;
     int d;
     static int init_output = 0;
-    nvmlReturn_t result;
 
     /* Iterate over all GPU device handles populated at init and print GPU power limit */
     for (d = chipid * (int)m_gpus_per_socket;
          d < (chipid + 1) * (int)m_gpus_per_socket; ++d)
     {
-        result = nvmlDeviceGetEnforcedPowerLimit(m_unit_devices_file_desc[d],
-                 &power_limit);
-        if (result != NVML_SUCCESS)
+        nvidia_gpu_read_device(d, NVIDIA_GPU_POWER_LIMIT, &sample);
+        if (sample.ret != NVML_SUCCESS)
         {
             variorum_error_handler("Could not query GPU power limit\n",
                                    VARIORUM_ERROR_PLATFORM_ENV,
                                    getenv("HOSTNAME"), __FILE__, __FUNCTION__,
                                    __LINE__);
         }
-        value = (double) power_limit * 0.001f;
+        value = (double) sample.limit * 0.001f;
 
         if (verbose)
         {
@@ -489,7 +635,7 @@ void cap_each_gpu_power_limit(int chipid, unsigned int powerlimit)
 
 void nvidia_gpu_get_power_json(int chipid, json_t *get_power_obj)
 {
-    unsigned int gpu_power;
+    struct nvidia_gpu_sample sample;
     double value = 0.0;
     double total_gpu_power = 0.0;
     int d;
@@ -516,8 +662,8 @@ void nvidia_gpu_get_power_json(int chipid, json_t *get_power_obj)
     for (d = chipid * (int)m_gpus_per_socket;
          d < (chipid + 1) * (int)m_gpus_per_socket; ++d)
     {
-        nvmlDeviceGetPowerUsage(m_unit_devices_file_desc[d], &gpu_power);
-        value = (double)gpu_power * 0.001f;
+        nvidia_gpu_read_device(d, NVIDIA_GPU_POWER, &sample);
+        value = (double)sample.power * 0.001f;
         snprintf(devID, devIDlen, "GPU_%d", d);
         json_object_set_new(gpu_obj, devID, json_real(value));
         total_gpu_power += value;
@@ -540,3 +686,196 @@ void nvidia_gpu_get_power_json(int chipid, json_t *get_power_obj)
 
 }
 
+
+/* Integrated energy of a device without an energy counter. */
+struct nvidia_gpu_energy_state
+{
+    double joules;
+    /* Time of the last power read. */
+    struct timeval last;
+    /* Timestamp (us) and power (mW) of the last driver power sample. */
+    unsigned long long last_sample_us;
+    unsigned int last_sample_mw;
+};
+
+/* Integrate the power samples the driver took since the last call, about
+ * every 20 ms, so the energy does not depend on how often Variorum reads. */
+static int nvidia_gpu_drain_power_samples(int d,
+        struct nvidia_gpu_energy_state *st)
+{
+    static nvmlSample_t *samples = NULL;
+    static unsigned int max_samples = 0;
+    nvmlValueType_t type;
+    unsigned int count, i;
+    unsigned long long ts, mw;
+    nvmlReturn_t ret;
+
+    if (samples == NULL)
+    {
+        ret = nvmlDeviceGetSamples(m_unit_devices_file_desc[d],
+                                   NVML_TOTAL_POWER_SAMPLES, 0, &type,
+                                   &max_samples, NULL);
+        if (ret != NVML_SUCCESS || max_samples == 0)
+        {
+            return -1;
+        }
+        if (max_samples > NVIDIA_GPU_MAX_POWER_SAMPLES)
+        {
+            max_samples = NVIDIA_GPU_MAX_POWER_SAMPLES;
+        }
+        samples = (nvmlSample_t *) malloc(max_samples * sizeof(nvmlSample_t));
+        if (samples == NULL)
+        {
+            return -1;
+        }
+    }
+
+    count = max_samples;
+    ret = nvmlDeviceGetSamples(m_unit_devices_file_desc[d],
+                               NVML_TOTAL_POWER_SAMPLES, st->last_sample_us,
+                               &type, &count, samples);
+    if (ret == NVML_ERROR_NOT_FOUND)
+    {
+        /* No new samples. */
+        return 0;
+    }
+    if (ret != NVML_SUCCESS)
+    {
+        return -1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ts = samples[i].timeStamp;
+        if (ts <= st->last_sample_us)
+        {
+            continue;
+        }
+        if (nvml_value(type, &samples[i].sampleValue, &mw))
+        {
+            return -1;
+        }
+        if (st->last_sample_us != 0)
+        {
+            st->joules += st->last_sample_mw * 0.001 *
+                          (ts - st->last_sample_us) / 1000000.0;
+        }
+        st->last_sample_us = ts;
+        st->last_sample_mw = mw;
+    }
+    return 0;
+}
+
+/* Energy of a device since an arbitrary origin (J). Volta and newer GPUs
+ * count energy in the driver, so the difference of two reads is exact no
+ * matter how often the power changed in between. Older GPUs have no counter;
+ * their power is integrated instead, from the driver's power samples when
+ * VARIORUM_NVIDIA_GPU_POWER_SAMPLES=1, otherwise over the time between
+ * reads. Energy and power come from the same field value query. */
+static double nvidia_gpu_device_energy(int d)
+{
+    static struct nvidia_gpu_energy_state *state = NULL;
+    static unsigned ndevices = 0;
+    struct nvidia_gpu_energy_state *st;
+    struct nvidia_gpu_sample sample;
+    struct timeval now;
+    char *val;
+
+    nvidia_gpu_read_device(d, NVIDIA_GPU_ENERGY | NVIDIA_GPU_POWER, &sample);
+    if (sample.valid & NVIDIA_GPU_ENERGY)
+    {
+        return sample.energy * 0.001;
+    }
+
+    if (ndevices < m_total_unit_devices)
+    {
+        free(state);
+        ndevices = m_total_unit_devices;
+        state = (struct nvidia_gpu_energy_state *) calloc(ndevices,
+                sizeof(struct nvidia_gpu_energy_state));
+        if (state == NULL)
+        {
+            ndevices = 0;
+            return 0.0;
+        }
+    }
+    st = &state[d];
+
+    val = getenv("VARIORUM_NVIDIA_GPU_POWER_SAMPLES");
+    if (val != NULL && atoi(val) == 1 &&
+            nvidia_gpu_drain_power_samples(d, st) == 0)
+    {
+        return st->joules;
+    }
+
+    if (!(sample.valid & NVIDIA_GPU_POWER))
+    {
+        variorum_error_handler("Could not query GPU energy or power",
+                               VARIORUM_ERROR_PLATFORM_ENV, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return st->joules;
+    }
+    gettimeofday(&now, NULL);
+    if (st->last.tv_sec != 0)
+    {
+        st->joules += sample.power * 0.001 *
+                      ((now.tv_sec - st->last.tv_sec) +
+                       (now.tv_usec - st->last.tv_usec) / 1000000.0);
+    }
+    st->last = now;
+    return st->joules;
+}
+
+int nvidia_gpu_get_energy_counters(struct variorum_energy_counters *counters)
+{
+    unsigned d;
+
+    for (d = 0; d < m_total_unit_devices; d++)
+    {
+        counters->gpu_joules += nvidia_gpu_device_energy(d);
+    }
+    return 0;
+}
+
+void nvidia_gpu_get_energy_json(int chipid, json_t *get_energy_obj)
+{
+    double value = 0.0;
+    double total_gpu_energy = 0.0;
+    int d;
+    char devID[24];
+    char socket_id[12];
+    snprintf(socket_id, 12, "socket_%d", chipid);
+
+    //try to find socket object in node object, set new object if not found
+    json_t *socket_obj = json_object_get(get_energy_obj, socket_id);
+    if (socket_obj == NULL)
+    {
+        socket_obj = json_object();
+        json_object_set_new(get_energy_obj, socket_id, socket_obj);
+    }
+
+    //create new json object for GPU
+    json_t *gpu_obj = json_object();
+    json_object_set_new(socket_obj, "energy_gpu_joules", gpu_obj);
+
+    for (d = chipid * (int)m_gpus_per_socket;
+         d < (chipid + 1) * (int)m_gpus_per_socket; ++d)
+    {
+        value = nvidia_gpu_device_energy(d);
+        snprintf(devID, sizeof(devID), "GPU_%d", d);
+        json_object_set_new(gpu_obj, devID, json_real(value));
+        total_gpu_energy += value;
+    }
+
+    // If we have an existing CPU object with energy_node_joules, update its
+    // value, as for power above.
+#ifndef VARIORUM_WITH_IBM_CPU
+    if (json_object_get(get_energy_obj, "energy_node_joules") != NULL)
+    {
+        double energy_node;
+        energy_node = json_real_value(json_object_get(get_energy_obj,
+                                      "energy_node_joules"));
+        json_object_set_new(get_energy_obj, "energy_node_joules",
+                            json_real(energy_node + total_gpu_energy));
+    }
+#endif
+}
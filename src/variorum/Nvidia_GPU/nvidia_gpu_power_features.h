@@ -13,6 +13,8 @@
 #include <string.h>
 #include <sys/time.h>
 
+#include <variorum_region.h>
+
 extern unsigned m_total_unit_devices;
 extern nvmlDevice_t *m_unit_devices_file_desc;
 extern unsigned m_gpus_per_socket;
@@ -82,4 +84,13 @@ void nvidia_gpu_get_power_json(
     json_t *output
 );
 
+int nvidia_gpu_get_energy_counters(
+    struct variorum_energy_counters *counters
+);
+
+void nvidia_gpu_get_energy_json(
+    int chipid,
+    json_t *output
+);
+
 #endif
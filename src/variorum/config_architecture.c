@@ -5,6 +5,7 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +14,7 @@
 #include <config_architecture.h>
 #include <variorum_config.h>
 #include <variorum_error.h>
+#include <variorum_self_stats.h>
 #include <variorum_topology.h>
 
 #ifdef VARIORUM_WITH_INTEL_CPU
@@ -62,10 +64,42 @@ int P_MSR_CORE_IDX;
 
 struct platform g_platform[MAX_PLATFORMS];
 
+unsigned long g_variorum_exits = 0;
+
+/* Serializes API calls across threads. Recursive, since API calls nest. */
+static pthread_mutex_t api_lock;
+static pthread_once_t api_lock_once = PTHREAD_ONCE_INIT;
+
+static void api_lock_init(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&api_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void variorum_lock(void)
+{
+    pthread_once(&api_lock_once, api_lock_init);
+    pthread_mutex_lock(&api_lock);
+}
+
+void variorum_unlock(void)
+{
+    pthread_mutex_unlock(&api_lock);
+}
+
 int variorum_enter(const char *filename, const char *func_name, int line_num)
 {
     int err = 0;
     int i;
+    uint64_t t0;
+
+    /* Held until variorum_exit(), or released here on failure. */
+    variorum_lock();
+    t0 = variorum_self_ticks();
 
     char *val = getenv("VARIORUM_LOG");
     if (val != NULL && atoi(val) == 1)
@@ -74,6 +108,7 @@ int variorum_enter(const char *filename, const char *func_name, int line_num)
         printf("Number of registered platforms: %d\n", P_NUM_PLATFORMS);
     }
 
+    variorum_self_stats_init();
     variorum_init_func_ptrs();
 
     //Triggers initialization on first call.  Errors assert.
@@ -88,6 +123,8 @@ int variorum_enter(const char *filename, const char *func_name, int line_num)
         variorum_error_handler("Cannot detect architecture", err,
                                getenv("HOSTNAME"), __FILE__, __FUNCTION__,
                                __LINE__);
+        VARIORUM_SELF_STATS_TIME(enter, t0);
+        variorum_unlock();
         return err;
     }
     // Sets function pointers on all platforms
@@ -97,8 +134,11 @@ int variorum_enter(const char *filename, const char *func_name, int line_num)
         variorum_error_handler("Cannot set function pointers", err,
                                getenv("HOSTNAME"), __FILE__, __FUNCTION__,
                                __LINE__);
+        VARIORUM_SELF_STATS_TIME(enter, t0);
+        variorum_unlock();
         return err;
     }
+    VARIORUM_SELF_STATS_TIME(enter, t0);
     return err;
 }
 
@@ -114,15 +154,16 @@ int variorum_exit(const char *filename, const char *func_name, int line_num)
     }
 
 #ifdef VARIORUM_WITH_INTEL_CPU
-    err = finalize_msr();
-    if (err)
+    if (intel_cpu_backend() == INTEL_CPU_BACKEND_MSR)
     {
-        return err;
+        err = finalize_msr();
+        if (err)
+        {
+            variorum_unlock();
+            return err;
+        }
     }
 #endif
-#ifdef VARIORUM_WITH_AMD_CPU
-    esmi_exit();
-#endif
 #ifdef VARIORUM_WITH_NVIDIA_GPU
     shutdownNVML();
 #endif
@@ -134,6 +175,8 @@ int variorum_exit(const char *filename, const char *func_name, int line_num)
     {
         free(g_platform[i].arch_id);
     }
+    g_variorum_exits++;
+    variorum_unlock();
 
     return err;
 }
@@ -342,6 +385,7 @@ void variorum_init_func_ptrs()
         g_platform[i].variorum_cap_gpu_power_ratio = NULL;
         g_platform[i].variorum_cap_each_socket_power_limit = NULL;
         g_platform[i].variorum_cap_each_core_frequency_limit = NULL;
+        g_platform[i].variorum_cap_cpu_frequency_targets = NULL;
         g_platform[i].variorum_print_available_frequencies = NULL;
         g_platform[i].variorum_cap_each_gpu_power_limit = NULL;
         g_platform[i].variorum_print_features = NULL;
@@ -361,7 +405,17 @@ void variorum_init_func_ptrs()
         g_platform[i].variorum_print_energy = NULL;
         g_platform[i].variorum_get_thermals_json = NULL;
         g_platform[i].variorum_get_frequency_json = NULL;
+        g_platform[i].variorum_write_power_json = NULL;
+        g_platform[i].variorum_write_frequency_json = NULL;
+        g_platform[i].variorum_start_counter_sampling = NULL;
+        g_platform[i].variorum_sample_counters = NULL;
+        g_platform[i].variorum_stop_counter_sampling = NULL;
+        g_platform[i].variorum_start_energy_window = NULL;
+        g_platform[i].variorum_stop_energy_window = NULL;
+        g_platform[i].variorum_get_energy_counters = NULL;
         g_platform[i].variorum_get_energy_json = NULL;
+        g_platform[i].variorum_sample_core_power = NULL;
+        g_platform[i].variorum_get_core_power_json = NULL;
     }
 }
 
@@ -370,12 +424,23 @@ int variorum_set_func_ptrs()
     int err = 0;
 
 #ifdef VARIORUM_WITH_INTEL_CPU
-    err = set_intel_func_ptrs(P_INTEL_CPU_IDX);
-    if (err)
+    if (intel_cpu_backend() == INTEL_CPU_BACKEND_POWERCAP)
     {
-        return err;
+        err = set_intel_powercap_func_ptrs(P_INTEL_CPU_IDX);
+    }
+    else if (intel_cpu_backend() == INTEL_CPU_BACKEND_PERF_EVENT)
+    {
+        err = set_intel_perf_event_func_ptrs(P_INTEL_CPU_IDX);
+    }
+    else
+    {
+        err = set_intel_func_ptrs(P_INTEL_CPU_IDX);
+        if (err)
+        {
+            return err;
+        }
+        err = init_msr();
     }
-    err = init_msr();
 #endif
 #ifdef VARIORUM_WITH_INTEL_GPU
     err = set_intel_gpu_func_ptrs(P_INTEL_GPU_IDX);
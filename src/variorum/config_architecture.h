@@ -12,6 +12,13 @@
 
 #include <jansson.h>
 
+#include <variorum_json_writer.h>
+
+struct variorum_counter_sample;
+struct variorum_energy_window;
+struct variorum_energy_counters;
+struct variorum_core_power_sample;
+
 /// @brief Create a mask from bit m to n (63 >= m >= n >= 0).
 ///
 /// Example: MASK_RANGE(4,2) --> (((1<<((4)-(2)+1))-1)<<(2))
@@ -172,6 +179,17 @@ struct platform
 
     int (*variorum_cap_each_core_frequency_limit)(int core_freq_mhz);
 
+    /// @brief Function pointer to request a frequency for each of a set of
+    /// logical CPUs.
+    ///
+    /// @param [in] ncpus Number of CPUs.
+    /// @param [in] cpus Logical CPU identifiers.
+    /// @param [in] cpu_freq_mhz Desired frequency of each CPU in MHz.
+    ///
+    /// @return Error code.
+    int (*variorum_cap_cpu_frequency_targets)(int ncpus, const int *cpus,
+            const int *cpu_freq_mhz);
+
     /// @brief Cap the power usage identically of each GPU on the node.
     ///
     /// @param [in] gpu_power_limit Desired power limit in watts for each GPU
@@ -263,6 +281,53 @@ struct platform
     /// @return Error code.
     int (*variorum_get_frequency_json)(json_t *get_clock_obj_json);
 
+    /// @brief Function pointer to stream node power data as JSON members
+    /// into a writer, without building a JSON object.
+    ///
+    /// @return Error code.
+    int (*variorum_write_power_json)(struct variorum_json_writer *jw);
+
+    /// @brief Function pointer to stream frequency information as JSON
+    /// members into a writer, without building a JSON object.
+    ///
+    /// @return Error code.
+    int (*variorum_write_frequency_json)(struct variorum_json_writer *jw);
+
+    /// @brief Function pointer to program events for counter sampling.
+    ///
+    /// @param [in] events Comma-separated event names, or NULL for the
+    ///        model default.
+    ///
+    /// @return Error code.
+    int (*variorum_start_counter_sampling)(const char *events);
+
+    /// @brief Function pointer to read per-thread counter deltas.
+    ///
+    /// @return Error code.
+    int (*variorum_sample_counters)(struct variorum_counter_sample *sample);
+
+    /// @brief Function pointer to stop counter sampling.
+    ///
+    /// @return Error code.
+    int (*variorum_stop_counter_sampling)(void);
+
+    /// @brief Function pointer to start a precision energy window.
+    ///
+    /// @return Error code.
+    int (*variorum_start_energy_window)(void);
+
+    /// @brief Function pointer to end a precision energy window.
+    ///
+    /// @return Error code.
+    int (*variorum_stop_energy_window)(struct variorum_energy_window *window);
+
+    /// @brief Function pointer to add the cumulative energy of the
+    /// platform's domains to a snapshot.
+    ///
+    /// @return Error code.
+    int (*variorum_get_energy_counters)(struct variorum_energy_counters
+                                        *counters);
+
     /// @brief Function pointer to get JSON object for thermal information
     ///
     /// @return Error code.
@@ -283,6 +348,16 @@ struct platform
     /// @return Error code.
     int (*variorum_get_energy_json)(json_t *get_energy_obj);
 
+    /// @brief Function pointer to sample per-core energy and power.
+    ///
+    /// @return Error code.
+    int (*variorum_sample_core_power)(struct variorum_core_power_sample *sample);
+
+    /// @brief Function pointer to get JSON object for per-core power.
+    ///
+    /// @return Error code.
+    int (*variorum_get_core_power_json)(json_t *get_core_power_obj);
+
     /// @brief Identifier for architecture.
     uint64_t *arch_id;
     /// @brief Hostname.
@@ -311,6 +386,17 @@ extern struct platform g_platform[2];
 // across Intel and AMD platforms.
 extern int P_MSR_CORE_IDX;
 
+// Number of completed variorum_exit() calls. Callers that keep the platform
+// entered across API calls (e.g., region profiling) re-enter when it changes.
+extern unsigned long g_variorum_exits;
+
+// Library-wide recursive lock serializing API calls across threads.
+// variorum_enter() takes it and variorum_exit() releases it, so every
+// successful enter must be paired with an exit.
+void variorum_lock(void);
+
+void variorum_unlock(void);
+
 int variorum_enter(
     const char *filename,
     const char *func_name,
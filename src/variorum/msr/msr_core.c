@@ -17,11 +17,90 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <msr_core.h>
+#include <msr_readers.h>
 #include <config_architecture.h>
 #include <variorum_error.h>
+#include <variorum_sample_plan.h>
+#include <variorum_self_stats.h>
+
+/* Batches merged into one read per sample, see sample_plan_begin(). */
+static struct
+{
+    struct variorum_sample_plan plan;
+    int subscribed[SAMPLE_PLAN];
+    unsigned numops[SAMPLE_PLAN];
+    int compiled;
+    int active;
+    /* Per-socket shares of the merged batch when sampler threads are used,
+     * and the merged index of each of their operations. */
+    unsigned nsockets;
+    struct msr_batch_array *socket_batch;
+    unsigned **socket_idx;
+} sample;
+
+/* Cached batches, see set_batch_cache_class(). */
+static struct
+{
+    int cache_class;
+    int valid;
+    uint64_t stamp_ms;
+} batch_cache[SAMPLE_PLAN];
+
+static uint64_t cache_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static uint64_t cache_ttl_ms(void)
+{
+    static int init = 0;
+    static uint64_t ttl = MSR_CACHE_DEFAULT_TTL_MS;
+
+    if (!init)
+    {
+        char *val = getenv("VARIORUM_MSR_CACHE_TTL_MS");
+        init = 1;
+        if (val != NULL && atoi(val) >= 0)
+        {
+            ttl = (uint64_t)atoi(val);
+        }
+    }
+    return ttl;
+}
+
+static int batch_cache_hit(const int batchnum)
+{
+    if (batchnum < 0 || batchnum >= SAMPLE_PLAN ||
+            batch_cache[batchnum].cache_class == MSR_CACHE_VOLATILE ||
+            !batch_cache[batchnum].valid)
+    {
+        return 0;
+    }
+    if (batch_cache[batchnum].cache_class == MSR_CACHE_SLOW && cache_ttl_ms() > 0 &&
+            cache_now_ms() - batch_cache[batchnum].stamp_ms >= cache_ttl_ms())
+    {
+        batch_cache[batchnum].valid = 0;
+        return 0;
+    }
+    return 1;
+}
+
+static void batch_cache_fill(const int batchnum)
+{
+    if (batchnum >= 0 && batchnum < SAMPLE_PLAN &&
+            batch_cache[batchnum].cache_class != MSR_CACHE_VOLATILE)
+    {
+        batch_cache[batchnum].valid = 1;
+        batch_cache[batchnum].stamp_ms = cache_now_ms();
+    }
+}
 
 static uint64_t devidx(unsigned socket, unsigned core, unsigned thread)
 {
@@ -93,18 +172,43 @@ static int batch_storage(struct msr_batch_array **batchsel, const int batchnum,
     return 0;
 }
 
-static int compatibility_batch(int batchnum, int type)
+/* Write-through: drop every cached batch holding the written register.
+ * Socket-scope registers are written through core 0 but read on the socket's
+ * reader CPU, see load_socket_batch(), so a write invalidates the register on
+ * every processor of the same socket. */
+static void batch_cache_invalidate(unsigned cpu, off_t msr)
 {
     struct msr_batch_array *batch = NULL;
+    unsigned socket = cpu_socket(cpu);
+    unsigned i;
+    int b;
+
+    for (b = 0; b < SAMPLE_PLAN; b++)
+    {
+        if (!batch_cache[b].valid)
+        {
+            continue;
+        }
+        batch_storage(&batch, b, NULL);
+        for (i = 0; i < batch->numops; i++)
+        {
+            if (batch->ops[i].msr == (__u32)msr &&
+                    cpu_socket(batch->ops[i].cpu) == socket)
+            {
+                batch_cache[b].valid = 0;
+                break;
+            }
+        }
+    }
+}
+
+static int compatibility_batch(struct msr_batch_array *batch, int type)
+{
     int i;
 
     fprintf(stderr,
             "Warning: <variorum> No /dev/cpu/msr_batch, using compatibility batch: compatibility_batch(): %s: %s:%s::%d\n",
             strerror(errno), getenv("HOSTNAME"), __FILE__, __LINE__);
-    if (batch_storage(&batch, batchnum, NULL))
-    {
-        return -1;
-    }
     for (i = 0; i < (int)batch->numops; i++)
     {
         if (type == BATCH_READ)
@@ -162,40 +266,33 @@ static int *core_fd(const unsigned dev_idx)
     return NULL;
 }
 
-static int do_batch_op(int batchnum, int type)
+static int batch_fd(void)
 {
     static int batchfd = 0;
-    struct msr_batch_array *batch = NULL;
-    int res, i, j;
 
     if (batchfd == 0)
     {
+        VARIORUM_SELF_STATS_SYSCALLS(1);
         if ((batchfd = open(MSR_BATCH_PATH, O_RDWR)) < 0)
         {
             perror(MSR_BATCH_PATH);
             batchfd = -1;
         }
     }
+    return batchfd;
+}
+
+int do_batch_array(struct msr_batch_array *batch, int type)
+{
+    int batchfd = batch_fd();
+    int res, i, j;
+
 #ifdef USE_NO_BATCH
-    return compatibility_batch(batchnum, type);
+    return compatibility_batch(batch, type);
 #endif
     if (batchfd < 0)
     {
-        return compatibility_batch(batchnum, type);
-    }
-    if (batch_storage(&batch, batchnum, NULL))
-    {
-        return -1;
-    }
-#ifdef BATCH_DEBUG
-    fprintf(stderr, "BATCH %d: %s MSRs, numops %u\n", batchnum,
-            (type == BATCH_READ ? "reading" : "writing"), batch->numops);
-#endif
-    if (batch->numops <= 0)
-    {
-        variorum_error_handler("Using empty batch", VARIORUM_ERROR_MSR_BATCH,
-                               getenv("HOSTNAME"), __FILE__, __FUNCTION__, __LINE__);
-        return -1;
+        return compatibility_batch(batch, type);
     }
 
     /* If current flag is the opposite type, switch the flags. */
@@ -208,6 +305,7 @@ static int do_batch_op(int batchnum, int type)
             batch->ops[j].isrdmsr = readflag;
         }
     }
+    VARIORUM_SELF_STATS_SYSCALLS(1);
     res = ioctl(batchfd, X86_IOC_MSR_BATCH, batch);
     if (res < 0)
     {
@@ -223,6 +321,29 @@ static int do_batch_op(int batchnum, int type)
         }
         return res;
     }
+    return 0;
+}
+
+static int do_batch_op(int batchnum, int type)
+{
+    struct msr_batch_array *batch = NULL;
+    int res;
+
+    if (batch_storage(&batch, batchnum, NULL))
+    {
+        return -1;
+    }
+#ifdef BATCH_DEBUG
+    fprintf(stderr, "BATCH %d: %s MSRs, numops %u\n", batchnum,
+            (type == BATCH_READ ? "reading" : "writing"), batch->numops);
+#endif
+    if (batch->numops <= 0)
+    {
+        variorum_error_handler("Using empty batch", VARIORUM_ERROR_MSR_BATCH,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    res = do_batch_array(batch, type);
 #ifdef BATCH_DEBUG
     int k;
     for (k = 0; k < batch->numops; k++)
@@ -232,7 +353,7 @@ static int do_batch_op(int batchnum, int type)
                 &batch->ops[k].msrdata);
     }
 #endif
-    return 0;
+    return res;
 }
 
 int sockets_assert(const unsigned *socket)
@@ -544,6 +665,7 @@ int read_msr_by_idx(int dev_idx, off_t msr, uint64_t *val)
     fprintf(stderr, "%s %s::%d (read_msr_by_idx) msr=%lu (0x%lx)\n",
             getenv("HOSTNAME"), __FILE__, __LINE__, msr, msr);
 #endif
+    VARIORUM_SELF_STATS_SYSCALLS(1);
     rc = pread(*file_descriptor, (void *)val, (size_t)sizeof(uint64_t), msr);
     if (rc != sizeof(uint64_t))
     {
@@ -573,7 +695,9 @@ int write_msr_by_idx(int dev_idx, off_t msr, uint64_t val)
     fprintf(stderr, "%s %s::%d (write_msr_by_idx) msr=%lu (0x%lx)\n",
             getenv("HOSTNAME"), __FILE__, __LINE__, msr, msr);
 #endif
+    VARIORUM_SELF_STATS_SYSCALLS(1);
     rc = pwrite(*file_descriptor, &val, (size_t)sizeof(uint64_t), msr);
+    batch_cache_invalidate(dev_idx, msr);
     if (rc != sizeof(uint64_t))
     {
         sprintf(variorum_error_msg, "Pwrite failed on dev_idx %d", dev_idx);
@@ -622,13 +746,38 @@ int allocate_batch(int batchnum, size_t bsize)
 
 int load_socket_batch(off_t msr, uint64_t **val, int batchnum)
 {
-    unsigned dev_idx, val_idx;
-    unsigned nsockets, ncores, nthreads;
+    unsigned socket;
+    unsigned nsockets;
 #ifdef VARIORUM_WITH_AMD_CPU
-    variorum_get_topology(&nsockets, &ncores, &nthreads, P_MSR_CORE_IDX);
+    variorum_get_topology(&nsockets, NULL, NULL, P_MSR_CORE_IDX);
 #endif
 #ifdef VARIORUM_WITH_INTEL_CPU
-    variorum_get_topology(&nsockets, &ncores, &nthreads, P_MSR_CORE_IDX);
+    variorum_get_topology(&nsockets, NULL, NULL, P_MSR_CORE_IDX);
+#endif
+
+    if (val == NULL)
+    {
+        variorum_error_handler("Given uninitialized array", VARIORUM_ERROR_MSR_BATCH,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__, __LINE__);
+        return VARIORUM_ERROR_MSR_BATCH;
+    }
+
+    for (socket = 0; socket < nsockets; socket++)
+    {
+        create_batch_op(msr, socket_reader_cpu(socket), &val[socket], batchnum);
+    }
+    return 0;
+}
+
+int load_socket_core_batch(off_t msr, uint64_t **val, int batchnum)
+{
+    unsigned socket;
+    unsigned nsockets;
+#ifdef VARIORUM_WITH_AMD_CPU
+    variorum_get_topology(&nsockets, NULL, NULL, P_MSR_CORE_IDX);
+#endif
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(&nsockets, NULL, NULL, P_MSR_CORE_IDX);
 #endif
 
     if (val == NULL)
@@ -638,11 +787,9 @@ int load_socket_batch(off_t msr, uint64_t **val, int batchnum)
         return VARIORUM_ERROR_MSR_BATCH;
     }
 
-    for (dev_idx = 0, val_idx = 0; dev_idx < ncores;
-         dev_idx += ncores / nsockets, val_idx++)
+    for (socket = 0; socket < nsockets; socket++)
     {
-        create_batch_op(msr, dev_idx, &val[val_idx % (nsockets * (nthreads / ncores))],
-                        batchnum);
+        create_batch_op(msr, devidx(socket, 0, 0), &val[socket], batchnum);
     }
     return 0;
 }
@@ -678,13 +825,337 @@ int load_thread_batch(off_t msr, uint64_t **val, int batchnum)
 
 int read_batch(const int batchnum)
 {
-    int err = do_batch_op(batchnum, BATCH_READ);
+    uint64_t t0;
+    int err;
+
+    /* Already read as part of the current sample, or still cached. */
+    if (sample.active && batchnum >= 0 && batchnum < SAMPLE_PLAN &&
+            sample.subscribed[batchnum])
+    {
+        return 0;
+    }
+    if (batch_cache_hit(batchnum))
+    {
+        return 0;
+    }
+    t0 = variorum_self_ticks();
+    err = do_batch_op(batchnum, BATCH_READ);
+    if (!err)
+    {
+        batch_cache_fill(batchnum);
+    }
+    VARIORUM_SELF_STATS_TIME(batch, t0);
     return err;
 }
 
 int write_batch(const int batchnum)
 {
-    return do_batch_op(batchnum, BATCH_WRITE);
+    struct msr_batch_array *batch = NULL;
+    uint64_t t0 = variorum_self_ticks();
+    int err = do_batch_op(batchnum, BATCH_WRITE);
+    unsigned i;
+
+    VARIORUM_SELF_STATS_TIME(batch, t0);
+    if (batch_storage(&batch, batchnum, NULL) == 0)
+    {
+        for (i = 0; i < batch->numops; i++)
+        {
+            batch_cache_invalidate(batch->ops[i].cpu, batch->ops[i].msr);
+        }
+    }
+    return err;
+}
+
+int write_batch_selected(const int batchnum, const unsigned char *selected)
+{
+    struct msr_batch_array *batch = NULL;
+    struct msr_batch_array subset;
+    uint64_t t0;
+    unsigned i;
+    int err;
+
+    if (batch_storage(&batch, batchnum, NULL) || batch->numops == 0)
+    {
+        return -1;
+    }
+    subset.ops = (struct msr_batch_op *) malloc(batch->numops * sizeof(
+                     struct msr_batch_op));
+    if (subset.ops == NULL)
+    {
+        return -1;
+    }
+    subset.numops = 0;
+    for (i = 0; i < batch->numops; i++)
+    {
+        if (selected[i])
+        {
+            subset.ops[subset.numops++] = batch->ops[i];
+        }
+    }
+    if (subset.numops == 0)
+    {
+        free(subset.ops);
+        return 0;
+    }
+    t0 = variorum_self_ticks();
+    err = do_batch_array(&subset, BATCH_WRITE);
+    VARIORUM_SELF_STATS_TIME(batch, t0);
+    for (i = 0; i < subset.numops; i++)
+    {
+        batch_cache_invalidate(subset.ops[i].cpu, subset.ops[i].msr);
+    }
+    free(subset.ops);
+    return err;
+}
+
+int set_batch_cache_class(const int batchnum, int cache_class)
+{
+    if (batchnum < 0 || batchnum >= SAMPLE_PLAN ||
+            cache_class < MSR_CACHE_VOLATILE || cache_class > MSR_CACHE_INVARIANT)
+    {
+        variorum_error_handler("Invalid batch cache class", VARIORUM_ERROR_MSR_BATCH,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    batch_cache[batchnum].cache_class = cache_class;
+    batch_cache[batchnum].valid = 0;
+    return 0;
+}
+
+static void free_sample_plan_split(void)
+{
+    unsigned s;
+
+    for (s = 0; s < sample.nsockets; s++)
+    {
+        free(sample.socket_batch[s].ops);
+        free(sample.socket_idx[s]);
+    }
+    free(sample.socket_batch);
+    free(sample.socket_idx);
+    sample.socket_batch = NULL;
+    sample.socket_idx = NULL;
+    sample.nsockets = 0;
+}
+
+/* Split the merged batch by socket, so each socket sampler thread issues the
+ * operations of its own socket. */
+static int split_sample_plan(const struct msr_batch_array *merged)
+{
+    unsigned i, s;
+
+#ifdef VARIORUM_WITH_AMD_CPU
+    variorum_get_topology(&sample.nsockets, NULL, NULL, P_MSR_CORE_IDX);
+#endif
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(&sample.nsockets, NULL, NULL, P_MSR_CORE_IDX);
+#endif
+    sample.socket_batch = (struct msr_batch_array *) calloc(sample.nsockets,
+                          sizeof(struct msr_batch_array));
+    sample.socket_idx = (unsigned **) calloc(sample.nsockets, sizeof(unsigned *));
+    if (sample.socket_batch == NULL || sample.socket_idx == NULL)
+    {
+        return -1;
+    }
+    for (s = 0; s < sample.nsockets; s++)
+    {
+        sample.socket_batch[s].ops = (struct msr_batch_op *) malloc(
+                                         merged->numops * sizeof(struct msr_batch_op));
+        sample.socket_idx[s] = (unsigned *) malloc(merged->numops * sizeof(unsigned));
+        if (sample.socket_batch[s].ops == NULL || sample.socket_idx[s] == NULL)
+        {
+            return -1;
+        }
+    }
+    for (i = 0; i < merged->numops; i++)
+    {
+        struct msr_batch_array *share;
+
+        s = cpu_socket(merged->ops[i].cpu);
+        share = &sample.socket_batch[s];
+        sample.socket_idx[s][share->numops] = i;
+        share->ops[share->numops++] = merged->ops[i];
+    }
+    return 0;
+}
+
+static int read_sample_plan_by_socket(struct msr_batch_array *merged)
+{
+    unsigned i, s;
+    int err;
+
+    /* Open the batch device before the threads share it. */
+    if (batch_fd() < 0)
+    {
+        return -1;
+    }
+    err = run_socket_readers(sample.socket_batch, BATCH_READ);
+    if (err)
+    {
+        return err;
+    }
+    for (s = 0; s < sample.nsockets; s++)
+    {
+        for (i = 0; i < sample.socket_batch[s].numops; i++)
+        {
+            merged->ops[sample.socket_idx[s][i]].msrdata =
+                sample.socket_batch[s].ops[i].msrdata;
+        }
+    }
+    return 0;
+}
+
+static int compile_sample_plan(void)
+{
+    struct msr_batch_array *batch = NULL;
+    struct msr_batch_op *ops;
+    int b, nregs;
+    unsigned i;
+
+    sample.compiled = 0;
+    variorum_sample_plan_free(&sample.plan);
+    free_sample_plan_split();
+    for (b = 0; b < SAMPLE_PLAN; b++)
+    {
+        if (!sample.subscribed[b])
+        {
+            continue;
+        }
+        if (batch_storage(&batch, b, NULL))
+        {
+            return -1;
+        }
+        for (i = 0; i < batch->numops; i++)
+        {
+            if (variorum_sample_plan_add(&sample.plan, batch->ops[i].cpu,
+                                         batch->ops[i].msr,
+                                         (uint64_t *) &batch->ops[i].msrdata))
+            {
+                return -1;
+            }
+        }
+        sample.numops[b] = batch->numops;
+    }
+
+    nregs = variorum_sample_plan_compile(&sample.plan);
+    if (nregs <= 0)
+    {
+        return -1;
+    }
+    if (batch_storage(&batch, SAMPLE_PLAN, NULL))
+    {
+        return -1;
+    }
+    ops = (struct msr_batch_op *) realloc(batch->ops,
+                                          nregs * sizeof(struct msr_batch_op));
+    if (ops == NULL)
+    {
+        return -1;
+    }
+    memset(ops, 0, nregs * sizeof(struct msr_batch_op));
+    for (i = 0; i < (unsigned)nregs; i++)
+    {
+        ops[i].cpu = (__u16) sample.plan.cpu[i];
+        ops[i].msr = sample.plan.reg[i];
+        ops[i].isrdmsr = (__u8) 1;
+    }
+    batch->ops = ops;
+    batch->numops = nregs;
+    if (socket_readers_enabled() && split_sample_plan(batch))
+    {
+        return -1;
+    }
+    sample.compiled = 1;
+#ifdef BATCH_DEBUG
+    fprintf(stderr, "BATCH: sample plan merged %u ops into %d\n",
+            sample.plan.nslots, nregs);
+#endif
+    return 0;
+}
+
+static int sample_plan_stale(void)
+{
+    struct msr_batch_array *batch = NULL;
+    int b;
+
+    if (!sample.compiled)
+    {
+        return 1;
+    }
+    for (b = 0; b < SAMPLE_PLAN; b++)
+    {
+        if (sample.subscribed[b])
+        {
+            batch_storage(&batch, b, NULL);
+            if (batch->numops != sample.numops[b])
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int sample_plan_subscribe(const int batchnum)
+{
+    if (batchnum < 0 || batchnum >= SAMPLE_PLAN)
+    {
+        variorum_error_handler("Invalid batch for sample plan",
+                               VARIORUM_ERROR_MSR_BATCH, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    if (!sample.subscribed[batchnum])
+    {
+        sample.subscribed[batchnum] = 1;
+        sample.compiled = 0;
+    }
+    return 0;
+}
+
+int sample_plan_begin(void)
+{
+    struct msr_batch_array *batch = NULL;
+    uint64_t t0;
+    int err, b;
+
+    sample.active = 0;
+    if (sample_plan_stale() && compile_sample_plan())
+    {
+        return -1;
+    }
+    batch_storage(&batch, SAMPLE_PLAN, NULL);
+    t0 = variorum_self_ticks();
+    /* Fall back to a single batch if the sampler threads are unavailable. */
+    if (sample.socket_batch == NULL || read_sample_plan_by_socket(batch))
+    {
+        err = do_batch_op(SAMPLE_PLAN, BATCH_READ);
+    }
+    else
+    {
+        err = 0;
+    }
+    VARIORUM_SELF_STATS_TIME(batch, t0);
+    if (err)
+    {
+        return err;
+    }
+    variorum_sample_plan_scatter(&sample.plan, &batch->ops[0].msrdata,
+                                 sizeof(struct msr_batch_op));
+    for (b = 0; b < SAMPLE_PLAN; b++)
+    {
+        if (sample.subscribed[b])
+        {
+            batch_cache_fill(b);
+        }
+    }
+    sample.active = 1;
+    return 0;
+}
+
+void sample_plan_end(void)
+{
+    sample.active = 0;
 }
 
 int create_batch_op(off_t msr, uint64_t cpu, uint64_t **dest,
@@ -717,6 +1188,10 @@ int create_batch_op(off_t msr, uint64_t cpu, uint64_t **dest,
     }
 
     batch->numops++;
+    if (batchnum < SAMPLE_PLAN)
+    {
+        batch_cache[batchnum].valid = 0;
+    }
 #ifdef BATCH_DEBUG
     printf("create_batch_op: batchnum = %d numops = %d size = %d\n", batchnum,
            batch->numops, *size);
@@ -102,6 +102,15 @@ enum variorum_data_type_e
     TURBO_RATIO_LIMIT_CORES = 34,
     TDP_DEFS = 35,
     TDP_CONFIG = 36,
+    /// @brief Package RAPL power limits.
+    PKG_POWER_LIMIT = 37,
+    /// @brief DRAM RAPL power limits.
+    DRAM_POWER_LIMIT = 38,
+    /// @brief Per-thread frequency targets.
+    PERF_CTRL_TARGETS = 39,
+    /// @brief Merged operations of every batch subscribed to the sample plan.
+    /// Must remain the last entry.
+    SAMPLE_PLAN = 40,
 };
 
 /// @brief Enum encompassing batch operations.
@@ -115,6 +124,25 @@ enum variorum_batch_op_type_e
     BATCH_READ,
 };
 
+/// @brief Enum encompassing how long values read by a batch stay valid.
+///
+/// Writes issued through write_msr_by_idx() or write_batch() invalidate every
+/// cached batch holding the written register.
+enum variorum_msr_cache_class_e
+{
+    /// @brief Read on every access (default).
+    MSR_CACHE_VOLATILE = 0,
+    /// @brief Read again once the revalidation interval has elapsed, to catch
+    /// writes made outside of variorum (default 1000 ms, see
+    /// VARIORUM_MSR_CACHE_TTL_MS, 0 disables revalidation).
+    MSR_CACHE_SLOW = 1,
+    /// @brief Read once, e.g., fused ratios and units.
+    MSR_CACHE_INVARIANT = 2,
+};
+
+/// @brief Default revalidation interval of MSR_CACHE_SLOW batches (ms).
+#define MSR_CACHE_DEFAULT_TTL_MS 1000
+
 /// @brief Structure holding multiple read/write operations to various MSRs.
 struct msr_batch_array
 {
@@ -366,7 +394,8 @@ int load_thread_batch(
 ///
 /// This function associates an existing allocated array (for the MSR values)
 /// with an existing batch handle. After this function call, issuing a read or
-/// write to the batched MSR can be done with read/write_batch.
+/// write to the batched MSR can be done with read/write_batch. Each socket's
+/// register is accessed on the socket's reader CPU, see socket_reader_cpu().
 ///
 /// @param [in] msr Address of register to read.
 ///
@@ -382,6 +411,26 @@ int load_socket_batch(
     int batchnum
 );
 
+/// @brief Create a batch for a per-core MSR on the first core of each socket.
+///
+/// Same as load_socket_batch(), but each socket's register is accessed on the
+/// socket's first core rather than on its reader CPU, for registers that are
+/// per core and represent the socket through core 0.
+///
+/// @param [in] msr Address of register to read.
+///
+/// @param [out] val Array to store values for reading from or writing to
+///              batched MSR.
+///
+/// @param [in] batchnum Identify a unique batch.
+///
+/// @return 0 if successful, else -1 if val is NULL.
+int load_socket_core_batch(
+    off_t msr,
+    uint64_t **val,
+    int batchnum
+);
+
 /// @brief Allocate a batch handle.
 ///
 /// This function initializes a batch handle with a given size.
@@ -397,8 +446,25 @@ int allocate_batch(
     size_t bsize
 );
 
+/// @brief Execute a batch that is not managed by allocate_batch(), e.g., a
+/// per-socket share of the sample plan.
+///
+/// @param [in,out] batch Operations to execute.
+///
+/// @param [in] type BATCH_READ or BATCH_WRITE.
+///
+/// @return 0 if successful, else -1.
+int do_batch_array(
+    struct msr_batch_array *batch,
+    int type
+);
+
 /// @brief Read from a batched set of MSRs.
 ///
+/// Between sample_plan_begin() and sample_plan_end(), a batch subscribed to
+/// the sample plan already holds the values of the current sample and is not
+/// read again.
+///
 /// @param [in] batchnum Identify a unique batch.
 ///
 /// @return 0 if successful, else -1.
@@ -415,6 +481,62 @@ int write_batch(
     const int batchnum
 );
 
+/// @brief Write a subset of a batched set of MSRs with one batch operation.
+///
+/// @param [in] batchnum Identify a unique batch.
+///
+/// @param [in] selected Nonzero for each operation of the batch to write, in
+///             the order in which the operations were created.
+///
+/// @return 0 if successful (including when nothing is selected), else -1.
+int write_batch_selected(
+    const int batchnum,
+    const unsigned char *selected
+);
+
+/// @brief Set the cache class of a batch.
+///
+/// read_batch() returns the cached values of a batch while they are valid
+/// instead of issuing a new batch operation.
+///
+/// @param [in] batchnum Identify a unique batch.
+///
+/// @param [in] cache_class One of variorum_msr_cache_class_e.
+///
+/// @return 0 if successful, else -1.
+int set_batch_cache_class(
+    const int batchnum,
+    int cache_class
+);
+
+/// @brief Add every operation of an allocated batch to the sample plan.
+///
+/// The sample plan merges the subscribed batches into a single list of
+/// (cpu, msr) reads, sorted by CPU and without duplicates, so that a full
+/// sample costs one batch operation. Operations added to a batch after it was
+/// subscribed are picked up on the next sample_plan_begin().
+///
+/// @param [in] batchnum Identify a unique batch.
+///
+/// @return 0 if successful, else -1.
+int sample_plan_subscribe(
+    const int batchnum
+);
+
+/// @brief Read every subscribed batch with a single batch operation.
+///
+/// Results are scattered back to the storage of each subscribed batch, so
+/// existing decoders see the new values through their batch pointers. Until
+/// sample_plan_end() is called, read_batch() on subscribed batches is a
+/// no-op.
+///
+/// @return 0 if successful, else -1. On failure no sample window is opened
+/// and read_batch() falls back to reading each batch.
+int sample_plan_begin(void);
+
+/// @brief Close the sample window opened by sample_plan_begin().
+void sample_plan_end(void);
+
 /// @brief Create a batch operation for a given CPU.
 ///
 /// @param [in] msr Address of register to read.
@@ -0,0 +1,251 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+// Necessary for sched_setaffinity & CPU_SET.
+#define _GNU_SOURCE
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <config_architecture.h>
+#include <msr_readers.h>
+#include <variorum_error.h>
+
+static struct
+{
+    int started;
+    int stop;
+    unsigned nsockets;
+    pthread_t *threads;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    struct msr_batch_array *batches;
+    int type;
+    int *err;
+} readers;
+
+static void msr_topology(unsigned *nsockets, unsigned *ncores,
+                         unsigned *nthreads)
+{
+#ifdef VARIORUM_WITH_AMD_CPU
+    variorum_get_topology(nsockets, ncores, nthreads, P_MSR_CORE_IDX);
+#endif
+#ifdef VARIORUM_WITH_INTEL_CPU
+    variorum_get_topology(nsockets, ncores, nthreads, P_MSR_CORE_IDX);
+#endif
+}
+
+unsigned cpu_socket(unsigned cpu)
+{
+    unsigned nsockets, ncores, nthreads;
+
+    msr_topology(&nsockets, &ncores, &nthreads);
+    /* Same numbering as devidx(): hardware threads of all cores first, then
+     * their SMT siblings. */
+    return (cpu % ncores) / (ncores / nsockets);
+}
+
+static void parse_housekeeping_cpus(const char *list, unsigned *reader,
+                                    unsigned nthreads)
+{
+    char *copy = strdup(list);
+    char *tok, *save = NULL;
+
+    if (copy == NULL)
+    {
+        return;
+    }
+    for (tok = strtok_r(copy, ",", &save); tok != NULL;
+            tok = strtok_r(NULL, ",", &save))
+    {
+        char *end;
+        unsigned long first = strtoul(tok, &end, 10);
+        unsigned long last = first;
+        unsigned long cpu;
+
+        if (end == tok)
+        {
+            variorum_error_handler("Invalid VARIORUM_HOUSEKEEPING_CPUS entry",
+                                   VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                                   __FILE__, __FUNCTION__, __LINE__);
+            continue;
+        }
+        if (*end == '-')
+        {
+            last = strtoul(end + 1, NULL, 10);
+        }
+        for (cpu = first; cpu <= last && cpu < nthreads; cpu++)
+        {
+            unsigned socket = cpu_socket((unsigned)cpu);
+            if (reader[socket] == UINT_MAX)
+            {
+                reader[socket] = (unsigned)cpu;
+            }
+        }
+    }
+    free(copy);
+}
+
+unsigned socket_reader_cpu(unsigned socket)
+{
+    static unsigned *reader = NULL;
+    unsigned nsockets, ncores, nthreads;
+    unsigned s;
+
+    if (reader == NULL)
+    {
+        char *list = getenv("VARIORUM_HOUSEKEEPING_CPUS");
+        unsigned cores_per_socket, threads_per_core;
+
+        msr_topology(&nsockets, &ncores, &nthreads);
+        cores_per_socket = ncores / nsockets;
+        threads_per_core = nthreads / ncores;
+        reader = (unsigned *) malloc(nsockets * sizeof(unsigned));
+        for (s = 0; s < nsockets; s++)
+        {
+            reader[s] = UINT_MAX;
+        }
+        if (list != NULL)
+        {
+            parse_housekeeping_cpus(list, reader, nthreads);
+        }
+        /* Default to the last hardware thread of the socket, which is the
+         * least likely to host an application rank. */
+        for (s = 0; s < nsockets; s++)
+        {
+            if (reader[s] == UINT_MAX)
+            {
+                reader[s] = (threads_per_core - 1) * ncores + s * cores_per_socket +
+                            cores_per_socket - 1;
+            }
+        }
+    }
+    return reader[socket];
+}
+
+int socket_readers_enabled(void)
+{
+    char *val = getenv("VARIORUM_SOCKET_READERS");
+
+    return val != NULL && atoi(val) == 1;
+}
+
+static void *socket_reader_main(void *arg)
+{
+    unsigned socket = (unsigned)(uintptr_t)arg;
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(socket_reader_cpu(socket), &set);
+    if (sched_setaffinity(0, sizeof(set), &set))
+    {
+        fprintf(stderr,
+                "Warning: <variorum> Could not pin sampler thread of socket %u to CPU %u: %s:%s::%d\n",
+                socket, socket_reader_cpu(socket), getenv("HOSTNAME"), __FILE__,
+                __LINE__);
+    }
+    while (1)
+    {
+        pthread_barrier_wait(&readers.start);
+        if (readers.stop)
+        {
+            break;
+        }
+        readers.err[socket] = 0;
+        if (readers.batches[socket].numops > 0)
+        {
+            readers.err[socket] = do_batch_array(&readers.batches[socket],
+                                                 readers.type);
+        }
+        pthread_barrier_wait(&readers.done);
+    }
+    return NULL;
+}
+
+static int start_socket_readers(void)
+{
+    unsigned s, ncores, nthreads;
+
+    msr_topology(&readers.nsockets, &ncores, &nthreads);
+    /* Resolve reader CPUs before any thread looks them up. */
+    socket_reader_cpu(0);
+    readers.threads = (pthread_t *) malloc(readers.nsockets * sizeof(pthread_t));
+    readers.err = (int *) calloc(readers.nsockets, sizeof(int));
+    if (readers.threads == NULL || readers.err == NULL)
+    {
+        readers.started = -1;
+        return -1;
+    }
+    pthread_barrier_init(&readers.start, NULL, readers.nsockets + 1);
+    pthread_barrier_init(&readers.done, NULL, readers.nsockets + 1);
+    for (s = 0; s < readers.nsockets; s++)
+    {
+        if (pthread_create(&readers.threads[s], NULL, socket_reader_main,
+                           (void *)(uintptr_t)s))
+        {
+            variorum_error_handler("Could not start socket sampler thread",
+                                   VARIORUM_ERROR_RUNTIME, getenv("HOSTNAME"),
+                                   __FILE__, __FUNCTION__, __LINE__);
+            /* Threads already started stay parked, never use them. */
+            readers.started = -1;
+            return -1;
+        }
+    }
+    readers.started = 1;
+    atexit(stop_socket_readers);
+    return 0;
+}
+
+void stop_socket_readers(void)
+{
+    unsigned s;
+
+    if (readers.started != 1)
+    {
+        return;
+    }
+    /* Release the parked threads with the stop flag set. */
+    readers.stop = 1;
+    pthread_barrier_wait(&readers.start);
+    for (s = 0; s < readers.nsockets; s++)
+    {
+        pthread_join(readers.threads[s], NULL);
+    }
+    pthread_barrier_destroy(&readers.start);
+    pthread_barrier_destroy(&readers.done);
+    free(readers.threads);
+    free(readers.err);
+    readers.threads = NULL;
+    readers.err = NULL;
+    readers.stop = 0;
+    readers.started = 0;
+}
+
+int run_socket_readers(struct msr_batch_array *batches, int type)
+{
+    unsigned s;
+
+    if (readers.started < 0 || (!readers.started && start_socket_readers()))
+    {
+        return -1;
+    }
+    readers.batches = batches;
+    readers.type = type;
+    pthread_barrier_wait(&readers.start);
+    pthread_barrier_wait(&readers.done);
+    for (s = 0; s < readers.nsockets; s++)
+    {
+        if (readers.err[s])
+        {
+            return readers.err[s];
+        }
+    }
+    return 0;
+}
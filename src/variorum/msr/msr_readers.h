@@ -0,0 +1,67 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef MSR_READERS_H_INCLUDE
+#define MSR_READERS_H_INCLUDE
+
+#include <msr_core.h>
+
+// Socket-scope registers can be read from any logical processor of the
+// socket. The msr driver executes the read on the target processor, so
+// reading from a processor that runs application work interrupts it. Each
+// socket therefore has a reader CPU, by default its last hardware thread, or
+// the first processor of the socket listed in VARIORUM_HOUSEKEEPING_CPUS
+// (e.g., "35,71" or "32-35,68-71").
+//
+// With VARIORUM_SOCKET_READERS=1, one sampler thread per socket is pinned to
+// the reader CPU and issues the socket's share of each sample, so that
+// socket-scope reads execute locally instead of by interprocessor interrupt.
+
+/// @brief Socket a logical processor belongs to.
+///
+/// @param [in] cpu Unique logical processor index.
+///
+/// @return Socket/package index.
+unsigned cpu_socket(
+    unsigned cpu
+);
+
+/// @brief Logical processor issuing socket-scope reads for a socket.
+///
+/// @param [in] socket Unique socket/package identifier.
+///
+/// @return Logical processor index.
+unsigned socket_reader_cpu(
+    unsigned socket
+);
+
+/// @brief Check if per-socket sampler threads are requested.
+///
+/// @return 1 if VARIORUM_SOCKET_READERS=1, else 0.
+int socket_readers_enabled(void);
+
+/// @brief Execute one batch per socket, each on its pinned sampler thread.
+///
+/// Threads are started on first use and run until stop_socket_readers() or
+/// process exit.
+///
+/// @param [in,out] batches Array of one batch per socket. Empty batches are
+///        skipped.
+///
+/// @param [in] type BATCH_READ or BATCH_WRITE.
+///
+/// @return 0 if successful, else the first error of any socket.
+int run_socket_readers(
+    struct msr_batch_array *batches,
+    int type
+);
+
+/// @brief Stop and join the per-socket sampler threads.
+///
+/// Registered with atexit() when the threads start. A later
+/// run_socket_readers() starts new threads.
+void stop_socket_readers(void);
+
+#endif
@@ -16,6 +16,12 @@
 #include <config_architecture.h>
 #include <variorum.h>
 #include <variorum_error.h>
+#include <variorum_json_obj.h>
+#include <variorum_self_stats.h>
+
+#ifdef VARIORUM_WITH_INTEL_CPU
+#include <perf_event_features.h>
+#endif
 
 #ifdef LIBJUSTIFY_FOUND
 #include <cprintf.h>
@@ -33,6 +39,105 @@ int g_socket;
 int g_core;
 FILE *fp = 0;
 
+static char *self_timed_json_dumps(const json_t *obj)
+{
+    uint64_t t0 = variorum_self_ticks();
+    char *s = json_dumps(obj, JSON_INDENT(4));
+    VARIORUM_SELF_STATS_TIME(json_dumps, t0);
+    return s;
+}
+
+/* Reusable per-thread output buffer for the streaming JSON path. */
+static __thread char *json_stream_buf = NULL;
+static __thread size_t json_stream_cap = 0;
+
+static const char *cached_hostname(void)
+{
+    static char hostname[1024] = "";
+    if (hostname[0] == '\0')
+    {
+        gethostname(hostname, 1024);
+    }
+    return hostname;
+}
+
+static int power_json_streamable(void)
+{
+    int i;
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_write_power_json == NULL)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int frequency_json_streamable(void)
+{
+    int i;
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_write_frequency_json == NULL)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Emits the same document as the jansson-based path, member by member. The
+ * platforms read the hardware while writing, so only the writer's own time
+ * is accounted to json_dumps, as on the jansson path; the MSR reads stay
+ * under the batch timer. */
+static int write_power_json(struct variorum_json_writer *jw, uint64_t ts)
+{
+    int i;
+    int err;
+
+    variorum_json_writer_begin_object(jw, NULL);
+    variorum_json_writer_begin_object(jw, cached_hostname());
+    variorum_json_writer_integer(jw, "timestamp", ts);
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        err = g_platform[i].variorum_write_power_json(jw);
+        if (err)
+        {
+            VARIORUM_SELF_STATS_ADD(json_dumps, jw->ticks);
+            return -1;
+        }
+    }
+    variorum_json_writer_end_object(jw);
+    variorum_json_writer_end_object(jw);
+    err = variorum_json_writer_finish(jw);
+    VARIORUM_SELF_STATS_ADD(json_dumps, jw->ticks);
+    return err;
+}
+
+static int write_frequency_json(struct variorum_json_writer *jw, uint64_t ts)
+{
+    int i;
+    int err;
+
+    variorum_json_writer_begin_object(jw, NULL);
+    variorum_json_writer_begin_object(jw, cached_hostname());
+    variorum_json_writer_integer(jw, "timestamp", ts);
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        err = g_platform[i].variorum_write_frequency_json(jw);
+        if (err)
+        {
+            printf("Error with variorum get frequency json platform %d\n", i);
+        }
+    }
+    variorum_json_writer_end_object(jw);
+    variorum_json_writer_end_object(jw);
+    err = variorum_json_writer_finish(jw);
+    VARIORUM_SELF_STATS_ADD(json_dumps, jw->ticks);
+    return err;
+}
+
 static void print_children(hwloc_topology_t topology, hwloc_obj_t obj,
                            int depth)
 {
@@ -116,6 +221,7 @@ int variorum_poll_power(FILE *output)
         err = g_platform[i].variorum_poll_power(output);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -144,11 +250,13 @@ int variorum_monitoring(FILE *output)
                                    VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
                                    getenv("HOSTNAME"), __FILE__,
                                    __FUNCTION__, __LINE__);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return 0;
         }
         err = g_platform[i].variorum_monitoring(output);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -182,6 +290,7 @@ int variorum_print_power_limit(void)
         err = g_platform[i].variorum_print_power_limit(0);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -215,6 +324,7 @@ int variorum_print_verbose_power_limit(void)
         err = g_platform[i].variorum_print_power_limit(1);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -341,12 +451,14 @@ int variorum_cap_best_effort_node_power_limit(int node_power_limit)
                                VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
                                getenv("HOSTNAME"), __FILE__,
                                __FUNCTION__, __LINE__);
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return 0;
     }
     err = g_platform[i].variorum_cap_best_effort_node_power_limit(
               node_power_limit);
     if (err)
     {
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return -1;
     }
 
@@ -375,11 +487,13 @@ int variorum_cap_gpu_power_ratio(int gpu_power_ratio)
                                    VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
                                    getenv("HOSTNAME"), __FILE__,
                                    __FUNCTION__, __LINE__);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return 0;
         }
         err = g_platform[i].variorum_cap_gpu_power_ratio(gpu_power_ratio);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -408,11 +522,13 @@ int variorum_cap_each_socket_power_limit(int socket_power_limit)
                                    VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
                                    getenv("HOSTNAME"), __FILE__,
                                    __FUNCTION__, __LINE__);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return 0;
         }
         err = g_platform[i].variorum_cap_each_socket_power_limit(socket_power_limit);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -441,11 +557,50 @@ int variorum_cap_each_core_frequency_limit(int core_freq_mhz)
                                    VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
                                    getenv("HOSTNAME"), __FILE__,
                                    __FUNCTION__, __LINE__);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return 0;
         }
         err = g_platform[i].variorum_cap_each_core_frequency_limit(core_freq_mhz);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+    }
+    err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    return err;
+}
+
+int variorum_cap_cpu_frequency_targets(int ncpus, const int *cpus,
+                                       const int *cpu_freq_mhz)
+{
+    int err = 0;
+    int i;
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_cap_cpu_frequency_targets == NULL)
+        {
+            variorum_error_handler("Feature not yet implemented or is not supported",
+                                   VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                                   getenv("HOSTNAME"), __FILE__,
+                                   __FUNCTION__, __LINE__);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return 0;
+        }
+        err = g_platform[i].variorum_cap_cpu_frequency_targets(ncpus, cpus,
+                cpu_freq_mhz);
+        if (err)
+        {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -474,12 +629,14 @@ int variorum_cap_socket_frequency_limit(int socketid, int socket_freq_mhz)
                                    VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
                                    getenv("HOSTNAME"), __FILE__,
                                    __FUNCTION__, __LINE__);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return 0;
         }
         err = g_platform[i].variorum_cap_socket_frequency_limit(socketid,
                 socket_freq_mhz);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -508,11 +665,12 @@ int variorum_cap_each_gpu_power_limit(int gpu_power_limit)
                                    VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
                                    getenv("HOSTNAME"), __FILE__,
                                    __FUNCTION__, __LINE__);
-            return 0;
+            continue;
         }
         err = g_platform[i].variorum_cap_each_gpu_power_limit(gpu_power_limit);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -546,6 +704,7 @@ int variorum_print_features(void)
         err = g_platform[i].variorum_print_features();
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -579,6 +738,7 @@ int variorum_print_thermals(void)
         err = g_platform[i].variorum_print_thermals(0);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -612,6 +772,7 @@ int variorum_print_verbose_thermals(void)
         err = g_platform[i].variorum_print_thermals(1);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -645,6 +806,279 @@ int variorum_print_counters(void)
         err = g_platform[i].variorum_print_counters(0);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+    }
+    err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    return err;
+}
+
+int variorum_start_counter_sampling(const char *events)
+{
+    int err = 0;
+    int i;
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_start_counter_sampling == NULL)
+        {
+            variorum_error_handler("Feature not yet implemented or is not supported",
+                                   VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                                   getenv("HOSTNAME"), __FILE__,
+                                   __FUNCTION__, __LINE__);
+            continue;
+        }
+        err = g_platform[i].variorum_start_counter_sampling(events);
+        if (err)
+        {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+    }
+    err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    return err;
+}
+
+int variorum_sample_counters(struct variorum_counter_sample *sample)
+{
+    int err = 0;
+    int i;
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_sample_counters == NULL)
+        {
+            variorum_error_handler("Feature not yet implemented or is not supported",
+                                   VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                                   getenv("HOSTNAME"), __FILE__,
+                                   __FUNCTION__, __LINE__);
+            continue;
+        }
+        err = g_platform[i].variorum_sample_counters(sample);
+        if (err)
+        {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+    }
+    err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    return err;
+}
+
+int variorum_stop_counter_sampling(void)
+{
+    int err = 0;
+    int i;
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_stop_counter_sampling == NULL)
+        {
+            variorum_error_handler("Feature not yet implemented or is not supported",
+                                   VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                                   getenv("HOSTNAME"), __FILE__,
+                                   __FUNCTION__, __LINE__);
+            continue;
+        }
+        err = g_platform[i].variorum_stop_counter_sampling();
+        if (err)
+        {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+    }
+    err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    return err;
+}
+
+int variorum_sample_core_power(struct variorum_core_power_sample *sample)
+{
+    int err = 0;
+    int i;
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_sample_core_power == NULL)
+        {
+            variorum_error_handler("Feature not yet implemented or is not supported",
+                                   VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                                   getenv("HOSTNAME"), __FILE__,
+                                   __FUNCTION__, __LINE__);
+            continue;
+        }
+        err = g_platform[i].variorum_sample_core_power(sample);
+        if (err)
+        {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+    }
+    err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    return err;
+}
+
+int variorum_get_core_power_json(char **get_core_power_obj_str)
+{
+    int err = 0;
+    int i;
+    char hostname[1024];
+    uint64_t ts;
+    struct timeval tv;
+    gethostname(hostname, 1024);
+    gettimeofday(&tv, NULL);
+
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+
+    json_t *get_core_power_obj = json_object();
+    json_t *node_obj = json_object();
+    json_object_set_new(get_core_power_obj, hostname, node_obj);
+
+    ts = tv.tv_sec * (uint64_t)1000000 + tv.tv_usec;
+    json_object_set_new(node_obj, "timestamp", json_integer(ts));
+
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_get_core_power_json == NULL)
+        {
+            variorum_error_handler("Feature not yet implemented or is not supported",
+                                   VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                                   getenv("HOSTNAME"), __FILE__,
+                                   __FUNCTION__, __LINE__);
+            continue;
+        }
+        err = g_platform[i].variorum_get_core_power_json(node_obj);
+        if (err)
+        {
+            json_decref(get_core_power_obj);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+    }
+    *get_core_power_obj_str = self_timed_json_dumps(get_core_power_obj);
+    json_decref(get_core_power_obj);
+
+    err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    return err;
+}
+
+int variorum_read_thread_counters(struct variorum_thread_counters *counters)
+{
+    // Called on hot paths, so no variorum_enter(); the counters of each
+    // thread are independent of the platform function pointers.
+#ifdef VARIORUM_WITH_INTEL_CPU
+    return perf_event_read_thread_counters(counters);
+#else
+    (void)counters;
+    variorum_error_handler("Feature not yet implemented or is not supported",
+                           VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                           getenv("HOSTNAME"), __FILE__,
+                           __FUNCTION__, __LINE__);
+    return -1;
+#endif
+}
+
+int variorum_start_energy_window(void)
+{
+    int err = 0;
+    int i;
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_start_energy_window == NULL)
+        {
+            variorum_error_handler("Feature not yet implemented or is not supported",
+                                   VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                                   getenv("HOSTNAME"), __FILE__,
+                                   __FUNCTION__, __LINE__);
+            continue;
+        }
+        err = g_platform[i].variorum_start_energy_window();
+        if (err)
+        {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+    }
+    err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    return err;
+}
+
+int variorum_stop_energy_window(struct variorum_energy_window *window)
+{
+    int err = 0;
+    int i;
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_stop_energy_window == NULL)
+        {
+            variorum_error_handler("Feature not yet implemented or is not supported",
+                                   VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                                   getenv("HOSTNAME"), __FILE__,
+                                   __FUNCTION__, __LINE__);
+            continue;
+        }
+        err = g_platform[i].variorum_stop_energy_window(window);
+        if (err)
+        {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -678,6 +1112,7 @@ int variorum_print_verbose_counters(void)
         err = g_platform[i].variorum_print_counters(1);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -711,6 +1146,7 @@ int variorum_print_frequency(void)
         err = g_platform[i].variorum_print_frequency(0);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -744,6 +1180,7 @@ int variorum_print_verbose_frequency(void)
         err = g_platform[i].variorum_print_frequency(1);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -777,6 +1214,7 @@ int variorum_print_power(void)
         err = g_platform[i].variorum_print_power(0);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -810,6 +1248,7 @@ int variorum_print_verbose_power(void)
         err = g_platform[i].variorum_print_power(1);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -893,6 +1332,7 @@ int variorum_print_turbo(void)
         err = g_platform[i].variorum_print_turbo();
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -926,6 +1366,7 @@ int variorum_print_gpu_utilization(void)
         err = g_platform[i].variorum_print_gpu_utilization(0);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -959,6 +1400,7 @@ int variorum_print_verbose_gpu_utilization(void)
         err = g_platform[i].variorum_print_gpu_utilization(1);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -987,11 +1429,13 @@ int variorum_enable_turbo(void)
                                    VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
                                    getenv("HOSTNAME"), __FILE__,
                                    __FUNCTION__, __LINE__);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return 0;
         }
         err = g_platform[i].variorum_enable_turbo();
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -1020,11 +1464,13 @@ int variorum_disable_turbo(void)
                                    VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
                                    getenv("HOSTNAME"), __FILE__,
                                    __FUNCTION__, __LINE__);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return 0;
         }
         err = g_platform[i].variorum_disable_turbo();
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -1036,22 +1482,18 @@ int variorum_disable_turbo(void)
     return err;
 }
 
-int variorum_get_power_json(char **get_power_obj_str)
+/* Builds the object graph of the jansson-based path. Called between
+ * variorum_enter() and variorum_exit(). */
+static int build_power_json(json_t **get_power_obj_out)
 {
-    int err = 0;
-    int i;
+    char hostname[1024];
+    struct timeval tv;
     uint64_t ts;
-    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
-    if (err)
-    {
-        return -1;
-    }
+    int err;
+    int i;
 
-    char hostname[1024];
     gethostname(hostname, 1024);
 
-    struct timeval tv;
-
     json_t *get_power_obj = json_object();
     json_t *node_obj = json_object();
     json_object_set_new(get_power_obj, hostname, node_obj);
@@ -1073,13 +1515,87 @@ int variorum_get_power_json(char **get_power_obj_str)
         err = g_platform[i].variorum_get_power_json(node_obj);
         if (err)
         {
-            // For the JSON functions, we return a -1 here, so users don't need
-            // to explicitly check for NULL strings.
+            json_decref(get_power_obj);
             return -1;
         }
     }
+    *get_power_obj_out = get_power_obj;
+    return 0;
+}
+
+int variorum_get_power_json_obj(json_t **get_power_obj)
+{
+    int err = 0;
+
+    if (get_power_obj == NULL)
+    {
+        return -1;
+    }
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    if (build_power_json(get_power_obj))
+    {
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        json_decref(*get_power_obj);
+        *get_power_obj = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int variorum_get_power_json(char **get_power_obj_str)
+{
+    int err = 0;
+    uint64_t ts;
+    json_t *get_power_obj = NULL;
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+
+    struct timeval tv;
+
+    // Avoid building a JSON object graph when every platform can stream.
+    if (power_json_streamable())
+    {
+        struct variorum_json_writer jw;
+        variorum_json_writer_init_growable(&jw, &json_stream_buf,
+                                           &json_stream_cap, 4);
+        gettimeofday(&tv, NULL);
+        ts = tv.tv_sec * (uint64_t)1000000 + tv.tv_usec;
+        if (write_power_json(&jw, ts))
+        {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+        *get_power_obj_str = strdup(json_stream_buf);
+
+        err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+        if (err)
+        {
+            return -1;
+        }
+        return err;
+    }
+
+    if (build_power_json(&get_power_obj))
+    {
+        // For the JSON functions, we return a -1 here, so users don't need
+        // to explicitly check for NULL strings.
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
 
-    *get_power_obj_str = json_dumps(get_power_obj, JSON_INDENT(4));
+    *get_power_obj_str = self_timed_json_dumps(get_power_obj);
     json_decref(get_power_obj);
 
     err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
@@ -1091,8 +1607,26 @@ int variorum_get_power_json(char **get_power_obj_str)
 }
 
 int variorum_get_utilization_json(char **get_util_obj_str)
+{
+    json_t *get_util_obj = NULL;
+
+    if (variorum_get_utilization_json_obj(&get_util_obj))
+    {
+        return -1;
+    }
+    *get_util_obj_str = self_timed_json_dumps(get_util_obj);
+    json_decref(get_util_obj);
+    return 0;
+}
+
+int variorum_get_utilization_json_obj(json_t **get_util_obj_out)
 {
     int err = 0;
+
+    if (get_util_obj_out == NULL)
+    {
+        return -1;
+    }
     err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
     if (err)
     {
@@ -1162,6 +1696,7 @@ int variorum_get_utilization_json(char **get_util_obj_str)
     {
         printf("JSON get gpu utilization failed. Exiting.\n");
         free(gpu_util_str);
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return -1;
     }
 
@@ -1195,11 +1730,13 @@ int variorum_get_utilization_json(char **get_util_obj_str)
     fp = fopen(CPU_FILE, "r");
     if (fp == NULL)
     {
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return -1;
     }
     // read the first line (cpu)
     if (fgets(str, 100, fp) == NULL)
     {
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return -1;
     }
     if (str != NULL)
@@ -1266,6 +1803,7 @@ int variorum_get_utilization_json(char **get_util_obj_str)
     fp = fopen(MEM_FILE, "r");
     if (fp == NULL)
     {
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return -1;
     }
     fseek(fp, 0, SEEK_SET);
@@ -1313,15 +1851,15 @@ int variorum_get_utilization_json(char **get_util_obj_str)
 
     fclose(fp);
     json_object_set_new(get_cpu_util_obj, "memory_util%", json_real(mem_util));
-    *get_util_obj_str = json_dumps(get_util_obj, JSON_INDENT(4));
-    json_decref(get_util_obj);
     state = 1;
 
     err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
     if (err)
     {
+        json_decref(get_util_obj);
         return -1;
     }
+    *get_util_obj_out = get_util_obj;
     return err;
 }
 
@@ -1372,12 +1910,14 @@ int variorum_get_node_power_domain_info_json(char **get_domain_obj_str)
                                __FUNCTION__, __LINE__);
         // For the JSON functions, we return a -1 here, so users don't need
         // to explicitly check for NULL strings.
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return -1;
     }
     err = g_platform[i].variorum_get_node_power_domain_info_json(
               get_domain_obj_str);
     if (err)
     {
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return -1;
     }
     err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
@@ -1425,11 +1965,12 @@ int variorum_get_thermals_json(char **get_thermal_obj_str)
         err = g_platform[i].variorum_get_thermals_json(node_obj);
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
 
-    *get_thermal_obj_str = json_dumps(get_thermal_obj, JSON_INDENT(4));
+    *get_thermal_obj_str = self_timed_json_dumps(get_thermal_obj);
     json_decref(get_thermal_obj);
 
     err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
@@ -1456,6 +1997,28 @@ int variorum_get_frequency_json(char **get_frequency_obj_str)
         return -1;
     }
 
+    // Avoid building a JSON object graph when every platform can stream.
+    if (frequency_json_streamable())
+    {
+        struct variorum_json_writer jw;
+        variorum_json_writer_init_growable(&jw, &json_stream_buf,
+                                           &json_stream_cap, 4);
+        ts = tv.tv_sec * (uint64_t)1000000 + tv.tv_usec;
+        if (write_frequency_json(&jw, ts))
+        {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+            return -1;
+        }
+        *get_frequency_obj_str = strdup(json_stream_buf);
+
+        err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+        if (err)
+        {
+            return -1;
+        }
+        return err;
+    }
+
     json_t *get_frequency_obj = json_object();
     json_t *node_obj = json_object();
     json_object_set_new(get_frequency_obj, hostname, node_obj);
@@ -1480,7 +2043,7 @@ int variorum_get_frequency_json(char **get_frequency_obj_str)
         }
     }
 
-    *get_frequency_obj_str = json_dumps(get_frequency_obj, JSON_INDENT(4));
+    *get_frequency_obj_str = self_timed_json_dumps(get_frequency_obj);
     json_decref(get_frequency_obj);
 
     err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
@@ -1491,6 +2054,84 @@ int variorum_get_frequency_json(char **get_frequency_obj_str)
     return err;
 }
 
+int variorum_get_power_json_buf(char *buf, size_t *len, int indent)
+{
+    int err = 0;
+    uint64_t ts;
+    struct timeval tv;
+    struct variorum_json_writer jw;
+
+    if (buf == NULL || len == NULL)
+    {
+        return -1;
+    }
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    if (!power_json_streamable())
+    {
+        variorum_error_handler("Feature not yet implemented or is not supported",
+                               VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                               getenv("HOSTNAME"), __FILE__,
+                               __FUNCTION__, __LINE__);
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+
+    gettimeofday(&tv, NULL);
+    ts = tv.tv_sec * (uint64_t)1000000 + tv.tv_usec;
+    variorum_json_writer_init(&jw, buf, *len, indent);
+    err = write_power_json(&jw, ts);
+    *len = jw.len;
+
+    if (variorum_exit(__FILE__, __FUNCTION__, __LINE__) || err)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int variorum_get_frequency_json_buf(char *buf, size_t *len, int indent)
+{
+    int err = 0;
+    uint64_t ts;
+    struct timeval tv;
+    struct variorum_json_writer jw;
+
+    if (buf == NULL || len == NULL)
+    {
+        return -1;
+    }
+    gettimeofday(&tv, NULL);
+    err = variorum_enter(__FILE__, __FUNCTION__, __LINE__);
+    if (err)
+    {
+        return -1;
+    }
+    if (!frequency_json_streamable())
+    {
+        variorum_error_handler("Feature not yet implemented or is not supported",
+                               VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                               getenv("HOSTNAME"), __FILE__,
+                               __FUNCTION__, __LINE__);
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+
+    ts = tv.tv_sec * (uint64_t)1000000 + tv.tv_usec;
+    variorum_json_writer_init(&jw, buf, *len, indent);
+    err = write_frequency_json(&jw, ts);
+    *len = jw.len;
+
+    if (variorum_exit(__FILE__, __FUNCTION__, __LINE__) || err)
+    {
+        return -1;
+    }
+    return 0;
+}
+
 /*
 int variorum_get_gpu_power_json(char **get_power_obj_str)
 {
@@ -1523,12 +2164,14 @@ int variorum_get_gpu_power_json(char **get_power_obj_str)
                                __FUNCTION__, __LINE__);
         // For the JSON functions, we return a -1 here, so users don't need
         // to explicitly check for NULL strings.
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return -1;
     }
 
     err = g_platform[i].variorum_get_gpu_power_json(get_power_obj_str);
     if (err)
     {
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return -1;
     }
     err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
@@ -1556,11 +2199,13 @@ int variorum_print_available_frequencies(void)
             variorum_error_handler("Feature not yet implemented or is not supported",
                                    VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED, getenv("HOSTNAME"), __FILE__,
                                    __FUNCTION__, __LINE__);
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return 0;
         }
         err = g_platform[i].variorum_print_available_frequencies();
         if (err)
         {
+            variorum_exit(__FILE__, __FUNCTION__, __LINE__);
             return -1;
         }
     }
@@ -1606,11 +2251,13 @@ int variorum_print_energy(void)
                 variorum_error_handler("Feature not yet implemented or is not supported",
                                        VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED, getenv("HOSTNAME"), __FILE__,
                                        __FUNCTION__, __LINE__);
+                variorum_exit(__FILE__, __FUNCTION__, __LINE__);
                 return 0;
             }
             err = g_platform[i].variorum_print_energy(0);
             if (err)
             {
+                variorum_exit(__FILE__, __FUNCTION__, __LINE__);
                 return -1;
             }
         }
@@ -1621,6 +2268,7 @@ int variorum_print_energy(void)
         variorum_error_handler("Feature not yet implemented or is not supported",
                                VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED, getenv("HOSTNAME"), __FILE__,
                                __FUNCTION__, __LINE__);
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return 0;
     }
     err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
@@ -1666,11 +2314,13 @@ int variorum_print_verbose_energy(void)
                 variorum_error_handler("Feature not yet implemented or is not supported",
                                        VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED, getenv("HOSTNAME"), __FILE__,
                                        __FUNCTION__, __LINE__);
+                variorum_exit(__FILE__, __FUNCTION__, __LINE__);
                 return 0;
             }
             err = g_platform[i].variorum_print_energy(1);
             if (err)
             {
+                variorum_exit(__FILE__, __FUNCTION__, __LINE__);
                 return -1;
             }
         }
@@ -1681,6 +2331,7 @@ int variorum_print_verbose_energy(void)
         variorum_error_handler("Feature not yet implemented or is not supported",
                                VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED, getenv("HOSTNAME"), __FILE__,
                                __FUNCTION__, __LINE__);
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
         return 0;
     }
     err = variorum_exit(__FILE__, __FUNCTION__, __LINE__);
@@ -1695,8 +2346,6 @@ int variorum_get_energy_json(char **get_energy_obj_str)
 {
     int err = 0;
     int i;
-    int has_cpu = 0;
-    int has_gpu = 0;
     char hostname[1024];
     uint64_t ts;
     struct timeval tv;
@@ -1716,48 +2365,26 @@ int variorum_get_energy_json(char **get_energy_obj_str)
     ts = tv.tv_sec * (uint64_t)1000000 + tv.tv_usec;
     json_object_set_new(node_obj, "timestamp", json_integer(ts));
 
-    // If we have a GPU-only build, we should exit with a helpful message.
-    // If we have a CPU-only or CPU+GPU multi-platform build, we should print
-    // the node-level energy.
-    // First check if we have a CPU platform, then check for a GPU platform
-
-#if defined(VARIORUM_WITH_INTEL_CPU) || defined(VARIORUM_WITH_AMD_CPU) || defined(VARIORUM_WITH_IBM_CPU)
-    has_cpu = 1;
-#endif
-#if defined(VARIORUM_WITH_NVIDIA_GPU) || defined(VARIORUM_WITH_AMD_GPU) || defined(VARIORUM_WITH_INTEL_GPU)
-    has_gpu = 1;
-#endif
-
-    // CPU-only or multi-platform build
-    if ((has_cpu && has_gpu) || (has_cpu))
+    // CPU platforms come first and report the node-level energy. GPU
+    // platforms add the energy counter of each device, and add it to the
+    // node-level energy if a CPU platform reported one.
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
     {
-        for (i = 0; i < P_NUM_PLATFORMS; i++)
+        if (g_platform[i].variorum_get_energy_json == NULL)
         {
-            if (g_platform[i].variorum_get_energy_json == NULL)
-            {
-                variorum_error_handler("Feature not yet implemented or is not supported",
-                                       VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
-                                       getenv("HOSTNAME"), __FILE__,
-                                       __FUNCTION__, __LINE__);
-                return 0;
-            }
-            err = g_platform[i].variorum_get_energy_json(node_obj);
-            if (err)
-            {
-                printf("Error with variorum get frequency json platform %d\n", i);
-            }
-            *get_energy_obj_str = json_dumps(get_energy_obj, JSON_INDENT(4));
+            variorum_error_handler("Feature not yet implemented or is not supported",
+                                   VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                                   getenv("HOSTNAME"), __FILE__,
+                                   __FUNCTION__, __LINE__);
+            continue;
+        }
+        err = g_platform[i].variorum_get_energy_json(node_obj);
+        if (err)
+        {
+            printf("Error with variorum get energy json platform %d\n", i);
         }
     }
-    else
-    {
-        // We have a GPU-only build, currently doesn't support get_energy
-        variorum_error_handler("Feature not yet implemented or is not supported",
-                               VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED, getenv("HOSTNAME"), __FILE__,
-                               __FUNCTION__, __LINE__);
-        *get_energy_obj_str = json_dumps(get_energy_obj, JSON_INDENT(4));
-        return 0;
-    }
+    *get_energy_obj_str = self_timed_json_dumps(get_energy_obj);
 
     json_decref(get_energy_obj);
 
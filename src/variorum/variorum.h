@@ -6,6 +6,7 @@
 #ifndef VARIORUM_H_INCLUDE
 #define VARIORUM_H_INCLUDE
 
+#include <stdint.h>
 #include <stdio.h>
 
 /// @brief Collect power limits and energy usage for both the package and DRAM
@@ -129,6 +130,23 @@ int variorum_cap_gpu_power_ratio(int gpu_power_ratio);
 /// not supported, otherwise -1
 int variorum_cap_each_core_frequency_limit(int cpu_freq_mhz);
 
+/// @brief Request a frequency for each of a set of logical CPUs, e.g., to
+/// slow down the cores of ranks waiting in communication.
+///
+/// @supparch
+/// - Intel Skylake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @param [in] ncpus Number of entries in cpus and cpu_freq_mhz.
+/// @param [in] cpus Logical CPU identifiers.
+/// @param [in] cpu_freq_mhz Desired frequency of each CPU in MHz.
+///
+/// @return 0 if successful or if feature has not been implemented or is
+/// not supported, otherwise -1
+int variorum_cap_cpu_frequency_targets(int ncpus, const int *cpus,
+                                       const int *cpu_freq_mhz);
+
 /// @brief Cap the frequency of the target processor.
 ///
 /// @supparch
@@ -698,6 +716,60 @@ int variorum_get_thermals_json(char **get_thermal_obj_str);
 /// check for NULL strings.
 int variorum_get_frequency_json(char **get_frequency_obj_str);
 
+/// @brief Write node power information in JSON format into a caller-provided
+/// buffer, without allocating. The output is identical to
+/// variorum_get_power_json() when indent is 4; an indent of 0 produces
+/// compact output.
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Haswell
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+/// - Intel Sapphire Rapids
+///
+/// @param [out] buf Buffer receiving the NUL-terminated JSON string.
+///
+/// @param [in,out] len Capacity of buf on input; length of the JSON string
+/// (excluding the NUL) on output. If the buffer was too small, this is the
+/// size needed and the function returns -1.
+///
+/// @param [in] indent Number of spaces per nesting level, or 0 for compact
+/// output.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_get_power_json_buf(char *buf, size_t *len, int indent);
+
+/// @brief Write node frequency information in JSON format into a
+/// caller-provided buffer, without allocating. The output is identical to
+/// variorum_get_frequency_json() when indent is 4; an indent of 0 produces
+/// compact output.
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @param [out] buf Buffer receiving the NUL-terminated JSON string.
+///
+/// @param [in,out] len Capacity of buf on input; length of the JSON string
+/// (excluding the NUL) on output. If the buffer was too small, this is the
+/// size needed and the function returns -1.
+///
+/// @param [in] indent Number of spaces per nesting level, or 0 for compact
+/// output.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_get_frequency_json_buf(char *buf, size_t *len, int indent);
+
 /// @brief Populate a string in JSON format with node level energy information
 ///
 /// @supparch
@@ -719,6 +791,402 @@ int variorum_get_frequency_json(char **get_frequency_obj_str);
 /// check for NULL strings.
 int variorum_get_energy_json(char **get_energy_obj_str);
 
+/*****************************/
+/* Self-Overhead Measurement */
+/*****************************/
+/// @brief Overhead counters accumulated by Variorum on the calling thread.
+/// Timings are in ticks of a cheap hardware counter; divide by
+/// ticks_per_usec to convert to microseconds.
+struct variorum_self_stats
+{
+    /// @brief Number of calls to variorum_enter.
+    uint64_t enter_calls;
+    /// @brief Ticks spent in variorum_enter.
+    uint64_t enter_ticks;
+    /// @brief Number of MSR batch reads and writes.
+    uint64_t batch_calls;
+    /// @brief Ticks spent in MSR batch reads and writes.
+    uint64_t batch_ticks;
+    /// @brief Number of JSON objects serialized.
+    uint64_t json_dumps_calls;
+    /// @brief Ticks spent serializing JSON objects. Hardware reads done while
+    /// a document is streamed are not included.
+    uint64_t json_dumps_ticks;
+    /// @brief Number of sample records written to output files.
+    uint64_t io_calls;
+    /// @brief Ticks spent writing sample records to output files.
+    uint64_t io_ticks;
+    /// @brief Number of system calls issued (MSR access, timer sleeps).
+    uint64_t syscalls;
+    /// @brief Number of bytes written to output files.
+    uint64_t bytes_written;
+    /// @brief Number of samples skipped by timer catch-up.
+    uint64_t dropped_samples;
+    /// @brief Estimated tick rate of the counter used for the timings.
+    double ticks_per_usec;
+};
+
+/// @brief Get the sampling-overhead counters of the calling thread. Counters
+/// are kept per thread without locks, so they are cheap enough to leave on.
+///
+/// @supparch
+/// - All architectures
+///
+/// @param [out] stats Location to copy the counters to.
+///
+/// @return 0 if successful, otherwise -1
+int variorum_get_self_stats(struct variorum_self_stats *stats);
+
+/// @brief Reset the sampling-overhead counters of the calling thread.
+///
+/// @supparch
+/// - All architectures
+void variorum_reset_self_stats(void);
+
+/********************/
+/* Counter Sampling */
+/********************/
+/// @brief Per-thread performance counter deltas over one sampling interval.
+struct variorum_counter_sample
+{
+    /// @brief Number of hardware threads.
+    unsigned nthreads;
+    /// @brief Number of events, including the fixed counters
+    /// (INST_RETIRED.ANY, CPU_CLK_UNHALTED.THREAD, CPU_CLK_UNHALTED.REF_TSC),
+    /// which come first.
+    unsigned nevents;
+    /// @brief Event names, nevents entries.
+    const char *const *names;
+    /// @brief Deltas indexed [thread * nevents + event]. Events that were
+    /// multiplexed out during the interval are estimated from their last
+    /// measured rate.
+    const double *deltas;
+    /// @brief Length of the interval in nanoseconds.
+    uint64_t elapsed_ns;
+};
+
+/// @brief Program named performance monitoring events on all hardware
+/// threads. When more events are requested than there are general-purpose
+/// counters, the events are split into groups that rotate on every call to
+/// variorum_sample_counters().
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Haswell
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @param [in] events Comma-separated event names (e.g.,
+///        "LONGEST_LAT_CACHE.MISS,BR_MISP_RETIRED.ALL_BRANCHES"), or NULL for
+///        the default events of the processor model.
+///
+/// @return 0 if successful, otherwise -1
+int variorum_start_counter_sampling(const char *events);
+
+/// @brief Read per-thread counter deltas since the previous sample (or since
+/// variorum_start_counter_sampling()). The returned arrays are owned by
+/// Variorum and remain valid until the next call.
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Haswell
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @param [out] sample Counter deltas of the interval.
+///
+/// @return 0 if successful, otherwise -1
+int variorum_sample_counters(struct variorum_counter_sample *sample);
+
+/// @brief Disable the events programmed by variorum_start_counter_sampling().
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Haswell
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @return 0 if successful, otherwise -1
+int variorum_stop_counter_sampling(void);
+
+/// @brief Fixed counters of the calling thread, counted at user level.
+struct variorum_thread_counters
+{
+    /// @brief Instructions retired.
+    uint64_t instructions;
+    /// @brief Unhalted core cycles.
+    uint64_t cycles;
+    /// @brief Unhalted reference cycles.
+    uint64_t ref_cycles;
+};
+
+/// @brief Read the fixed counters of the calling thread. The counters are
+/// opened through perf_event on the thread's first call and read with rdpmc
+/// afterwards where the kernel allows it, so no privileges are needed and a
+/// read does not enter the kernel. Subtract two reads to measure a region.
+/// The counters are closed when the thread exits.
+///
+/// @supparch
+/// - Intel (Linux perf_event)
+///
+/// @param [out] counters Counts since the thread's first call.
+///
+/// @return 0 if successful, otherwise -1
+int variorum_read_thread_counters(struct variorum_thread_counters *counters);
+
+/*************************/
+/* Per-Core Power Series */
+/*************************/
+/// @brief Per-core energy and power of one sample, with the power summed
+/// per CCD (core complex die) and per socket.
+struct variorum_core_power_sample
+{
+    /// @brief Number of cores, CCDs, and sockets.
+    unsigned ncores;
+    unsigned nccds;
+    unsigned nsockets;
+    /// @brief CCD of each core and socket of each CCD.
+    const unsigned *core_ccd;
+    const unsigned *ccd_socket;
+    /// @brief Energy of each core since the first sample (J).
+    const double *core_joules;
+    /// @brief Power of each core, CCD, and socket over the interval (W).
+    const double *core_watts;
+    const double *ccd_watts;
+    const double *socket_watts;
+    /// @brief Length of the interval in nanoseconds, 0 for the first sample.
+    uint64_t elapsed_ns;
+};
+
+/// @brief Sample the energy counter of every core and compute per-core,
+/// per-CCD, and per-socket power since the previous call. The first call
+/// sets the baseline and reports zero power. The arrays stay valid until the
+/// next call.
+///
+/// @supparch
+/// - AMD EPYC Milan and newer
+///
+/// @param [out] sample Per-core energy and power.
+///
+/// @return 0 if successful, otherwise -1
+int variorum_sample_core_power(struct variorum_core_power_sample *sample);
+
+/// @brief Sample per-core power as with variorum_sample_core_power() and
+/// return it as a JSON string. Each socket object holds the sum of its cores
+/// (power_cores_watts), the power of each CCD (ccd), and the power of each
+/// core (core).
+///
+/// @supparch
+/// - AMD EPYC Milan and newer
+///
+/// @param [out] get_core_power_obj_str JSON object as a string, to be freed
+///              by the caller.
+///
+/// @return 0 if successful, otherwise -1
+int variorum_get_core_power_json(char **get_core_power_obj_str);
+
+/****************************/
+/* Precision Energy Windows */
+/****************************/
+/// @brief Package energy over a window aligned to energy counter updates.
+struct variorum_energy_window
+{
+    /// @brief Package energy of all sockets between the aligned start and end
+    /// updates (J).
+    double joules;
+    /// @brief Bound on the absolute error of joules with respect to seconds
+    /// (J).
+    double error_joules;
+    /// @brief Length of the aligned window, measured with the timestamp
+    /// counter (s).
+    double seconds;
+    /// @brief Observed interval between energy counter updates (s).
+    double update_interval;
+};
+
+/// @brief Start a precision energy window. The energy status counters update
+/// about once per millisecond, so reading them at an arbitrary phase leaves
+/// up to one update of error at each end of a window. Instead, the start of
+/// the window waits for the next update of each socket's counter and
+/// timestamps it with the timestamp counter. The update interval is measured
+/// by polling the counter on first use (a few tens of milliseconds).
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Haswell
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @return 0 if successful, otherwise -1
+int variorum_start_energy_window(void);
+
+/// @brief End a precision energy window at the next update of each socket's
+/// energy counter and report the energy with an error bound.
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Haswell
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @param [out] window Energy, error bound and length of the window.
+///
+/// @return 0 if successful, otherwise -1 (e.g., no window was started)
+int variorum_stop_energy_window(struct variorum_energy_window *window);
+
+/***************************/
+/* Region Energy Profiling */
+/***************************/
+/// @brief Open a named region on the calling thread. Only the energy
+/// counters (package, DRAM and GPU where available) are read. Regions nest and
+/// may be used from several threads (e.g., OpenMP); each thread keeps its own
+/// stack of open regions. Per-region energy, time and call counts accumulate
+/// in a table that is written when the process exits, to stdout or to the
+/// file named by VARIORUM_REGION_PROFILE.
+///
+/// The platform stays initialized between region calls, so a begin/end pair
+/// costs a few counter reads. With VARIORUM_REGION_SAMPLER_MS set, a
+/// background thread reads the counters at that interval and begin/end only
+/// copy its latest snapshot, at the cost of energy resolution.
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Haswell
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @param [in] name Region name.
+///
+/// @return 0 if successful, otherwise -1
+int variorum_region_begin(const char *name);
+
+/// @brief Close the innermost open region of the calling thread and add its
+/// energy and time to the region's totals. Totals of enclosing regions
+/// include nested ones.
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Haswell
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @param [in] name Region name, must match the innermost open region.
+///
+/// @return 0 if successful, otherwise -1
+int variorum_region_end(const char *name);
+
+/// @brief Print the accumulated energy, time, call count and average power
+/// of each region.
+///
+/// @supparch
+/// - All architectures
+///
+/// @return 0 if successful, otherwise -1
+int variorum_print_region_summary(void);
+
+/*********************************/
+/* Shared Memory Node Telemetry  */
+/*********************************/
+/// @brief Start publishing node energy and power into a POSIX shared memory
+/// segment. A background thread reads the energy counters every interval and
+/// writes the sample, together with a ring of the latest samples, under a
+/// sequence lock. Any local process can then map the segment read-only with
+/// variorum_telemetry_attach() (see variorum_telemetry.h) and read consistent
+/// samples without privileges or system calls, so many tools and ranks on a
+/// node share one sampler.
+///
+/// @supparch
+/// - Intel Sandy Bridge
+/// - Intel Ivy Bridge
+/// - Intel Haswell
+/// - Intel Broadwell
+/// - Intel Skylake
+/// - Intel Kaby Lake
+/// - Intel Cascade Lake
+/// - Intel Cooper Lake
+///
+/// @param [in] name POSIX shared memory name, or NULL for
+///             "/variorum-telemetry".
+/// @param [in] interval_ms Sampling interval in milliseconds.
+/// @param [in] history_len Number of samples kept in the ring.
+///
+/// @return 0 if successful, otherwise -1 (e.g., another publisher owns the
+/// segment)
+int variorum_start_telemetry_publisher(const char *name, int interval_ms,
+                                       int history_len);
+
+/// @brief Stop the publisher of this process and remove its segment.
+///
+/// @supparch
+/// - All architectures
+///
+/// @return 0 if successful, otherwise -1 (no publisher was started)
+int variorum_stop_telemetry_publisher(void);
+
+/**************************/
+/* Monitoring Output Mode */
+/**************************/
+/// @brief Output formats of variorum_monitoring() in verbose mode.
+enum variorum_monitoring_format_e
+{
+    /// @brief Human-readable _VAR_MONITOR lines (default).
+    VARIORUM_MONITORING_TEXT = 0,
+    /// @brief Delta/varint encoded binary trace.
+    VARIORUM_MONITORING_ENCODED = 1,
+    /// @brief Encoded binary trace with zstd-compressed blocks.
+    VARIORUM_MONITORING_ENCODED_ZSTD = 2,
+};
+
+/// @brief Select the output format of variorum_monitoring(). The encoded
+/// formats write a compact binary trace that can be decoded with
+/// scripts/var_monitor-decode-trace.py. Floating-point columns are stored
+/// with 6 decimal digits, matching the text output.
+///
+/// @supparch
+/// - Intel Sandy Bridge and newer
+///
+/// @param [in] format One of enum variorum_monitoring_format_e.
+///
+/// @return 0 if successful, otherwise -1 (e.g., zstd was requested but
+/// Variorum was built without it)
+int variorum_set_monitoring_format(int format);
+
+/// @brief Write out any samples buffered by an encoded monitoring trace.
+///
+/// @supparch
+/// - All architectures
+///
+/// @return 0 if successful, otherwise -1
+int variorum_monitoring_flush(void);
+
 /// @brief Returns Variorum version as a constant string.
 ///
 /// @supparch
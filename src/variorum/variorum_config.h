@@ -0,0 +1,30 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_CONFIG_H
+#define VARIORUM_CONFIG_H
+
+#define VARIORUM_WITH_INTEL_CPU    ON
+/* #undef VARIORUM_WITH_INTEL_GPU */
+/* #undef VARIORUM_WITH_AMD_CPU */
+/* #undef VARIORUM_WITH_IBM_CPU */
+/* #undef VARIORUM_WITH_NVIDIA_GPU */
+/* #undef VARIORUM_WITH_ARM_CPU */
+/* #undef VARIORUM_WITH_AMD_GPU */
+/* #undef VARIORUM_DEBUG */
+
+#define VARIORUM_INSTALL_PREFIX "/usr/local"
+
+#define VARIORUM_VERSION 0.5.0
+
+#define VARIORUM_CXX_COMPILER "/usr/bin/c++"
+
+#define VARIORUM_C_COMPILER "/usr/bin/cc"
+
+/* #undef VARIORUM_FORTRAN_COMPILER */
+
+#define VARIORUM_SYSTEM_TYPE "Linux-6.18.44-fc-v139"
+
+#endif
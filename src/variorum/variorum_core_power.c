@@ -0,0 +1,314 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <variorum_core_power.h>
+
+int variorum_core_power_init(struct variorum_core_power *cp, unsigned ncores,
+                             const unsigned *core_ccd, unsigned nccds,
+                             const unsigned *ccd_socket, double joules_per_tick)
+{
+    unsigned i;
+
+    memset(cp, 0, sizeof(*cp));
+    if (ncores == 0 || nccds == 0)
+    {
+        return -1;
+    }
+    cp->ncores = ncores;
+    cp->nccds = nccds;
+    cp->joules_per_tick = joules_per_tick;
+    cp->core_ccd = (unsigned *) malloc(ncores * sizeof(unsigned));
+    cp->ccd_socket = (unsigned *) malloc(nccds * sizeof(unsigned));
+    cp->prev = (uint64_t *) calloc(ncores, sizeof(uint64_t));
+    cp->ticks = (uint64_t *) calloc(ncores, sizeof(uint64_t));
+    cp->delta = (uint64_t *) calloc(ncores, sizeof(uint64_t));
+    cp->core_joules = (double *) calloc(ncores, sizeof(double));
+    cp->core_watts = (double *) calloc(ncores, sizeof(double));
+    cp->ccd_watts = (double *) calloc(nccds, sizeof(double));
+    if (cp->core_ccd == NULL || cp->ccd_socket == NULL || cp->prev == NULL ||
+            cp->ticks == NULL || cp->delta == NULL || cp->core_joules == NULL ||
+            cp->core_watts == NULL || cp->ccd_watts == NULL)
+    {
+        variorum_core_power_free(cp);
+        return -1;
+    }
+    for (i = 0; i < ncores; i++)
+    {
+        cp->core_ccd[i] = core_ccd[i] < nccds ? core_ccd[i] : nccds - 1;
+    }
+    for (i = 0; i < nccds; i++)
+    {
+        cp->ccd_socket[i] = ccd_socket[i];
+        if (ccd_socket[i] + 1 > cp->nsockets)
+        {
+            cp->nsockets = ccd_socket[i] + 1;
+        }
+    }
+    cp->socket_watts = (double *) calloc(cp->nsockets, sizeof(double));
+    if (cp->socket_watts == NULL)
+    {
+        variorum_core_power_free(cp);
+        return -1;
+    }
+    return 0;
+}
+
+/* The per-core loops have no branches and no aliasing, so each one
+ * vectorizes: subtraction in the width of the counter (which absorbs a
+ * wraparound), widening add, and conversion and scaling to joules and
+ * watts. */
+static void extend_counters(unsigned n, const uint32_t *restrict raw,
+                            uint64_t *restrict prev, uint64_t *restrict delta,
+                            uint64_t *restrict ticks)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+    {
+        delta[i] = (uint32_t)(raw[i] - (uint32_t)prev[i]);
+        prev[i] = raw[i];
+        ticks[i] += delta[i];
+    }
+}
+
+static void extend_counters64(unsigned n, const uint64_t *restrict raw,
+                              uint64_t *restrict prev, uint64_t *restrict delta,
+                              uint64_t *restrict ticks)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+    {
+        delta[i] = raw[i] - prev[i];
+        prev[i] = raw[i];
+        ticks[i] += delta[i];
+    }
+}
+
+static void scale_counters(unsigned n, const uint64_t *restrict delta,
+                           const uint64_t *restrict ticks, double joules_per_tick,
+                           double watts_per_tick, double *restrict joules,
+                           double *restrict watts)
+{
+    unsigned i;
+
+    for (i = 0; i < n; i++)
+    {
+        joules[i] = (double)ticks[i] * joules_per_tick;
+        watts[i] = (double)delta[i] * watts_per_tick;
+    }
+}
+
+/* Returns 1 for the first sample, which only sets the baseline. */
+static int start_update(struct variorum_core_power *cp, uint64_t now_ns)
+{
+    if (cp->nsamples == 0)
+    {
+        cp->last_ns = now_ns;
+        cp->nsamples = 1;
+        return 1;
+    }
+    cp->elapsed_ns = now_ns - cp->last_ns;
+    cp->last_ns = now_ns;
+    return 0;
+}
+
+static void finish_update(struct variorum_core_power *cp)
+{
+    double watts_per_tick = 0.0;
+    unsigned i;
+
+    if (cp->elapsed_ns > 0)
+    {
+        watts_per_tick = cp->joules_per_tick * 1e9 / cp->elapsed_ns;
+    }
+    scale_counters(cp->ncores, cp->delta, cp->ticks, cp->joules_per_tick,
+                   watts_per_tick, cp->core_joules, cp->core_watts);
+
+    memset(cp->ccd_watts, 0, cp->nccds * sizeof(double));
+    memset(cp->socket_watts, 0, cp->nsockets * sizeof(double));
+    for (i = 0; i < cp->ncores; i++)
+    {
+        cp->ccd_watts[cp->core_ccd[i]] += cp->core_watts[i];
+    }
+    for (i = 0; i < cp->nccds; i++)
+    {
+        cp->socket_watts[cp->ccd_socket[i]] += cp->ccd_watts[i];
+    }
+    cp->nsamples++;
+}
+
+void variorum_core_power_update(struct variorum_core_power *cp,
+                                const uint32_t *raw, uint64_t now_ns)
+{
+    unsigned i;
+
+    if (start_update(cp, now_ns))
+    {
+        for (i = 0; i < cp->ncores; i++)
+        {
+            cp->prev[i] = raw[i];
+        }
+        return;
+    }
+    extend_counters(cp->ncores, raw, cp->prev, cp->delta, cp->ticks);
+    finish_update(cp);
+}
+
+void variorum_core_power_update64(struct variorum_core_power *cp,
+                                  const uint64_t *raw, uint64_t now_ns)
+{
+    if (start_update(cp, now_ns))
+    {
+        memcpy(cp->prev, raw, cp->ncores * sizeof(uint64_t));
+        return;
+    }
+    extend_counters64(cp->ncores, raw, cp->prev, cp->delta, cp->ticks);
+    finish_update(cp);
+}
+
+void variorum_core_power_get_sample(const struct variorum_core_power *cp,
+                                    struct variorum_core_power_sample *sample)
+{
+    sample->ncores = cp->ncores;
+    sample->nccds = cp->nccds;
+    sample->nsockets = cp->nsockets;
+    sample->core_ccd = cp->core_ccd;
+    sample->ccd_socket = cp->ccd_socket;
+    sample->core_joules = cp->core_joules;
+    sample->core_watts = cp->core_watts;
+    sample->ccd_watts = cp->ccd_watts;
+    sample->socket_watts = cp->socket_watts;
+    sample->elapsed_ns = cp->elapsed_ns;
+}
+
+void variorum_core_power_to_json(const struct variorum_core_power *cp,
+                                 json_t *node_obj)
+{
+    char key[32];
+    unsigned s, i;
+
+    for (s = 0; s < cp->nsockets; s++)
+    {
+        snprintf(key, sizeof(key), "socket_%u", s);
+        json_t *socket_obj = json_object_get(node_obj, key);
+        if (socket_obj == NULL)
+        {
+            socket_obj = json_object();
+            json_object_set_new(node_obj, key, socket_obj);
+        }
+        json_object_set_new(socket_obj, "power_cores_watts",
+                            json_real(cp->socket_watts[s]));
+
+        json_t *ccd_obj = json_object();
+        json_object_set_new(socket_obj, "ccd", ccd_obj);
+        for (i = 0; i < cp->nccds; i++)
+        {
+            if (cp->ccd_socket[i] != s)
+            {
+                continue;
+            }
+            snprintf(key, sizeof(key), "ccd_%u_power_watts", i);
+            json_object_set_new(ccd_obj, key, json_real(cp->ccd_watts[i]));
+        }
+
+        json_t *core_obj = json_object();
+        json_object_set_new(socket_obj, "core", core_obj);
+        for (i = 0; i < cp->ncores; i++)
+        {
+            if (cp->ccd_socket[cp->core_ccd[i]] != s)
+            {
+                continue;
+            }
+            snprintf(key, sizeof(key), "core_%u_power_watts", i);
+            json_object_set_new(core_obj, key, json_real(cp->core_watts[i]));
+        }
+    }
+}
+
+int variorum_core_power_trace_open(const struct variorum_core_power *cp,
+                                   struct variorum_trace *t, FILE *out)
+{
+    unsigned ncols = cp->ncores + cp->nccds + cp->nsockets;
+    unsigned i, col = 0;
+    char **names;
+    int err;
+
+    names = (char **) calloc(ncols, sizeof(char *));
+    if (names == NULL)
+    {
+        return -1;
+    }
+    for (i = 0; i < cp->ncores; i++, col++)
+    {
+        names[col] = (char *) malloc(32);
+        snprintf(names[col], 32, "core%u_mwatts", i);
+    }
+    for (i = 0; i < cp->nccds; i++, col++)
+    {
+        names[col] = (char *) malloc(32);
+        snprintf(names[col], 32, "ccd%u_mwatts", i);
+    }
+    for (i = 0; i < cp->nsockets; i++, col++)
+    {
+        names[col] = (char *) malloc(32);
+        snprintf(names[col], 32, "socket%u_mwatts", i);
+    }
+    err = variorum_trace_open(t, out, ncols, (const char *const *) names, NULL,
+                              VARIORUM_TRACE_BLOCK_ROWS, 0);
+    for (i = 0; i < ncols; i++)
+    {
+        free(names[i]);
+    }
+    free(names);
+    return err;
+}
+
+int variorum_core_power_trace_append(const struct variorum_core_power *cp,
+                                     struct variorum_trace *t)
+{
+    unsigned ncols = cp->ncores + cp->nccds + cp->nsockets;
+    int64_t *values;
+    unsigned i, col = 0;
+    int err;
+
+    values = (int64_t *) malloc(ncols * sizeof(int64_t));
+    if (values == NULL)
+    {
+        return -1;
+    }
+    for (i = 0; i < cp->ncores; i++)
+    {
+        values[col++] = (int64_t)(cp->core_watts[i] * 1000 + 0.5);
+    }
+    for (i = 0; i < cp->nccds; i++)
+    {
+        values[col++] = (int64_t)(cp->ccd_watts[i] * 1000 + 0.5);
+    }
+    for (i = 0; i < cp->nsockets; i++)
+    {
+        values[col++] = (int64_t)(cp->socket_watts[i] * 1000 + 0.5);
+    }
+    err = variorum_trace_append(t, (int64_t)cp->last_ns, values);
+    free(values);
+    return err;
+}
+
+void variorum_core_power_free(struct variorum_core_power *cp)
+{
+    free(cp->core_ccd);
+    free(cp->ccd_socket);
+    free(cp->prev);
+    free(cp->ticks);
+    free(cp->delta);
+    free(cp->core_joules);
+    free(cp->core_watts);
+    free(cp->ccd_watts);
+    free(cp->socket_watts);
+    memset(cp, 0, sizeof(*cp));
+}
@@ -0,0 +1,156 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_CORE_POWER_H_INCLUDE
+#define VARIORUM_CORE_POWER_H_INCLUDE
+
+#include <jansson.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <variorum.h>
+#include <variorum_trace.h>
+
+/// @brief Per-core energy and power time series.
+///
+/// The per-core energy counters (32-bit MSRs or the 64-bit E-SMI counters)
+/// are read into one contiguous array per sample and extended to 64 bits. All per-core state is stored as
+/// separate arrays (structure of arrays), so a sample is a few passes of
+/// straight-line arithmetic over ncores elements that the compiler turns
+/// into vector instructions. Core power is then summed per CCD and per
+/// socket.
+struct variorum_core_power
+{
+    /// @brief Number of cores, CCDs, and sockets.
+    unsigned ncores;
+    unsigned nccds;
+    unsigned nsockets;
+    /// @brief CCD of each core, ncores entries.
+    unsigned *core_ccd;
+    /// @brief Socket of each CCD, nccds entries.
+    unsigned *ccd_socket;
+    /// @brief Energy of one counter increment (J).
+    double joules_per_tick;
+    /// @brief Raw counter values of the previous sample.
+    uint64_t *prev;
+    /// @brief Counters extended to 64 bits.
+    uint64_t *ticks;
+    /// @brief Increments of the last interval.
+    uint64_t *delta;
+    /// @brief Energy since the first sample (J).
+    double *core_joules;
+    /// @brief Power over the last interval (W).
+    double *core_watts;
+    double *ccd_watts;
+    double *socket_watts;
+    /// @brief Timestamp of the previous sample (ns).
+    uint64_t last_ns;
+    /// @brief Length of the last interval (ns).
+    uint64_t elapsed_ns;
+    /// @brief Number of samples taken.
+    uint64_t nsamples;
+};
+
+/// @brief Allocate a time series.
+///
+/// @param [out] cp Time series.
+/// @param [in] ncores Number of cores.
+/// @param [in] core_ccd CCD of each core.
+/// @param [in] nccds Number of CCDs.
+/// @param [in] ccd_socket Socket of each CCD.
+/// @param [in] joules_per_tick Energy of one counter increment (J).
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_core_power_init(
+    struct variorum_core_power *cp,
+    unsigned ncores,
+    const unsigned *core_ccd,
+    unsigned nccds,
+    const unsigned *ccd_socket,
+    double joules_per_tick
+);
+
+/// @brief Add a sample of the raw 32-bit counters of every core.
+///
+/// The first sample only sets the baseline. Counters may wrap at most once
+/// between consecutive samples.
+///
+/// @param [in,out] cp Time series.
+/// @param [in] raw Counter of each core, ncores entries.
+/// @param [in] now_ns Time of the sample (ns).
+void variorum_core_power_update(
+    struct variorum_core_power *cp,
+    const uint32_t *raw,
+    uint64_t now_ns
+);
+
+/// @brief Add a sample of the raw 64-bit counters of every core, such as the
+/// E-SMI energy counters, which do not wrap in practice.
+///
+/// The first sample only sets the baseline.
+///
+/// @param [in,out] cp Time series.
+/// @param [in] raw Counter of each core, ncores entries.
+/// @param [in] now_ns Time of the sample (ns).
+void variorum_core_power_update64(
+    struct variorum_core_power *cp,
+    const uint64_t *raw,
+    uint64_t now_ns
+);
+
+/// @brief Describe the last sample.
+///
+/// @param [in] cp Time series.
+/// @param [out] sample Arrays of the time series, valid until the next
+///              update.
+void variorum_core_power_get_sample(
+    const struct variorum_core_power *cp,
+    struct variorum_core_power_sample *sample
+);
+
+/// @brief Add the power of each core, CCD, and socket of the last sample to
+/// a node object, as socket_<s>: {power_cores_watts, ccd: {...}, core: {...}}.
+///
+/// @param [in] cp Time series.
+/// @param [out] node_obj Node object.
+void variorum_core_power_to_json(
+    const struct variorum_core_power *cp,
+    json_t *node_obj
+);
+
+/// @brief Start an encoded trace with one column per core, CCD, and socket
+/// power, in milliwatts.
+///
+/// @param [in] cp Time series.
+/// @param [out] t Trace.
+/// @param [in] out Destination file.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_core_power_trace_open(
+    const struct variorum_core_power *cp,
+    struct variorum_trace *t,
+    FILE *out
+);
+
+/// @brief Append the last sample to a trace started with
+/// variorum_core_power_trace_open().
+///
+/// @param [in] cp Time series.
+/// @param [in,out] t Trace.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_core_power_trace_append(
+    const struct variorum_core_power *cp,
+    struct variorum_trace *t
+);
+
+/// @brief Release a time series.
+///
+/// @param [in,out] cp Time series.
+void variorum_core_power_free(
+    struct variorum_core_power *cp
+);
+
+#endif
@@ -0,0 +1,175 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <variorum_counter_mux.h>
+#include <variorum_error.h>
+
+static const struct variorum_pmc_event *find_event(
+    const struct variorum_pmc_event *table, unsigned ntable, const char *name)
+{
+    unsigned i;
+
+    for (i = 0; i < ntable; i++)
+    {
+        if (strcmp(table[i].name, name) == 0)
+        {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+int variorum_counter_mux_init(struct variorum_counter_mux *mux,
+                              const struct variorum_pmc_event *table,
+                              unsigned ntable, const char *names,
+                              unsigned ncounters, unsigned nthreads)
+{
+    char list[VARIORUM_COUNTER_MUX_LIST_MAX];
+    char *tok, *save = NULL;
+    unsigned i;
+
+    memset(mux, 0, sizeof(*mux));
+    if (ncounters == 0 || nthreads == 0)
+    {
+        return -1;
+    }
+    mux->events = (const struct variorum_pmc_event **)
+                  malloc(ntable * sizeof(*mux->events));
+    if (mux->events == NULL)
+    {
+        return -1;
+    }
+
+    if (names == NULL)
+    {
+        for (i = 0; i < ntable; i++)
+        {
+            mux->events[mux->nevents++] = &table[i];
+        }
+    }
+    else
+    {
+        if (strlen(names) >= sizeof(list))
+        {
+            variorum_counter_mux_free(mux);
+            return -1;
+        }
+        strcpy(list, names);
+        for (tok = strtok_r(list, ",", &save); tok != NULL;
+                tok = strtok_r(NULL, ",", &save))
+        {
+            const struct variorum_pmc_event *e = find_event(table, ntable, tok);
+            if (e == NULL)
+            {
+                variorum_error_handler("Unknown performance monitoring event",
+                                       VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                                       __FILE__, __FUNCTION__, __LINE__);
+                variorum_counter_mux_free(mux);
+                return -1;
+            }
+            if (mux->nevents == ntable)
+            {
+                /* Duplicates beyond the table size. */
+                variorum_counter_mux_free(mux);
+                return -1;
+            }
+            mux->events[mux->nevents++] = e;
+        }
+    }
+    if (mux->nevents == 0)
+    {
+        variorum_counter_mux_free(mux);
+        return -1;
+    }
+
+    mux->nthreads = nthreads;
+    mux->ncounters = ncounters;
+    mux->ngroups = (mux->nevents + ncounters - 1) / ncounters;
+    mux->rate = (double *) calloc((size_t)nthreads * mux->nevents,
+                                  sizeof(double));
+    mux->deltas = (double *) calloc((size_t)nthreads * mux->nevents,
+                                    sizeof(double));
+    mux->running_ns = (uint64_t *) calloc(mux->nevents, sizeof(uint64_t));
+    if (mux->rate == NULL || mux->deltas == NULL || mux->running_ns == NULL)
+    {
+        variorum_counter_mux_free(mux);
+        return -1;
+    }
+    return 0;
+}
+
+unsigned variorum_counter_mux_group_size(const struct variorum_counter_mux
+                                         *mux, unsigned group)
+{
+    unsigned first = group * mux->ncounters;
+
+    if (first >= mux->nevents)
+    {
+        return 0;
+    }
+    return mux->nevents - first < mux->ncounters ? mux->nevents - first :
+           mux->ncounters;
+}
+
+const struct variorum_pmc_event *variorum_counter_mux_event(
+    const struct variorum_counter_mux *mux, unsigned group, unsigned slot)
+{
+    if (slot >= variorum_counter_mux_group_size(mux, group))
+    {
+        return NULL;
+    }
+    return mux->events[group * mux->ncounters + slot];
+}
+
+unsigned variorum_counter_mux_update(struct variorum_counter_mux *mux,
+                                     const uint64_t *raw, uint64_t elapsed_ns)
+{
+    unsigned first = mux->active * mux->ncounters;
+    unsigned size = variorum_counter_mux_group_size(mux, mux->active);
+    unsigned t, e;
+
+    for (t = 0; t < mux->nthreads; t++)
+    {
+        double *rate = &mux->rate[(size_t)t * mux->nevents];
+        double *delta = &mux->deltas[(size_t)t * mux->nevents];
+
+        for (e = 0; e < mux->nevents; e++)
+        {
+            if (e >= first && e < first + size)
+            {
+                uint64_t count = raw[(size_t)t * mux->ncounters + (e - first)];
+                delta[e] = (double)count;
+                if (elapsed_ns > 0)
+                {
+                    rate[e] = (double)count / (double)elapsed_ns;
+                }
+            }
+            else
+            {
+                delta[e] = rate[e] * (double)elapsed_ns;
+            }
+        }
+    }
+    for (e = first; e < first + size; e++)
+    {
+        mux->running_ns[e] += elapsed_ns;
+    }
+    mux->enabled_ns += elapsed_ns;
+
+    mux->active = (mux->active + 1) % mux->ngroups;
+    return mux->active;
+}
+
+void variorum_counter_mux_free(struct variorum_counter_mux *mux)
+{
+    free(mux->events);
+    free(mux->rate);
+    free(mux->deltas);
+    free(mux->running_ns);
+    memset(mux, 0, sizeof(*mux));
+}
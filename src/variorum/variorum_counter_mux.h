@@ -0,0 +1,111 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_COUNTER_MUX_H_INCLUDE
+#define VARIORUM_COUNTER_MUX_H_INCLUDE
+
+#include <stdint.h>
+
+/// @brief Maximum length of an event list passed to
+/// variorum_counter_mux_init().
+#define VARIORUM_COUNTER_MUX_LIST_MAX 1024
+
+/// @brief Programmable performance monitoring event, as encoded in
+/// IA32_PERFEVTSELx.
+struct variorum_pmc_event
+{
+    /// @brief Event name, e.g., LONGEST_LAT_CACHE.MISS.
+    const char *name;
+    /// @brief Event select [7:0].
+    uint8_t event;
+    /// @brief Unit mask [15:8].
+    uint8_t umask;
+    /// @brief Counter mask [31:24].
+    uint8_t cmask;
+};
+
+/// @brief Time-multiplexing state for more events than programmable
+/// counters.
+///
+/// Events are split into groups of at most ncounters. One group is active per
+/// sampling interval and the groups rotate round-robin. For events of the
+/// active group the interval delta is the measured count; for the other
+/// events it is extrapolated from the rate observed the last time their group
+/// was active.
+struct variorum_counter_mux
+{
+    /// @brief Number of hardware threads.
+    unsigned nthreads;
+    /// @brief Number of selected events.
+    unsigned nevents;
+    /// @brief Programmable counters available per thread.
+    unsigned ncounters;
+    /// @brief Number of event groups.
+    unsigned ngroups;
+    /// @brief Group counting in the current interval.
+    unsigned active;
+    /// @brief Selected events, in group order.
+    const struct variorum_pmc_event **events;
+    /// @brief Last observed rate per thread and event (counts/ns).
+    double *rate;
+    /// @brief Interval deltas per thread and event, row-major by thread.
+    double *deltas;
+    /// @brief Total time each event was counted (ns).
+    uint64_t *running_ns;
+    /// @brief Total time since the first interval (ns).
+    uint64_t enabled_ns;
+};
+
+/// @brief Select events from a model's event table and build the groups.
+///
+/// @param [out] mux Multiplexing state.
+/// @param [in] table Events supported by the processor model.
+/// @param [in] ntable Number of entries in table.
+/// @param [in] names Comma-separated event names, or NULL for the whole table.
+/// @param [in] ncounters Programmable counters available per thread.
+/// @param [in] nthreads Number of hardware threads.
+///
+/// @return 0 if successful, otherwise -1 (e.g., unknown event name).
+int variorum_counter_mux_init(
+    struct variorum_counter_mux *mux,
+    const struct variorum_pmc_event *table,
+    unsigned ntable,
+    const char *names,
+    unsigned ncounters,
+    unsigned nthreads
+);
+
+/// @brief Number of events in a group.
+unsigned variorum_counter_mux_group_size(
+    const struct variorum_counter_mux *mux,
+    unsigned group
+);
+
+/// @brief Event programmed on a counter slot of a group, or NULL.
+const struct variorum_pmc_event *variorum_counter_mux_event(
+    const struct variorum_counter_mux *mux,
+    unsigned group,
+    unsigned slot
+);
+
+/// @brief Account one interval of the active group and rotate.
+///
+/// @param [in] raw Counts of the active group, indexed
+///        [thread * ncounters + slot].
+/// @param [in] elapsed_ns Length of the interval.
+///
+/// @return Group to program for the next interval.
+unsigned variorum_counter_mux_update(
+    struct variorum_counter_mux *mux,
+    const uint64_t *raw,
+    uint64_t elapsed_ns
+);
+
+/// @brief Release the multiplexing state.
+void variorum_counter_mux_free(
+    struct variorum_counter_mux *mux
+);
+
+#endif
@@ -0,0 +1,451 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <variorum.h>
+#include <variorum_daemon.h>
+#include <variorum_error.h>
+
+struct daemon_client
+{
+    int fd;
+    uid_t uid;
+    /* A power request waits for the next hardware read. */
+    int pending;
+    uint32_t seq;
+};
+
+static struct
+{
+    struct daemon_client *clients;
+    int nclients;
+    struct pollfd *fds;
+    /* Start of the open coalescing window, 0 if none is open. */
+    double window_start;
+    int have_last;
+    double last_time;
+    struct variorum_energy_counters origin;
+    struct variorum_energy_counters last;
+    double watts[3];
+    uint64_t requests;
+    uint64_t hardware_reads;
+} server;
+
+static const struct variorum_daemon_backend platform_backend =
+{
+    variorum_region_read_counters,
+    variorum_cap_best_effort_node_power_limit,
+    variorum_cap_each_socket_power_limit,
+};
+
+static double daemon_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+void variorum_daemon_default_config(struct variorum_daemon_config *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->socket_path = VARIORUM_DAEMON_DEFAULT_SOCKET;
+    config->coalesce_us = 1000;
+    config->max_clients = 256;
+    config->policy.min_node_watts = 1;
+    config->policy.max_node_watts = 1 << 20;
+    config->policy.min_socket_watts = 1;
+    config->policy.max_socket_watts = 1 << 20;
+}
+
+int variorum_daemon_check_cap(const struct variorum_daemon_policy *policy,
+                              uid_t uid, int op, int watts)
+{
+    int i, allowed = uid == 0;
+
+    for (i = 0; i < policy->num_cap_uids && !allowed; i++)
+    {
+        allowed = policy->cap_uids[i] == uid;
+    }
+    if (!allowed)
+    {
+        return VARIORUM_DAEMON_EPERM;
+    }
+    switch (op)
+    {
+        case VARIORUM_DAEMON_OP_CAP_NODE_POWER:
+            return watts < policy->min_node_watts || watts > policy->max_node_watts ?
+                   VARIORUM_DAEMON_EPERM : VARIORUM_DAEMON_OK;
+        case VARIORUM_DAEMON_OP_CAP_SOCKET_POWER:
+            return watts < policy->min_socket_watts ||
+                   watts > policy->max_socket_watts ?
+                   VARIORUM_DAEMON_EPERM : VARIORUM_DAEMON_OK;
+        default:
+            return VARIORUM_DAEMON_EINVAL;
+    }
+}
+
+static void fill_response(struct variorum_daemon_response *r, int op,
+                          uint32_t seq, int status)
+{
+    memset(r, 0, sizeof(*r));
+    r->magic = VARIORUM_DAEMON_MAGIC;
+    r->version = VARIORUM_DAEMON_VERSION;
+    r->op = op;
+    r->seq = seq;
+    r->status = status;
+    r->requests = server.requests;
+    r->hardware_reads = server.hardware_reads;
+}
+
+static void drop_client(int i)
+{
+    close(server.clients[i].fd);
+    server.clients[i] = server.clients[--server.nclients];
+}
+
+/* Never block on a client: one that stops reading its responses is dropped
+ * once its socket buffer fills, instead of stalling every other client. */
+static int send_response(int i, const struct variorum_daemon_response *r)
+{
+    if (send(server.clients[i].fd, r, sizeof(*r),
+             MSG_NOSIGNAL | MSG_DONTWAIT) != sizeof(*r))
+    {
+        drop_client(i);
+        return -1;
+    }
+    return 0;
+}
+
+/* One hardware read answers every pending power request. */
+static void serve_pending(const struct variorum_daemon_backend *backend)
+{
+    struct variorum_energy_counters now;
+    struct variorum_daemon_response r;
+    double time;
+    int status = VARIORUM_DAEMON_OK;
+    int i;
+
+    server.window_start = 0.0;
+    time = daemon_now();
+    if (backend->read_energy(&now) != 0)
+    {
+        status = VARIORUM_DAEMON_EIO;
+    }
+    else
+    {
+        server.hardware_reads++;
+        if (!server.have_last)
+        {
+            server.origin = now;
+        }
+        else if (time > server.last_time)
+        {
+            server.watts[0] = (now.pkg_joules - server.last.pkg_joules) /
+                              (time - server.last_time);
+            server.watts[1] = (now.dram_joules - server.last.dram_joules) /
+                              (time - server.last_time);
+            server.watts[2] = (now.gpu_joules - server.last.gpu_joules) /
+                              (time - server.last_time);
+        }
+        server.have_last = 1;
+        server.last = now;
+        server.last_time = time;
+    }
+
+    for (i = server.nclients - 1; i >= 0; i--)
+    {
+        if (!server.clients[i].pending)
+        {
+            continue;
+        }
+        server.clients[i].pending = 0;
+        fill_response(&r, VARIORUM_DAEMON_OP_GET_POWER, server.clients[i].seq,
+                      status);
+        if (status == VARIORUM_DAEMON_OK)
+        {
+            r.time = time;
+            r.energy.pkg_joules = now.pkg_joules - server.origin.pkg_joules;
+            r.energy.dram_joules = now.dram_joules - server.origin.dram_joules;
+            r.energy.gpu_joules = now.gpu_joules - server.origin.gpu_joules;
+            r.pkg_watts = server.watts[0];
+            r.dram_watts = server.watts[1];
+            r.gpu_watts = server.watts[2];
+        }
+        send_response(i, &r);
+    }
+}
+
+static void handle_request(int i, const struct variorum_daemon_config *config,
+                           const struct variorum_daemon_backend *backend)
+{
+    struct daemon_client *c = &server.clients[i];
+    struct variorum_daemon_request req;
+    struct variorum_daemon_response r;
+    ssize_t len;
+    int status, err;
+
+    len = recv(c->fd, &req, sizeof(req), MSG_DONTWAIT);
+    if (len == 0 || (len < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        drop_client(i);
+        return;
+    }
+    if (len < 0)
+    {
+        return;
+    }
+    server.requests++;
+    if (len != sizeof(req) || req.magic != VARIORUM_DAEMON_MAGIC ||
+            req.version != VARIORUM_DAEMON_VERSION)
+    {
+        fill_response(&r, 0, len >= 12 ? req.seq : 0, VARIORUM_DAEMON_EINVAL);
+        send_response(i, &r);
+        return;
+    }
+    switch (req.op)
+    {
+        case VARIORUM_DAEMON_OP_GET_POWER:
+            c->pending = 1;
+            c->seq = req.seq;
+            if (server.window_start == 0.0)
+            {
+                server.window_start = daemon_now();
+            }
+            return;
+        case VARIORUM_DAEMON_OP_CAP_NODE_POWER:
+        case VARIORUM_DAEMON_OP_CAP_SOCKET_POWER:
+            status = variorum_daemon_check_cap(&config->policy, c->uid, req.op,
+                                               req.arg);
+            if (status == VARIORUM_DAEMON_OK)
+            {
+                err = req.op == VARIORUM_DAEMON_OP_CAP_NODE_POWER ?
+                      backend->cap_best_effort_node_power_limit(req.arg) :
+                      backend->cap_each_socket_power_limit(req.arg);
+                status = err ? VARIORUM_DAEMON_EIO : VARIORUM_DAEMON_OK;
+            }
+            break;
+        default:
+            status = VARIORUM_DAEMON_EINVAL;
+            break;
+    }
+    fill_response(&r, req.op, req.seq, status);
+    send_response(i, &r);
+}
+
+static void accept_client(int listen_fd, int max_clients)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return;
+    }
+    /* Caps are authorized by the kernel's view of the peer, not by
+     * anything the client sends. */
+    if (server.nclients == max_clients ||
+            getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+    {
+        close(fd);
+        return;
+    }
+    server.clients[server.nclients].fd = fd;
+    server.clients[server.nclients].uid = cred.uid;
+    server.clients[server.nclients].pending = 0;
+    server.nclients++;
+}
+
+static int listen_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            chmod(path, 0666) != 0 || listen(fd, 64) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int variorum_daemon_serve(const struct variorum_daemon_config *config,
+                          const struct variorum_daemon_backend *backend,
+                          volatile int *stop)
+{
+    int listen_fd, i, n;
+    double now, remaining;
+    struct timespec timeout;
+
+    if (backend == NULL)
+    {
+        backend = &platform_backend;
+    }
+    listen_fd = listen_socket(config->socket_path);
+    if (listen_fd < 0)
+    {
+        variorum_error_handler("Could not listen on daemon socket",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    memset(&server, 0, sizeof(server));
+    server.clients = (struct daemon_client *) malloc(config->max_clients * sizeof(
+                         struct daemon_client));
+    server.fds = (struct pollfd *) malloc((config->max_clients + 1) * sizeof(
+                                              struct pollfd));
+    if (server.clients == NULL || server.fds == NULL)
+    {
+        free(server.clients);
+        free(server.fds);
+        close(listen_fd);
+        unlink(config->socket_path);
+        return -1;
+    }
+
+    while (!*stop)
+    {
+        /* Wait for the rest of an open window, otherwise for a request. */
+        remaining = 0.1;
+        if (server.window_start != 0.0)
+        {
+            remaining = server.window_start + config->coalesce_us / 1e6 - daemon_now();
+            remaining = remaining < 0.0 ? 0.0 : remaining;
+        }
+        timeout.tv_sec = (time_t)remaining;
+        timeout.tv_nsec = (long)((remaining - timeout.tv_sec) * 1e9);
+
+        server.fds[0].fd = listen_fd;
+        server.fds[0].events = POLLIN;
+        for (i = 0; i < server.nclients; i++)
+        {
+            server.fds[i + 1].fd = server.clients[i].fd;
+            server.fds[i + 1].events = POLLIN;
+            server.fds[i + 1].revents = 0;
+        }
+        n = server.nclients;
+        if (ppoll(server.fds, n + 1, &timeout, NULL) > 0)
+        {
+            /* Back to front, dropped clients are replaced by the last one. */
+            for (i = n - 1; i >= 0; i--)
+            {
+                if (server.fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+                {
+                    handle_request(i, config, backend);
+                }
+            }
+            if (server.fds[0].revents & POLLIN)
+            {
+                accept_client(listen_fd, config->max_clients);
+            }
+        }
+        now = daemon_now();
+        if (server.window_start != 0.0 &&
+                now >= server.window_start + config->coalesce_us / 1e6)
+        {
+            serve_pending(backend);
+        }
+    }
+
+    for (i = server.nclients - 1; i >= 0; i--)
+    {
+        drop_client(i);
+    }
+    free(server.clients);
+    free(server.fds);
+    close(listen_fd);
+    unlink(config->socket_path);
+    return 0;
+}
+
+int variorum_daemon_connect(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (socket_path == NULL)
+    {
+        socket_path = VARIORUM_DAEMON_DEFAULT_SOCKET;
+    }
+    if (strlen(socket_path) >= sizeof(addr.sun_path))
+    {
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int variorum_daemon_call(int fd, int op, int arg,
+                         struct variorum_daemon_response *response)
+{
+    static uint32_t next_seq = 0;
+    struct variorum_daemon_request req;
+    ssize_t len;
+
+    memset(&req, 0, sizeof(req));
+    req.magic = VARIORUM_DAEMON_MAGIC;
+    req.version = VARIORUM_DAEMON_VERSION;
+    req.op = op;
+    req.seq = __atomic_add_fetch(&next_seq, 1, __ATOMIC_RELAXED);
+    req.arg = arg;
+    if (send(fd, &req, sizeof(req), MSG_NOSIGNAL) != sizeof(req))
+    {
+        return -1;
+    }
+    do
+    {
+        len = recv(fd, response, sizeof(*response), 0);
+    }
+    while (len < 0 && errno == EINTR);
+    if (len != sizeof(*response) || response->magic != VARIORUM_DAEMON_MAGIC ||
+            response->seq != req.seq)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+void variorum_daemon_disconnect(int fd)
+{
+    close(fd);
+}
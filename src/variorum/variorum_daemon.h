@@ -0,0 +1,190 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_DAEMON_H_INCLUDE
+#define VARIORUM_DAEMON_H_INCLUDE
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <variorum_region.h>
+
+/// @brief First word of every message ("VRMD").
+#define VARIORUM_DAEMON_MAGIC 0x444d5256
+/// @brief Protocol version. The daemon rejects other versions.
+#define VARIORUM_DAEMON_VERSION 1
+/// @brief Socket used when none is given.
+#define VARIORUM_DAEMON_DEFAULT_SOCKET "/run/variorumd.sock"
+/// @brief Most UIDs in a cap policy.
+#define VARIORUM_DAEMON_MAX_UIDS 32
+
+/// @brief Requests of the protocol.
+enum variorum_daemon_op
+{
+    /// @brief Read node energy and power.
+    VARIORUM_DAEMON_OP_GET_POWER = 1,
+    /// @brief Set a best-effort node power limit, arg in watts.
+    VARIORUM_DAEMON_OP_CAP_NODE_POWER = 2,
+    /// @brief Set the power limit of each socket, arg in watts.
+    VARIORUM_DAEMON_OP_CAP_SOCKET_POWER = 3,
+};
+
+/// @brief Status codes of a response.
+enum variorum_daemon_status
+{
+    VARIORUM_DAEMON_OK = 0,
+    /// @brief Malformed request or unknown operation.
+    VARIORUM_DAEMON_EINVAL = 1,
+    /// @brief The cap policy denies the request.
+    VARIORUM_DAEMON_EPERM = 2,
+    /// @brief The hardware access failed.
+    VARIORUM_DAEMON_EIO = 3,
+};
+
+/// @brief Fixed-size request. Both ends run on the same node, so fields are
+/// in native byte order.
+struct variorum_daemon_request
+{
+    uint32_t magic;
+    uint16_t version;
+    /// @brief enum variorum_daemon_op.
+    uint16_t op;
+    /// @brief Echoed in the response.
+    uint32_t seq;
+    /// @brief Operation argument, e.g., a power limit in watts.
+    int32_t arg;
+};
+
+/// @brief Fixed-size response.
+struct variorum_daemon_response
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t op;
+    uint32_t seq;
+    /// @brief enum variorum_daemon_status.
+    int32_t status;
+    /// @brief CLOCK_MONOTONIC time of the hardware read (s).
+    double time;
+    /// @brief Energy since the daemon started (J).
+    struct variorum_energy_counters energy;
+    /// @brief Package power between the last two hardware reads (W).
+    double pkg_watts;
+    /// @brief DRAM power between the last two hardware reads (W).
+    double dram_watts;
+    /// @brief GPU power between the last two hardware reads (W).
+    double gpu_watts;
+    /// @brief Requests and hardware reads served by the daemon so far.
+    uint64_t requests;
+    uint64_t hardware_reads;
+};
+
+/// @brief Hardware access of the daemon.
+struct variorum_daemon_backend
+{
+    int (*read_energy)(struct variorum_energy_counters *counters);
+    int (*cap_best_effort_node_power_limit)(int node_power_limit);
+    int (*cap_each_socket_power_limit)(int socket_power_limit);
+};
+
+/// @brief Who may write caps, and within which bounds.
+struct variorum_daemon_policy
+{
+    /// @brief UIDs allowed to write caps besides root.
+    uid_t cap_uids[VARIORUM_DAEMON_MAX_UIDS];
+    int num_cap_uids;
+    /// @brief Node limits outside [min, max] are denied (W).
+    int min_node_watts;
+    int max_node_watts;
+    /// @brief Socket limits outside [min, max] are denied (W).
+    int min_socket_watts;
+    int max_socket_watts;
+};
+
+/// @brief Daemon settings.
+struct variorum_daemon_config
+{
+    /// @brief UNIX domain socket to listen on.
+    const char *socket_path;
+    /// @brief Power requests arriving within this window of the first
+    /// pending one share one hardware read (us).
+    long coalesce_us;
+    /// @brief Most concurrent clients.
+    int max_clients;
+    struct variorum_daemon_policy policy;
+};
+
+/// @brief Fill a configuration with the defaults: the default socket, a
+/// 1 ms window, 256 clients and caps by root only.
+///
+/// @param [out] config Configuration.
+void variorum_daemon_default_config(
+    struct variorum_daemon_config *config
+);
+
+/// @brief Decide whether a client may write a cap.
+///
+/// @param [in] policy Cap policy.
+/// @param [in] uid UID of the client.
+/// @param [in] op VARIORUM_DAEMON_OP_CAP_NODE_POWER or
+///             VARIORUM_DAEMON_OP_CAP_SOCKET_POWER.
+/// @param [in] watts Requested limit.
+///
+/// @return VARIORUM_DAEMON_OK, VARIORUM_DAEMON_EPERM or
+/// VARIORUM_DAEMON_EINVAL.
+int variorum_daemon_check_cap(
+    const struct variorum_daemon_policy *policy,
+    uid_t uid,
+    int op,
+    int watts
+);
+
+/// @brief Serve clients until stop becomes non-zero.
+///
+/// @param [in] config Settings.
+/// @param [in] backend Hardware access, or NULL to use the platform.
+/// @param [in] stop Checked at least every 100 ms.
+///
+/// @return 0 if stopped, otherwise -1 (e.g., the socket could not be
+/// bound).
+int variorum_daemon_serve(
+    const struct variorum_daemon_config *config,
+    const struct variorum_daemon_backend *backend,
+    volatile int *stop
+);
+
+/// @brief Connect to a daemon.
+///
+/// @param [in] socket_path Socket of the daemon, or NULL for the default.
+///
+/// @return Connection file descriptor, or -1.
+int variorum_daemon_connect(
+    const char *socket_path
+);
+
+/// @brief Send a request and wait for its response.
+///
+/// @param [in] fd Connection from variorum_daemon_connect().
+/// @param [in] op enum variorum_daemon_op.
+/// @param [in] arg Operation argument.
+/// @param [out] response Response of the daemon.
+///
+/// @return 0 if a response was received, otherwise -1. The outcome of the
+/// request is in response->status.
+int variorum_daemon_call(
+    int fd,
+    int op,
+    int arg,
+    struct variorum_daemon_response *response
+);
+
+/// @brief Close a connection.
+///
+/// @param [in] fd Connection from variorum_daemon_connect().
+void variorum_daemon_disconnect(
+    int fd
+);
+
+#endif
@@ -0,0 +1,91 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <variorum_energy_window.h>
+
+static int cmp_double(const void *a, const void *b)
+{
+    double da = *(const double *) a;
+    double db = *(const double *) b;
+
+    return da < db ? -1 : (da > db);
+}
+
+double variorum_rapl_update_ticks(const struct variorum_rapl_tick *ticks,
+                                  unsigned nticks)
+{
+    double *gaps;
+    double median;
+    unsigned i;
+
+    if (nticks < 2)
+    {
+        return 0.0;
+    }
+    gaps = (double *) malloc((nticks - 1) * sizeof(double));
+    if (gaps == NULL)
+    {
+        return 0.0;
+    }
+    /* Midpoints of the update brackets; the median ignores updates the
+     * poller observed late. */
+    for (i = 1; i < nticks; i++)
+    {
+        gaps[i - 1] = ((double)ticks[i].before + ticks[i].after) / 2.0 -
+                      ((double)ticks[i - 1].before + ticks[i - 1].after) / 2.0;
+    }
+    qsort(gaps, nticks - 1, sizeof(double), cmp_double);
+    median = gaps[(nticks - 1) / 2];
+    free(gaps);
+    return median;
+}
+
+void variorum_energy_window_compute(const struct variorum_rapl_tick *start,
+                                    const struct variorum_rapl_tick *end,
+                                    const double *units_per_joule,
+                                    unsigned nsockets, double ticks_per_sec,
+                                    double update_ticks,
+                                    struct variorum_energy_window *window)
+{
+    unsigned s;
+    double seconds = 0.0;
+
+    memset(window, 0, sizeof(*window));
+    if (nsockets == 0 || ticks_per_sec <= 0.0)
+    {
+        return;
+    }
+    for (s = 0; s < nsockets; s++)
+    {
+        double t0 = ((double)start[s].before + start[s].after) / 2.0;
+        double t1 = ((double)end[s].before + end[s].after) / 2.0;
+        seconds += (t1 - t0) / ticks_per_sec;
+    }
+    seconds /= nsockets;
+
+    for (s = 0; s < nsockets; s++)
+    {
+        double t0 = ((double)start[s].before + start[s].after) / 2.0;
+        double t1 = ((double)end[s].before + end[s].after) / 2.0;
+        double width = (t1 - t0) / ticks_per_sec;
+        /* Half the bracket of each update. */
+        double uncertain = ((double)(start[s].after - start[s].before) +
+                            (double)(end[s].after - end[s].before)) / 2.0 /
+                           ticks_per_sec;
+        double joules = ((end[s].raw - start[s].raw) & VARIORUM_RAPL_ENERGY_MASK) /
+                        units_per_joule[s];
+        double watts = width > 0.0 ? joules / width : 0.0;
+
+        window->joules += joules;
+        window->error_joules += 1.0 / units_per_joule[s] +
+                                watts * (uncertain + fabs(width - seconds));
+    }
+    window->seconds = seconds;
+    window->update_interval = update_ticks / ticks_per_sec;
+}
@@ -0,0 +1,67 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_ENERGY_WINDOW_H_INCLUDE
+#define VARIORUM_ENERGY_WINDOW_H_INCLUDE
+
+#include <stdint.h>
+
+#include <variorum.h>
+
+/// @brief Width of the RAPL energy status counters.
+#define VARIORUM_RAPL_ENERGY_MASK 0xFFFFFFFFULL
+
+/// @brief Observed update of an energy counter.
+///
+/// The counter is polled until its value changes. The update happened after
+/// the last read that returned the old value started and before the first
+/// read that returned the new value completed.
+struct variorum_rapl_tick
+{
+    /// @brief Counter value after the update.
+    uint64_t raw;
+    /// @brief Timestamp taken before the last read of the old value.
+    uint64_t before;
+    /// @brief Timestamp taken after the first read of the new value.
+    uint64_t after;
+};
+
+/// @brief Median interval between consecutive counter updates.
+///
+/// @param [in] ticks Consecutive updates of one counter.
+/// @param [in] nticks Number of updates, at least 2.
+///
+/// @return Interval in timestamp ticks, 0 if there are fewer than 2 updates.
+double variorum_rapl_update_ticks(
+    const struct variorum_rapl_tick *ticks,
+    unsigned nticks
+);
+
+/// @brief Energy between two aligned updates of each socket's counter.
+///
+/// The error bound covers one energy unit of counter resolution and the
+/// energy, at the window's average power, of the uncertainty in when each
+/// update happened. Sockets update independently, so seconds is the mean of
+/// the per-socket windows and the difference to each socket's window is
+/// added to the bound. The counters are assumed to wrap at most once.
+///
+/// @param [in] start Update that starts the window, one per socket.
+/// @param [in] end Update that ends the window, one per socket.
+/// @param [in] units_per_joule Inverse energy status unit, one per socket.
+/// @param [in] nsockets Number of sockets.
+/// @param [in] ticks_per_sec Timestamp counter frequency.
+/// @param [in] update_ticks Interval between updates in timestamp ticks.
+/// @param [out] window Energy, error bound and length of the window.
+void variorum_energy_window_compute(
+    const struct variorum_rapl_tick *start,
+    const struct variorum_rapl_tick *end,
+    const double *units_per_joule,
+    unsigned nsockets,
+    double ticks_per_sec,
+    double update_ticks,
+    struct variorum_energy_window *window
+);
+
+#endif
@@ -0,0 +1,34 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_JSON_OBJ_H_INCLUDE
+#define VARIORUM_JSON_OBJ_H_INCLUDE
+
+#include <jansson.h>
+
+/// @brief Get the node power as a JSON object, in the same layout as
+/// variorum_get_power_json(). For in-tree tools that walk the sample, so it
+/// is not serialized and parsed again.
+///
+/// @param [out] get_power_obj New JSON object, released by the caller with
+///              json_decref().
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_get_power_json_obj(
+    json_t **get_power_obj
+);
+
+/// @brief Get the node utilization as a JSON object, in the same layout as
+/// variorum_get_utilization_json().
+///
+/// @param [out] get_util_obj New JSON object, released by the caller with
+///              json_decref().
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_get_utilization_json_obj(
+    json_t **get_util_obj
+);
+
+#endif
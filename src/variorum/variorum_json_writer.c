@@ -0,0 +1,313 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <variorum_json_writer.h>
+#include <variorum_self_stats.h>
+
+static int reserve(struct variorum_json_writer *jw, size_t n)
+{
+    size_t need = jw->len + n + 1;
+    size_t newcap;
+    char *newbuf;
+
+    if (!jw->overflow && need <= jw->cap)
+    {
+        return 1;
+    }
+    if (jw->growbuf != NULL && !jw->overflow)
+    {
+        newcap = jw->cap ? jw->cap : 1024;
+        while (newcap < need)
+        {
+            newcap *= 2;
+        }
+        newbuf = realloc(jw->buf, newcap);
+        if (newbuf != NULL)
+        {
+            jw->buf = *jw->growbuf = newbuf;
+            jw->cap = *jw->growcap = newcap;
+            return 1;
+        }
+    }
+    /* Keep counting so the caller learns the required size. */
+    jw->overflow = 1;
+    return 0;
+}
+
+static void put(struct variorum_json_writer *jw, const char *s, size_t n)
+{
+    if (reserve(jw, n))
+    {
+        memcpy(jw->buf + jw->len, s, n);
+    }
+    jw->len += n;
+}
+
+static void putc_(struct variorum_json_writer *jw, char c)
+{
+    if (reserve(jw, 1))
+    {
+        jw->buf[jw->len] = c;
+    }
+    jw->len++;
+}
+
+static void put_spaces(struct variorum_json_writer *jw, int n)
+{
+    static const char spaces[] = "                                ";
+    while (n > 0)
+    {
+        int k = n < (int)(sizeof(spaces) - 1) ? n : (int)(sizeof(spaces) - 1);
+        put(jw, spaces, k);
+        n -= k;
+    }
+}
+
+static void put_escaped(struct variorum_json_writer *jw, const char *s)
+{
+    const char *p;
+    char seq[8];
+
+    putc_(jw, '"');
+    for (p = s; *p != '\0'; p++)
+    {
+        unsigned char c = (unsigned char)*p;
+        switch (c)
+        {
+            case '"':
+                put(jw, "\\\"", 2);
+                break;
+            case '\\':
+                put(jw, "\\\\", 2);
+                break;
+            case '\b':
+                put(jw, "\\b", 2);
+                break;
+            case '\f':
+                put(jw, "\\f", 2);
+                break;
+            case '\n':
+                put(jw, "\\n", 2);
+                break;
+            case '\r':
+                put(jw, "\\r", 2);
+                break;
+            case '\t':
+                put(jw, "\\t", 2);
+                break;
+            default:
+                if (c < 0x20)
+                {
+                    snprintf(seq, sizeof(seq), "\\u%04X", c);
+                    put(jw, seq, 6);
+                }
+                else
+                {
+                    putc_(jw, (char)c);
+                }
+                break;
+        }
+    }
+    putc_(jw, '"');
+}
+
+/* Separator, newline and indentation before a member, then the key. */
+static void begin_member(struct variorum_json_writer *jw, const char *key)
+{
+    if (jw->depth > 0)
+    {
+        if (jw->nonempty[jw->depth])
+        {
+            putc_(jw, ',');
+        }
+        jw->nonempty[jw->depth] = 1;
+        if (jw->indent > 0)
+        {
+            putc_(jw, '\n');
+            put_spaces(jw, jw->indent * jw->depth);
+        }
+    }
+    if (key != NULL)
+    {
+        put_escaped(jw, key);
+        if (jw->indent > 0)
+        {
+            put(jw, ": ", 2);
+        }
+        else
+        {
+            putc_(jw, ':');
+        }
+    }
+}
+
+/* Format a double the same way as jansson (%.17g, always with a '.' or
+ * exponent, no '+' or leading zeros in the exponent). */
+static int format_real(char *out, size_t size, double value)
+{
+    char *start, *end;
+    int length;
+
+    length = snprintf(out, size, "%.17g", value);
+    if (length < 0 || (size_t)length >= size)
+    {
+        return -1;
+    }
+    if (strchr(out, '.') == NULL && strchr(out, 'e') == NULL)
+    {
+        if ((size_t)length + 3 >= size)
+        {
+            return -1;
+        }
+        out[length] = '.';
+        out[length + 1] = '0';
+        out[length + 2] = '\0';
+        length += 2;
+    }
+    start = strchr(out, 'e');
+    if (start)
+    {
+        start++;
+        end = start + 1;
+        if (*start == '-')
+        {
+            start++;
+        }
+        while (*end == '0')
+        {
+            end++;
+        }
+        if (end != start)
+        {
+            memmove(start, end, length - (size_t)(end - out) + 1);
+            length -= (int)(end - start);
+        }
+    }
+    return length;
+}
+
+void variorum_json_writer_init(struct variorum_json_writer *jw, char *buf,
+                               size_t cap, int indent)
+{
+    memset(jw, 0, sizeof(*jw));
+    jw->buf = buf;
+    jw->cap = cap;
+    jw->indent = indent;
+}
+
+void variorum_json_writer_init_growable(struct variorum_json_writer *jw,
+                                        char **buf, size_t *cap, int indent)
+{
+    variorum_json_writer_init(jw, *buf, *cap, indent);
+    jw->growbuf = buf;
+    jw->growcap = cap;
+}
+
+void variorum_json_writer_begin_object(struct variorum_json_writer *jw,
+                                       const char *key)
+{
+    uint64_t t0 = variorum_self_ticks();
+
+    begin_member(jw, key);
+    putc_(jw, '{');
+    if (jw->depth + 1 < VARIORUM_JSON_WRITER_MAX_DEPTH)
+    {
+        jw->depth++;
+        jw->nonempty[jw->depth] = 0;
+    }
+    jw->ticks += variorum_self_ticks() - t0;
+}
+
+void variorum_json_writer_end_object(struct variorum_json_writer *jw)
+{
+    uint64_t t0 = variorum_self_ticks();
+
+    if (jw->depth == 0)
+    {
+        return;
+    }
+    if (jw->nonempty[jw->depth] && jw->indent > 0)
+    {
+        putc_(jw, '\n');
+        put_spaces(jw, jw->indent * (jw->depth - 1));
+    }
+    jw->depth--;
+    putc_(jw, '}');
+    jw->ticks += variorum_self_ticks() - t0;
+}
+
+void variorum_json_writer_real(struct variorum_json_writer *jw,
+                               const char *key, double value)
+{
+    uint64_t t0 = variorum_self_ticks();
+    char num[64];
+    int n;
+
+    if (!isfinite(value))
+    {
+        return;
+    }
+    n = format_real(num, sizeof(num), value);
+    if (n < 0)
+    {
+        return;
+    }
+    begin_member(jw, key);
+    put(jw, num, n);
+    jw->ticks += variorum_self_ticks() - t0;
+}
+
+void variorum_json_writer_integer(struct variorum_json_writer *jw,
+                                  const char *key, long long value)
+{
+    uint64_t t0 = variorum_self_ticks();
+    char num[32];
+    int n;
+
+    n = snprintf(num, sizeof(num), "%lld", value);
+    begin_member(jw, key);
+    put(jw, num, n);
+    jw->ticks += variorum_self_ticks() - t0;
+}
+
+void variorum_json_writer_string(struct variorum_json_writer *jw,
+                                 const char *key, const char *value)
+{
+    uint64_t t0 = variorum_self_ticks();
+
+    if (value == NULL)
+    {
+        return;
+    }
+    begin_member(jw, key);
+    put_escaped(jw, value);
+    jw->ticks += variorum_self_ticks() - t0;
+}
+
+int variorum_json_writer_finish(struct variorum_json_writer *jw)
+{
+    uint64_t t0 = variorum_self_ticks();
+    int ret = 0;
+
+    if (jw->overflow || !reserve(jw, 0))
+    {
+        if (jw->cap > 0)
+        {
+            jw->buf[jw->cap - 1] = '\0';
+        }
+        ret = -1;
+    }
+    else
+    {
+        jw->buf[jw->len] = '\0';
+    }
+    jw->ticks += variorum_self_ticks() - t0;
+    return ret;
+}
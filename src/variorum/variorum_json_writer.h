@@ -0,0 +1,102 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_JSON_WRITER_H_INCLUDE
+#define VARIORUM_JSON_WRITER_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Maximum nesting depth of objects emitted by the writer.
+#define VARIORUM_JSON_WRITER_MAX_DEPTH 32
+
+/// @brief Streaming JSON writer emitting directly into a character buffer.
+///
+/// The output is byte-compatible with json_dumps() using JSON_INDENT(indent)
+/// for indent > 0, or JSON_COMPACT for indent == 0, provided keys are emitted
+/// in the same order in which they would be inserted into a jansson object.
+struct variorum_json_writer
+{
+    /// @brief Output buffer.
+    char *buf;
+    /// @brief Capacity of the output buffer in bytes.
+    size_t cap;
+    /// @brief Bytes emitted so far (may exceed cap on overflow).
+    size_t len;
+    /// @brief Number of spaces per nesting level, 0 for compact output.
+    int indent;
+    /// @brief Current nesting depth.
+    int depth;
+    /// @brief Caller's buffer and capacity, updated when the buffer grows;
+    /// NULL for fixed-size buffers.
+    char **growbuf;
+    size_t *growcap;
+    /// @brief Set when the output did not fit into the buffer.
+    int overflow;
+    /// @brief Whether the object at each depth already has a member.
+    char nonempty[VARIORUM_JSON_WRITER_MAX_DEPTH];
+    /// @brief Self-overhead ticks spent emitting output, excluding the
+    /// caller's work between the calls.
+    uint64_t ticks;
+};
+
+/// @brief Start writing into a caller-provided buffer of cap bytes.
+void variorum_json_writer_init(
+    struct variorum_json_writer *jw,
+    char *buf,
+    size_t cap,
+    int indent
+);
+
+/// @brief Start writing into a buffer that is grown with realloc as needed.
+/// The buffer is reused across calls, so *buf and *cap are updated in place.
+void variorum_json_writer_init_growable(
+    struct variorum_json_writer *jw,
+    char **buf,
+    size_t *cap,
+    int indent
+);
+
+/// @brief Open an object, as a member named key if key is not NULL.
+void variorum_json_writer_begin_object(
+    struct variorum_json_writer *jw,
+    const char *key
+);
+
+/// @brief Close the innermost open object.
+void variorum_json_writer_end_object(
+    struct variorum_json_writer *jw
+);
+
+/// @brief Emit a real-valued member. Non-finite values are skipped, like
+/// json_real() rejecting them.
+void variorum_json_writer_real(
+    struct variorum_json_writer *jw,
+    const char *key,
+    double value
+);
+
+/// @brief Emit an integer member.
+void variorum_json_writer_integer(
+    struct variorum_json_writer *jw,
+    const char *key,
+    long long value
+);
+
+/// @brief Emit a string member.
+void variorum_json_writer_string(
+    struct variorum_json_writer *jw,
+    const char *key,
+    const char *value
+);
+
+/// @brief Terminate the output.
+///
+/// @return 0 if the output fit into the buffer, otherwise -1.
+int variorum_json_writer_finish(
+    struct variorum_json_writer *jw
+);
+
+#endif
@@ -0,0 +1,136 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+
+#include <variorum_power_balancer.h>
+
+static double min_of(double a, double b)
+{
+    return a < b ? a : b;
+}
+
+int variorum_power_balance(const struct variorum_power_balancer_config *config,
+                           const struct variorum_power_balancer_node *nodes,
+                           int num_nodes, double *caps)
+{
+    double lo = config->min_cap_watts;
+    double hi = config->max_cap_watts;
+    double step = config->max_step_watts > 0.0 ? config->max_step_watts :
+                  config->budget_watts;
+    double total = 0.0, mean = 0.0, pool, wsum;
+    double *room;
+    int i, nprog = 0, pass;
+
+    if (num_nodes <= 0 || lo * num_nodes > config->budget_watts || lo > hi)
+    {
+        return -1;
+    }
+    room = (double *) calloc(num_nodes, sizeof(double));
+    if (room == NULL)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < num_nodes; i++)
+    {
+        caps[i] = nodes[i].cap_watts < lo ? lo :
+                  nodes[i].cap_watts > hi ? hi : nodes[i].cap_watts;
+        total += caps[i];
+        if (nodes[i].progress > 0.0)
+        {
+            mean += nodes[i].progress;
+            nprog++;
+        }
+    }
+    /* The budget shrank or the caps were never balanced: scale the share
+     * above the minimum. */
+    if (total > config->budget_watts)
+    {
+        double scale = (config->budget_watts - lo * num_nodes) /
+                       (total - lo * num_nodes);
+        total = 0.0;
+        for (i = 0; i < num_nodes; i++)
+        {
+            caps[i] = lo + (caps[i] - lo) * scale;
+            total += caps[i];
+        }
+    }
+    pool = config->budget_watts - total;
+    if (pool < 0.0)
+    {
+        pool = 0.0;
+    }
+    if (nprog > 0)
+    {
+        mean /= nprog;
+    }
+
+    /* Reclaim headroom and part of the cap of nodes ahead of the others;
+     * the rest are limited by their cap and receive. */
+    for (i = 0; i < num_nodes; i++)
+    {
+        const struct variorum_power_balancer_node *n = &nodes[i];
+        double give;
+
+        if (n->power_watts < caps[i] - config->margin_watts)
+        {
+            give = caps[i] - (n->power_watts + config->margin_watts);
+        }
+        else if (nprog > 1 && n->progress > mean * (1.0 + config->progress_tolerance))
+        {
+            give = (caps[i] - lo) * (1.0 - mean / n->progress);
+        }
+        else
+        {
+            room[i] = min_of(step, hi - caps[i]);
+            continue;
+        }
+        give = min_of(min_of(give, step), caps[i] - lo);
+        if (give > 0.0)
+        {
+            caps[i] -= give;
+            pool += give;
+        }
+    }
+
+    /* Water-fill the pool, the slowest receivers first in proportion. A
+     * receiver that reaches its room drops out of the next pass. */
+    for (pass = 0; pass < num_nodes && pool > 1e-9; pass++)
+    {
+        double given = 0.0;
+
+        wsum = 0.0;
+        for (i = 0; i < num_nodes; i++)
+        {
+            if (room[i] > 0.0)
+            {
+                wsum += nodes[i].progress > 0.0 && nprog > 0 ? mean / nodes[i].progress
+                        : 1.0;
+            }
+        }
+        if (wsum == 0.0)
+        {
+            break;
+        }
+        for (i = 0; i < num_nodes; i++)
+        {
+            double w, add;
+
+            if (room[i] <= 0.0)
+            {
+                continue;
+            }
+            w = nodes[i].progress > 0.0 && nprog > 0 ? mean / nodes[i].progress : 1.0;
+            add = min_of(pool * w / wsum, room[i]);
+            caps[i] += add;
+            room[i] -= add;
+            given += add;
+        }
+        pool -= given;
+    }
+    free(room);
+    return 0;
+}
@@ -0,0 +1,59 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_POWER_BALANCER_H_INCLUDE
+#define VARIORUM_POWER_BALANCER_H_INCLUDE
+
+/// @brief Limits of a job power budget.
+struct variorum_power_balancer_config
+{
+    /// @brief Job power budget, the most the node caps may sum to (W).
+    double budget_watts;
+    /// @brief Lowest cap of any node (W).
+    double min_cap_watts;
+    /// @brief Highest cap of any node (W).
+    double max_cap_watts;
+    /// @brief A node drawing within this much of its cap is limited by it
+    /// (W); a node drawing less keeps this much above its power.
+    double margin_watts;
+    /// @brief Largest change of one node's cap per step (W).
+    double max_step_watts;
+    /// @brief Relative progress difference below which nodes count as
+    /// balanced.
+    double progress_tolerance;
+};
+
+/// @brief Measurements of one node over the last balancing interval.
+struct variorum_power_balancer_node
+{
+    /// @brief Current cap (W).
+    double cap_watts;
+    /// @brief Average power (W).
+    double power_watts;
+    /// @brief Application progress rate, higher is faster, or 0 if unknown.
+    double progress;
+};
+
+/// @brief Compute the next node caps of a job.
+///
+/// @note Nodes drawing less than their cap give up the headroom, and nodes
+/// progressing faster than the average give up part of their cap. The freed
+/// watts and any unallocated budget go to nodes limited by their cap,
+/// weighted toward the slowest. Caps always sum to at most the budget.
+///
+/// @param [in] config Budget and limits.
+/// @param [in] nodes Measurements of each node.
+/// @param [in] num_nodes Number of nodes.
+/// @param [out] caps Next cap of each node (W).
+///
+/// @return 0 if successful, otherwise -1 (the minimum caps exceed the budget).
+int variorum_power_balance(
+    const struct variorum_power_balancer_config *config,
+    const struct variorum_power_balancer_node *nodes,
+    int num_nodes,
+    double *caps
+);
+
+#endif
@@ -0,0 +1,688 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <variorum_error.h>
+#include <variorum_powercap.h>
+
+/* Parse the decimal value of a sysfs attribute without strtoull(); every
+ * sample parses one value per zone. */
+static uint64_t parse_u64(const char *buf, ssize_t n)
+{
+    uint64_t v = 0;
+    ssize_t i;
+
+    for (i = 0; i < n && buf[i] >= '0' && buf[i] <= '9'; i++)
+    {
+        v = v * 10 + (uint64_t)(buf[i] - '0');
+    }
+    return v;
+}
+
+static int pread_u64(int fd, uint64_t *value)
+{
+    char buf[32];
+    ssize_t n = pread(fd, buf, sizeof(buf), 0);
+
+    if (n <= 0 || buf[0] < '0' || buf[0] > '9')
+    {
+        return -1;
+    }
+    *value = parse_u64(buf, n);
+    return 0;
+}
+
+static int read_attr(const char *root, const char *zone, const char *attr,
+                     char *buf, size_t len)
+{
+    char path[512];
+    ssize_t n;
+    int fd;
+
+    snprintf(path, sizeof(path), "%s/%s/%s", root, zone, attr);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    n = read(fd, buf, len - 1);
+    close(fd);
+    if (n <= 0)
+    {
+        return -1;
+    }
+    /* Drop the trailing newline. */
+    if (buf[n - 1] == '\n')
+    {
+        n--;
+    }
+    buf[n] = '\0';
+    return 0;
+}
+
+static int open_attr(const char *root, const char *zone, const char *attr,
+                     int flags)
+{
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/%s/%s", root, zone, attr);
+    return open(path, flags | O_CLOEXEC);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Map a zone name to its domain. Package zones are named package-N, or
+ * package-N-die-M on multi-die processors. Core and uncore subzones are
+ * part of the package domain and are skipped. */
+static int zone_domain(const char *name, unsigned *socket)
+{
+    if (strncmp(name, "package-", strlen("package-")) == 0)
+    {
+        *socket = (unsigned)parse_u64(name + strlen("package-"),
+                                      strlen(name) - strlen("package-"));
+        return VARIORUM_POWERCAP_PKG;
+    }
+    if (strcmp(name, "dram") == 0)
+    {
+        return VARIORUM_POWERCAP_DRAM;
+    }
+    if (strcmp(name, "psys") == 0)
+    {
+        *socket = 0;
+        return VARIORUM_POWERCAP_PSYS;
+    }
+    return -1;
+}
+
+static int zone_cmp(const void *a, const void *b)
+{
+    const struct variorum_powercap_zone *x = (const struct variorum_powercap_zone
+            *) a;
+    const struct variorum_powercap_zone *y = (const struct variorum_powercap_zone
+            *) b;
+
+    if (x->socket != y->socket)
+    {
+        return x->socket < y->socket ? -1 : 1;
+    }
+    return (int)x->domain - (int)y->domain;
+}
+
+int variorum_powercap_open(struct variorum_powercap *pc, const char *root)
+{
+    struct variorum_powercap_zone *z;
+    struct dirent *ent;
+    char name[64], parent[64], buf[32];
+    unsigned socket = 0;
+    int domain;
+    const char *p;
+    DIR *dir;
+
+    memset(pc, 0, sizeof(*pc));
+    if (root == NULL)
+    {
+        root = VARIORUM_POWERCAP_ROOT;
+    }
+    dir = opendir(root);
+    if (dir == NULL)
+    {
+        return -1;
+    }
+    while ((ent = readdir(dir)) != NULL &&
+            pc->nzones < VARIORUM_POWERCAP_MAX_ZONES)
+    {
+        /* Zones are intel-rapl:N and subzones intel-rapl:N:M, also on AMD.
+         * The intel-rapl-mmio zones duplicate the package zones. */
+        if (strncmp(ent->d_name, "intel-rapl:", strlen("intel-rapl:")) != 0)
+        {
+            continue;
+        }
+        if (read_attr(root, ent->d_name, "name", name, sizeof(name)))
+        {
+            continue;
+        }
+        domain = zone_domain(name, &socket);
+        if (domain == VARIORUM_POWERCAP_DRAM)
+        {
+            /* The socket of a subzone is the one of its parent. */
+            p = strchr(ent->d_name + strlen("intel-rapl:"), ':');
+            if (p == NULL)
+            {
+                continue;
+            }
+            snprintf(parent, sizeof(parent), "%.*s", (int)(p - ent->d_name),
+                     ent->d_name);
+            if (read_attr(root, parent, "name", name, sizeof(name)) ||
+                    zone_domain(name, &socket) != VARIORUM_POWERCAP_PKG)
+            {
+                continue;
+            }
+        }
+        else if (domain < 0)
+        {
+            continue;
+        }
+
+        z = &pc->zones[pc->nzones];
+        z->domain = (enum variorum_powercap_domain)domain;
+        z->socket = socket;
+        z->energy_fd = open_attr(root, ent->d_name, "energy_uj", O_RDONLY);
+        if (z->energy_fd < 0)
+        {
+            /* Recent kernels restrict energy_uj to root. */
+            continue;
+        }
+        if (pread_u64(z->energy_fd, &z->last_uj))
+        {
+            close(z->energy_fd);
+            continue;
+        }
+        z->max_energy_uj = 0;
+        if (read_attr(root, ent->d_name, "max_energy_range_uj", buf,
+                      sizeof(buf)) == 0)
+        {
+            z->max_energy_uj = parse_u64(buf, strlen(buf));
+        }
+        z->limit_writable = 1;
+        z->limit_fd = open_attr(root, ent->d_name, "constraint_0_power_limit_uw",
+                                O_RDWR);
+        if (z->limit_fd < 0)
+        {
+            z->limit_writable = 0;
+            z->limit_fd = open_attr(root, ent->d_name, "constraint_0_power_limit_uw",
+                                    O_RDONLY);
+        }
+        z->total_uj = 0;
+        z->watts = 0.0;
+        if (socket + 1 > pc->nsockets)
+        {
+            pc->nsockets = socket + 1;
+        }
+        pc->nzones++;
+    }
+    closedir(dir);
+
+    if (pc->nzones == 0)
+    {
+        return -1;
+    }
+    qsort(pc->zones, pc->nzones, sizeof(pc->zones[0]), zone_cmp);
+    pc->last = now_sec();
+    return 0;
+}
+
+int variorum_powercap_read(struct variorum_powercap *pc)
+{
+    struct variorum_powercap_zone *z;
+    uint64_t uj, delta;
+    double now = now_sec();
+    unsigned i;
+
+    pc->elapsed = now - pc->last;
+    for (i = 0; i < pc->nzones; i++)
+    {
+        z = &pc->zones[i];
+        if (pread_u64(z->energy_fd, &uj))
+        {
+            return -1;
+        }
+        if (uj >= z->last_uj)
+        {
+            delta = uj - z->last_uj;
+        }
+        else if (z->max_energy_uj > z->last_uj)
+        {
+            /* energy_uj wrapped around at max_energy_range_uj. */
+            delta = z->max_energy_uj - z->last_uj + uj;
+        }
+        else
+        {
+            /* The wrap point is unknown, so the energy consumed across it
+             * cannot be recovered. Count nothing for this interval and
+             * restart from the new value. */
+            delta = 0;
+        }
+        z->total_uj += delta;
+        z->last_uj = uj;
+        if (pc->elapsed > 0)
+        {
+            z->watts = delta / 1e6 / pc->elapsed;
+        }
+    }
+    pc->last = now;
+    return 0;
+}
+
+int variorum_powercap_set_socket_limit(struct variorum_powercap *pc,
+                                       unsigned watts)
+{
+    struct variorum_powercap_zone *z;
+    char buf[32];
+    int n;
+    unsigned i;
+
+    n = snprintf(buf, sizeof(buf), "%llu\n", (unsigned long long)watts * 1000000ULL);
+    for (i = 0; i < pc->nzones; i++)
+    {
+        z = &pc->zones[i];
+        if (z->domain != VARIORUM_POWERCAP_PKG)
+        {
+            continue;
+        }
+        if (!z->limit_writable || pwrite(z->limit_fd, buf, n, 0) != n)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int variorum_powercap_get_limit(const struct variorum_powercap_zone *zone,
+                                double *watts)
+{
+    uint64_t uw;
+
+    if (zone->limit_fd < 0 || pread_u64(zone->limit_fd, &uw))
+    {
+        return -1;
+    }
+    *watts = uw / 1e6;
+    return 0;
+}
+
+void variorum_powercap_close(struct variorum_powercap *pc)
+{
+    unsigned i;
+
+    for (i = 0; i < pc->nzones; i++)
+    {
+        close(pc->zones[i].energy_fd);
+        if (pc->zones[i].limit_fd >= 0)
+        {
+            close(pc->zones[i].limit_fd);
+        }
+    }
+    pc->nzones = 0;
+}
+
+/**************************/
+/* Platform Function Ptrs */
+/**************************/
+
+/* Zones of this node, opened on first use and kept open for the lifetime of
+ * the process. */
+static struct variorum_powercap node;
+/* 0 if not opened yet, 1 if open, -1 if not available. */
+static int node_state = 0;
+
+static const char *domain_labels[VARIORUM_POWERCAP_NUM_DOMAINS] =
+{
+    "_PACKAGE_ENERGY", "_DRAM_ENERGY", "_PLATFORM_ENERGY"
+};
+
+static int node_open(void)
+{
+    if (node_state == 0)
+    {
+        node_state = variorum_powercap_open(&node, NULL) == 0 ? 1 : -1;
+    }
+    return node_state > 0 ? 0 : -1;
+}
+
+static int node_read(void)
+{
+    if (node_open())
+    {
+        variorum_error_handler("No readable RAPL zone in " VARIORUM_POWERCAP_ROOT,
+                               VARIORUM_ERROR_FEATURE_NOT_AVAILABLE,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+    return variorum_powercap_read(&node);
+}
+
+/* Sum over the zones of a socket and domain, e.g., the dies of a package. */
+static double node_sum(unsigned socket, enum variorum_powercap_domain domain,
+                       int joules, int *found)
+{
+    double sum = 0.0;
+    unsigned i;
+
+    *found = 0;
+    for (i = 0; i < node.nzones; i++)
+    {
+        if (node.zones[i].socket == socket && node.zones[i].domain == domain)
+        {
+            sum += joules ? node.zones[i].total_uj / 1e6 : node.zones[i].watts;
+            *found = 1;
+        }
+    }
+    return sum;
+}
+
+/* Node value from the platform domain if there is one, otherwise the sum of
+ * the package and DRAM domains. */
+static double node_total(int joules)
+{
+    double sum = 0.0;
+    unsigned i;
+    int found;
+
+    sum = node_sum(0, VARIORUM_POWERCAP_PSYS, joules, &found);
+    if (found)
+    {
+        return sum;
+    }
+    for (i = 0; i < node.nzones; i++)
+    {
+        sum += joules ? node.zones[i].total_uj / 1e6 : node.zones[i].watts;
+    }
+    return sum;
+}
+
+int powercap_available(void)
+{
+    return node_open() == 0;
+}
+
+static void print_zones(int long_ver, int with_power)
+{
+    static int init[2] = {0, 0};
+    struct variorum_powercap_zone *z;
+    char hostname[1024];
+    unsigned i;
+
+    gethostname(hostname, 1024);
+    if (long_ver == 0 && !init[with_power])
+    {
+        if (with_power)
+        {
+            fprintf(stdout, "_POWERCAP Domain Host Socket Energy_J Power_W Elapsed_sec\n");
+        }
+        else
+        {
+            fprintf(stdout, "_POWERCAP Domain Host Socket Energy_J\n");
+        }
+        init[with_power] = 1;
+    }
+    for (i = 0; i < node.nzones; i++)
+    {
+        z = &node.zones[i];
+        if (long_ver == 0 && with_power)
+        {
+            fprintf(stdout, "_POWERCAP %s %s %d %lf %lf %lf\n", domain_labels[z->domain],
+                    hostname, z->socket, z->total_uj / 1e6, z->watts, node.elapsed);
+        }
+        else if (long_ver == 0)
+        {
+            fprintf(stdout, "_POWERCAP %s %s %d %lf\n", domain_labels[z->domain],
+                    hostname, z->socket, z->total_uj / 1e6);
+        }
+        else if (with_power)
+        {
+            fprintf(stdout,
+                    "%s Host: %s, Socket: %d, Energy: %lf J, Power: %lf W, Elapsed: %lf sec\n",
+                    domain_labels[z->domain], hostname, z->socket, z->total_uj / 1e6,
+                    z->watts, node.elapsed);
+        }
+        else
+        {
+            fprintf(stdout, "%s Host: %s, Socket: %d, Energy: %lf J\n",
+                    domain_labels[z->domain], hostname, z->socket, z->total_uj / 1e6);
+        }
+    }
+}
+
+int powercap_get_power(int long_ver)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (node_read())
+    {
+        return -1;
+    }
+    print_zones(long_ver, 1);
+    return 0;
+}
+
+int powercap_get_energy(int long_ver)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (node_read())
+    {
+        return -1;
+    }
+    print_zones(long_ver, 0);
+    return 0;
+}
+
+int powercap_get_power_limits(int long_ver)
+{
+    static int init = 0;
+    struct variorum_powercap_zone *z;
+    char hostname[1024];
+    double watts;
+    unsigned i;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (node_read())
+    {
+        return -1;
+    }
+    gethostname(hostname, 1024);
+    if (long_ver == 0 && !init)
+    {
+        fprintf(stdout, "_POWERCAP_LIMIT Domain Host Socket PowerLimit_W\n");
+        init = 1;
+    }
+    for (i = 0; i < node.nzones; i++)
+    {
+        z = &node.zones[i];
+        if (variorum_powercap_get_limit(z, &watts))
+        {
+            continue;
+        }
+        if (long_ver == 0)
+        {
+            fprintf(stdout, "_POWERCAP_LIMIT %s %s %d %lf\n", domain_labels[z->domain],
+                    hostname, z->socket, watts);
+        }
+        else
+        {
+            fprintf(stdout, "_POWERCAP_LIMIT Domain: %s, Host: %s, Socket: %d, "
+                    "PowerLimit: %lf W\n", domain_labels[z->domain], hostname,
+                    z->socket, watts);
+        }
+    }
+    return 0;
+}
+
+int powercap_cap_each_socket_power_limit(int socket_power_limit)
+{
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (node_open() || socket_power_limit < 0)
+    {
+        return -1;
+    }
+    if (variorum_powercap_set_socket_limit(&node, socket_power_limit))
+    {
+        variorum_error_handler("Could not write constraint_0_power_limit_uw",
+                               VARIORUM_ERROR_FEATURE_NOT_AVAILABLE,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+    return 0;
+}
+
+int powercap_get_power_json(json_t *get_power_obj)
+{
+    char socketid[12];
+    double watts;
+    unsigned s;
+    int found;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (node_read())
+    {
+        return -1;
+    }
+    for (s = 0; s < node.nsockets; s++)
+    {
+        json_t *socket_obj = json_object();
+
+        snprintf(socketid, sizeof(socketid), "socket_%d", s);
+        json_object_set_new(get_power_obj, socketid, socket_obj);
+        watts = node_sum(s, VARIORUM_POWERCAP_PKG, 0, &found);
+        if (found)
+        {
+            json_object_set_new(socket_obj, "power_cpu_watts", json_real(watts));
+        }
+        watts = node_sum(s, VARIORUM_POWERCAP_DRAM, 0, &found);
+        if (found)
+        {
+            json_object_set_new(socket_obj, "power_mem_watts", json_real(watts));
+        }
+    }
+    json_object_set_new(get_power_obj, "power_node_watts",
+                        json_real(node_total(0)));
+    return 0;
+}
+
+int powercap_write_power_json(struct variorum_json_writer *jw)
+{
+    char socketid[12];
+    double watts;
+    unsigned s;
+    int found;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (node_read())
+    {
+        return -1;
+    }
+    for (s = 0; s < node.nsockets; s++)
+    {
+        snprintf(socketid, sizeof(socketid), "socket_%d", s);
+        variorum_json_writer_begin_object(jw, socketid);
+        watts = node_sum(s, VARIORUM_POWERCAP_PKG, 0, &found);
+        if (found)
+        {
+            variorum_json_writer_real(jw, "power_cpu_watts", watts);
+        }
+        watts = node_sum(s, VARIORUM_POWERCAP_DRAM, 0, &found);
+        if (found)
+        {
+            variorum_json_writer_real(jw, "power_mem_watts", watts);
+        }
+        variorum_json_writer_end_object(jw);
+    }
+    variorum_json_writer_real(jw, "power_node_watts", node_total(0));
+    return 0;
+}
+
+int powercap_get_energy_json(json_t *get_energy_obj)
+{
+    char socketid[12];
+    double joules;
+    unsigned s;
+    int found;
+
+    char *val = getenv("VARIORUM_LOG");
+    if (val != NULL && atoi(val) == 1)
+    {
+        printf("Running %s\n", __FUNCTION__);
+    }
+
+    if (node_read())
+    {
+        return -1;
+    }
+    for (s = 0; s < node.nsockets; s++)
+    {
+        json_t *socket_obj = json_object();
+
+        snprintf(socketid, sizeof(socketid), "socket_%d", s);
+        json_object_set_new(get_energy_obj, socketid, socket_obj);
+        joules = node_sum(s, VARIORUM_POWERCAP_PKG, 1, &found);
+        if (found)
+        {
+            json_object_set_new(socket_obj, "energy_cpu_joules", json_real(joules));
+        }
+        joules = node_sum(s, VARIORUM_POWERCAP_DRAM, 1, &found);
+        if (found)
+        {
+            json_object_set_new(socket_obj, "energy_mem_joules", json_real(joules));
+        }
+    }
+    json_object_set_new(get_energy_obj, "energy_node_joules",
+                        json_real(node_total(1)));
+    return 0;
+}
+
+int powercap_get_energy_counters(struct variorum_energy_counters *counters)
+{
+    unsigned i;
+
+    if (node_read())
+    {
+        return -1;
+    }
+    for (i = 0; i < node.nzones; i++)
+    {
+        if (node.zones[i].domain == VARIORUM_POWERCAP_PKG)
+        {
+            counters->pkg_joules += node.zones[i].total_uj / 1e6;
+        }
+        else if (node.zones[i].domain == VARIORUM_POWERCAP_DRAM)
+        {
+            counters->dram_joules += node.zones[i].total_uj / 1e6;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,205 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_POWERCAP_H_INCLUDE
+#define VARIORUM_POWERCAP_H_INCLUDE
+
+#include <jansson.h>
+#include <stdint.h>
+
+#include <variorum_json_writer.h>
+#include <variorum_region.h>
+
+/// @brief Default location of the powercap class.
+#define VARIORUM_POWERCAP_ROOT "/sys/class/powercap"
+
+/// @brief Maximum number of RAPL zones and subzones of one node.
+#define VARIORUM_POWERCAP_MAX_ZONES 64
+
+/// @brief Power domain of a zone.
+enum variorum_powercap_domain
+{
+    VARIORUM_POWERCAP_PKG,
+    VARIORUM_POWERCAP_DRAM,
+    VARIORUM_POWERCAP_PSYS,
+    VARIORUM_POWERCAP_NUM_DOMAINS
+};
+
+/// @brief One RAPL zone of the powercap class, e.g., intel-rapl:0 (package)
+/// or intel-rapl:0:1 (DRAM).
+struct variorum_powercap_zone
+{
+    /// @brief Domain of the zone.
+    enum variorum_powercap_domain domain;
+    /// @brief Socket of the zone, 0 for the platform domain.
+    unsigned socket;
+    /// @brief Open energy_uj, re-read at offset 0 on every sample.
+    int energy_fd;
+    /// @brief Open constraint_0_power_limit_uw (long term), read-write if
+    /// permitted, otherwise read-only, or -1.
+    int limit_fd;
+    /// @brief Whether limit_fd is writable.
+    int limit_writable;
+    /// @brief Value at which energy_uj wraps around (uJ), 0 if unknown. A
+    /// decrease of energy_uj with an unknown wrap point counts as no energy.
+    uint64_t max_energy_uj;
+    /// @brief Last value read from energy_uj (uJ).
+    uint64_t last_uj;
+    /// @brief Energy since the zone was opened (uJ), never wraps.
+    uint64_t total_uj;
+    /// @brief Power between the last two samples (W).
+    double watts;
+};
+
+/// @brief RAPL zones of a node, discovered once and kept open.
+struct variorum_powercap
+{
+    /// @brief Number of zones, sorted by socket, then domain.
+    unsigned nzones;
+    /// @brief Number of sockets, i.e., the highest package index plus one.
+    unsigned nsockets;
+    struct variorum_powercap_zone zones[VARIORUM_POWERCAP_MAX_ZONES];
+    /// @brief Time of the last sample (s, CLOCK_MONOTONIC).
+    double last;
+    /// @brief Time between the last two samples (s).
+    double elapsed;
+};
+
+/// @brief Discover the package, DRAM, and platform zones and open their
+/// energy and power limit files.
+///
+/// @param [out] pc Zones.
+/// @param [in] root Powercap class directory, or NULL for
+///             VARIORUM_POWERCAP_ROOT.
+///
+/// @return 0 if successful, otherwise -1 (no readable zone).
+int variorum_powercap_open(
+    struct variorum_powercap *pc,
+    const char *root
+);
+
+/// @brief Sample the energy of every zone, one pread() each, and update the
+/// accumulated energy and power.
+///
+/// @param [in,out] pc Zones.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_powercap_read(
+    struct variorum_powercap *pc
+);
+
+/// @brief Set the long-term power limit of every package zone.
+///
+/// @param [in,out] pc Zones.
+/// @param [in] watts Power limit of each socket (W).
+///
+/// @return 0 if successful, otherwise -1 (a limit is not writable).
+int variorum_powercap_set_socket_limit(
+    struct variorum_powercap *pc,
+    unsigned watts
+);
+
+/// @brief Read the long-term power limit of a zone.
+///
+/// @param [in] zone Zone.
+/// @param [out] watts Power limit (W).
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_powercap_get_limit(
+    const struct variorum_powercap_zone *zone,
+    double *watts
+);
+
+/// @brief Close the files of every zone.
+///
+/// @param [in,out] pc Zones.
+void variorum_powercap_close(
+    struct variorum_powercap *pc
+);
+
+/// @brief Whether this node exposes readable RAPL zones through the
+/// powercap class.
+///
+/// @return 1 if available, otherwise 0.
+int powercap_available(
+    void
+);
+
+/// @brief Print the energy and power of each zone.
+///
+/// @param [in] long_ver Toggle between CSV formatted and long formatted
+///        output.
+///
+/// @return 0 if successful, otherwise -1.
+int powercap_get_power(
+    int long_ver
+);
+
+/// @brief Print the energy of each zone.
+///
+/// @param [in] long_ver Toggle between CSV formatted and long formatted
+///        output.
+///
+/// @return 0 if successful, otherwise -1.
+int powercap_get_energy(
+    int long_ver
+);
+
+/// @brief Print the long-term power limit of each zone.
+///
+/// @param [in] long_ver Toggle between CSV formatted and long formatted
+///        output.
+///
+/// @return 0 if successful, otherwise -1.
+int powercap_get_power_limits(
+    int long_ver
+);
+
+/// @brief Set the long-term power limit of each socket.
+///
+/// @param [in] socket_power_limit Power limit (W).
+///
+/// @return 0 if successful, otherwise -1.
+int powercap_cap_each_socket_power_limit(
+    int socket_power_limit
+);
+
+/// @brief Add the power of each socket and the node to a JSON object.
+///
+/// @param [out] get_power_obj Node object.
+///
+/// @return 0 if successful, otherwise -1.
+int powercap_get_power_json(
+    json_t *get_power_obj
+);
+
+/// @brief Stream the power of each socket and the node into a writer.
+///
+/// @param [in,out] jw JSON writer.
+///
+/// @return 0 if successful, otherwise -1.
+int powercap_write_power_json(
+    struct variorum_json_writer *jw
+);
+
+/// @brief Add the energy of each socket and the node to a JSON object.
+///
+/// @param [out] get_energy_obj Node object.
+///
+/// @return 0 if successful, otherwise -1.
+int powercap_get_energy_json(
+    json_t *get_energy_obj
+);
+
+/// @brief Add the package and DRAM energy of all sockets to a snapshot.
+///
+/// @param [in,out] counters Snapshot.
+///
+/// @return 0 if successful, otherwise -1.
+int powercap_get_energy_counters(
+    struct variorum_energy_counters *counters
+);
+
+#endif
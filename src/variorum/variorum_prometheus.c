@@ -0,0 +1,555 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <variorum_error.h>
+#include <variorum_prometheus.h>
+
+/* Longest formatted value, e.g., -1.7976931348623157e+308. */
+#define VALUE_MAX_LEN 32
+
+/* Room for the scrape counter at the end of a rendering. */
+#define FOOTER_MAX_LEN (256 + sizeof(((struct variorum_prometheus *)0)->common_labels))
+
+/* Largest request header read before answering. */
+#define REQUEST_MAX_LEN 2048
+
+/* Connections whose request is still being read. Further clients wait in the
+ * listen backlog. */
+#define MAX_PENDING 16
+
+/* Time a client has to send its request and read the response. */
+#define REQUEST_TIMEOUT_MS 1000
+
+/* Interval at which the server checks whether it is asked to stop. */
+#define STOP_POLL_MS 100
+
+/* A connection whose request header is incomplete. */
+struct pending_request
+{
+    int fd;
+    size_t len;
+    uint64_t deadline_ms;
+    char req[REQUEST_MAX_LEN];
+};
+
+/* Write an unsigned integer, return its length. */
+static size_t format_uint(char *p, uint64_t v)
+{
+    char tmp[20];
+    size_t n = 0, i;
+
+    do
+    {
+        tmp[n++] = '0' + (v % 10);
+        v /= 10;
+    }
+    while (v != 0);
+    for (i = 0; i < n; i++)
+    {
+        p[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+/* Write a value in the exposition format, return its length. Values that fit
+ * are written with millisecond resolution without going through printf,
+ * which dominates the cost of a scrape otherwise. */
+static size_t format_value(char *p, double v)
+{
+    size_t n = 0;
+    uint64_t scaled, frac;
+
+    if (isnan(v))
+    {
+        memcpy(p, "NaN", 3);
+        return 3;
+    }
+    if (isinf(v))
+    {
+        memcpy(p, v > 0 ? "+Inf" : "-Inf", 4);
+        return 4;
+    }
+    if (fabs(v) >= 1e15)
+    {
+        return snprintf(p, VALUE_MAX_LEN, "%.17g", v);
+    }
+    if (v < 0)
+    {
+        p[n++] = '-';
+        v = -v;
+    }
+    scaled = (uint64_t)(v * 1000.0 + 0.5);
+    n += format_uint(p + n, scaled / 1000);
+    frac = scaled % 1000;
+    if (frac != 0)
+    {
+        p[n++] = '.';
+        p[n++] = '0' + frac / 100;
+        p[n++] = '0' + (frac / 10) % 10;
+        p[n++] = '0' + frac % 10;
+        while (p[n - 1] == '0')
+        {
+            n--;
+        }
+    }
+    return n;
+}
+
+/* Append "name{labels} " to dst, joining the common and series labels. */
+static int format_series(char *dst, size_t len, const char *family,
+                         const char *common, const char *labels)
+{
+    int has_common = common[0] != '\0';
+    int has_labels = labels != NULL && labels[0] != '\0';
+
+    if (!has_common && !has_labels)
+    {
+        return snprintf(dst, len, "%s ", family);
+    }
+    return snprintf(dst, len, "%s{%s%s%s} ", family, common,
+                    has_common && has_labels ? "," : "",
+                    has_labels ? labels : "");
+}
+
+static void free_schema(struct variorum_prometheus *e)
+{
+    unsigned i;
+
+    for (i = 0; i < VARIORUM_PROMETHEUS_MAX_SERIES; i++)
+    {
+        free(e->prefix[i]);
+        e->prefix[i] = NULL;
+        e->prefix_len[i] = 0;
+    }
+    e->prefix_total = 0;
+    e->last_family[0] = '\0';
+    e->nseries = 0;
+    e->schema_fixed = 0;
+}
+
+int variorum_prometheus_push(struct variorum_prometheus *e, const char *family,
+                             const char *help, const char *labels, double value)
+{
+    char text[1024];
+    int n = 0;
+
+    if (e->next >= VARIORUM_PROMETHEUS_MAX_SERIES)
+    {
+        e->next++;
+        return -1;
+    }
+    if (!e->schema_fixed)
+    {
+        if (strncmp(family, e->last_family, sizeof(e->last_family)) != 0)
+        {
+            n = snprintf(text, sizeof(text), "# HELP %s %s\n# TYPE %s gauge\n",
+                         family, help != NULL ? help : family, family);
+            snprintf(e->last_family, sizeof(e->last_family), "%s", family);
+        }
+        n += format_series(text + n, sizeof(text) - n, family, e->common_labels,
+                           labels);
+        if (n >= (int)sizeof(text))
+        {
+            e->next++;
+            return -1;
+        }
+        e->prefix[e->next] = strdup(text);
+        e->prefix_len[e->next] = n;
+        e->prefix_total += n;
+    }
+    else if (e->next >= e->nseries)
+    {
+        e->next++;
+        return -1;
+    }
+    e->staging[e->next++] = value;
+    return 0;
+}
+
+int variorum_prometheus_end_row(struct variorum_prometheus *e)
+{
+    unsigned n = e->next;
+    unsigned i;
+
+    e->next = 0;
+    if (!e->schema_fixed)
+    {
+        for (i = 0; i < n && i < VARIORUM_PROMETHEUS_MAX_SERIES; i++)
+        {
+            if (e->prefix[i] == NULL)
+            {
+                break;
+            }
+        }
+        if (i != n)
+        {
+            /* A series could not be registered; start over with the next
+             * row. */
+            free_schema(e);
+            return -1;
+        }
+        e->nseries = n;
+        e->schema_fixed = 1;
+    }
+    else if (n != e->nseries)
+    {
+        return -1;
+    }
+
+    __atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(e->values, e->staging, n * sizeof(double));
+    e->rows++;
+    __atomic_store_n(&e->seq, e->seq + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+size_t variorum_prometheus_render(struct variorum_prometheus *e, char *buf,
+                                  size_t len)
+{
+    double values[VARIORUM_PROMETHEUS_MAX_SERIES];
+    unsigned nseries, i;
+    uint64_t rows;
+    uint32_t seq;
+    size_t need, n = 0;
+
+    do
+    {
+        seq = __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+        rows = e->rows;
+        nseries = rows > 0 ? e->nseries : 0;
+        memcpy(values, e->values, nseries * sizeof(double));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while ((seq & 1) || seq != __atomic_load_n(&e->seq, __ATOMIC_RELAXED));
+
+    /* The schema does not change once a row is published. */
+    need = (nseries > 0 ? e->prefix_total : 0) +
+           (size_t)nseries * (VALUE_MAX_LEN + 1) + FOOTER_MAX_LEN;
+    if (need > len)
+    {
+        return need;
+    }
+    for (i = 0; i < nseries; i++)
+    {
+        memcpy(buf + n, e->prefix[i], e->prefix_len[i]);
+        n += e->prefix_len[i];
+        n += format_value(buf + n, values[i]);
+        buf[n++] = '\n';
+    }
+    n += snprintf(buf + n, len - n,
+                  "# HELP variorum_exporter_scrapes_total Scrapes served by this exporter.\n"
+                  "# TYPE variorum_exporter_scrapes_total counter\n");
+    n += format_series(buf + n, len - n, "variorum_exporter_scrapes_total",
+                       e->common_labels, NULL);
+    n += format_uint(buf + n, __atomic_load_n(&e->scrapes, __ATOMIC_RELAXED));
+    buf[n++] = '\n';
+    return n;
+}
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Read what a non-blocking client has sent so far. Return 1 once the request
+ * header is complete (or fills the buffer), 0 if more is expected, and -1 if
+ * the client went away. */
+static int read_request(struct pending_request *p)
+{
+    ssize_t r;
+
+    r = recv(p->fd, p->req + p->len, sizeof(p->req) - 1 - p->len, 0);
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        return 0;
+    }
+    if (r <= 0)
+    {
+        return -1;
+    }
+    p->len += r;
+    p->req[p->len] = '\0';
+    if (strstr(p->req, "\r\n\r\n") != NULL || strstr(p->req, "\n\n") != NULL ||
+            p->len == sizeof(p->req) - 1)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+static void send_response(int fd, const char *status, const char *type,
+                          const char *body, size_t body_len)
+{
+    char header[256];
+    struct iovec iov[2];
+    struct msghdr msg;
+    int n;
+
+    n = snprintf(header, sizeof(header),
+                 "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n"
+                 "Connection: close\r\n\r\n", status, type, body_len);
+    iov[0].iov_base = header;
+    iov[0].iov_len = n;
+    iov[1].iov_base = (void *)body;
+    iov[1].iov_len = body_len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    /* One segment, so Nagle's algorithm does not delay the body. A client
+     * that went away is not an error of the exporter. */
+    (void)sendmsg(fd, &msg, MSG_NOSIGNAL);
+}
+
+static void serve_client(struct variorum_prometheus *e, int fd,
+                         const char *req, char **body, size_t *body_cap)
+{
+    const char *path;
+    size_t n;
+
+    if (strncmp(req, "GET ", 4) != 0)
+    {
+        send_response(fd, "405 Method Not Allowed", "text/plain", "", 0);
+        return;
+    }
+    path = req + 4;
+    if (strncmp(path, "/metrics", 8) != 0 ||
+            (path[8] != ' ' && path[8] != '?'))
+    {
+        static const char msg[] = "Try /metrics\n";
+        send_response(fd, "404 Not Found", "text/plain", msg, sizeof(msg) - 1);
+        return;
+    }
+
+    __atomic_add_fetch(&e->scrapes, 1, __ATOMIC_RELAXED);
+    while ((n = variorum_prometheus_render(e, *body, *body_cap)) > *body_cap)
+    {
+        char *grown = (char *) realloc(*body, n);
+        if (grown == NULL)
+        {
+            send_response(fd, "500 Internal Server Error", "text/plain", "", 0);
+            return;
+        }
+        *body = grown;
+        *body_cap = n;
+    }
+    send_response(fd, "200 OK", VARIORUM_PROMETHEUS_CONTENT_TYPE, *body, n);
+}
+
+/* Answer a complete request. The response is sent in blocking mode, bounded
+ * by what is left of the client's deadline. */
+static void finish_request(struct variorum_prometheus *e,
+                           struct pending_request *p, uint64_t now,
+                           char **body, size_t *body_cap)
+{
+    uint64_t left = p->deadline_ms > now ? p->deadline_ms - now : 1;
+    struct timeval tv;
+
+    tv.tv_sec = left / 1000;
+    tv.tv_usec = (left % 1000) * 1000;
+    fcntl(p->fd, F_SETFL, fcntl(p->fd, F_GETFL) & ~O_NONBLOCK);
+    setsockopt(p->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    serve_client(e, p->fd, p->req, body, body_cap);
+}
+
+/* Serves every client from one thread. Requests are read without blocking,
+ * and each connection has its own deadline, so a slow client delays no other
+ * scraper and is dropped once its time is up. */
+static void *prometheus_server(void *arg)
+{
+    struct variorum_prometheus *e = (struct variorum_prometheus *) arg;
+    struct pending_request *pending;
+    struct pollfd pfd[MAX_PENDING + 1];
+    unsigned npending = 0, nfds, i;
+    size_t body_cap = 0;
+    char *body = NULL;
+    uint64_t now;
+    int timeout, fd, ret, listen_idx;
+
+    pending = (struct pending_request *) malloc(MAX_PENDING * sizeof(*pending));
+    if (pending == NULL)
+    {
+        return NULL;
+    }
+    while (!__atomic_load_n(&e->stop, __ATOMIC_ACQUIRE))
+    {
+        now = now_ms();
+        timeout = STOP_POLL_MS;
+        nfds = 0;
+        for (i = 0; i < npending; i++)
+        {
+            pfd[nfds].fd = pending[i].fd;
+            pfd[nfds].events = POLLIN;
+            pfd[nfds].revents = 0;
+            nfds++;
+            if (pending[i].deadline_ms <= now)
+            {
+                timeout = 0;
+            }
+            else if (pending[i].deadline_ms - now < (uint64_t)timeout)
+            {
+                timeout = (int)(pending[i].deadline_ms - now);
+            }
+        }
+        /* Accept only while there is room to track the client. */
+        listen_idx = -1;
+        if (npending < MAX_PENDING)
+        {
+            listen_idx = nfds;
+            pfd[nfds].fd = e->listen_fd;
+            pfd[nfds].events = POLLIN;
+            pfd[nfds].revents = 0;
+            nfds++;
+        }
+        if (poll(pfd, nfds, timeout) < 0)
+        {
+            continue;
+        }
+
+        now = now_ms();
+        for (i = 0; i < npending; )
+        {
+            ret = 0;
+            if (pfd[i].revents != 0)
+            {
+                ret = read_request(&pending[i]);
+            }
+            if (ret == 1)
+            {
+                finish_request(e, &pending[i], now, &body, &body_cap);
+            }
+            if (ret != 0 || pending[i].deadline_ms <= now)
+            {
+                close(pending[i].fd);
+                /* Keep the poll results aligned with the pending entries. */
+                pending[i] = pending[npending - 1];
+                pfd[i] = pfd[npending - 1];
+                npending--;
+                continue;
+            }
+            i++;
+        }
+        if (listen_idx >= 0 && (pfd[listen_idx].revents & POLLIN))
+        {
+            fd = accept4(e->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd >= 0)
+            {
+                pending[npending].fd = fd;
+                pending[npending].len = 0;
+                pending[npending].req[0] = '\0';
+                pending[npending].deadline_ms = now + REQUEST_TIMEOUT_MS;
+                npending++;
+            }
+        }
+    }
+    for (i = 0; i < npending; i++)
+    {
+        close(pending[i].fd);
+    }
+    free(pending);
+    free(body);
+    return NULL;
+}
+
+int variorum_prometheus_open(struct variorum_prometheus *e,
+                             const char *address, int port, const char *hostname)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int one = 1;
+
+    memset(e, 0, sizeof(*e));
+    e->listen_fd = -1;
+    if (hostname != NULL)
+    {
+        snprintf(e->common_labels, sizeof(e->common_labels), "host=\"%s\"",
+                 hostname);
+    }
+    if (port < 0 || port > 65535)
+    {
+        variorum_error_handler("Invalid exporter port", VARIORUM_ERROR_INVAL,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    /* Loopback unless an address is given; exposing the node's power on
+     * other interfaces is an explicit choice, e.g., "0.0.0.0". */
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (address != NULL && inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+    {
+        variorum_error_handler("Invalid exporter address", VARIORUM_ERROR_INVAL,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+
+    e->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (e->listen_fd < 0)
+    {
+        return -1;
+    }
+    setsockopt(e->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(e->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            listen(e->listen_fd, 16) != 0 ||
+            getsockname(e->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0)
+    {
+        variorum_error_handler("Could not listen on exporter port",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        close(e->listen_fd);
+        e->listen_fd = -1;
+        return -1;
+    }
+    e->port = ntohs(addr.sin_port);
+
+    if (pthread_create(&e->thread, NULL, prometheus_server, e) != 0)
+    {
+        close(e->listen_fd);
+        e->listen_fd = -1;
+        return -1;
+    }
+    e->running = 1;
+    return 0;
+}
+
+void variorum_prometheus_close(struct variorum_prometheus *e)
+{
+    if (e->running)
+    {
+        __atomic_store_n(&e->stop, 1, __ATOMIC_RELEASE);
+        pthread_join(e->thread, NULL);
+        e->running = 0;
+    }
+    if (e->listen_fd >= 0)
+    {
+        close(e->listen_fd);
+        e->listen_fd = -1;
+    }
+    free_schema(e);
+}
@@ -0,0 +1,134 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_PROMETHEUS_H_INCLUDE
+#define VARIORUM_PROMETHEUS_H_INCLUDE
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Maximum number of series of one exporter.
+#define VARIORUM_PROMETHEUS_MAX_SERIES 256
+
+/// @brief Content type of a /metrics response (text exposition format).
+#define VARIORUM_PROMETHEUS_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+
+/// @brief HTTP exporter serving the last sample in the Prometheus text
+/// format.
+///
+/// The sampler pushes one value per series and ends the row, in the same
+/// order every time. The series (family, help text and labels) are taken
+/// from the first row and must not change afterwards, so the text before
+/// every value is rendered once. A scrape copies the latest row under a
+/// sequence lock and formats only the values; it never touches the
+/// hardware.
+struct variorum_prometheus
+{
+    /// @brief Listening socket, -1 if closed.
+    int listen_fd;
+    /// @brief Bound TCP port.
+    int port;
+    /// @brief Labels common to every series, e.g., host="quartz1".
+    char common_labels[128];
+    /// @brief Number of series (fixed after the first row).
+    unsigned nseries;
+    /// @brief Series being filled in the current row.
+    unsigned next;
+    /// @brief Whether the schema is fixed.
+    int schema_fixed;
+    /// @brief Family of the last series registered, to emit HELP and TYPE
+    /// once per family.
+    char last_family[64];
+    /// @brief Pre-rendered text before each value: HELP and TYPE lines for
+    /// the first series of a family, then the name and labels.
+    char *prefix[VARIORUM_PROMETHEUS_MAX_SERIES];
+    size_t prefix_len[VARIORUM_PROMETHEUS_MAX_SERIES];
+    /// @brief Size of all prefixes, to bound a rendering.
+    size_t prefix_total;
+    /// @brief Row being filled by the sampler.
+    double staging[VARIORUM_PROMETHEUS_MAX_SERIES];
+    /// @brief Last complete row.
+    double values[VARIORUM_PROMETHEUS_MAX_SERIES];
+    /// @brief Sequence lock of values, odd while a row is published.
+    uint32_t seq;
+    /// @brief Number of rows published.
+    uint64_t rows;
+    /// @brief Number of /metrics requests served.
+    uint64_t scrapes;
+    /// @brief Server thread.
+    pthread_t thread;
+    int running;
+    int stop;
+};
+
+/// @brief Listen on a TCP port and serve /metrics from a thread.
+///
+/// @param [out] e Exporter.
+/// @param [in] address IPv4 address to bind, e.g., "0.0.0.0" for all
+///             interfaces, or NULL for the loopback interface only.
+/// @param [in] port TCP port, or 0 for any free port (see e->port).
+/// @param [in] hostname Value of the host label of every series, or NULL
+///             for none.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_prometheus_open(
+    struct variorum_prometheus *e,
+    const char *address,
+    int port,
+    const char *hostname
+);
+
+/// @brief Set the value of the next series of the current row.
+///
+/// @param [in,out] e Exporter.
+/// @param [in] family Metric name, e.g., variorum_cpu_power_watts.
+/// @param [in] help Description of the family, used on the first row.
+/// @param [in] labels Labels besides the common ones, e.g., socket="0", or
+///             NULL.
+/// @param [in] value Value.
+///
+/// @return 0 if successful, otherwise -1 (too many series).
+int variorum_prometheus_push(
+    struct variorum_prometheus *e,
+    const char *family,
+    const char *help,
+    const char *labels,
+    double value
+);
+
+/// @brief Publish the current row to scrapers.
+///
+/// @param [in,out] e Exporter.
+///
+/// @return 0 if successful, -1 if the row does not match the schema (the
+/// row is discarded).
+int variorum_prometheus_end_row(
+    struct variorum_prometheus *e
+);
+
+/// @brief Render the last row in the text exposition format.
+///
+/// @param [in] e Exporter.
+/// @param [out] buf Destination.
+/// @param [in] len Capacity of buf.
+///
+/// @return Length of the text, without a terminating NUL. A value greater
+/// than len means buf was too small; it is then a capacity that suffices
+/// and nothing was written.
+size_t variorum_prometheus_render(
+    struct variorum_prometheus *e,
+    char *buf,
+    size_t len
+);
+
+/// @brief Stop the server and release the exporter.
+///
+/// @param [in,out] e Exporter.
+void variorum_prometheus_close(
+    struct variorum_prometheus *e
+);
+
+#endif
@@ -0,0 +1,461 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <config_architecture.h>
+#include <variorum.h>
+#include <variorum_error.h>
+#include <variorum_region.h>
+#include <variorum_timers.h>
+
+struct open_region
+{
+    const char *name;
+    double start;
+    struct variorum_energy_counters counters;
+};
+
+/* Regions opened by the calling thread, innermost last. */
+static __thread struct open_region region_stack[VARIORUM_REGION_MAX_DEPTH];
+static __thread unsigned region_depth = 0;
+
+/* Open addressing table of region totals, keyed by name. */
+static struct
+{
+    unsigned size;
+    unsigned count;
+    struct variorum_region_stats *slot;
+} regions;
+
+static pthread_mutex_t region_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Platform left entered between region calls, see g_variorum_exits. Only
+ * accessed with the library lock held, except for the sampler fields. */
+static struct
+{
+    int entered;
+    unsigned long exits;
+    int sampler;
+    int stop;
+    pthread_t thread;
+    unsigned seq;
+    struct variorum_energy_counters snapshot;
+} session;
+
+static uint64_t hash_name(const char *name)
+{
+    uint64_t h = 1469598103934665603ULL;
+
+    while (*name)
+    {
+        h ^= (unsigned char) *name++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static struct variorum_region_stats *find_slot(const char *name)
+{
+    unsigned i;
+
+    if (regions.size == 0)
+    {
+        return NULL;
+    }
+    for (i = hash_name(name) & (regions.size - 1); regions.slot[i].name != NULL;
+            i = (i + 1) & (regions.size - 1))
+    {
+        if (strcmp(regions.slot[i].name, name) == 0)
+        {
+            return &regions.slot[i];
+        }
+    }
+    return &regions.slot[i];
+}
+
+static int grow_table(void)
+{
+    struct variorum_region_stats *old = regions.slot;
+    unsigned oldsize = regions.size;
+    unsigned i;
+
+    regions.size = oldsize ? 2 * oldsize : 64;
+    regions.slot = (struct variorum_region_stats *)
+                   calloc(regions.size, sizeof(struct variorum_region_stats));
+    if (regions.slot == NULL)
+    {
+        regions.slot = old;
+        regions.size = oldsize;
+        return -1;
+    }
+    for (i = 0; i < oldsize; i++)
+    {
+        if (old[i].name != NULL)
+        {
+            *find_slot(old[i].name) = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+static struct variorum_region_stats *lookup_or_insert(const char *name)
+{
+    struct variorum_region_stats *st;
+
+    /* Keep the load factor below 3/4. */
+    if (4 * (regions.count + 1) > 3 * regions.size && grow_table())
+    {
+        return NULL;
+    }
+    st = find_slot(name);
+    if (st->name == NULL)
+    {
+        st->name = strdup(name);
+        if (st->name == NULL)
+        {
+            return NULL;
+        }
+        regions.count++;
+    }
+    return st;
+}
+
+int variorum_region_push(const char *name, double now,
+                         const struct variorum_energy_counters *counters)
+{
+    struct variorum_region_stats *st;
+
+    if (region_depth == VARIORUM_REGION_MAX_DEPTH)
+    {
+        variorum_error_handler("Regions nested too deep", VARIORUM_ERROR_INVAL,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+    /* Keep the table's copy of the name, the caller's may not outlive the
+     * region. The copy does not move when the table grows. */
+    pthread_mutex_lock(&region_lock);
+    st = lookup_or_insert(name);
+    pthread_mutex_unlock(&region_lock);
+    if (st == NULL)
+    {
+        return -1;
+    }
+    region_stack[region_depth].name = st->name;
+    region_stack[region_depth].start = now;
+    region_stack[region_depth].counters = *counters;
+    region_depth++;
+    return 0;
+}
+
+int variorum_region_pop(const char *name, double now,
+                        const struct variorum_energy_counters *counters)
+{
+    struct open_region *r;
+    struct variorum_region_stats *st;
+
+    if (region_depth == 0 ||
+            strcmp(region_stack[region_depth - 1].name, name) != 0)
+    {
+        variorum_error_handler("Region end does not match the innermost open region",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"), __FILE__,
+                               __FUNCTION__, __LINE__);
+        return -1;
+    }
+    r = &region_stack[--region_depth];
+
+    pthread_mutex_lock(&region_lock);
+    st = lookup_or_insert(name);
+    if (st != NULL)
+    {
+        st->calls++;
+        st->seconds += now - r->start;
+        st->energy.pkg_joules += counters->pkg_joules - r->counters.pkg_joules;
+        st->energy.dram_joules += counters->dram_joules - r->counters.dram_joules;
+        st->energy.gpu_joules += counters->gpu_joules - r->counters.gpu_joules;
+    }
+    pthread_mutex_unlock(&region_lock);
+    return st != NULL ? 0 : -1;
+}
+
+int variorum_region_get_stats(const char *name,
+                              struct variorum_region_stats *stats)
+{
+    struct variorum_region_stats *st;
+    int ret = -1;
+
+    pthread_mutex_lock(&region_lock);
+    st = find_slot(name);
+    if (st != NULL && st->name != NULL)
+    {
+        *stats = *st;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&region_lock);
+    return ret;
+}
+
+void variorum_region_write_summary(FILE *output)
+{
+    char hostname[1024];
+    unsigned i;
+
+    gethostname(hostname, 1024);
+    pthread_mutex_lock(&region_lock);
+    fprintf(output,
+            "_REGION_ENERGY Host Region Calls Time_s Pkg_J DRAM_J GPU_J Avg_W\n");
+    for (i = 0; i < regions.size; i++)
+    {
+        struct variorum_region_stats *st = &regions.slot[i];
+        double joules;
+
+        if (st->name == NULL)
+        {
+            continue;
+        }
+        joules = st->energy.pkg_joules + st->energy.dram_joules +
+                 st->energy.gpu_joules;
+        fprintf(output, "_REGION_ENERGY %s %s %lu %lf %lf %lf %lf %lf\n", hostname,
+                st->name, st->calls, st->seconds, st->energy.pkg_joules,
+                st->energy.dram_joules, st->energy.gpu_joules,
+                st->seconds > 0.0 ? joules / st->seconds : 0.0);
+    }
+    pthread_mutex_unlock(&region_lock);
+}
+
+void variorum_region_reset(void)
+{
+    unsigned i;
+
+    pthread_mutex_lock(&region_lock);
+    for (i = 0; i < regions.size; i++)
+    {
+        free(regions.slot[i].name);
+    }
+    free(regions.slot);
+    memset(&regions, 0, sizeof(regions));
+    pthread_mutex_unlock(&region_lock);
+}
+
+static double region_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void write_region_profile(void)
+{
+    char *path = getenv("VARIORUM_REGION_PROFILE");
+    FILE *output = stdout;
+
+    if (regions.count == 0)
+    {
+        return;
+    }
+    if (path != NULL)
+    {
+        output = fopen(path, "w");
+        if (output == NULL)
+        {
+            variorum_error_handler("Could not open region profile",
+                                   VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                                   __FILE__, __FUNCTION__, __LINE__);
+            return;
+        }
+    }
+    variorum_region_write_summary(output);
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+}
+
+/* Stop the sampler and exit the platform if the session is still the last
+ * one entered. Registered with atexit() when the session is first entered. */
+static void close_region_session(void)
+{
+    if (__atomic_load_n(&session.sampler, __ATOMIC_ACQUIRE))
+    {
+        __atomic_store_n(&session.stop, 1, __ATOMIC_RELAXED);
+        pthread_join(session.thread, NULL);
+        __atomic_store_n(&session.sampler, 0, __ATOMIC_RELEASE);
+    }
+    variorum_lock();
+    if (session.entered && session.exits == g_variorum_exits)
+    {
+        session.entered = 0;
+        /* Stands in for the hold of the session's variorum_enter(), which
+         * variorum_exit() releases. */
+        variorum_lock();
+        variorum_exit(__FILE__, __FUNCTION__, __LINE__);
+    }
+    variorum_unlock();
+}
+
+/* Read the energy counters of all platforms under the library lock. The
+ * platform stays entered between calls, so each read is only the counter
+ * reads themselves; any other API call exits the platform, after which it is
+ * entered again. */
+static int read_energy_counters(struct variorum_energy_counters *counters)
+{
+    static int registered = 0;
+    int found = 0;
+    int ret = 0;
+    int i;
+
+    variorum_lock();
+    if (!session.entered || session.exits != g_variorum_exits)
+    {
+        if (variorum_enter(__FILE__, __FUNCTION__, __LINE__))
+        {
+            variorum_unlock();
+            return -1;
+        }
+        /* The session outlives this call, so drop the lock variorum_enter()
+         * took; close_region_session() pairs the enter with an exit. */
+        variorum_unlock();
+        session.entered = 1;
+        session.exits = g_variorum_exits;
+        if (!registered)
+        {
+            registered = 1;
+            atexit(write_region_profile);
+            atexit(close_region_session);
+        }
+    }
+
+    memset(counters, 0, sizeof(*counters));
+    for (i = 0; i < P_NUM_PLATFORMS; i++)
+    {
+        if (g_platform[i].variorum_get_energy_counters == NULL)
+        {
+            continue;
+        }
+        if (g_platform[i].variorum_get_energy_counters(counters))
+        {
+            ret = -1;
+            break;
+        }
+        found = 1;
+    }
+    variorum_unlock();
+    if (ret)
+    {
+        return -1;
+    }
+    if (!found)
+    {
+        variorum_error_handler("Feature not yet implemented or is not supported",
+                               VARIORUM_ERROR_FEATURE_NOT_IMPLEMENTED,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    return 0;
+}
+
+/* Background sampler publishing counters through a sequence lock, so region
+ * begin and end only copy the latest snapshot. The sampler is the only
+ * writer once started. */
+static void *region_sampler(void *arg)
+{
+    long interval_ms = (long)(intptr_t) arg;
+    struct variorum_energy_counters counters;
+
+    while (!__atomic_load_n(&session.stop, __ATOMIC_RELAXED))
+    {
+        if (read_energy_counters(&counters) == 0)
+        {
+            __atomic_store_n(&session.seq, session.seq + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            session.snapshot = counters;
+            __atomic_store_n(&session.seq, session.seq + 1, __ATOMIC_RELEASE);
+        }
+        sleep_ms(interval_ms);
+    }
+    return NULL;
+}
+
+static void start_region_sampler(void)
+{
+    char *val;
+    long interval_ms;
+
+    val = getenv("VARIORUM_REGION_SAMPLER_MS");
+    if (val == NULL || (interval_ms = atol(val)) <= 0)
+    {
+        return;
+    }
+    /* Publish a first snapshot before anyone reads it. */
+    if (read_energy_counters(&session.snapshot) != 0)
+    {
+        return;
+    }
+    if (pthread_create(&session.thread, NULL, region_sampler,
+                       (void *)(intptr_t) interval_ms) == 0)
+    {
+        __atomic_store_n(&session.sampler, 1, __ATOMIC_RELEASE);
+    }
+}
+
+int variorum_region_read_counters(struct variorum_energy_counters *counters)
+{
+    unsigned seq;
+
+    if (__atomic_load_n(&session.sampler, __ATOMIC_ACQUIRE))
+    {
+        do
+        {
+            seq = __atomic_load_n(&session.seq, __ATOMIC_ACQUIRE);
+            *counters = session.snapshot;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        }
+        while ((seq & 1) || seq != __atomic_load_n(&session.seq, __ATOMIC_RELAXED));
+        return 0;
+    }
+    return read_energy_counters(counters);
+}
+
+int variorum_region_begin(const char *name)
+{
+    struct variorum_energy_counters counters;
+
+    static pthread_once_t sampler_once = PTHREAD_ONCE_INIT;
+
+    if (name == NULL)
+    {
+        return -1;
+    }
+    pthread_once(&sampler_once, start_region_sampler);
+    if (variorum_region_read_counters(&counters))
+    {
+        return -1;
+    }
+    return variorum_region_push(name, region_now(), &counters);
+}
+
+int variorum_region_end(const char *name)
+{
+    struct variorum_energy_counters counters;
+    double now = region_now();
+
+    if (name == NULL || variorum_region_read_counters(&counters))
+    {
+        return -1;
+    }
+    return variorum_region_pop(name, now, &counters);
+}
+
+int variorum_print_region_summary(void)
+{
+    variorum_region_write_summary(stdout);
+    return 0;
+}
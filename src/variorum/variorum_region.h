@@ -0,0 +1,97 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_REGION_H_INCLUDE
+#define VARIORUM_REGION_H_INCLUDE
+
+#include <stdint.h>
+#include <stdio.h>
+
+/// @brief Maximum nesting depth of regions per thread.
+#define VARIORUM_REGION_MAX_DEPTH 64
+
+/// @brief Cumulative energy of the node's domains since an arbitrary origin.
+struct variorum_energy_counters
+{
+    /// @brief Package energy of all sockets (J).
+    double pkg_joules;
+    /// @brief DRAM energy of all sockets (J).
+    double dram_joules;
+    /// @brief Energy of all GPUs (J).
+    double gpu_joules;
+};
+
+/// @brief Accumulated measurements of one named region.
+struct variorum_region_stats
+{
+    /// @brief Region name.
+    char *name;
+    /// @brief Number of completed begin/end pairs.
+    uint64_t calls;
+    /// @brief Total time inside the region (s).
+    double seconds;
+    /// @brief Total energy inside the region. Nested regions are inclusive.
+    struct variorum_energy_counters energy;
+};
+
+/// @brief Open a region on the calling thread.
+///
+/// @param [in] name Region name.
+/// @param [in] now Current time (s).
+/// @param [in] counters Current energy counters.
+///
+/// @return 0 if successful, otherwise -1 (nesting too deep).
+int variorum_region_push(
+    const char *name,
+    double now,
+    const struct variorum_energy_counters *counters
+);
+
+/// @brief Close the innermost region of the calling thread and add its time
+/// and energy to the region's totals.
+///
+/// @param [in] name Region name, must match the innermost open region.
+/// @param [in] now Current time (s).
+/// @param [in] counters Current energy counters.
+///
+/// @return 0 if successful, otherwise -1 (no or another region is open).
+int variorum_region_pop(
+    const char *name,
+    double now,
+    const struct variorum_energy_counters *counters
+);
+
+/// @brief Copy the totals of a region.
+///
+/// @param [in] name Region name.
+/// @param [out] stats Totals; the name points into the table.
+///
+/// @return 0 if the region was seen, otherwise -1.
+int variorum_region_get_stats(
+    const char *name,
+    struct variorum_region_stats *stats
+);
+
+/// @brief Write one line per region with its totals.
+///
+/// @param [in] output Destination stream.
+void variorum_region_write_summary(
+    FILE *output
+);
+
+/// @brief Read the node's cumulative energy counters, from the background
+/// sampler's latest snapshot when VARIORUM_REGION_SAMPLER_MS is set.
+///
+/// @param [out] counters Current energy counters.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_region_read_counters(
+    struct variorum_energy_counters *counters
+);
+
+/// @brief Drop all region totals.
+void variorum_region_reset(void);
+
+#endif
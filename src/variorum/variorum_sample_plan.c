@@ -0,0 +1,140 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <variorum_sample_plan.h>
+
+struct plan_key
+{
+    uint32_t cpu;
+    uint32_t reg;
+    unsigned slot;
+};
+
+static int cmp_plan_key(const void *a, const void *b)
+{
+    const struct plan_key *ka = (const struct plan_key *) a;
+    const struct plan_key *kb = (const struct plan_key *) b;
+
+    if (ka->cpu != kb->cpu)
+    {
+        return ka->cpu < kb->cpu ? -1 : 1;
+    }
+    if (ka->reg != kb->reg)
+    {
+        return ka->reg < kb->reg ? -1 : 1;
+    }
+    /* Keep subscription order stable for equal registers. */
+    return ka->slot < kb->slot ? -1 : (ka->slot > kb->slot);
+}
+
+static int grow(void **arr, unsigned count, size_t size)
+{
+    void *tmp = realloc(*arr, count * size);
+    if (tmp == NULL)
+    {
+        return -1;
+    }
+    *arr = tmp;
+    return 0;
+}
+
+int variorum_sample_plan_add(struct variorum_sample_plan *plan, uint32_t cpu,
+                             uint32_t reg, uint64_t *dest)
+{
+    if (dest == NULL)
+    {
+        return -1;
+    }
+    if (plan->nslots == plan->maxslots)
+    {
+        unsigned maxslots = plan->maxslots ? 2 * plan->maxslots : 64;
+        if (grow((void **) &plan->slot_dest, maxslots, sizeof(uint64_t *)) ||
+                grow((void **) &plan->slot_cpu, maxslots, sizeof(uint32_t)) ||
+                grow((void **) &plan->slot_addr, maxslots, sizeof(uint32_t)) ||
+                grow((void **) &plan->slot_reg, maxslots, sizeof(unsigned)))
+        {
+            return -1;
+        }
+        plan->maxslots = maxslots;
+    }
+    plan->slot_dest[plan->nslots] = dest;
+    plan->slot_cpu[plan->nslots] = cpu;
+    plan->slot_addr[plan->nslots] = reg;
+    plan->nslots++;
+    return 0;
+}
+
+int variorum_sample_plan_compile(struct variorum_sample_plan *plan)
+{
+    struct plan_key *keys;
+    unsigned i;
+
+    free(plan->cpu);
+    free(plan->reg);
+    plan->cpu = NULL;
+    plan->reg = NULL;
+    plan->nregs = 0;
+    if (plan->nslots == 0)
+    {
+        return 0;
+    }
+
+    keys = (struct plan_key *) malloc(plan->nslots * sizeof(struct plan_key));
+    plan->cpu = (uint32_t *) malloc(plan->nslots * sizeof(uint32_t));
+    plan->reg = (uint32_t *) malloc(plan->nslots * sizeof(uint32_t));
+    if (keys == NULL || plan->cpu == NULL || plan->reg == NULL)
+    {
+        free(keys);
+        return -1;
+    }
+    for (i = 0; i < plan->nslots; i++)
+    {
+        keys[i].cpu = plan->slot_cpu[i];
+        keys[i].reg = plan->slot_addr[i];
+        keys[i].slot = i;
+    }
+    qsort(keys, plan->nslots, sizeof(struct plan_key), cmp_plan_key);
+
+    for (i = 0; i < plan->nslots; i++)
+    {
+        if (plan->nregs == 0 || keys[i].cpu != plan->cpu[plan->nregs - 1] ||
+                keys[i].reg != plan->reg[plan->nregs - 1])
+        {
+            plan->cpu[plan->nregs] = keys[i].cpu;
+            plan->reg[plan->nregs] = keys[i].reg;
+            plan->nregs++;
+        }
+        plan->slot_reg[keys[i].slot] = plan->nregs - 1;
+    }
+    free(keys);
+    return (int)plan->nregs;
+}
+
+void variorum_sample_plan_scatter(const struct variorum_sample_plan *plan,
+                                  const void *base, size_t stride)
+{
+    const char *values = (const char *) base;
+    unsigned i;
+
+    for (i = 0; i < plan->nslots; i++)
+    {
+        memcpy(plan->slot_dest[i], values + plan->slot_reg[i] * stride,
+               sizeof(uint64_t));
+    }
+}
+
+void variorum_sample_plan_free(struct variorum_sample_plan *plan)
+{
+    free(plan->cpu);
+    free(plan->reg);
+    free(plan->slot_reg);
+    free(plan->slot_dest);
+    free(plan->slot_cpu);
+    free(plan->slot_addr);
+    memset(plan, 0, sizeof(*plan));
+}
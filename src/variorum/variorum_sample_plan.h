@@ -0,0 +1,79 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_SAMPLE_PLAN_H_INCLUDE
+#define VARIORUM_SAMPLE_PLAN_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Merged list of registers read by one sample.
+///
+/// Consumers subscribe (cpu, register, destination) triples. Compiling the
+/// plan sorts the registers by CPU, then by address, and folds duplicates, so
+/// the whole sample can be issued as a single batch. After the batch
+/// executes, the results are scattered back to every subscribed destination.
+struct variorum_sample_plan
+{
+    /// @brief Number of unique registers after compiling.
+    unsigned nregs;
+    /// @brief CPU of each unique register, sorted.
+    uint32_t *cpu;
+    /// @brief Address of each unique register.
+    uint32_t *reg;
+    /// @brief Number of subscribed destinations.
+    unsigned nslots;
+    /// @brief Capacity of the subscription arrays.
+    unsigned maxslots;
+    /// @brief Unique register backing each destination (valid once compiled).
+    unsigned *slot_reg;
+    /// @brief Destination of each subscription.
+    uint64_t **slot_dest;
+    /// @brief CPU of each subscription.
+    uint32_t *slot_cpu;
+    /// @brief Register address of each subscription.
+    uint32_t *slot_addr;
+};
+
+/// @brief Subscribe a destination to a register.
+///
+/// @param [in] plan Sample plan.
+/// @param [in] cpu Logical CPU the register is read on.
+/// @param [in] reg Register address.
+/// @param [in] dest Where the value is scattered after each sample.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_sample_plan_add(
+    struct variorum_sample_plan *plan,
+    uint32_t cpu,
+    uint32_t reg,
+    uint64_t *dest
+);
+
+/// @brief Sort and deduplicate the subscribed registers.
+///
+/// @return Number of unique registers, otherwise -1.
+int variorum_sample_plan_compile(
+    struct variorum_sample_plan *plan
+);
+
+/// @brief Copy register values to the subscribed destinations.
+///
+/// @param [in] plan Compiled sample plan.
+/// @param [in] base Address of the value of the first unique register.
+/// @param [in] stride Distance in bytes between consecutive values, e.g.,
+///        sizeof(struct msr_batch_op) when scattering out of a batch.
+void variorum_sample_plan_scatter(
+    const struct variorum_sample_plan *plan,
+    const void *base,
+    size_t stride
+);
+
+/// @brief Drop all subscriptions and release the plan.
+void variorum_sample_plan_free(
+    struct variorum_sample_plan *plan
+);
+
+#endif
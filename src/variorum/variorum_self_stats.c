@@ -0,0 +1,61 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <string.h>
+#include <time.h>
+
+#include <variorum_self_stats.h>
+
+__thread struct variorum_self_stats g_self_stats;
+
+/* Tick/wall-clock pair captured on first use, used to convert ticks into
+ * microseconds without a calibration sleep. */
+static __thread uint64_t self_base_ticks = 0;
+static __thread uint64_t self_base_ns = 0;
+
+static uint64_t now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000UL + (uint64_t)t.tv_nsec;
+}
+
+void variorum_self_stats_init(void)
+{
+    if (self_base_ns == 0)
+    {
+        self_base_ns = now_ns();
+        self_base_ticks = variorum_self_ticks();
+    }
+}
+
+int variorum_get_self_stats(struct variorum_self_stats *stats)
+{
+    uint64_t dns;
+
+    if (stats == NULL)
+    {
+        return -1;
+    }
+    variorum_self_stats_init();
+
+    *stats = g_self_stats;
+    dns = now_ns() - self_base_ns;
+    if (dns > 0)
+    {
+        stats->ticks_per_usec = (variorum_self_ticks() - self_base_ticks) /
+                                (dns / 1000.0);
+    }
+    else
+    {
+        stats->ticks_per_usec = 0.0;
+    }
+    return 0;
+}
+
+void variorum_reset_self_stats(void)
+{
+    memset(&g_self_stats, 0, sizeof(g_self_stats));
+}
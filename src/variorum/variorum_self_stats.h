@@ -0,0 +1,73 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_SELF_STATS_H_INCLUDE
+#define VARIORUM_SELF_STATS_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <variorum.h>
+
+/// @brief Per-thread overhead counters of the calling thread. Only the owning
+/// thread updates its copy, so no locking is needed.
+extern __thread struct variorum_self_stats g_self_stats;
+
+/// @brief Read a cheap, monotonically increasing tick counter (TSC on x86,
+/// time base on Power, virtual counter on ARM, nanoseconds elsewhere).
+static inline uint64_t variorum_self_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__powerpc64__)
+    return __builtin_ppc_get_timebase();
+#elif defined(__aarch64__)
+    uint64_t t;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000UL + (uint64_t)t.tv_nsec;
+#endif
+}
+
+/// @brief Account one timed call that started at tick t0 to the given counter
+/// pair (e.g., enter, batch, json_dumps, io).
+#define VARIORUM_SELF_STATS_TIME(name, t0)                          \
+    do                                                              \
+    {                                                               \
+        g_self_stats.name##_calls++;                                \
+        g_self_stats.name##_ticks += variorum_self_ticks() - (t0);  \
+    } while (0)
+
+/// @brief Account one call whose ticks were measured piecewise by the callee
+/// (e.g., the streaming JSON writer) to the given counter pair.
+#define VARIORUM_SELF_STATS_ADD(name, ticks)                        \
+    do                                                              \
+    {                                                               \
+        g_self_stats.name##_calls++;                                \
+        g_self_stats.name##_ticks += (ticks);                       \
+    } while (0)
+
+/// @brief Account n system calls issued by the calling thread.
+#define VARIORUM_SELF_STATS_SYSCALLS(n) (g_self_stats.syscalls += (n))
+
+/// @brief Account bytes written to output by the calling thread.
+#define VARIORUM_SELF_STATS_BYTES(n) (g_self_stats.bytes_written += (n))
+
+/// @brief Account samples dropped by timer catch-up on the calling thread.
+#define VARIORUM_SELF_STATS_DROPPED(n) (g_self_stats.dropped_samples += (n))
+
+/// @brief Record the calibration base (ticks and wall time) for the calling
+/// thread, if not done yet.
+void variorum_self_stats_init(void);
+
+#endif
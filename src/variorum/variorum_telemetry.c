@@ -0,0 +1,328 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <variorum.h>
+#include <variorum_error.h>
+#include <variorum_region.h>
+#include <variorum_telemetry.h>
+#include <variorum_timers.h>
+
+static size_t segment_size(uint32_t history_len)
+{
+    return sizeof(struct variorum_telemetry_segment) +
+           (size_t)history_len * sizeof(struct variorum_telemetry_sample);
+}
+
+/* A segment is stale if its publisher no longer runs. */
+static int segment_is_stale(const char *name)
+{
+    struct variorum_telemetry_segment *segment = variorum_telemetry_attach(name);
+    int stale;
+
+    if (segment == NULL)
+    {
+        return 1;
+    }
+    stale = segment->closed ||
+            (kill(segment->publisher_pid, 0) != 0 && errno == ESRCH);
+    variorum_telemetry_detach(segment);
+    return stale;
+}
+
+int variorum_telemetry_create(const char *name, uint32_t history_len,
+                              uint32_t interval_ms,
+                              struct variorum_telemetry_segment **segment)
+{
+    struct variorum_telemetry_segment *s;
+    size_t size = segment_size(history_len);
+    int fd;
+
+    if (name == NULL || history_len == 0 || segment == NULL)
+    {
+        return -1;
+    }
+    /* Readers need no privileges, only the publisher may write. */
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == EEXIST && segment_is_stale(name))
+    {
+        shm_unlink(name);
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    }
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (ftruncate(fd, size) != 0)
+    {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    s = (struct variorum_telemetry_segment *) mmap(NULL, size,
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (s == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return -1;
+    }
+    s->version = VARIORUM_TELEMETRY_VERSION;
+    s->sample_size = sizeof(struct variorum_telemetry_sample);
+    s->history_len = history_len;
+    s->interval_ms = interval_ms;
+    s->publisher_pid = getpid();
+    /* Readers check the magic before anything else. */
+    __atomic_store_n(&s->magic, VARIORUM_TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+    *segment = s;
+    return 0;
+}
+
+void variorum_telemetry_write(struct variorum_telemetry_segment *segment,
+                              const struct variorum_telemetry_sample *sample)
+{
+    struct variorum_telemetry_sample *slot;
+
+    slot = &segment->history[segment->count % segment->history_len];
+    __atomic_store_n(&segment->seq, segment->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    *slot = *sample;
+    slot->index = segment->count;
+    segment->count++;
+    __atomic_store_n(&segment->seq, segment->seq + 1, __ATOMIC_RELEASE);
+}
+
+void variorum_telemetry_destroy(const char *name,
+                                struct variorum_telemetry_segment *segment)
+{
+    if (segment == NULL)
+    {
+        return;
+    }
+    __atomic_store_n(&segment->closed, 1, __ATOMIC_RELEASE);
+    munmap(segment, segment_size(segment->history_len));
+    shm_unlink(name);
+}
+
+struct variorum_telemetry_segment *variorum_telemetry_attach(const char *name)
+{
+    struct variorum_telemetry_segment *s;
+    struct stat st;
+    int fd;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 ||
+            (size_t)st.st_size < sizeof(struct variorum_telemetry_segment))
+    {
+        close(fd);
+        return NULL;
+    }
+    s = (struct variorum_telemetry_segment *) mmap(NULL, st.st_size, PROT_READ,
+            MAP_SHARED, fd, 0);
+    close(fd);
+    if (s == MAP_FAILED)
+    {
+        return NULL;
+    }
+    if (__atomic_load_n(&s->magic, __ATOMIC_ACQUIRE) != VARIORUM_TELEMETRY_MAGIC ||
+            s->version != VARIORUM_TELEMETRY_VERSION ||
+            s->sample_size != sizeof(struct variorum_telemetry_sample) ||
+            s->history_len == 0 ||
+            segment_size(s->history_len) > (size_t)st.st_size)
+    {
+        munmap(s, st.st_size);
+        return NULL;
+    }
+    return s;
+}
+
+int variorum_telemetry_read(const struct variorum_telemetry_segment *segment,
+                            struct variorum_telemetry_sample *sample)
+{
+    uint64_t count;
+    uint32_t seq;
+
+    do
+    {
+        seq = __atomic_load_n(&segment->seq, __ATOMIC_ACQUIRE);
+        count = segment->count;
+        if (count > 0)
+        {
+            *sample = segment->history[(count - 1) % segment->history_len];
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while ((seq & 1) || seq != __atomic_load_n(&segment->seq, __ATOMIC_RELAXED));
+
+    if (count == 0 || __atomic_load_n(&segment->closed, __ATOMIC_ACQUIRE))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int variorum_telemetry_read_history(const struct variorum_telemetry_segment
+                                    *segment, struct variorum_telemetry_sample *samples, int max_samples)
+{
+    uint64_t count, first, i;
+    uint32_t seq;
+    int n;
+
+    if (max_samples <= 0)
+    {
+        return 0;
+    }
+    do
+    {
+        seq = __atomic_load_n(&segment->seq, __ATOMIC_ACQUIRE);
+        count = segment->count;
+        n = count < segment->history_len ? (int)count : (int)segment->history_len;
+        if (n > max_samples)
+        {
+            n = max_samples;
+        }
+        first = count - n;
+        for (i = 0; i < (uint64_t)n; i++)
+        {
+            samples[i] = segment->history[(first + i) % segment->history_len];
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while ((seq & 1) || seq != __atomic_load_n(&segment->seq, __ATOMIC_RELAXED));
+    return n;
+}
+
+void variorum_telemetry_detach(struct variorum_telemetry_segment *segment)
+{
+    if (segment != NULL)
+    {
+        munmap(segment, segment_size(segment->history_len));
+    }
+}
+
+/* Publisher of this process. */
+static struct
+{
+    pthread_t thread;
+    int running;
+    int stop;
+    long interval_ms;
+    char name[256];
+    struct variorum_telemetry_segment *segment;
+    struct variorum_energy_counters origin;
+} publisher;
+
+static double telemetry_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void *telemetry_publisher(void *arg)
+{
+    struct variorum_telemetry_sample sample, last;
+    struct variorum_energy_counters counters;
+    (void)arg;
+
+    memset(&last, 0, sizeof(last));
+    while (!__atomic_load_n(&publisher.stop, __ATOMIC_ACQUIRE))
+    {
+        if (variorum_region_read_counters(&counters) == 0)
+        {
+            memset(&sample, 0, sizeof(sample));
+            sample.time = telemetry_now();
+            sample.pkg_joules = counters.pkg_joules - publisher.origin.pkg_joules;
+            sample.dram_joules = counters.dram_joules - publisher.origin.dram_joules;
+            sample.gpu_joules = counters.gpu_joules - publisher.origin.gpu_joules;
+            if (publisher.segment->count > 0 && sample.time > last.time)
+            {
+                sample.interval = sample.time - last.time;
+                sample.pkg_watts = (sample.pkg_joules - last.pkg_joules) / sample.interval;
+                sample.dram_watts = (sample.dram_joules - last.dram_joules) /
+                                    sample.interval;
+                sample.gpu_watts = (sample.gpu_joules - last.gpu_joules) / sample.interval;
+            }
+            variorum_telemetry_write(publisher.segment, &sample);
+            last = sample;
+        }
+        sleep_ms(publisher.interval_ms);
+    }
+    return NULL;
+}
+
+int variorum_start_telemetry_publisher(const char *name, int interval_ms,
+                                       int history_len)
+{
+    if (publisher.running)
+    {
+        variorum_error_handler("Telemetry publisher already running",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    if (name == NULL)
+    {
+        name = VARIORUM_TELEMETRY_DEFAULT_NAME;
+    }
+    if (interval_ms <= 0 || history_len <= 0 ||
+            strlen(name) >= sizeof(publisher.name))
+    {
+        variorum_error_handler("Invalid telemetry publisher arguments",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    if (variorum_region_read_counters(&publisher.origin))
+    {
+        return -1;
+    }
+    if (variorum_telemetry_create(name, history_len, interval_ms,
+                                  &publisher.segment))
+    {
+        variorum_error_handler("Could not create telemetry segment",
+                               VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                               __FILE__, __FUNCTION__, __LINE__);
+        return -1;
+    }
+    strcpy(publisher.name, name);
+    publisher.interval_ms = interval_ms;
+    publisher.stop = 0;
+    if (pthread_create(&publisher.thread, NULL, telemetry_publisher, NULL) != 0)
+    {
+        variorum_telemetry_destroy(publisher.name, publisher.segment);
+        return -1;
+    }
+    publisher.running = 1;
+    return 0;
+}
+
+int variorum_stop_telemetry_publisher(void)
+{
+    if (!publisher.running)
+    {
+        return -1;
+    }
+    __atomic_store_n(&publisher.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(publisher.thread, NULL);
+    variorum_telemetry_destroy(publisher.name, publisher.segment);
+    publisher.segment = NULL;
+    publisher.running = 0;
+    return 0;
+}
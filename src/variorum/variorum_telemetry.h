@@ -0,0 +1,149 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_TELEMETRY_H_INCLUDE
+#define VARIORUM_TELEMETRY_H_INCLUDE
+
+#include <stdint.h>
+
+/// @brief First word of a telemetry segment ("VTLM").
+#define VARIORUM_TELEMETRY_MAGIC 0x4d4c5456
+/// @brief Layout version of the segment. Readers refuse other versions.
+#define VARIORUM_TELEMETRY_VERSION 1
+/// @brief POSIX shared memory name used when none is given.
+#define VARIORUM_TELEMETRY_DEFAULT_NAME "/variorum-telemetry"
+
+/// @brief One published node sample.
+struct variorum_telemetry_sample
+{
+    /// @brief Sample number, starting at 0.
+    uint64_t index;
+    /// @brief CLOCK_MONOTONIC time of the sample (s).
+    double time;
+    /// @brief Time since the previous sample (s), 0 for the first one.
+    double interval;
+    /// @brief Package energy of all sockets since the publisher started (J).
+    double pkg_joules;
+    /// @brief DRAM energy of all sockets since the publisher started (J).
+    double dram_joules;
+    /// @brief Energy of all GPUs since the publisher started (J).
+    double gpu_joules;
+    /// @brief Package power over the last interval (W).
+    double pkg_watts;
+    /// @brief DRAM power over the last interval (W).
+    double dram_watts;
+    /// @brief GPU power over the last interval (W).
+    double gpu_watts;
+};
+
+/// @brief Shared memory segment of a publisher, followed by the history
+/// ring.
+///
+/// @note The publisher increments seq before and after updating the ring,
+/// so it is odd while a write is in progress. Readers copy what they need
+/// and retry if seq was odd or changed meanwhile.
+struct variorum_telemetry_segment
+{
+    /// @brief VARIORUM_TELEMETRY_MAGIC once the header is complete.
+    uint32_t magic;
+    /// @brief VARIORUM_TELEMETRY_VERSION of the publisher.
+    uint32_t version;
+    /// @brief sizeof(struct variorum_telemetry_sample) of the publisher.
+    uint32_t sample_size;
+    /// @brief Number of samples in the ring.
+    uint32_t history_len;
+    /// @brief Sampling interval of the publisher (ms).
+    uint32_t interval_ms;
+    /// @brief Process ID of the publisher.
+    int32_t publisher_pid;
+    /// @brief Set when the publisher has stopped.
+    uint32_t closed;
+    /// @brief Sequence lock of the ring and count.
+    uint32_t seq;
+    /// @brief Number of samples published; the latest is at
+    /// (count - 1) % history_len.
+    uint64_t count;
+    /// @brief Ring of the latest history_len samples.
+    struct variorum_telemetry_sample history[];
+};
+
+/// @brief Create a segment, replacing one left behind by a publisher that
+/// no longer runs.
+///
+/// @param [in] name POSIX shared memory name, e.g., "/variorum-telemetry".
+/// @param [in] history_len Number of samples kept in the ring.
+/// @param [in] interval_ms Sampling interval advertised to readers (ms).
+/// @param [out] segment Mapped segment.
+///
+/// @return 0 if successful, otherwise -1 (e.g., another publisher runs).
+int variorum_telemetry_create(
+    const char *name,
+    uint32_t history_len,
+    uint32_t interval_ms,
+    struct variorum_telemetry_segment **segment
+);
+
+/// @brief Publish a sample. There must be a single writer.
+///
+/// @param [in] segment Segment from variorum_telemetry_create().
+/// @param [in] sample Sample to publish; its index is set from the count.
+void variorum_telemetry_write(
+    struct variorum_telemetry_segment *segment,
+    const struct variorum_telemetry_sample *sample
+);
+
+/// @brief Mark a segment closed, unmap and remove it.
+///
+/// @param [in] name Name the segment was created with.
+/// @param [in] segment Segment from variorum_telemetry_create().
+void variorum_telemetry_destroy(
+    const char *name,
+    struct variorum_telemetry_segment *segment
+);
+
+/// @brief Map a segment read-only. Requires no privileges.
+///
+/// @param [in] name POSIX shared memory name.
+///
+/// @return The segment, or NULL if it does not exist or has another
+/// layout version.
+struct variorum_telemetry_segment *variorum_telemetry_attach(
+    const char *name
+);
+
+/// @brief Copy the latest sample without system calls.
+///
+/// @param [in] segment Segment from variorum_telemetry_attach().
+/// @param [out] sample Latest sample.
+///
+/// @return 0 if successful, otherwise -1 (nothing published yet or the
+/// publisher stopped).
+int variorum_telemetry_read(
+    const struct variorum_telemetry_segment *segment,
+    struct variorum_telemetry_sample *sample
+);
+
+/// @brief Copy the samples in the ring, oldest first.
+///
+/// @param [in] segment Segment from variorum_telemetry_attach().
+/// @param [out] samples Destination of up to max_samples samples.
+/// @param [in] max_samples Capacity of samples.
+///
+/// @return Number of samples copied, the newest ones if the ring holds
+/// more than max_samples.
+int variorum_telemetry_read_history(
+    const struct variorum_telemetry_segment *segment,
+    struct variorum_telemetry_sample *samples,
+    int max_samples
+);
+
+/// @brief Unmap a segment from variorum_telemetry_attach().
+///
+/// @param [in] segment Segment to unmap.
+void variorum_telemetry_detach(
+    struct variorum_telemetry_segment *segment
+);
+
+#endif
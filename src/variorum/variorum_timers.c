@@ -6,6 +6,7 @@
 #include <sys/time.h>
 #include <time.h>
 
+#include <variorum_self_stats.h>
 #include <variorum_timers.h>
 
 unsigned long now_ms(void)
@@ -29,6 +30,8 @@ int timer_sleep(struct mstimer *t)
             t->step++;
             t->nextms = t->startms + t->step * t->interval;
         }
+        /* All but the sample taken now are lost to the catch-up. */
+        VARIORUM_SELF_STATS_DROPPED(cadd - 1);
         /* We slept this many intervals. */
         return cadd;
     }
@@ -51,5 +54,6 @@ void sleep_ms(long ms)
     struct timeval i;
     i.tv_sec = ms / 1000;
     i.tv_usec = (ms % 1000) * 1000;
+    VARIORUM_SELF_STATS_SYSCALLS(1);
     select(0, NULL, NULL, NULL, &i);
 }
@@ -0,0 +1,74 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <string.h>
+
+#include <variorum_timing_wheel.h>
+
+static unsigned long gcd(unsigned long a, unsigned long b)
+{
+    while (b != 0)
+    {
+        unsigned long r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+int variorum_timing_wheel_init(struct variorum_timing_wheel *wheel,
+                               const unsigned long *period_ms, unsigned nmetrics)
+{
+    unsigned i;
+
+    memset(wheel, 0, sizeof(*wheel));
+    if (nmetrics == 0 || nmetrics > VARIORUM_TIMING_WHEEL_MAX_METRICS)
+    {
+        return -1;
+    }
+    for (i = 0; i < nmetrics; i++)
+    {
+        if (period_ms[i] == 0)
+        {
+            return -1;
+        }
+        wheel->tick_ms = gcd(period_ms[i], wheel->tick_ms);
+    }
+    wheel->nmetrics = nmetrics;
+    for (i = 0; i < nmetrics; i++)
+    {
+        wheel->period[i] = period_ms[i] / wheel->tick_ms;
+        wheel->due[i] = 0;
+        wheel->slot[0] |= (uint32_t)1 << i;
+    }
+    return 0;
+}
+
+uint32_t variorum_timing_wheel_advance(struct variorum_timing_wheel *wheel)
+{
+    unsigned s = wheel->now % VARIORUM_TIMING_WHEEL_SLOTS;
+    uint32_t pending = wheel->slot[s];
+    uint32_t fired = 0;
+    unsigned i;
+
+    for (i = 0; pending != 0; i++, pending >>= 1)
+    {
+        unsigned next;
+
+        /* Periods longer than the wheel wrap around; those metrics stay in
+         * the slot until a later revolution. */
+        if (!(pending & 1) || wheel->due[i] != wheel->now)
+        {
+            continue;
+        }
+        fired |= (uint32_t)1 << i;
+        wheel->due[i] += wheel->period[i];
+        next = wheel->due[i] % VARIORUM_TIMING_WHEEL_SLOTS;
+        wheel->slot[s] &= ~((uint32_t)1 << i);
+        wheel->slot[next] |= (uint32_t)1 << i;
+    }
+    wheel->now++;
+    return fired;
+}
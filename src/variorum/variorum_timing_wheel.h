@@ -0,0 +1,64 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_TIMING_WHEEL_H_INCLUDE
+#define VARIORUM_TIMING_WHEEL_H_INCLUDE
+
+#include <stdint.h>
+
+/// @brief Maximum number of metrics scheduled on one wheel.
+#define VARIORUM_TIMING_WHEEL_MAX_METRICS 32
+
+/// @brief Number of slots of the wheel.
+#define VARIORUM_TIMING_WHEEL_SLOTS 64
+
+/// @brief Multi-rate schedule of metrics sharing one sampling thread.
+///
+/// Every metric has its own period. All periods are multiples of a common
+/// tick, the greatest common divisor of the periods. Metrics are hashed into
+/// the slot of their next deadline, so advancing the wheel by one tick only
+/// visits the metrics of the current slot instead of every metric.
+struct variorum_timing_wheel
+{
+    /// @brief Length of one tick (ms).
+    unsigned long tick_ms;
+    /// @brief Number of scheduled metrics.
+    unsigned nmetrics;
+    /// @brief Current tick.
+    unsigned long now;
+    /// @brief Period of each metric, in ticks.
+    unsigned long period[VARIORUM_TIMING_WHEEL_MAX_METRICS];
+    /// @brief Next tick each metric is due.
+    unsigned long due[VARIORUM_TIMING_WHEEL_MAX_METRICS];
+    /// @brief Metrics (bit per metric) whose deadline hashes to each slot.
+    uint32_t slot[VARIORUM_TIMING_WHEEL_SLOTS];
+};
+
+/// @brief Build the wheel for a set of periods.
+///
+/// All metrics are due on the first tick.
+///
+/// @param [out] wheel Timing wheel.
+/// @param [in] period_ms Period of each metric (ms), all nonzero.
+/// @param [in] nmetrics Number of metrics, at most
+///        VARIORUM_TIMING_WHEEL_MAX_METRICS.
+///
+/// @return 0 if successful, otherwise -1.
+int variorum_timing_wheel_init(
+    struct variorum_timing_wheel *wheel,
+    const unsigned long *period_ms,
+    unsigned nmetrics
+);
+
+/// @brief Metrics due on the current tick, then move to the next tick.
+///
+/// @param [in,out] wheel Timing wheel.
+///
+/// @return Bit mask of the due metrics (bit i for metric i), 0 if none.
+uint32_t variorum_timing_wheel_advance(
+    struct variorum_timing_wheel *wheel
+);
+
+#endif
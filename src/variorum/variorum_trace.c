@@ -0,0 +1,419 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ZSTD_FOUND
+#include <zstd.h>
+#endif
+
+#include <variorum.h>
+#include <variorum_error.h>
+#include <variorum_self_stats.h>
+#include <variorum_trace.h>
+
+#define VARIORUM_TRACE_VERSION 1
+
+static int g_monitoring_format = VARIORUM_MONITORING_TEXT;
+static struct variorum_trace *g_active_trace = NULL;
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static int reserve(struct variorum_trace *t, size_t n)
+{
+    if (t->block_len + n > t->block_cap)
+    {
+        size_t cap = t->block_cap ? 2 * t->block_cap : 4096;
+        uint8_t *b;
+        while (cap < t->block_len + n)
+        {
+            cap *= 2;
+        }
+        b = realloc(t->block, cap);
+        if (b == NULL)
+        {
+            return -1;
+        }
+        t->block = b;
+        t->block_cap = cap;
+    }
+    return 0;
+}
+
+static void put_varint(struct variorum_trace *t, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        t->block[t->block_len++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    t->block[t->block_len++] = (uint8_t)v;
+}
+
+static int get_varint(struct variorum_trace_reader *r, uint64_t *v)
+{
+    uint64_t res = 0;
+    int shift = 0;
+
+    while (r->pos < r->block_len && shift < 64)
+    {
+        uint8_t b = r->block[r->pos++];
+        res |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            *v = res;
+            return 0;
+        }
+        shift += 7;
+    }
+    return -1;
+}
+
+static void reset_state(int64_t *prev, unsigned ncols, int64_t *prev_ts,
+                        int64_t *prev_ts_delta)
+{
+    memset(prev, 0, ncols * sizeof(int64_t));
+    *prev_ts = 0;
+    *prev_ts_delta = 0;
+}
+
+int variorum_trace_open(struct variorum_trace *t, FILE *out, unsigned ncols,
+                        const char *const *names, const unsigned *decimals,
+                        unsigned block_rows, int zstd_level)
+{
+    uint32_t hdr[4];
+    uint32_t len, dec;
+    size_t nbytes = 8 + sizeof(hdr);
+    unsigned i;
+
+    memset(t, 0, sizeof(*t));
+#ifndef ZSTD_FOUND
+    if (zstd_level > 0)
+    {
+        variorum_error_handler("Variorum was built without zstd support",
+                               VARIORUM_ERROR_FEATURE_NOT_AVAILABLE,
+                               getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                               __LINE__);
+        return -1;
+    }
+#endif
+    t->out = out;
+    t->ncols = ncols;
+    t->block_rows = block_rows ? block_rows : VARIORUM_TRACE_BLOCK_ROWS;
+    t->zstd_level = zstd_level;
+    t->prev = calloc(ncols, sizeof(int64_t));
+    if (t->prev == NULL)
+    {
+        return -1;
+    }
+
+    hdr[0] = VARIORUM_TRACE_VERSION;
+    hdr[1] = ncols;
+    hdr[2] = t->block_rows;
+    hdr[3] = 0;
+    if (fwrite(VARIORUM_TRACE_MAGIC, 1, 8, out) != 8 ||
+            fwrite(hdr, sizeof(hdr), 1, out) != 1)
+    {
+        return -1;
+    }
+    for (i = 0; i < ncols; i++)
+    {
+        len = (uint32_t)strlen(names[i]);
+        dec = decimals != NULL ? decimals[i] : 0;
+        if (fwrite(&len, sizeof(len), 1, out) != 1 ||
+                fwrite(names[i], 1, len, out) != len ||
+                fwrite(&dec, sizeof(dec), 1, out) != 1)
+        {
+            return -1;
+        }
+        nbytes += 2 * sizeof(uint32_t) + len;
+    }
+    fflush(out);
+    VARIORUM_SELF_STATS_BYTES(nbytes);
+    return 0;
+}
+
+int variorum_trace_append(struct variorum_trace *t, int64_t timestamp,
+                          const int64_t *values)
+{
+    int64_t delta;
+    unsigned i;
+
+    /* Worst case of 10 bytes per varint. */
+    if (reserve(t, 10 * (size_t)(t->ncols + 1)))
+    {
+        return -1;
+    }
+    if (t->nrows == 0)
+    {
+        reset_state(t->prev, t->ncols, &t->prev_ts, &t->prev_ts_delta);
+        t->first_ts = timestamp;
+    }
+
+    delta = timestamp - t->prev_ts;
+    put_varint(t, zigzag(delta - t->prev_ts_delta));
+    t->prev_ts_delta = delta;
+    t->prev_ts = timestamp;
+
+    for (i = 0; i < t->ncols; i++)
+    {
+        put_varint(t, zigzag(values[i] - t->prev[i]));
+        t->prev[i] = values[i];
+    }
+
+    t->nrows++;
+    if (t->nrows == t->block_rows)
+    {
+        return variorum_trace_flush(t);
+    }
+    return 0;
+}
+
+int variorum_trace_flush(struct variorum_trace *t)
+{
+    uint64_t t0 = variorum_self_ticks();
+    uint32_t hdr[6];
+    int64_t first_ts = t->first_ts;
+    const void *payload = t->block;
+    size_t stored_len = t->block_len;
+    void *zbuf = NULL;
+
+    if (t->nrows == 0)
+    {
+        return 0;
+    }
+
+    hdr[1] = 0;
+#ifdef ZSTD_FOUND
+    if (t->zstd_level > 0)
+    {
+        size_t bound = ZSTD_compressBound(t->block_len);
+        zbuf = malloc(bound);
+        if (zbuf != NULL)
+        {
+            size_t z = ZSTD_compress(zbuf, bound, t->block, t->block_len,
+                                     t->zstd_level);
+            if (!ZSTD_isError(z) && z < t->block_len)
+            {
+                payload = zbuf;
+                stored_len = z;
+                hdr[1] = VARIORUM_TRACE_ZSTD;
+            }
+        }
+    }
+#endif
+    hdr[0] = VARIORUM_TRACE_BLOCK_MAGIC;
+    hdr[2] = t->nrows;
+    hdr[3] = (uint32_t)t->block_len;
+    hdr[4] = (uint32_t)stored_len;
+    hdr[5] = 0;
+
+    if (fwrite(hdr, sizeof(hdr), 1, t->out) != 1 ||
+            fwrite(&first_ts, sizeof(first_ts), 1, t->out) != 1 ||
+            fwrite(payload, 1, stored_len, t->out) != stored_len)
+    {
+        free(zbuf);
+        return -1;
+    }
+    /* Make the complete block visible to readers of a live trace. */
+    fflush(t->out);
+    free(zbuf);
+
+    VARIORUM_SELF_STATS_TIME(io, t0);
+    VARIORUM_SELF_STATS_BYTES(sizeof(hdr) + sizeof(first_ts) + stored_len);
+    t->nrows = 0;
+    t->block_len = 0;
+    return 0;
+}
+
+int variorum_trace_close(struct variorum_trace *t)
+{
+    int rc = variorum_trace_flush(t);
+
+    if (g_active_trace == t)
+    {
+        g_active_trace = NULL;
+    }
+    free(t->prev);
+    free(t->block);
+    t->prev = NULL;
+    t->block = NULL;
+    return rc;
+}
+
+int variorum_trace_reader_open(struct variorum_trace_reader *r, FILE *in)
+{
+    char magic[8];
+    uint32_t hdr[4];
+    uint32_t len, dec;
+    unsigned i;
+
+    memset(r, 0, sizeof(*r));
+    r->in = in;
+    if (fread(magic, 1, 8, in) != 8 ||
+            memcmp(magic, VARIORUM_TRACE_MAGIC, 8) != 0 ||
+            fread(hdr, sizeof(hdr), 1, in) != 1)
+    {
+        return -1;
+    }
+    r->ncols = hdr[1];
+    for (i = 0; i < r->ncols; i++)
+    {
+        if (fread(&len, sizeof(len), 1, in) != 1 ||
+                fseek(in, len, SEEK_CUR) != 0 ||
+                fread(&dec, sizeof(dec), 1, in) != 1)
+        {
+            return -1;
+        }
+    }
+    r->prev = calloc(r->ncols ? r->ncols : 1, sizeof(int64_t));
+    return r->prev == NULL ? -1 : 0;
+}
+
+static int read_block(struct variorum_trace_reader *r)
+{
+    uint32_t hdr[6];
+    int64_t first_ts;
+    uint8_t *stored;
+
+    if (fread(hdr, sizeof(hdr), 1, r->in) != 1)
+    {
+        return 0;
+    }
+    if (hdr[0] != VARIORUM_TRACE_BLOCK_MAGIC ||
+            fread(&first_ts, sizeof(first_ts), 1, r->in) != 1)
+    {
+        return -1;
+    }
+    free(r->block);
+    r->block = malloc(hdr[3] ? hdr[3] : 1);
+    stored = (hdr[1] & VARIORUM_TRACE_ZSTD) ? malloc(hdr[4] ? hdr[4] : 1) :
+             r->block;
+    if (r->block == NULL || stored == NULL ||
+            fread(stored, 1, hdr[4], r->in) != hdr[4])
+    {
+        if (stored != r->block)
+        {
+            free(stored);
+        }
+        return -1;
+    }
+    if (hdr[1] & VARIORUM_TRACE_ZSTD)
+    {
+#ifdef ZSTD_FOUND
+        size_t z = ZSTD_decompress(r->block, hdr[3], stored, hdr[4]);
+        free(stored);
+        if (ZSTD_isError(z) || z != hdr[3])
+        {
+            return -1;
+        }
+#else
+        free(stored);
+        return -1;
+#endif
+    }
+    r->block_len = hdr[3];
+    r->pos = 0;
+    r->rows_left = hdr[2];
+    reset_state(r->prev, r->ncols, &r->prev_ts, &r->prev_ts_delta);
+    return 1;
+}
+
+int variorum_trace_read(struct variorum_trace_reader *r, int64_t *timestamp,
+                        int64_t *values)
+{
+    uint64_t v;
+    unsigned i;
+    int rc;
+
+    while (r->rows_left == 0)
+    {
+        rc = read_block(r);
+        if (rc <= 0)
+        {
+            return rc;
+        }
+    }
+    if (get_varint(r, &v))
+    {
+        return -1;
+    }
+    r->prev_ts_delta += unzigzag(v);
+    r->prev_ts += r->prev_ts_delta;
+    *timestamp = r->prev_ts;
+    for (i = 0; i < r->ncols; i++)
+    {
+        if (get_varint(r, &v))
+        {
+            return -1;
+        }
+        r->prev[i] += unzigzag(v);
+        values[i] = r->prev[i];
+    }
+    r->rows_left--;
+    return 1;
+}
+
+void variorum_trace_reader_close(struct variorum_trace_reader *r)
+{
+    free(r->prev);
+    free(r->block);
+    r->prev = NULL;
+    r->block = NULL;
+}
+
+int variorum_trace_format(void)
+{
+    return g_monitoring_format;
+}
+
+void variorum_trace_set_active(struct variorum_trace *t)
+{
+    g_active_trace = t;
+}
+
+int variorum_set_monitoring_format(int format)
+{
+    switch (format)
+    {
+        case VARIORUM_MONITORING_TEXT:
+        case VARIORUM_MONITORING_ENCODED:
+            break;
+        case VARIORUM_MONITORING_ENCODED_ZSTD:
+#ifndef ZSTD_FOUND
+            variorum_error_handler("Variorum was built without zstd support",
+                                   VARIORUM_ERROR_FEATURE_NOT_AVAILABLE,
+                                   getenv("HOSTNAME"), __FILE__, __FUNCTION__,
+                                   __LINE__);
+            return -1;
+#endif
+            break;
+        default:
+            variorum_error_handler("Invalid monitoring format",
+                                   VARIORUM_ERROR_INVAL, getenv("HOSTNAME"),
+                                   __FILE__, __FUNCTION__, __LINE__);
+            return -1;
+    }
+    g_monitoring_format = format;
+    return 0;
+}
+
+int variorum_monitoring_flush(void)
+{
+    if (g_active_trace == NULL)
+    {
+        return 0;
+    }
+    return variorum_trace_flush(g_active_trace);
+}
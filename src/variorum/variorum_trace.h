@@ -0,0 +1,143 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#ifndef VARIORUM_TRACE_H_INCLUDE
+#define VARIORUM_TRACE_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/// @brief Magic bytes at the start of an encoded trace file.
+#define VARIORUM_TRACE_MAGIC "VARTRC01"
+
+/// @brief Magic number at the start of each block ("VBLK").
+#define VARIORUM_TRACE_BLOCK_MAGIC 0x4b4c4256U
+
+/// @brief Block flag set when the payload is zstd-compressed.
+#define VARIORUM_TRACE_ZSTD 0x1U
+
+/// @brief Default number of samples per block.
+#define VARIORUM_TRACE_BLOCK_ROWS 64
+
+/// @brief Encoded trace writer for integer sample streams.
+///
+/// Each sample is a timestamp plus ncols signed 64-bit values. Timestamps
+/// are stored as delta-of-delta and values as per-column deltas, both
+/// zigzag/varint encoded. Samples are grouped into blocks; the encoder state
+/// is reset at every block so each block decodes on its own.
+///
+/// File layout (native byte order):
+///   header: magic[8], u32 version, u32 ncols, u32 block_rows, u32 reserved,
+///           ncols x { u32 name_len, name, u32 decimals }
+///   blocks: u32 magic, u32 flags, u32 nrows, u32 raw_len, u32 stored_len,
+///           u32 reserved, i64 first_timestamp, payload[stored_len]
+/// A column with decimals d holds values scaled by 10^d.
+struct variorum_trace
+{
+    /// @brief Destination file.
+    FILE *out;
+    /// @brief Number of value columns (excluding the timestamp).
+    unsigned ncols;
+    /// @brief Samples per block.
+    unsigned block_rows;
+    /// @brief Samples in the current block.
+    unsigned nrows;
+    /// @brief zstd compression level, 0 for uncompressed blocks.
+    int zstd_level;
+    /// @brief Previous values per column in the current block.
+    int64_t *prev;
+    /// @brief Previous timestamp and timestamp delta in the current block.
+    int64_t prev_ts;
+    int64_t prev_ts_delta;
+    /// @brief First timestamp of the current block.
+    int64_t first_ts;
+    /// @brief Encoded payload of the current block.
+    uint8_t *block;
+    size_t block_len;
+    size_t block_cap;
+};
+
+/// @brief Start an encoded trace on an open file and write its header.
+///
+/// @param [in] decimals Per-column number of decimal digits kept when
+/// values are scaled to integers (may be NULL for all zero).
+int variorum_trace_open(
+    struct variorum_trace *t,
+    FILE *out,
+    unsigned ncols,
+    const char *const *names,
+    const unsigned *decimals,
+    unsigned block_rows,
+    int zstd_level
+);
+
+/// @brief Append one sample. The block is written out once it is full.
+int variorum_trace_append(
+    struct variorum_trace *t,
+    int64_t timestamp,
+    const int64_t *values
+);
+
+/// @brief Write out the current (possibly partial) block.
+int variorum_trace_flush(
+    struct variorum_trace *t
+);
+
+/// @brief Flush and release the writer. The file is not closed.
+int variorum_trace_close(
+    struct variorum_trace *t
+);
+
+/// @brief Encoded trace reader.
+struct variorum_trace_reader
+{
+    /// @brief Source file.
+    FILE *in;
+    /// @brief Number of value columns.
+    unsigned ncols;
+    /// @brief Decoded payload of the current block.
+    uint8_t *block;
+    size_t block_len;
+    size_t pos;
+    /// @brief Samples left in the current block.
+    unsigned rows_left;
+    /// @brief Decoder state.
+    int64_t *prev;
+    int64_t prev_ts;
+    int64_t prev_ts_delta;
+};
+
+/// @brief Open a trace for reading and skip its header.
+int variorum_trace_reader_open(
+    struct variorum_trace_reader *r,
+    FILE *in
+);
+
+/// @brief Decode the next sample.
+///
+/// @return 1 if a sample was decoded, 0 at end of trace, -1 on error.
+int variorum_trace_read(
+    struct variorum_trace_reader *r,
+    int64_t *timestamp,
+    int64_t *values
+);
+
+/// @brief Release the reader. The file is not closed.
+void variorum_trace_reader_close(
+    struct variorum_trace_reader *r
+);
+
+/// @brief Output format selected with variorum_set_monitoring_format().
+int variorum_trace_format(
+    void
+);
+
+/// @brief Register the trace that variorum_monitoring_flush() acts on.
+void variorum_trace_set_active(
+    struct variorum_trace *t
+);
+
+#endif
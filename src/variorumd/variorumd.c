@@ -0,0 +1,104 @@
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// Variorum Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: MIT
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <variorum.h>
+#include <variorum_daemon.h>
+
+static volatile int stop = 0;
+
+static void handle_signal(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+/* Parse "min:max" watt bounds. */
+static int parse_bounds(const char *arg, int *min, int *max)
+{
+    return sscanf(arg, "%d:%d", min, max) == 2 && *min > 0 && *max >= *min ? 0 :
+           -1;
+}
+
+int main(int argc, char **argv)
+{
+    struct variorum_daemon_config config;
+    struct sigaction sa;
+    char *uid, *list;
+    int opt;
+
+    const char *usage =
+        "Usage: %s [-h] [-v] [-s socket] [-w window_us] [-u uid[,uid...]]\n"
+        "          [-n min:max] [-p min:max]\n"
+        "  -s  UNIX socket to listen on (default: "
+        VARIORUM_DAEMON_DEFAULT_SOCKET ")\n"
+        "  -w  coalesce power requests arriving within this window (default: 1000)\n"
+        "  -u  UIDs besides root allowed to write power caps\n"
+        "  -n  allowed node power limits in watts\n"
+        "  -p  allowed socket power limits in watts\n";
+
+    variorum_daemon_default_config(&config);
+    while ((opt = getopt(argc, argv, "hvs:w:u:n:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                printf(usage, argv[0]);
+                return 0;
+            case 'v':
+                printf("%s\n", variorum_get_current_version());
+                return 0;
+            case 's':
+                config.socket_path = optarg;
+                break;
+            case 'w':
+                config.coalesce_us = atol(optarg);
+                break;
+            case 'u':
+                list = optarg;
+                for (uid = strtok(list, ","); uid != NULL; uid = strtok(NULL, ","))
+                {
+                    if (config.policy.num_cap_uids == VARIORUM_DAEMON_MAX_UIDS)
+                    {
+                        fprintf(stderr, "Too many UIDs\n");
+                        return -1;
+                    }
+                    config.policy.cap_uids[config.policy.num_cap_uids++] = atoi(uid);
+                }
+                break;
+            case 'n':
+                if (parse_bounds(optarg, &config.policy.min_node_watts,
+                                 &config.policy.max_node_watts))
+                {
+                    fprintf(stderr, usage, argv[0]);
+                    return -1;
+                }
+                break;
+            case 'p':
+                if (parse_bounds(optarg, &config.policy.min_socket_watts,
+                                 &config.policy.max_socket_watts))
+                {
+                    fprintf(stderr, usage, argv[0]);
+                    return -1;
+                }
+                break;
+            default:
+                fprintf(stderr, usage, argv[0]);
+                return -1;
+        }
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    return variorum_daemon_serve(&config, NULL, &stop);
+}